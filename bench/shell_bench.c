@@ -0,0 +1,867 @@
+/**
+ * @brief Benchmark of the shell on a host build (POSIX port).
+ *
+ * Measures the command path and the ttys path, and prints the results as one
+ * JSON document, to track regressions from release to release:
+ * - cmd_execute: commands per second, with a client of 10, 100 and 1000
+ *   commands (first and last command), through each dispatch path: a command
+ *   name found through the hash index, a subcommand name found by a linear
+ *   search, and an abbreviated command name found through the trie (if the
+ *   name fits in it). Also for the dio module's "set" command.
+ * - cmd_tokenize: cost per line, for 1, 4 and 10 tokens.
+ * - cmd_parse_args: cost per format.
+ * - cmd_parse_schema: cost of argument schemas equivalent to some of the
+ *   formats.
+ * - num_parse: cost of the num module conversions, and of the C library
+ *   functions they replace, for the same strings.
+ * - ttys_write / printf: bytes per second through the TX buffer.
+ * - ttys_byte: cost per byte of a block written by ttys_putc() calls, and by
+ *   one ttys_write() call, for 16 and 256 byte blocks.
+ * - ring: bytes per second through a ring (ring_write() and ring_read()), the
+ *   copies of the ttys buffers without the ttys locking and port calls.
+ * - log: cost of a log_info() call with three arguments, and of its output by
+ *   log_drain() (none in LOG_MODE_DIRECT, where the call formats it).
+ * - tmr: cost of reading the monotonic clock, in cycles and in microseconds.
+ * - console_latency: time from the end of line being in the RX buffer to
+ *   console_run() returning with the command executed and its response
+ *   queued (percentiles), with the same client sizes.
+ *
+ * The ttys instance runs on the "none" device (the output is discarded), so
+ * only the shell's own code is measured. The input lines are put straight in
+ * the RX buffer, as the UART interrupt handler would.
+ *
+ * Build (from the repository root) and run:
+ *
+ *     gcc -O2 -DSHELL_PORT_POSIX -DCMD_HASH_SIZE=2048 -Ishell/include \
+ *         -Iexample -Iexample/posix shell/[a-z]*.c shell/port/[a-z]*.c \
+ *         example/dio.c bench/shell_bench.c -o shell_bench
+ *     ./shell_bench [-t <ms-per-test>] [-o <file>] > results.json
+ *
+ * The command name hash index must hold the largest table
+ * (CMD_HASH_SIZE=2048). The default trie only holds the first names of the
+ * larger tables; the trie path of their last command is measured with
+ * -DCMD_TRIE_SIZE=4096.
+ *
+ * tools/bench_compare.py compares two result files.
+ */
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "shell.h"
+#include "ttys_port.h"
+#include "dio.h"
+
+//=============================================================================
+//                         Preprocessor Constants
+//=============================================================================
+#define BENCH_INSTANCE TTYS_INSTANCE_UART1
+
+// Default minimum duration of a measurement (ms)
+#define BENCH_DEFAULT_MS 200
+
+// Number of console latency samples
+#define BENCH_LATENCY_SAMPLES 20000
+
+// Largest command table
+#define BENCH_MAX_CMDS 1000
+
+// Command line buffer size (as the console's)
+#define BENCH_LINE_SIZE 80
+
+// Size of the ring of the ring measurement
+#define BENCH_RING_SIZE 512
+
+// Log calls between two log_drain() calls (must fit in LOG_BUF_SIZE)
+#define BENCH_LOG_BATCH 16
+
+#if CMD_HASH_SIZE < 2 * BENCH_MAX_CMDS
+#error "Build with -DCMD_HASH_SIZE=2048"
+#endif
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+/**
+ * A measured operation. It is called with its argument, n times in a row.
+ */
+typedef void (*bench_func)(void* arg, uint32_t n);
+
+/**
+ * A command dispatch path, and the command lines that take it
+ */
+struct bench_dispatch_path {
+    const char* name;
+    const char* fmt;    // Format of the line, with the command number
+};
+
+/**
+ * Arguments of a cmd_parse_args() measurement
+ */
+struct bench_parse_case {
+    const char* fmt;
+    const char* args[4];
+    int32_t argc;
+};
+
+/**
+ * Arguments of a cmd_parse_schema() measurement, with the equivalent format
+ */
+struct bench_schema_case {
+    const char* fmt;
+    const struct cmd_args_schema* schema;
+    const char* args[4];
+    int32_t argc;
+};
+
+/**
+ * Number conversions measured
+ */
+enum bench_num_func {
+    BENCH_NUM_UINT,
+    BENCH_NUM_INT,
+    BENCH_NUM_HEX,
+    BENCH_NUM_FIXED,
+    BENCH_STRTOUL,
+    BENCH_STRTOL,
+    BENCH_STRTOUL_HEX,
+    BENCH_STRTOD_FIXED,
+};
+
+/**
+ * Arguments of a number conversion measurement
+ */
+struct bench_num_case {
+    enum bench_num_func func;
+    const char* name;
+    const char* str;
+};
+
+// Argument structs of the schemas
+struct bench_su_args {
+    const char* s;
+    uint32_t u;
+};
+
+struct bench_uuuu_args {
+    uint32_t u0;
+    uint32_t u1;
+    uint32_t u2;
+    uint32_t u3;
+};
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static uint64_t bench_now_ns(void);
+static double bench_run(bench_func func, void* arg);
+static void bench_result(const char* name, const char* fields, double ns);
+static void bench_register_cmds(uint32_t num_cmds);
+static int32_t bench_cmd(int32_t argc, const char** argv);
+static bool bench_runs(const char* line);
+static void bench_execute(void* arg, uint32_t n);
+static void bench_tokenize(void* arg, uint32_t n);
+static void bench_parse_args(void* arg, uint32_t n);
+static void bench_parse_schema(void* arg, uint32_t n);
+static int32_t bench_schema_cmd(const void* args, int32_t num_args);
+static void bench_num(void* arg, uint32_t n);
+static void bench_ttys_write(void* arg, uint32_t n);
+static void bench_ttys_putc(void* arg, uint32_t n);
+static void bench_ring(void* arg, uint32_t n);
+static void bench_printf(void* arg, uint32_t n);
+static void bench_log(void);
+static void bench_tmr(void* arg, uint32_t n);
+static void bench_rx_inject(const char* data);
+static int bench_compare_u64(const void* a, const void* b);
+static void bench_latency(uint32_t num_cmds, const char* line);
+
+//=============================================================================
+//                        Public (global) variables
+//=============================================================================
+// The simulated GPIO ports of the dio module (see stm32f7xx_ll_gpio.h).
+GPIO_TypeDef gpio_sim_ports[GPIO_SIM_NUM_PORTS];
+
+//=============================================================================
+//                        Private (static) variables
+//=============================================================================
+static FILE* bench_out;
+static uint64_t bench_min_ns = BENCH_DEFAULT_MS * 1000000ULL;
+static bool bench_first_result = true;
+
+// Log level of the log measurement
+static int32_t log_level = LOG_INFO;
+
+// Generated command table, of which the first num_cmds are registered, as
+// the commands of the "bench" client, and as the subcommands of "sub cmds".
+static struct cmd_info bench_cmds[BENCH_MAX_CMDS];
+static char bench_cmd_names[BENCH_MAX_CMDS][8];
+
+// The full names end with "x", so that the name without it is an
+// abbreviation.
+static const struct bench_dispatch_path bench_dispatch_paths[] = {
+    { "hash", "bench c%04ux LED_1 1" },
+    { "linear", "sub cmds c%04ux LED_1 1" },
+    { "trie", "bench c%04u LED_1 1" },
+};
+
+static struct dio_out_info bench_dio_outputs[1] = {
+    {
+        .name = "LED_1",
+        .port = DIO_PORT_J,
+        .pin  = DIO_PIN_13,
+        .pull = DIO_PULL_NO,
+        .init_value = 0,
+        .speed = DIO_SPEED_FREQ_LOW,
+        .output_type = DIO_OUTPUT_PUSHPULL,
+    },
+};
+
+static const struct bench_schema_case bench_schema_cases[] = {
+    {
+        "su",
+        CMD_ARGS(struct bench_su_args, bench_schema_cmd, 2,
+            CMD_ARG_STR(struct bench_su_args, s, "s"),
+            CMD_ARG_UINT(struct bench_su_args, u, "u", 0, UINT32_MAX)),
+        { "LED_1", "1" }, 2
+    },
+    {
+        "uuuu",
+        CMD_ARGS(struct bench_uuuu_args, bench_schema_cmd, 4,
+            CMD_ARG_UINT(struct bench_uuuu_args, u0, "u0", 0, UINT32_MAX),
+            CMD_ARG_UINT(struct bench_uuuu_args, u1, "u1", 0, UINT32_MAX),
+            CMD_ARG_UINT(struct bench_uuuu_args, u2, "u2", 0, UINT32_MAX),
+            CMD_ARG_UINT(struct bench_uuuu_args, u3, "u3", 0, UINT32_MAX)),
+        { "1", "22", "333", "4444" }, 4
+    },
+};
+
+// Result of the number conversions, so that they are not optimized out.
+static volatile int32_t bench_num_sink;
+
+// Result of the clock reads, so that they are not optimized out.
+static volatile uint64_t bench_tmr_sink;
+
+// Each num module conversion is followed by the C library one it replaces.
+static const struct bench_num_case bench_num_cases[] = {
+    { BENCH_NUM_UINT, "num_parse_uint", "4294967295" },
+    { BENCH_STRTOUL, "strtoul", "4294967295" },
+    { BENCH_NUM_UINT, "num_parse_uint", "1" },
+    { BENCH_STRTOUL, "strtoul", "1" },
+    { BENCH_NUM_UINT, "num_parse_uint", "0xdeadbeef" },
+    { BENCH_STRTOUL, "strtoul", "0xdeadbeef" },
+    { BENCH_NUM_INT, "num_parse_int", "-123456" },
+    { BENCH_STRTOL, "strtol", "-123456" },
+    { BENCH_NUM_HEX, "num_parse_hex", "20001000" },
+    { BENCH_STRTOUL_HEX, "strtoul_hex", "20001000" },
+    { BENCH_NUM_FIXED, "num_parse_fixed_q16", "3.14159" },
+    { BENCH_STRTOD_FIXED, "strtod_q16", "3.14159" },
+};
+
+static struct dio_cfg bench_dio_cfg = {
+    .num_inputs = 0,
+    .inputs = NULL,
+    .num_outputs = ARRAY_SIZE(bench_dio_outputs),
+    .outputs = bench_dio_outputs,
+};
+
+//=============================================================================
+//                        Public (global) functions
+//=============================================================================
+int main(int argc, char** argv)
+{
+    static const uint32_t table_sizes[] = { 10, 100, 1000 };
+    static const char* const token_lines[] = {
+        "status",
+        "dio set LED_1 1",
+        "a b c d e f g h i j",
+    };
+    static const struct bench_parse_case parse_cases[] = {
+        { "i", { "-12345" }, 1 },
+        { "u", { "0x1234abcd" }, 1 },
+        { "p", { "20001000" }, 1 },
+        { "s", { "LED_1" }, 1 },
+        { "su", { "LED_1", "1" }, 2 },
+        { "uuuu", { "1", "22", "333", "4444" }, 4 },
+        { "u[u", { "7" }, 1 },
+    };
+    char line[BENCH_LINE_SIZE];
+    char fields[128];
+    const char* out_path = NULL;
+    int out_fd;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:o:")) != -1) {
+        switch (opt) {
+            case 't':
+                bench_min_ns = strtoull(optarg, NULL, 0) * 1000000ULL;
+                break;
+            case 'o':
+                out_path = optarg;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-t ms-per-test] [-o file]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+
+    // The results go to the original stdout (or a file), as the shell takes
+    // over the stdout stream.
+    out_fd = out_path != NULL ? -1 : dup(STDOUT_FILENO);
+    bench_out = out_path != NULL ? fopen(out_path, "w") : fdopen(out_fd, "w");
+    if (bench_out == NULL) {
+        perror("bench output");
+        return 1;
+    }
+
+    setenv("TTYS_UART1", "none", 1);
+    if (shell_init(BENCH_INSTANCE) != 0) {
+        fprintf(stderr, "shell init failed\n");
+        return 1;
+    }
+    dio_init(&bench_dio_cfg);
+
+    for (uint32_t idx = 0; idx < BENCH_MAX_CMDS; idx++) {
+        snprintf(bench_cmd_names[idx], sizeof(bench_cmd_names[idx]),
+                 "c%04ux", (unsigned)idx);
+        memcpy(&bench_cmds[idx], &(struct cmd_info) {
+                   .name = bench_cmd_names[idx],
+                   .help = "Benchmark command, usage: bench cNNNNx <s> <u>",
+                   .func = bench_cmd,
+               }, sizeof(struct cmd_info));
+    }
+
+    fprintf(bench_out, "{\n  \"benchmark\": \"shell\",\n"
+            "  \"ttys_rx_buf_size\": %u,\n  \"ttys_tx_buf_size\": %u,\n"
+            "  \"cmd_hash_size\": %u,\n  \"cmd_trie_size\": %u,\n"
+            "  \"results\": [\n",
+            (unsigned)TTYS_UART1_RX_BUF_SIZE,
+            (unsigned)TTYS_UART1_TX_BUF_SIZE, (unsigned)CMD_HASH_SIZE,
+            (unsigned)CMD_TRIE_SIZE);
+
+    // Command dispatch, through each path. A name that does not fit in the
+    // trie has no trie entry.
+    for (uint32_t idx = 0; idx < ARRAY_SIZE(table_sizes); idx++) {
+        uint32_t num_cmds = table_sizes[idx];
+        bench_register_cmds(num_cmds);
+        for (uint32_t path = 0; path < ARRAY_SIZE(bench_dispatch_paths);
+             path++) {
+            for (uint32_t last = 0; last < 2; last++) {
+                snprintf(line, sizeof(line), bench_dispatch_paths[path].fmt,
+                         (unsigned)(last ? num_cmds - 1 : 0));
+                if (!bench_runs(line))
+                    continue;
+                snprintf(fields, sizeof(fields),
+                         "\"commands\": %u, \"path\": \"%s\", "
+                         "\"line\": \"%s\"", (unsigned)num_cmds,
+                         bench_dispatch_paths[path].name, line);
+                bench_result("cmd_execute", fields,
+                             bench_run(bench_execute, line));
+            }
+        }
+    }
+    snprintf(line, sizeof(line), "dio set LED_1 1");
+    snprintf(fields, sizeof(fields), "\"commands\": 3, \"line\": \"%s\"", line);
+    bench_result("cmd_execute", fields, bench_run(bench_execute, line));
+
+    // Tokenization
+    for (uint32_t idx = 0; idx < ARRAY_SIZE(token_lines); idx++) {
+        snprintf(fields, sizeof(fields), "\"line\": \"%s\", \"bytes\": %u",
+                 token_lines[idx], (unsigned)strlen(token_lines[idx]));
+        bench_result("cmd_tokenize", fields,
+                     bench_run(bench_tokenize, (void*)token_lines[idx]));
+    }
+
+    // Argument parsing
+    for (uint32_t idx = 0; idx < ARRAY_SIZE(parse_cases); idx++) {
+        snprintf(fields, sizeof(fields), "\"format\": \"%s\", \"args\": %ld",
+                 parse_cases[idx].fmt, (long)parse_cases[idx].argc);
+        bench_result("cmd_parse_args", fields,
+                     bench_run(bench_parse_args, (void*)&parse_cases[idx]));
+    }
+    for (uint32_t idx = 0; idx < ARRAY_SIZE(bench_schema_cases); idx++) {
+        snprintf(fields, sizeof(fields), "\"format\": \"%s\", \"args\": %ld",
+                 bench_schema_cases[idx].fmt,
+                 (long)bench_schema_cases[idx].argc);
+        bench_result("cmd_parse_schema", fields,
+                     bench_run(bench_parse_schema,
+                               (void*)&bench_schema_cases[idx]));
+    }
+
+    // Number conversions
+    for (uint32_t idx = 0; idx < ARRAY_SIZE(bench_num_cases); idx++) {
+        snprintf(fields, sizeof(fields), "\"func\": \"%s\", \"str\": \"%s\"",
+                 bench_num_cases[idx].name, bench_num_cases[idx].str);
+        bench_result("num_parse", fields,
+                     bench_run(bench_num, (void*)&bench_num_cases[idx]));
+    }
+
+    // ttys output path
+    for (uint32_t block = 1; block <= 256; block *= 16) {
+        snprintf(fields, sizeof(fields), "\"bytes\": %u", (unsigned)block);
+        bench_result("ttys_write", fields,
+                     bench_run(bench_ttys_write, (void*)(uintptr_t)block));
+    }
+    for (uint32_t block = 16; block <= 256; block *= 16) {
+        snprintf(fields, sizeof(fields), "\"func\": \"ttys_putc\", "
+                 "\"block\": %u", (unsigned)block);
+        bench_result("ttys_byte", fields,
+                     bench_run(bench_ttys_putc, (void*)(uintptr_t)block) /
+                     block);
+        snprintf(fields, sizeof(fields), "\"func\": \"ttys_write\", "
+                 "\"block\": %u", (unsigned)block);
+        bench_result("ttys_byte", fields,
+                     bench_run(bench_ttys_write, (void*)(uintptr_t)block) /
+                     block);
+    }
+    snprintf(fields, sizeof(fields), "\"bytes\": %u",
+             (unsigned)strlen("LED_1 = 1, count 12345\n"));
+    bench_result("printf", fields, bench_run(bench_printf, NULL));
+
+    // Ring copies
+    for (uint32_t block = 1; block <= 256; block *= 16) {
+        snprintf(fields, sizeof(fields), "\"bytes\": %u", (unsigned)block);
+        bench_result("ring", fields,
+                     bench_run(bench_ring, (void*)(uintptr_t)block));
+    }
+
+    // Logging
+    bench_log();
+
+    // Clock
+    bench_result("tmr", "\"func\": \"tmr_get_cycles\"",
+                 bench_run(bench_tmr, (void*)tmr_get_cycles));
+    bench_result("tmr", "\"func\": \"tmr_get_us\"",
+                 bench_run(bench_tmr, (void*)tmr_get_us));
+
+    // Console latency
+    for (uint32_t idx = 0; idx < ARRAY_SIZE(table_sizes); idx++) {
+        snprintf(line, sizeof(line), "bench c%04ux LED_1 1",
+                 (unsigned)(table_sizes[idx] - 1));
+        bench_latency(table_sizes[idx], line);
+    }
+
+    fprintf(bench_out, "\n  ]\n}\n");
+    fclose(bench_out);
+
+    return 0;
+}
+
+//=============================================================================
+//                       Private (static) functions
+//=============================================================================
+/**
+ * @brief Get a monotonic time stamp.
+ *
+ * @return Time in nanoseconds.
+ */
+static uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/**
+ * @brief Measure an operation.
+ *
+ * @param[in] func The operation.
+ * @param[in] arg Its argument.
+ *
+ * @return Average time per call in nanoseconds.
+ *
+ * The number of calls is doubled until a run lasts the minimum duration, so
+ * the clock overhead is negligible.
+ */
+static double bench_run(bench_func func, void* arg)
+{
+    uint32_t n = 1;
+    uint64_t start;
+    uint64_t elapsed;
+
+    func(arg, 1);  // Warm up
+
+    for (;;) {
+        start = bench_now_ns();
+        func(arg, n);
+        elapsed = bench_now_ns() - start;
+        if (elapsed >= bench_min_ns || n >= (1U << 30))
+            break;
+        n *= 2;
+    }
+
+    return (double)elapsed / n;
+}
+
+
+/**
+ * @brief Print a result, as an element of the results array.
+ *
+ * @param[in] name Name of the measurement.
+ * @param[in] fields Parameters of the measurement (JSON members).
+ * @param[in] ns Average time per operation.
+ */
+static void bench_result(const char* name, const char* fields, double ns)
+{
+    fprintf(bench_out, "%s    {\"name\": \"%s\", %s, \"ns_per_op\": %.1f, "
+            "\"ops_per_s\": %.0f}",
+            bench_first_result ? "" : ",\n", name, fields, ns,
+            ns > 0 ? 1e9 / ns : 0.0);
+    bench_first_result = false;
+}
+
+
+/**
+ * @brief Register the benchmark clients, with a number of commands.
+ *
+ * @param[in] num_cmds Number of commands of "bench", and of subcommands of
+ *                     "sub cmds".
+ *
+ * The client and command infos have const members, so they are rebuilt in
+ * place.
+ */
+static void bench_register_cmds(uint32_t num_cmds)
+{
+    static struct cmd_client_info client_info;
+    static struct cmd_client_info sub_client_info;
+    static struct cmd_info sub_cmd;
+
+    memcpy(&client_info, &(struct cmd_client_info) {
+               .name = "bench",
+               .num_cmds = num_cmds,
+               .cmds = bench_cmds,
+           }, sizeof(struct cmd_client_info));
+    cmd_register(&client_info);
+
+    memcpy(&sub_cmd, &(struct cmd_info) {
+               .name = "cmds",
+               .help = "Benchmark commands, as subcommands",
+               .num_subcmds = num_cmds,
+               .subcmds = bench_cmds,
+           }, sizeof(struct cmd_info));
+    memcpy(&sub_client_info, &(struct cmd_client_info) {
+               .name = "sub",
+               .num_cmds = 1,
+               .cmds = &sub_cmd,
+           }, sizeof(struct cmd_client_info));
+    cmd_register(&sub_client_info);
+}
+
+
+/**
+ * @brief Command function of the generated commands.
+ *
+ * @param[in] argc Number of arguments, including the client and command
+ *                 names.
+ * @param[in] argv Argument values.
+ *
+ * @return 0 for success, else a "ERR" value.
+ *
+ * Does what a typical command does: parse its arguments, the last two (after
+ * "bench cNNNNx", or "sub cmds cNNNNx").
+ */
+static int32_t bench_cmd(int32_t argc, const char** argv)
+{
+    struct cmd_arg_val arg_vals[2];
+
+    if (argc < 4 || cmd_parse_args(2, argv + argc - 2, "su", arg_vals) != 2)
+        return SHELL_ERR_BAD_CMD;
+
+    return 0;
+}
+
+
+/**
+ * @brief Check that a command line runs its command.
+ *
+ * @param[in] line The command line.
+ *
+ * @return True if the command ran, and succeeded.
+ */
+static bool bench_runs(const char* line)
+{
+    char bfr[BENCH_LINE_SIZE];
+
+    snprintf(bfr, sizeof(bfr), "%s", line);
+
+    return cmd_execute(bfr) == 0;
+}
+
+
+static void bench_execute(void* arg, uint32_t n)
+{
+    const char* line = arg;
+    size_t len = strlen(line) + 1;
+    char bfr[BENCH_LINE_SIZE];
+
+    // cmd_execute() splits the line in place, so it is copied every time.
+    while (n--) {
+        memcpy(bfr, line, len);
+        cmd_execute(bfr);
+    }
+}
+
+
+static void bench_tokenize(void* arg, uint32_t n)
+{
+    const char* line = arg;
+    size_t len = strlen(line) + 1;
+    char bfr[BENCH_LINE_SIZE];
+    const char* tokens[CMD_MAX_TOKENS];
+
+    while (n--) {
+        memcpy(bfr, line, len);
+        cmd_tokenize(bfr, tokens, CMD_MAX_TOKENS);
+    }
+}
+
+
+static void bench_parse_args(void* arg, uint32_t n)
+{
+    const struct bench_parse_case* pc = arg;
+    struct cmd_arg_val arg_vals[4];
+
+    while (n--)
+        cmd_parse_args(pc->argc, (const char**)pc->args, pc->fmt, arg_vals);
+}
+
+
+static void bench_parse_schema(void* arg, uint32_t n)
+{
+    const struct bench_schema_case* sc = arg;
+    union {
+        max_align_t align;
+        uint8_t bytes[CMD_ARGS_MAX_SIZE];
+    } args;
+
+    while (n--)
+        cmd_parse_schema(sc->schema, sc->argc, (const char**)sc->args,
+                         args.bytes);
+}
+
+
+static void bench_num(void* arg, uint32_t n)
+{
+    const struct bench_num_case* nc = arg;
+    uint32_t uval;
+    int32_t ival;
+
+    while (n--) {
+        switch (nc->func) {
+            case BENCH_NUM_UINT:
+                num_parse_uint(nc->str, &uval);
+                bench_num_sink = uval;
+                break;
+            case BENCH_NUM_INT:
+                num_parse_int(nc->str, &ival);
+                bench_num_sink = ival;
+                break;
+            case BENCH_NUM_HEX:
+                num_parse_hex(nc->str, &uval);
+                bench_num_sink = uval;
+                break;
+            case BENCH_NUM_FIXED:
+                num_parse_fixed(nc->str, 16, &ival);
+                bench_num_sink = ival;
+                break;
+            case BENCH_STRTOUL:
+                bench_num_sink = strtoul(nc->str, NULL, 0);
+                break;
+            case BENCH_STRTOL:
+                bench_num_sink = strtol(nc->str, NULL, 0);
+                break;
+            case BENCH_STRTOUL_HEX:
+                bench_num_sink = strtoul(nc->str, NULL, 16);
+                break;
+            case BENCH_STRTOD_FIXED:
+                bench_num_sink = strtod(nc->str, NULL) * 65536.0 + 0.5;
+                break;
+        }
+    }
+}
+
+
+/**
+ * @brief Command function of the schemas, which are only parsed.
+ *
+ * @param[in] args The arguments.
+ * @param[in] num_args Number of arguments.
+ *
+ * @return 0
+ */
+static int32_t bench_schema_cmd(const void* args, int32_t num_args)
+{
+    (void)args;
+    (void)num_args;
+
+    return 0;
+}
+
+
+static void bench_ttys_write(void* arg, uint32_t n)
+{
+    uint32_t block = (uintptr_t)arg;
+    char data[256];
+
+    memset(data, 'x', sizeof(data));
+    while (n--)
+        ttys_write(BENCH_INSTANCE, data, block);
+}
+
+
+static void bench_ttys_putc(void* arg, uint32_t n)
+{
+    uint32_t block = (uintptr_t)arg;
+
+    while (n--) {
+        for (uint32_t idx = 0; idx < block; idx++)
+            ttys_putc(BENCH_INSTANCE, 'x');
+    }
+}
+
+
+/**
+ * @brief Write a block in a ring and read it back.
+ *
+ * The ring does not start at a multiple of the block size, so some of the
+ * copies are split at the end of the buffer (half of the 256 bytes ones).
+ */
+static void bench_ring(void* arg, uint32_t n)
+{
+    static char buf[BENCH_RING_SIZE];
+    static struct ring ring;
+    uint32_t block = (uintptr_t)arg;
+    char data[256];
+
+    memset(data, 'x', sizeof(data));
+    ring_init(&ring, buf, sizeof(buf));
+    ring_write(&ring, data, 100);
+    ring_read(&ring, data, 100);
+
+    while (n--) {
+        ring_write(&ring, data, block);
+        ring_read(&ring, data, block);
+    }
+}
+
+
+static void bench_printf(void* arg, uint32_t n)
+{
+    (void)arg;
+
+    while (n--)
+        printf("%s = %d, count %lu\n", "LED_1", 1, 12345UL);
+}
+
+
+/**
+ * @brief Measure the cost of logging, on the caller's side and in log_drain().
+ *
+ * The messages are logged in batches, each followed by log_drain(), and the
+ * two are timed separately.
+ */
+static void bench_log(void)
+{
+    uint64_t call_ns = 0;
+    uint64_t drain_ns = 0;
+    uint64_t n = 0;
+    uint64_t start;
+    char fields[64];
+
+    while (call_ns + drain_ns < bench_min_ns) {
+        start = bench_now_ns();
+        for (uint32_t idx = 0; idx < BENCH_LOG_BATCH; idx++)
+            log_info("%s = %d, count %lu\n", "LED_1", 1, 12345UL);
+        call_ns += bench_now_ns() - start;
+
+        start = bench_now_ns();
+        log_drain();
+        drain_ns += bench_now_ns() - start;
+        n += BENCH_LOG_BATCH;
+    }
+
+    snprintf(fields, sizeof(fields), "\"mode\": %u, \"step\": \"call\"",
+             (unsigned)LOG_MODE);
+    bench_result("log", fields, (double)call_ns / n);
+    snprintf(fields, sizeof(fields), "\"mode\": %u, \"step\": \"drain\"",
+             (unsigned)LOG_MODE);
+    bench_result("log", fields, (double)drain_ns / n);
+}
+
+
+/**
+ * @brief Read the monotonic clock.
+ *
+ * @param[in] arg The function reading it (tmr_get_cycles or tmr_get_us).
+ * @param[in] n Number of reads.
+ */
+static void bench_tmr(void* arg, uint32_t n)
+{
+    uint64_t (*func)(void) = (uint64_t (*)(void))arg;
+
+    while (n--)
+        bench_tmr_sink = func();
+}
+
+
+/**
+ * @brief Put characters in the RX buffer, as the UART would.
+ *
+ * @param[in] data The characters.
+ */
+static void bench_rx_inject(const char* data)
+{
+    ring_write(&ttys_states[BENCH_INSTANCE].rx_ring, data, strlen(data));
+}
+
+
+static int bench_compare_u64(const void* a, const void* b)
+{
+    uint64_t va = *(const uint64_t*)a;
+    uint64_t vb = *(const uint64_t*)b;
+
+    return va < vb ? -1 : va > vb;
+}
+
+
+/**
+ * @brief Measure the console latency for a command line.
+ *
+ * @param[in] num_cmds Number of commands in the benchmark client.
+ * @param[in] line The command line (without end of line).
+ *
+ * The line is typed first (console_run() echoes it), then the end of line
+ * arrives and the next console_run() call is timed.
+ */
+static void bench_latency(uint32_t num_cmds, const char* line)
+{
+    static uint64_t samples[BENCH_LATENCY_SAMPLES];
+    uint64_t start;
+
+    bench_register_cmds(num_cmds);
+
+    for (uint32_t idx = 0; idx < BENCH_LATENCY_SAMPLES; idx++) {
+        bench_rx_inject(line);
+        console_run();
+        bench_rx_inject("\r");
+        start = bench_now_ns();
+        console_run();
+        samples[idx] = bench_now_ns() - start;
+    }
+    qsort(samples, BENCH_LATENCY_SAMPLES, sizeof(samples[0]),
+          bench_compare_u64);
+
+    fprintf(bench_out, ",\n    {\"name\": \"console_latency\", "
+            "\"commands\": %u, \"line\": \"%s\", \"samples\": %u, "
+            "\"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu, "
+            "\"max_ns\": %llu}",
+            (unsigned)num_cmds, line, (unsigned)BENCH_LATENCY_SAMPLES,
+            (unsigned long long)samples[BENCH_LATENCY_SAMPLES / 2],
+            (unsigned long long)samples[BENCH_LATENCY_SAMPLES * 9 / 10],
+            (unsigned long long)samples[BENCH_LATENCY_SAMPLES * 99 / 100],
+            (unsigned long long)samples[BENCH_LATENCY_SAMPLES - 1]);
+}
@@ -0,0 +1,154 @@
+/**
+ * @brief Main program of the example, as a Linux process.
+ *
+ * Runs the shell with the dio module on a simulated GPIO bank. See README.md
+ * for the build command.
+ *
+ * The console is on standard input and output by default (see port_posix.h to
+ * use a pseudo terminal or a Unix socket instead). The process ends at the end
+ * of its input, so scripts can be piped to it:
+ *
+ *     printf 'dio set LED_1 1\ndio status\n' | ./shell_posix
+ */
+
+#include "shell.h"
+#include "dio.h"
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+// Arguments of "gpio in"
+struct gpio_in_args {
+    int32_t port;
+    uint32_t pin;
+    bool value;
+};
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static int32_t cmd_gpio_in(const void* args, int32_t num_args);
+
+//=============================================================================
+//                        Public (global) variables
+//=============================================================================
+// The simulated GPIO ports (see stm32f7xx_ll_gpio.h).
+GPIO_TypeDef gpio_sim_ports[GPIO_SIM_NUM_PORTS];
+
+//=============================================================================
+//                        Private (static) variables
+//=============================================================================
+// Config info for dio module, as on the target board. These variables must be
+// static since the dio module holds a pointer to them.
+static struct dio_in_info d_inputs[1] = {
+    {
+        // User Button
+        .name = "User_Btn",
+        .port = DIO_PORT_A,
+        .pin  = DIO_PIN_0,
+        .pull = DIO_PULL_NO,
+        .invert = 1,
+    }
+};
+
+static struct dio_out_info d_outputs[2] = {
+    {
+        // LED 1
+        .name = "LED_1",
+        .port = DIO_PORT_J,
+        .pin  = DIO_PIN_13,
+        .pull = DIO_PULL_NO,
+        .init_value = 0,
+        .speed = DIO_SPEED_FREQ_LOW,
+        .output_type = DIO_OUTPUT_PUSHPULL,
+    },
+    {
+        // LED 2
+        .name = "LED_2",
+        .port = DIO_PORT_J,
+        .pin  = DIO_PIN_5,
+        .pull = DIO_PULL_NO,
+        .init_value = 0,
+        .speed = DIO_SPEED_FREQ_LOW,
+        .output_type = DIO_OUTPUT_PUSHPULL,
+    },
+};
+
+static struct dio_cfg dio_cfg = {
+    .num_inputs = ARRAY_SIZE(d_inputs),
+    .inputs = d_inputs,
+    .num_outputs = ARRAY_SIZE(d_outputs),
+    .outputs = d_outputs,
+};
+
+static const char* const gpio_port_names[GPIO_SIM_NUM_PORTS] = {
+    "A", "B", "C", "D", "E", "F", "G", "H", "I", "J", "K"
+};
+
+static struct cmd_info gpio_cmds[] = {
+    {
+        .name = "in",
+        .help = "Drive simulated input, usage: gpio in <port-letter> <pin> {0|1}",
+        .args = CMD_ARGS(struct gpio_in_args, cmd_gpio_in, 3,
+                    CMD_ARG_ENUM(struct gpio_in_args, port, "port-letter",
+                                 gpio_port_names),
+                    CMD_ARG_UINT(struct gpio_in_args, pin, "pin", 0, 15),
+                    CMD_ARG_BOOL(struct gpio_in_args, value, "value")),
+    },
+};
+
+SHELL_CLIENT(gpio,
+    .num_cmds = ARRAY_SIZE(gpio_cmds),
+    .cmds = gpio_cmds,
+);
+
+//=============================================================================
+//                        Public (global) functions
+//=============================================================================
+int main(void)
+{
+    /* Shell Initialization */
+    if (shell_init(TTYS_INSTANCE_UART1) != 0)
+        return 1;
+
+    /* DIO init */
+    dio_init(&dio_cfg);
+
+    printf("Entering super loop\n");
+
+    /* Loop until the end of the input, waking up for the timers */
+    do {
+        console_run();
+    } while (ttys_posix_wait(tmr_get_idle_ms(1000)) >= 0);
+
+    printf("\n");
+
+    return 0;
+}
+
+//=============================================================================
+//                       Private (static) functions
+//=============================================================================
+/**
+ * @brief Console command function for "gpio in".
+ *
+ * @param[in] args The arguments (struct gpio_in_args).
+ * @param[in] num_args Number of arguments.
+ *
+ * @return 0 for success, else a "ERR" value. See code for details.
+ *
+ * Command usage: gpio in <port-letter> <pin> {0|1}
+ */
+static int32_t cmd_gpio_in(const void* args, int32_t num_args)
+{
+    const struct gpio_in_args* a = args;
+    GPIO_TypeDef* port = &gpio_sim_ports[a->port];
+    uint32_t pin = 1U << a->pin;
+
+    if (a->value)
+        port->IDR |= pin;
+    else
+        port->IDR &= ~pin;
+
+    return 0;
+}
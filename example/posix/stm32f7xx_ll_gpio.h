@@ -0,0 +1,136 @@
+#ifndef _STM32F7XX_LL_GPIO_SIM_H_
+#define _STM32F7XX_LL_GPIO_SIM_H_
+
+/**
+ * @brief Simulated GPIO bank for the POSIX build of the example.
+ *
+ * This header stands in for the STMicroelectronics LL GPIO header, with the
+ * subset used by the dio module. The GPIO ports are plain variables: outputs
+ * are stored in ODR, and inputs are read from IDR, which the "gpio" console
+ * command of the example sets (see main.c). An input reads its pull-up or
+ * pull-down level until set.
+ */
+
+#include <stdint.h>
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+typedef struct {
+    uint32_t MODER;
+    uint32_t OTYPER;
+    uint32_t OSPEEDR;
+    uint32_t PUPDR;
+    uint32_t IDR;
+    uint32_t ODR;
+} GPIO_TypeDef;
+
+//=============================================================================
+//                         Preprocessor Constants
+//=============================================================================
+#define GPIO_SIM_NUM_PORTS 11
+
+extern GPIO_TypeDef gpio_sim_ports[GPIO_SIM_NUM_PORTS];
+
+#define GPIOA (&gpio_sim_ports[0])
+#define GPIOB (&gpio_sim_ports[1])
+#define GPIOC (&gpio_sim_ports[2])
+#define GPIOD (&gpio_sim_ports[3])
+#define GPIOE (&gpio_sim_ports[4])
+#define GPIOF (&gpio_sim_ports[5])
+#define GPIOG (&gpio_sim_ports[6])
+#define GPIOH (&gpio_sim_ports[7])
+#define GPIOI (&gpio_sim_ports[8])
+#define GPIOJ (&gpio_sim_ports[9])
+#define GPIOK (&gpio_sim_ports[10])
+
+#define GPIO_PIN_0  ((uint16_t)0x0001)
+#define GPIO_PIN_1  ((uint16_t)0x0002)
+#define GPIO_PIN_2  ((uint16_t)0x0004)
+#define GPIO_PIN_3  ((uint16_t)0x0008)
+#define GPIO_PIN_4  ((uint16_t)0x0010)
+#define GPIO_PIN_5  ((uint16_t)0x0020)
+#define GPIO_PIN_6  ((uint16_t)0x0040)
+#define GPIO_PIN_7  ((uint16_t)0x0080)
+#define GPIO_PIN_8  ((uint16_t)0x0100)
+#define GPIO_PIN_9  ((uint16_t)0x0200)
+#define GPIO_PIN_10 ((uint16_t)0x0400)
+#define GPIO_PIN_11 ((uint16_t)0x0800)
+#define GPIO_PIN_12 ((uint16_t)0x1000)
+#define GPIO_PIN_13 ((uint16_t)0x2000)
+#define GPIO_PIN_14 ((uint16_t)0x4000)
+#define GPIO_PIN_15 ((uint16_t)0x8000)
+
+#define LL_GPIO_MODE_INPUT  0U
+#define LL_GPIO_MODE_OUTPUT 1U
+
+#define LL_GPIO_PULL_NO   0U
+#define LL_GPIO_PULL_UP   1U
+#define LL_GPIO_PULL_DOWN 2U
+
+#define LL_GPIO_SPEED_FREQ_LOW       0U
+#define LL_GPIO_SPEED_FREQ_MEDIUM    1U
+#define LL_GPIO_SPEED_FREQ_HIGH      2U
+#define LL_GPIO_SPEED_FREQ_VERY_HIGH 3U
+
+#define LL_GPIO_OUTPUT_PUSHPULL  0U
+#define LL_GPIO_OUTPUT_OPENDRAIN 1U
+
+//=============================================================================
+//                        LL GPIO functions (inline)
+//=============================================================================
+// As in the LL library, the 2-bit fields are at twice the pin number.
+#define GPIO_SIM_POS(pin) (2U * (uint32_t)__builtin_ctz(pin))
+
+static inline void LL_GPIO_SetPinMode(GPIO_TypeDef* port, uint32_t pin,
+                                      uint32_t mode)
+{
+    port->MODER = (port->MODER & ~(3U << GPIO_SIM_POS(pin))) |
+                  (mode << GPIO_SIM_POS(pin));
+}
+
+static inline void LL_GPIO_SetPinPull(GPIO_TypeDef* port, uint32_t pin,
+                                      uint32_t pull)
+{
+    port->PUPDR = (port->PUPDR & ~(3U << GPIO_SIM_POS(pin))) |
+                  (pull << GPIO_SIM_POS(pin));
+    if (pull == LL_GPIO_PULL_UP)
+        port->IDR |= pin;
+    else if (pull == LL_GPIO_PULL_DOWN)
+        port->IDR &= ~pin;
+}
+
+static inline void LL_GPIO_SetPinSpeed(GPIO_TypeDef* port, uint32_t pin,
+                                       uint32_t speed)
+{
+    port->OSPEEDR = (port->OSPEEDR & ~(3U << GPIO_SIM_POS(pin))) |
+                    (speed << GPIO_SIM_POS(pin));
+}
+
+static inline void LL_GPIO_SetPinOutputType(GPIO_TypeDef* port, uint32_t pin,
+                                            uint32_t output_type)
+{
+    port->OTYPER = (port->OTYPER & ~pin) | (output_type ? pin : 0);
+}
+
+static inline uint32_t LL_GPIO_IsInputPinSet(GPIO_TypeDef* port, uint32_t pin)
+{
+    return (port->IDR & pin) == pin;
+}
+
+static inline uint32_t LL_GPIO_IsOutputPinSet(GPIO_TypeDef* port, uint32_t pin)
+{
+    return (port->ODR & pin) == pin;
+}
+
+static inline void LL_GPIO_SetOutputPin(GPIO_TypeDef* port, uint32_t pin)
+{
+    port->ODR |= pin;
+}
+
+static inline void LL_GPIO_ResetOutputPin(GPIO_TypeDef* port, uint32_t pin)
+{
+    port->ODR &= ~pin;
+}
+
+#endif /* _STM32F7XX_LL_GPIO_SIM_H_ */
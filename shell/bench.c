@@ -0,0 +1,296 @@
+/**
+ * @brief Implementation of bench module.
+ *
+ * The whole module is compiled out unless SHELL_BENCH_ENABLED is set (see
+ * bench.h).
+ */
+
+#include "shell.h"
+
+#if SHELL_BENCH_ENABLED
+
+//=============================================================================
+//                              Common Macros
+//=============================================================================
+// Size of the command line run by "bench cmd", as the console's.
+#define BENCH_CMD_LINE_SIZE 80
+
+// Length of the lines of the "bench tx" test pattern, including "\r\n".
+#define BENCH_TX_LINE_LEN 64
+
+// Maximum wait for the TX buffer to drain.
+#define BENCH_TX_FLUSH_TIMEOUT_MS 10000
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static uint32_t bench_cycles_to_time(uint64_t cycles, uint32_t units_per_s);
+static int32_t cmd_bench_tx(int32_t argc, const char** argv);
+static int32_t cmd_bench_echo(int32_t argc, const char** argv);
+static int32_t cmd_bench_cmd(int32_t argc, const char** argv);
+
+//=============================================================================
+//                        Private (static) variables
+//=============================================================================
+static const struct cmd_info cmds[] = {
+    {
+        .name = "tx",
+        .func = cmd_bench_tx,
+        .help = "Measure TX throughput, usage: bench tx <bytes>",
+    },
+    {
+        .name = "echo",
+        .func = cmd_bench_echo,
+        .help = "Reply with a timestamp, usage: bench echo <seq>",
+    },
+    {
+        .name = "cmd",
+        .func = cmd_bench_cmd,
+        .help = "Time a command, usage: bench cmd <n> <command line>",
+    },
+};
+
+SHELL_CLIENT(bench,
+    .num_cmds = ARRAY_SIZE(cmds),
+    .cmds = cmds,
+    .log_level_ptr = NULL,
+    .num_pms = 0,
+    .pms = NULL,
+);
+
+//=============================================================================
+//                        Public (global) functions
+//=============================================================================
+int32_t bench_init(void)
+{
+    // The cycle counter is already started by tmr_init().
+    return 0;
+}
+
+//=============================================================================
+//                        Private (static) functions
+//=============================================================================
+/**
+ * @brief Convert cycles to time.
+ *
+ * @param[in] cycles Number of cycles.
+ * @param[in] units_per_s Time unit (e.g. 1000000 for microseconds).
+ *
+ * @return Time in units.
+ */
+static uint32_t bench_cycles_to_time(uint64_t cycles, uint32_t units_per_s)
+{
+    return (uint32_t)(cycles * units_per_s / port_get_cycles_hz());
+}
+
+
+/**
+ * @brief Console command function for "bench tx".
+ *
+ * @param[in] argc Number of arguments, including "bench".
+ * @param[in] argv Argument values, including "bench".
+ *
+ * @return 0 for success, else a "ERR" value. See code for details.
+ *
+ * Command usage: bench tx <bytes>
+ *
+ * The pattern is written straight into the TX buffer of the stdout instance
+ * (with ttys_tx_reserve()), and the time runs from the first byte queued to
+ * the last one sent. When the buffer is full, it is drained before being
+ * filled again; the line is then idle for the time of the refill only.
+ */
+static int32_t cmd_bench_tx(int32_t argc, const char** argv)
+{
+    enum ttys_instance_id instance_id = ttys_fd_to_instance(STDOUT_FILENO);
+    struct cmd_arg_val arg_vals[1];
+    uint32_t total;
+    uint32_t sent = 0;
+    uint64_t cycles = 0;
+    uint32_t last;
+    uint32_t now;
+    uint32_t bytes_per_s;
+    int32_t baud;
+    int32_t len;
+    int32_t idx;
+    int32_t rc;
+    char* ptr;
+
+    if (instance_id >= TTYS_NUM_INSTANCES) {
+        printf("No ttys instance on stdout\n");
+        return SHELL_ERR_RESOURCE;
+    }
+
+    if (cmd_parse_args(argc-2, argv+2, "u", arg_vals) != 1)
+        return SHELL_ERR_BAD_CMD;
+    total = arg_vals[0].val.u;
+
+    // Start with the buffer empty, so that its content is not counted.
+    rc = ttys_flush(instance_id, BENCH_TX_FLUSH_TIMEOUT_MS);
+    if (rc < 0)
+        return rc;
+
+    // The cycles are accumulated, as the counter can wrap around during a
+    // long run.
+    last = port_get_cycles();
+    while (sent < total) {
+        len = ttys_tx_reserve(instance_id, &ptr);
+        if (len < 0)
+            return len;
+        if (len == 0) {
+            // The buffer is full
+            rc = ttys_flush(instance_id, BENCH_TX_FLUSH_TIMEOUT_MS);
+            if (rc < 0)
+                break;
+        } else {
+            if ((uint32_t)len > total - sent)
+                len = total - sent;
+            for (idx = 0; idx < len; idx++) {
+                uint32_t col = (sent + idx) % BENCH_TX_LINE_LEN;
+                ptr[idx] = col == BENCH_TX_LINE_LEN - 2 ? '\r' :
+                           col == BENCH_TX_LINE_LEN - 1 ? '\n' :
+                           '0' + col % 10;
+            }
+            ttys_tx_commit(instance_id, len);
+            sent += len;
+        }
+        now = port_get_cycles();
+        cycles += now - last;
+        last = now;
+    }
+    if (rc == 0)
+        rc = ttys_flush(instance_id, BENCH_TX_FLUSH_TIMEOUT_MS);
+    cycles += port_get_cycles() - last;
+    if (rc < 0) {
+        printf("\nTX stalled after %lu bytes\n", (unsigned long)sent);
+        return rc;
+    }
+
+    if (cycles == 0) {
+        printf("\nNothing sent\n");
+        return 0;
+    }
+
+    bytes_per_s = (uint32_t)(sent * (uint64_t)port_get_cycles_hz() / cycles);
+    printf("\n%lu bytes in %lu us, %lu bytes/s", (unsigned long)sent,
+           (unsigned long)bench_cycles_to_time(cycles, 1000000U),
+           (unsigned long)bytes_per_s);
+    baud = ttys_get_baud(instance_id);
+    if (baud > 0)
+        printf(" (%lu%% of %ld baud)",
+               (unsigned long)(bytes_per_s * 1000ULL / baud), (long)baud);
+    printf("\n");
+
+    return 0;
+}
+
+
+/**
+ * @brief Console command function for "bench echo".
+ *
+ * @param[in] argc Number of arguments, including "bench".
+ * @param[in] argv Argument values, including "bench".
+ *
+ * @return 0 for success, else a "ERR" value. See code for details.
+ *
+ * Command usage: bench echo <seq>
+ *
+ * The reply is "echo <seq> <cycles> <cycles-per-second>", with the cycle
+ * counter read when the command starts.
+ */
+static int32_t cmd_bench_echo(int32_t argc, const char** argv)
+{
+    uint32_t cycles = port_get_cycles();
+
+    if (argc != 3) {
+        printf("Usage: bench echo <seq>\n");
+        return SHELL_ERR_BAD_CMD;
+    }
+
+    printf("echo %s %lu %lu\n", argv[2], (unsigned long)cycles,
+           (unsigned long)port_get_cycles_hz());
+
+    return 0;
+}
+
+
+/**
+ * @brief Console command function for "bench cmd".
+ *
+ * @param[in] argc Number of arguments, including "bench".
+ * @param[in] argv Argument values, including "bench".
+ *
+ * @return 0 for success, else a "ERR" value. See code for details.
+ *
+ * Command usage: bench cmd <n> <command line>
+ *
+ * The command line is rebuilt from its tokens, and copied before each run, as
+ * cmd_execute() splits it in place. Only cmd_execute() is timed. The runs stop
+ * at the first failure: a command line that is not valid, or a command that
+ * returns an error.
+ */
+static int32_t cmd_bench_cmd(int32_t argc, const char** argv)
+{
+    struct cmd_arg_val arg_vals[1];
+    char line[BENCH_CMD_LINE_SIZE];
+    char bfr[BENCH_CMD_LINE_SIZE];
+    uint32_t num_runs;
+    uint32_t run;
+    uint32_t start;
+    uint32_t cycles;
+    uint32_t min_cycles = UINT32_MAX;
+    uint32_t max_cycles = 0;
+    uint64_t sum_cycles = 0;
+    uint32_t len = 0;
+    int32_t idx;
+    int32_t rc;
+
+    if (argc < 4) {
+        printf("Usage: bench cmd <n> <command line>\n");
+        return SHELL_ERR_BAD_CMD;
+    }
+
+    if (cmd_parse_args(1, argv+2, "u", arg_vals) != 1)
+        return SHELL_ERR_BAD_CMD;
+    num_runs = arg_vals[0].val.u;
+    if (num_runs == 0) {
+        printf("Invalid number of runs '%s'\n", argv[2]);
+        return SHELL_ERR_ARG;
+    }
+
+    for (idx = 3; idx < argc; idx++) {
+        rc = snprintf(line + len, sizeof(line) - len, "%s%s",
+                      idx == 3 ? "" : " ", argv[idx]);
+        if (rc < 0 || (uint32_t)rc >= sizeof(line) - len) {
+            printf("Command line too long\n");
+            return SHELL_ERR_ARG;
+        }
+        len += rc;
+    }
+
+    for (run = 0; run < num_runs; run++) {
+        memcpy(bfr, line, len + 1);
+        start = port_get_cycles();
+        rc = cmd_execute(bfr);
+        cycles = port_get_cycles() - start;
+        if (rc < 0) {
+            printf("Run %lu failed (error %ld)\n", (unsigned long)run + 1,
+                   (long)rc);
+            return rc;
+        }
+        if (cycles < min_cycles)
+            min_cycles = cycles;
+        if (cycles > max_cycles)
+            max_cycles = cycles;
+        sum_cycles += cycles;
+    }
+
+    printf("%lu runs: min %lu, avg %lu, max %lu cycles (avg %lu ns)\n",
+           (unsigned long)num_runs, (unsigned long)min_cycles,
+           (unsigned long)(sum_cycles / num_runs), (unsigned long)max_cycles,
+           (unsigned long)bench_cycles_to_time(sum_cycles / num_runs,
+                                               1000000000U));
+
+    return 0;
+}
+
+#endif /* SHELL_BENCH_ENABLED */
@@ -1,338 +1,1746 @@
-/**
- * @brief Implementation of cmd module.
- */
-
-#include "shell.h"
-
-//=============================================================================
-//                         Preprocessor Constants
-//=============================================================================
-#define MAX_CMD_TOKENS 10
-
-//=============================================================================
-//                  Private (static) function declarations
-//=============================================================================
-static const char* log_level_str(int32_t level);
-static int32_t log_level_int(const char* level_name);
-
-//=============================================================================
-//                       Private (static) variables
-//=============================================================================
-static const struct cmd_client_info* client_info[CMD_MAX_CLIENTS];
-
-static int32_t log_level = LOG_DEFAULT;
-static const char* log_level_names[] = { LOG_LEVEL_NAMES_CSV };
-
-//=============================================================================
-//                       Public (global) functions
-//=============================================================================
-int32_t cmd_init(struct cmd_cfg* cfg)
-{
-    memset(client_info, 0, sizeof(client_info));
-    return 0;
-}
-
-
-int32_t cmd_register(const struct cmd_client_info* _client_info)
-{
-    for (int32_t idx = 0; idx < CMD_MAX_CLIENTS; idx++) {
-        if (client_info[idx] == NULL ||
-            strcasecmp(client_info[idx]->name, _client_info->name) == 0) {
-            client_info[idx] = _client_info;
-            return 0;
-        }
-    }
-
-    return SHELL_ERR_RESOURCE;
-}
-
-
-// TODO: Refactor by spliting in smaller functions!!
-int32_t cmd_execute(char* bfr)
-{
-    int32_t num_tokens = 0;
-    const char* tokens[MAX_CMD_TOKENS];
-    char* p = bfr;
-    int32_t idx;
-    int32_t idx2;
-    const struct cmd_client_info* ci;
-    const struct cmd_info* cmdi;
-
-    // Tokenize the command line in-place.
-    while (1) {
-
-        // Find start of token.
-        while (*p && isspace((unsigned char)*p))
-            p++;
-
-        if (*p == '\0') {
-            // Found end of line.
-            break;
-        } else {
-            if (num_tokens >= MAX_CMD_TOKENS) {
-                printf("Too many arguments\n");
-                return SHELL_ERR_BAD_CMD;
-            }
-            // Record pointer to token and find its end.
-            tokens[num_tokens++] = p;
-            while (*p && !isspace((unsigned char)*p))
-                p++;
-            if (*p) {
-                // Terminate token.
-                *p++ = '\0';
-            } else {
-                // Found end of line.
-                break;
-            }
-        }
-    }
-
-    // If there are no tokens, nothing to do.
-    if (num_tokens == 0)
-        return 0;
-
-    // Handle wild card commands
-    if (strcmp("*", tokens[0]) == 0) {
-        if (num_tokens < 2) {
-            printf("Wildcard missing command\n");
-            return SHELL_ERR_BAD_CMD;
-        }
-        if (strcasecmp(tokens[1], "log") == 0) {
-            int32_t log_level = 0;
-            if (num_tokens == 3) {
-                log_level = log_level_int(tokens[2]);
-                if (log_level < 0) {
-                    printf("Invalid log level: %s\n", tokens[2]);
-                    return SHELL_ERR_ARG;
-                }
-            } else if (num_tokens > 3) {
-                printf("Invalid arguments\n");
-                return SHELL_ERR_ARG;
-            }
-            for (idx = 0;
-                 idx < CMD_MAX_CLIENTS && client_info[idx] != NULL;
-                 idx++) {
-                ci = client_info[idx];
-                if (ci->log_level_ptr != NULL) {
-                    if (num_tokens == 3) {
-                        *ci->log_level_ptr = log_level;
-                    } else {
-                        printf("Log level for %s = %s\n", ci->name,
-                               log_level_str(*ci->log_level_ptr));
-                    }
-                }
-            }
-        }
-        return 0;
-    }
-
-    // Handle top-level help.
-    if (strcasecmp("help", tokens[0]) == 0 ||
-        strcasecmp("?", tokens[0]) == 0) {
-        for (idx = 0;
-             idx < CMD_MAX_CLIENTS && client_info[idx] != NULL;
-             idx++) {
-            ci = client_info[idx];
-            if (ci->num_cmds == 0)
-                continue;
-            printf("%s (", ci->name);
-            for (idx2 = 0; idx2 < ci->num_cmds; idx2++) {
-                cmdi = &ci->cmds[idx2];
-                printf("%s%s", idx2 == 0 ? "" : ", ", cmdi->name);
-            }
-            // If client provided log level, include log command.
-            if (ci->log_level_ptr)
-                printf("%s%s", idx2 == 0 ? "" : ", ", "log");
-
-            printf(")\n");
-        }
-        printf("\nLog levels are: %s\n", LOG_LEVEL_NAMES);
-        return 0;
-    }
-
-    // Find and execute the command.
-    for (idx = 0;
-         idx < CMD_MAX_CLIENTS && client_info[idx] != NULL;
-         idx++) {
-        ci = client_info[idx];
-        if (strcasecmp(tokens[0], ci->name) != 0)
-            continue;
-
-        // If there is no command, create a dummy.
-        if (num_tokens == 1)
-            tokens[1] = "";
-
-        // Handle help command directly.
-        if (strcasecmp(tokens[1], "help") == 0 ||
-            strcasecmp(tokens[1], "?") == 0) {
-            log_debug("Handle client help\n");
-            for (idx2 = 0; idx2 < ci->num_cmds; idx2++) {
-                cmdi = &ci->cmds[idx2];
-                printf("%s %s: %s\n", ci->name, cmdi->name, cmdi->help);
-            }
-
-            // If client provided log level, print help for log command.
-            if (ci->log_level_ptr) {
-                printf("%s log: set or get log level, args: [level]\n",
-                       ci->name);
-            }
-
-            if (ci->log_level_ptr)
-                printf("\nLog levels are: %s\n", LOG_LEVEL_NAMES);
-
-            return 0;
-        }
-
-        // Handle log command directly.
-        if (strcasecmp(tokens[1], "log") == 0) {
-            log_debug("Handle command log\n");
-            if (ci->log_level_ptr) {
-                if (num_tokens < 3) {
-                    printf("Log level for %s = %s\n", ci->name,
-                           log_level_str(*ci->log_level_ptr));
-                } else {
-                    int32_t log_level = log_level_int(tokens[2]);
-                    if (log_level < 0) {
-                        printf("Invalid log level: %s\n", tokens[2]);
-                        return SHELL_ERR_ARG;
-                    }
-                    *ci->log_level_ptr = log_level;
-                }
-            }
-            return 0;
-        }
-
-        // Find the command
-        for (idx2 = 0; idx2 < ci->num_cmds; idx2++) {
-            if (strcasecmp(tokens[1], ci->cmds[idx2].name) == 0) {
-                log_debug("Handle command\n");
-                ci->cmds[idx2].func(num_tokens, tokens);
-                return 0;
-            }
-        }
-
-        printf("No such command (%s %s)\n", tokens[0], tokens[1]);
-        return SHELL_ERR_BAD_CMD;
-    }
-
-    printf("No such command (%s)\n", tokens[0]);
-    return SHELL_ERR_BAD_CMD;
-}
-
-
-int32_t cmd_parse_args(int32_t argc, const char** argv, const char* fmt,
-                       struct cmd_arg_val* arg_vals)
-{
-    int32_t arg_cnt = 0;
-    char* endptr;
-    bool opt_args = false;
-
-    while (*fmt) {
-        if (*fmt == '[') {
-            opt_args = true;
-            fmt++;
-            continue;
-        }
-        if (*fmt == ']') {
-            fmt++;
-            continue;
-        }
-
-        if (arg_cnt >= argc) {
-            if (opt_args) {
-                return arg_cnt;
-            }
-            printf("Insufficient arguments\n");
-            return SHELL_ERR_BAD_CMD;
-        }
-
-        // These error conditions should not occur,
-        // but we check them for safety
-        if (*argv == NULL || **argv == '\0') {
-            printf("Invalid empty arguments\n");
-            return SHELL_ERR_BAD_CMD;
-        }
-
-        switch (*fmt) {
-            case 'i':
-                arg_vals->val.i = strtol(*argv, &endptr, 0);
-                if (*endptr) {
-                    printf("Argument '%s' not a valid integer\n", *argv);
-                    return SHELL_ERR_ARG;
-                }
-                break;
-            case 'u':
-                arg_vals->val.u = strtoul(*argv, &endptr, 0);
-                if (*endptr) {
-                    printf("Argument '%s' not a valid unsigned integer\n", *argv);
-                    return SHELL_ERR_ARG;
-                }
-                break;
-            case 'p':
-                arg_vals->val.p = (void*)strtoul(*argv, &endptr, 16);
-                if (*endptr) {
-                    printf("Argument '%s' not a valid pointer\n", *argv);
-                    return SHELL_ERR_ARG;
-                }
-                break;
-            case 's':
-                arg_vals->val.s = *argv;
-                break;
-            default:
-                printf("Bad argument format '%c'\n", *fmt);
-                return SHELL_ERR_ARG;
-        }
-        arg_vals->type = *fmt;
-        arg_vals++;
-        arg_cnt++;
-        argv++;
-        fmt++;
-        opt_args = false;
-    }
-    if (arg_cnt < argc) {
-        printf("Too many arguments\n");
-        return SHELL_ERR_BAD_CMD;
-    }
-
-    return arg_cnt;
-}
-
-//=============================================================================
-//                       Private (static) functions
-//=============================================================================
-/**
- * @brief Convert integer log level to a string.
- *
- * @param[in] level The log level as an integer.
- *
- * @return Log level as a string (or "INVALID" on error)
- */
-static const char* log_level_str(int32_t level)
-{
-    if (level < ARRAY_SIZE(log_level_names))
-        return log_level_names[level];
-
-    return "INVALID";
-}
-
-
-/**
- * @brief Convert log level string to an int.
- *
- * @param[in] level_name The log level as a string.
- *
- * @return Log level as an int, or -1 on error.
- */
-static int32_t log_level_int(const char* level_name)
-{
-    int32_t rc = -1;
-
-    for (int32_t level = 0; level < ARRAY_SIZE(log_level_names); level++) {
-        if (strcasecmp(level_name, log_level_names[level]) == 0) {
-            rc = level;
-            break;
-        }
-    }
-
-    return rc;
-}
+/**
+ * @brief Implementation of cmd module.
+ */
+
+#include "shell.h"
+
+//=============================================================================
+//                              Common Macros
+//=============================================================================
+#if CMD_TRIE_SIZE > 0
+_Static_assert(CMD_TRIE_SIZE >= 3 && CMD_TRIE_SIZE <= UINT16_MAX,
+               "CMD_TRIE_SIZE must be 0, or between 3 and 65535");
+#endif
+
+#if CMD_HASH_SIZE > 0
+_Static_assert((CMD_HASH_SIZE & (CMD_HASH_SIZE - 1)) == 0,
+               "CMD_HASH_SIZE must be a power of two");
+#endif
+
+// FNV-1a hash parameters (32 bits), as for the perfect hashes of
+// cmd_table.hpp.
+#define CMD_HASH_INIT  2166136261U
+#define CMD_HASH_PRIME 16777619U
+
+// Command index of a client name entry in the hash index.
+#define CMD_HASH_CLIENT 0xffff
+
+// Size of the command paths printed by the help (e.g. "ttys 1").
+#define CMD_PATH_SIZE 64
+
+// Number of clients in the linker section.
+#if CMD_SECTION_CLIENTS
+#define CMD_NUM_SECTION_CLIENTS \
+    ((int32_t)(__shell_clients_end - __shell_clients_start))
+#else
+#define CMD_NUM_SECTION_CLIENTS 0
+#endif
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+/**
+ * Kind of the name ending at a trie node, and of its target.
+ */
+enum cmd_name_type {
+    CMD_NAME_NONE,    /**< No name ends at the node                    */
+    CMD_NAME_CLIENT,  /**< Client, target is its struct cmd_client_info */
+    CMD_NAME_CMD,     /**< Command, target is its struct cmd_info      */
+    CMD_NAME_HELP,    /**< help command of a client (no target)        */
+    CMD_NAME_LOG,     /**< log command of a client (no target)         */
+    CMD_NAME_PM,      /**< pm command of a client (no target)          */
+};
+
+/**
+ * Entry of the command name hash index. A client name is hashed alone, a
+ * command name is hashed after its client name and a space, as in the command
+ * line, so that the same command name in two clients gets two hashes.
+ */
+struct cmd_hash_entry {
+    uint32_t hash;    /**< Hash of the (lowercase) name                  */
+    uint16_t client;  /**< Client index plus 1, 0 if the entry is free   */
+    uint16_t cmd;     /**< Command index, or CMD_HASH_CLIENT for client  */
+};
+
+/**
+ * Node of the command name trie.
+ *
+ * The names of each level (the clients, the commands of a client, or the
+ * subcommands of a command) form a radix tree: the edge to a node is labeled
+ * with the characters it adds to the name (at least one), and the children of
+ * a node start with different characters, in increasing order. Every node
+ * either ends a name or has two children or more, so a node with a single
+ * name below it is where that name ends. A node where a name ends links to the
+ * level of its subcommands.
+ *
+ * The labels point into the names (in flash), and the nodes are referenced by
+ * their index in cmd_trie[], 0 being none.
+ */
+struct cmd_trie_node {
+    const char* label;   /**< Edge label, in one of the names below       */
+    const void* target;  /**< Object named (see enum cmd_name_type)       */
+    uint16_t child;      /**< First child                                 */
+    uint16_t sibling;    /**< Next sibling                                */
+    uint16_t sub;        /**< First node of the next level                */
+    uint16_t num_names;  /**< Number of names ending here or below        */
+    uint8_t len;         /**< Label length                                */
+    uint8_t type;        /**< enum cmd_name_type                          */
+};
+
+/**
+ * Result of the search of a command line token.
+ */
+enum cmd_match_rc {
+    CMD_MATCH_NONE,       /**< No name starts with the token               */
+    CMD_MATCH_FOUND,      /**< The token is a name, or the start of one    */
+    CMD_MATCH_AMBIGUOUS,  /**< The token is the start of several names     */
+};
+
+/**
+ * Name found for a command line token.
+ */
+struct cmd_match {
+    uint8_t type;        /**< enum cmd_name_type                          */
+    const void* target;  /**< Object named                                */
+    uint16_t sub;        /**< First trie node of the next level, or 0     */
+    uint16_t node;       /**< Trie node reached (for the ambiguous names) */
+};
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static const char* log_level_str(int32_t level);
+static int32_t log_level_int(const char* level_name);
+static void cmd_pm(const struct cmd_client_info* ci, bool clear);
+static void cmd_client_help(const struct cmd_client_info* ci);
+static int32_t cmd_client_log(const struct cmd_client_info* ci,
+                              int32_t argc, const char** argv);
+static int32_t cmd_client_pm(const struct cmd_client_info* ci,
+                             int32_t argc, const char** argv);
+static void cmd_help_cmds(const char* path, const struct cmd_info* cmds,
+                          int32_t num_cmds);
+static int32_t cmd_not_found(enum cmd_match_rc rc, const char** tokens,
+                             int32_t num_tokens, uint16_t node);
+static int32_t cmd_parse_arg(const struct cmd_arg_desc* desc, const char* str,
+                             void* field);
+static int32_t cmd_arg_invalid(const struct cmd_arg_desc* desc,
+                               const char* str, bool range);
+static int32_t cmd_hex_digit(char c);
+static const struct cmd_client_info* cmd_client_at(int32_t idx);
+static enum cmd_match_rc cmd_match_client(const char** tokens,
+                                          struct cmd_match* match);
+static enum cmd_match_rc cmd_match_cmd(const struct cmd_client_info* ci,
+                                       const char** tokens,
+                                       struct cmd_match* match);
+static enum cmd_match_rc cmd_match_subcmd(const struct cmd_info* cmdi,
+                                          const char** tokens, int32_t idx,
+                                          struct cmd_match* match);
+static enum cmd_match_rc cmd_match_abbrev(const char** tokens, int32_t idx,
+                                          struct cmd_match* match);
+static int32_t cmd_find_client(const char* name);
+static int32_t cmd_find_cmd(const struct cmd_client_info* ci,
+                            const char* name);
+static int32_t cmd_find_name(const struct cmd_info* cmds, int32_t num_cmds,
+                             const char* name);
+static uint32_t cmd_hash_str(uint32_t hash, const char* str);
+static uint8_t cmd_lower(char c);
+#if CMD_HASH_SIZE > 0
+static void cmd_hash_build(void);
+static void cmd_hash_insert(uint32_t hash, int32_t client_idx, uint16_t cmd);
+static int32_t cmd_hash_find(uint32_t hash, const struct cmd_client_info* ci,
+                             const char* name);
+#endif
+#if CMD_TRIE_SIZE > 0
+static void cmd_trie_build(void);
+static void cmd_trie_add_cmds(uint16_t* level, const struct cmd_info* cmds,
+                              int32_t num_cmds);
+static uint16_t cmd_trie_insert(uint16_t* level, const char* name,
+                                uint8_t type, const void* target);
+static uint16_t cmd_trie_walk(uint16_t level, const char* str, uint32_t len,
+                              uint32_t* pos);
+static enum cmd_match_rc cmd_trie_match(uint16_t level, const char* str,
+                                        uint32_t len, struct cmd_match* match);
+static const char* cmd_trie_name(uint16_t node);
+static const char* cmd_name(uint8_t type, const void* target);
+static void cmd_trie_list(uint16_t node);
+#endif
+
+//=============================================================================
+//                       Private (static) variables
+//=============================================================================
+// Clients of the linker section, sorted by name (see shell_clients.ld).
+#if CMD_SECTION_CLIENTS
+extern const struct cmd_client_info __shell_clients_start[];
+extern const struct cmd_client_info __shell_clients_end[];
+#endif
+
+// Clients registered with cmd_register(), after those of the linker section.
+static const struct cmd_client_info* client_info[CMD_MAX_CLIENTS];
+
+// Names of the commands provided on behalf of the clients.
+static const char* const cmd_builtin_names[] = {
+    [CMD_NAME_HELP] = "help",
+    [CMD_NAME_LOG] = "log",
+    [CMD_NAME_PM] = "pm",
+};
+
+// Command name hash index, built on the first command after a registration.
+#if CMD_HASH_SIZE > 0
+static struct cmd_hash_entry cmd_hash[CMD_HASH_SIZE];
+static uint32_t cmd_hash_count;
+static bool cmd_hash_valid;
+
+// Set when a name did not fit in the hash index; the names that are not found
+// in it are then searched linearly.
+static bool cmd_hash_full;
+#endif
+
+// Command name trie, built on the first abbreviation or completion after a
+// registration.
+#if CMD_TRIE_SIZE > 0
+static struct cmd_trie_node cmd_trie[CMD_TRIE_SIZE];
+static uint16_t cmd_trie_count;
+static uint16_t cmd_trie_root;
+static bool cmd_trie_valid;
+
+// Set when names did not fit in the trie; they can then only be used in full.
+static bool cmd_trie_full;
+#endif
+
+static int32_t log_level = LOG_DEFAULT;
+static const char* log_level_names[] = { LOG_LEVEL_NAMES_CSV };
+
+// Values of the boolean arguments: false at even indexes, true at odd ones.
+static const char* const cmd_bool_names[] = {
+    "0", "1", "off", "on", "false", "true", "no", "yes"
+};
+
+//=============================================================================
+//                       Public (global) functions
+//=============================================================================
+int32_t cmd_init(struct cmd_cfg* cfg)
+{
+    // Nothing to do: the clients can be registered before (by the
+    // constructors of SHELL_CLIENT()), so they are not cleared.
+    return 0;
+}
+
+
+int32_t cmd_register(const struct cmd_client_info* _client_info)
+{
+    int32_t idx;
+
+    for (idx = 0; idx < CMD_MAX_CLIENTS; idx++) {
+        if (client_info[idx] == NULL ||
+            strcasecmp(client_info[idx]->name, _client_info->name) == 0)
+            break;
+    }
+    if (idx >= CMD_MAX_CLIENTS)
+        return SHELL_ERR_RESOURCE;
+
+    // The indexes are rebuilt on their next use, with the new names.
+    client_info[idx] = _client_info;
+#if CMD_HASH_SIZE > 0
+    cmd_hash_valid = false;
+#endif
+#if CMD_TRIE_SIZE > 0
+    cmd_trie_valid = false;
+#endif
+
+    return 0;
+}
+
+
+int32_t cmd_execute(char* bfr)
+{
+    int32_t num_tokens;
+    const char* tokens[CMD_MAX_TOKENS];
+    char path[CMD_PATH_SIZE];
+    int32_t idx;
+    int32_t idx2;
+    int32_t len;
+    const struct cmd_client_info* ci;
+    const struct cmd_info* cmdi;
+    struct cmd_match match;
+    enum cmd_match_rc rc;
+    int32_t num_args;
+    union {
+        max_align_t align;
+        uint8_t bytes[CMD_ARGS_MAX_SIZE];
+    } args;
+
+    num_tokens = cmd_tokenize(bfr, tokens, CMD_MAX_TOKENS);
+    if (num_tokens < 0) {
+        printf("Too many arguments\n");
+        return num_tokens;
+    }
+
+    // If there are no tokens, nothing to do.
+    if (num_tokens == 0)
+        return 0;
+
+    // Handle wild card commands
+    if (strcmp("*", tokens[0]) == 0) {
+        if (num_tokens < 2) {
+            printf("Wildcard missing command\n");
+            return SHELL_ERR_BAD_CMD;
+        }
+        if (strcasecmp(tokens[1], "log") == 0) {
+            int32_t log_level = 0;
+            if (num_tokens == 3) {
+                log_level = log_level_int(tokens[2]);
+                if (log_level < 0) {
+                    printf("Invalid log level: %s\n", tokens[2]);
+                    return SHELL_ERR_ARG;
+                }
+            } else if (num_tokens > 3) {
+                printf("Invalid arguments\n");
+                return SHELL_ERR_ARG;
+            }
+            for (idx = 0; (ci = cmd_client_at(idx)) != NULL; idx++) {
+                if (ci->log_level_ptr != NULL) {
+                    if (num_tokens == 3) {
+                        *ci->log_level_ptr = log_level;
+                    } else {
+                        printf("Log level for %s = %s\n", ci->name,
+                               log_level_str(*ci->log_level_ptr));
+                    }
+                }
+            }
+        } else if (strcasecmp(tokens[1], "pm") == 0) {
+            bool clear = false;
+            if (num_tokens == 3 && strcasecmp(tokens[2], "clear") == 0) {
+                clear = true;
+            } else if (num_tokens > 2) {
+                printf("Invalid arguments\n");
+                return SHELL_ERR_ARG;
+            }
+            for (idx = 0; (ci = cmd_client_at(idx)) != NULL; idx++)
+                cmd_pm(ci, clear);
+        }
+        return 0;
+    }
+
+    // Handle top-level help.
+    if (strcasecmp("help", tokens[0]) == 0 ||
+        strcasecmp("?", tokens[0]) == 0) {
+        for (idx = 0; (ci = cmd_client_at(idx)) != NULL; idx++) {
+            if (ci->num_cmds == 0 && ci->log_level_ptr == NULL &&
+                ci->num_pms == 0)
+                continue;
+            printf("%s (", ci->name);
+            for (idx2 = 0; idx2 < ci->num_cmds; idx2++) {
+                cmdi = &ci->cmds[idx2];
+                printf("%s%s", idx2 == 0 ? "" : ", ", cmdi->name);
+            }
+            // If client provided log level, include log command.
+            if (ci->log_level_ptr)
+                printf("%s%s", idx2++ == 0 ? "" : ", ", "log");
+
+            // If client provided measurements, include pm command.
+            if (ci->num_pms > 0)
+                printf("%s%s", idx2 == 0 ? "" : ", ", "pm");
+
+            printf(")\n");
+        }
+        printf("\nLog levels are: %s\n", LOG_LEVEL_NAMES);
+        return 0;
+    }
+
+#if CMD_HASH_SIZE > 0
+    if (!cmd_hash_valid)
+        cmd_hash_build();
+#endif
+
+    // Find the client. The tokens are replaced by the full names found, so
+    // that the command functions don't see the abbreviations.
+    rc = cmd_match_client(tokens, &match);
+    if (rc != CMD_MATCH_FOUND)
+        return cmd_not_found(rc, tokens, 1, match.node);
+    ci = match.target;
+    tokens[0] = ci->name;
+
+    // If there is no command, create a dummy.
+    if (num_tokens == 1)
+        tokens[1] = "";
+
+    if (strcmp(tokens[1], "?") == 0) {
+        cmd_client_help(ci);
+        return 0;
+    }
+
+    // Find the command, and handle the help, log and pm commands directly.
+    rc = cmd_match_cmd(ci, tokens, &match);
+    if (rc != CMD_MATCH_FOUND)
+        return cmd_not_found(rc, tokens, 2, match.node);
+
+    switch (match.type) {
+        case CMD_NAME_HELP:
+            log_debug("Handle client help\n");
+            cmd_client_help(ci);
+            return 0;
+        case CMD_NAME_LOG:
+            log_debug("Handle command log\n");
+            return cmd_client_log(ci, num_tokens, tokens);
+        case CMD_NAME_PM:
+            log_debug("Handle command pm\n");
+            return cmd_client_pm(ci, num_tokens, tokens);
+        default:
+            break;
+    }
+    cmdi = match.target;
+    tokens[1] = cmdi->name;
+
+    // Find the subcommands. A token that is not one is an argument, if the
+    // command has a function.
+    for (idx = 2; idx < num_tokens && cmdi->num_subcmds > 0; idx++) {
+        rc = cmd_match_subcmd(cmdi, tokens, idx, &match);
+        if (rc != CMD_MATCH_FOUND) {
+            if (cmdi->func != NULL || cmdi->args != NULL)
+                break;
+            return cmd_not_found(rc, tokens, idx + 1, match.node);
+        }
+        cmdi = match.target;
+        tokens[idx] = cmdi->name;
+    }
+
+    // A command without function needs a subcommand: list them.
+    if (cmdi->func == NULL && cmdi->args == NULL) {
+        len = 0;
+        for (idx2 = 0; idx2 < idx && len < (int32_t)sizeof(path); idx2++)
+            len += snprintf(path + len, sizeof(path) - len, "%s%s",
+                            idx2 == 0 ? "" : " ", tokens[idx2]);
+        cmd_help_cmds(path, cmdi->subcmds, cmdi->num_subcmds);
+        return SHELL_ERR_BAD_CMD;
+    }
+
+    // With a schema, the function is only called with valid arguments.
+    if (cmdi->args != NULL) {
+        num_args = cmd_parse_schema(cmdi->args, num_tokens - idx, tokens + idx,
+                                    args.bytes);
+        if (num_args < 0)
+            return num_args;
+        log_debug("Handle command\n");
+        return cmdi->args->func(args.bytes, num_args);
+    }
+
+    log_debug("Handle command\n");
+    return cmdi->func(num_tokens, tokens);
+}
+
+
+int32_t cmd_complete(char* bfr, uint32_t size)
+{
+#if CMD_TRIE_SIZE > 0
+    uint32_t len = strlen(bfr);
+    uint32_t start = 0;
+    uint32_t end;
+    uint32_t pos = 0;
+    uint16_t level;
+    uint16_t node;
+    const struct cmd_trie_node* n;
+    const char* ext;
+    uint32_t ext_len;
+    bool space;
+    struct cmd_match match;
+
+    if (!cmd_trie_valid)
+        cmd_trie_build();
+
+    // Follow the tokens before the last one (empty after a space), from level
+    // to level.
+    level = cmd_trie_root;
+    while (1) {
+        while (start < len && isspace((unsigned char)bfr[start]))
+            start++;
+        for (end = start; end < len && !isspace((unsigned char)bfr[end]);
+             end++)
+            ;
+        if (end == len)
+            break;
+        if (cmd_trie_match(level, bfr + start, end - start, &match) !=
+            CMD_MATCH_FOUND)
+            return SHELL_ERR_BAD_CMD;
+        level = match.sub;
+        start = end;
+    }
+    if (level == 0)
+        return SHELL_ERR_BAD_CMD;
+
+    // Find the node the last token ends in. An empty token is in all the
+    // nodes of the level, so they are listed unless there is only one.
+    if (end > start) {
+        node = cmd_trie_walk(level, bfr + start, end - start, &pos);
+        if (node == 0)
+            return SHELL_ERR_BAD_CMD;
+    } else if (cmd_trie[level].sibling == 0) {
+        node = level;
+    } else {
+        printf("\n");
+        for (node = level; node != 0; node = cmd_trie[node].sibling)
+            cmd_trie_list(node);
+        printf("\n");
+        return 0;
+    }
+
+    n = &cmd_trie[node];
+    if (n->num_names == 1) {
+        // A single name: complete it, and start the next token.
+        ext = cmd_trie_name(node) + (end - start);
+        ext_len = strlen(ext);
+        space = true;
+    } else if (pos < n->len) {
+        // The rest of the edge is common to all the names below.
+        ext = n->label + pos;
+        ext_len = n->len - pos;
+        space = false;
+    } else {
+        printf("\n");
+        cmd_trie_list(node);
+        printf("\n");
+        return 0;
+    }
+
+    if (len + ext_len + space >= size)
+        return SHELL_ERR_BAD_CMD;
+    memcpy(bfr + len, ext, ext_len);
+    len += ext_len;
+    if (space)
+        bfr[len++] = ' ';
+    bfr[len] = '\0';
+
+    return ext_len + space;
+#else
+    // Without the trie, there is nothing to complete from.
+    return SHELL_ERR_BAD_CMD;
+#endif
+}
+
+
+int32_t cmd_tokenize(char* bfr, const char** tokens, int32_t max_tokens)
+{
+    int32_t num_tokens = 0;
+    char* p = bfr;
+
+    while (1) {
+
+        // Find start of token.
+        while (*p && isspace((unsigned char)*p))
+            p++;
+
+        if (*p == '\0') {
+            // Found end of line.
+            break;
+        } else {
+            if (num_tokens >= max_tokens)
+                return SHELL_ERR_BAD_CMD;
+            // Record pointer to token and find its end.
+            tokens[num_tokens++] = p;
+            while (*p && !isspace((unsigned char)*p))
+                p++;
+            if (*p) {
+                // Terminate token.
+                *p++ = '\0';
+            } else {
+                // Found end of line.
+                break;
+            }
+        }
+    }
+
+    return num_tokens;
+}
+
+
+int32_t cmd_parse_args(int32_t argc, const char** argv, const char* fmt,
+                       struct cmd_arg_val* arg_vals)
+{
+    int32_t arg_cnt = 0;
+    int32_t rc;
+    uint32_t addr;
+    bool opt_args = false;
+
+    while (*fmt) {
+        if (*fmt == '[') {
+            opt_args = true;
+            fmt++;
+            continue;
+        }
+        if (*fmt == ']') {
+            fmt++;
+            continue;
+        }
+
+        if (arg_cnt >= argc) {
+            if (opt_args) {
+                return arg_cnt;
+            }
+            printf("Insufficient arguments\n");
+            return SHELL_ERR_BAD_CMD;
+        }
+
+        // These error conditions should not occur,
+        // but we check them for safety
+        if (*argv == NULL || **argv == '\0') {
+            printf("Invalid empty arguments\n");
+            return SHELL_ERR_BAD_CMD;
+        }
+
+        switch (*fmt) {
+            case 'i':
+                rc = num_parse_int(*argv, &arg_vals->val.i);
+                if (rc < 0) {
+                    printf("Argument '%s' not a valid integer%s\n", *argv,
+                           rc == SHELL_ERR_RANGE ? " (out of range)" : "");
+                    return SHELL_ERR_ARG;
+                }
+                break;
+            case 'u':
+                rc = num_parse_uint(*argv, &arg_vals->val.u);
+                if (rc < 0) {
+                    printf("Argument '%s' not a valid unsigned integer%s\n",
+                           *argv,
+                           rc == SHELL_ERR_RANGE ? " (out of range)" : "");
+                    return SHELL_ERR_ARG;
+                }
+                break;
+            case 'p':
+                rc = num_parse_hex(*argv, &addr);
+                if (rc < 0) {
+                    printf("Argument '%s' not a valid pointer\n", *argv);
+                    return SHELL_ERR_ARG;
+                }
+                arg_vals->val.p = (void*)(uintptr_t)addr;
+                break;
+            case 's':
+                arg_vals->val.s = *argv;
+                break;
+            default:
+                printf("Bad argument format '%c'\n", *fmt);
+                return SHELL_ERR_ARG;
+        }
+        arg_vals->type = *fmt;
+        arg_vals++;
+        arg_cnt++;
+        argv++;
+        fmt++;
+        opt_args = false;
+    }
+    if (arg_cnt < argc) {
+        printf("Too many arguments\n");
+        return SHELL_ERR_BAD_CMD;
+    }
+
+    return arg_cnt;
+}
+
+
+int32_t cmd_parse_schema(const struct cmd_args_schema* schema, int32_t argc,
+                         const char** argv, void* args)
+{
+    const struct cmd_arg_desc* desc;
+    int32_t idx;
+    int32_t rc;
+
+    if (argc < schema->num_required) {
+        printf("Missing argument <%s>\n", schema->args[argc].name);
+        return SHELL_ERR_BAD_CMD;
+    }
+    if (argc > schema->num_args) {
+        printf("Too many arguments\n");
+        return SHELL_ERR_BAD_CMD;
+    }
+
+    memset(args, 0, schema->size);
+    for (idx = 0; idx < argc; idx++) {
+        desc = &schema->args[idx];
+        rc = cmd_parse_arg(desc, argv[idx], (uint8_t*)args + desc->offset);
+        if (rc < 0)
+            return rc;
+    }
+
+    return argc;
+}
+
+
+//=============================================================================
+//                       Private (static) functions
+//=============================================================================
+/**
+ * @brief Convert integer log level to a string.
+ *
+ * @param[in] level The log level as an integer.
+ *
+ * @return Log level as a string (or "INVALID" on error)
+ */
+static const char* log_level_str(int32_t level)
+{
+    if (level < ARRAY_SIZE(log_level_names))
+        return log_level_names[level];
+
+    return "INVALID";
+}
+
+
+/**
+ * @brief Convert log level string to an int.
+ *
+ * @param[in] level_name The log level as a string.
+ *
+ * @return Log level as an int, or -1 on error.
+ */
+static int32_t log_level_int(const char* level_name)
+{
+    int32_t rc = -1;
+
+    for (int32_t level = 0; level < ARRAY_SIZE(log_level_names); level++) {
+        if (strcasecmp(level_name, log_level_names[level]) == 0) {
+            rc = level;
+            break;
+        }
+    }
+
+    return rc;
+}
+
+
+/**
+ * @brief Print or clear the performance measurements of a client.
+ *
+ * @param[in] ci The client info.
+ * @param[in] clear If true the counters are cleared, else all measurements
+ *                  are printed.
+ */
+static void cmd_pm(const struct cmd_client_info* ci, bool clear)
+{
+    for (int32_t idx = 0; idx < ci->num_pms; idx++) {
+        const struct cmd_pm_info* pmi = &ci->pms[idx];
+        if (clear) {
+            if (!pmi->gauge)
+                *pmi->val = 0;
+        } else {
+            printf("%s %s = %lu\n", ci->name, pmi->name,
+                   (unsigned long)*pmi->val);
+        }
+    }
+}
+
+
+/**
+ * @brief Get a client by index.
+ *
+ * @param[in] idx Index of the client: the clients of the linker section come
+ *                first, then those of client_info[].
+ *
+ * @return The client, or NULL past the last one.
+ */
+static const struct cmd_client_info* cmd_client_at(int32_t idx)
+{
+#if CMD_SECTION_CLIENTS
+    if (idx < CMD_NUM_SECTION_CLIENTS)
+        return &__shell_clients_start[idx];
+    idx -= CMD_NUM_SECTION_CLIENTS;
+#endif
+
+    return idx < CMD_MAX_CLIENTS ? client_info[idx] : NULL;
+}
+
+
+/**
+ * @brief Print the help of a client's commands.
+ *
+ * @param[in] ci The client info.
+ */
+static void cmd_client_help(const struct cmd_client_info* ci)
+{
+    cmd_help_cmds(ci->name, ci->cmds, ci->num_cmds);
+
+    // If client provided log level, print help for log command.
+    if (ci->log_level_ptr) {
+        printf("%s log: set or get log level, args: [level]\n",
+               ci->name);
+    }
+
+    // If client provided measurements, print help for pm command.
+    if (ci->num_pms > 0) {
+        printf("%s pm: get or clear performance measurements, "
+               "args: [clear]\n", ci->name);
+    }
+
+    if (ci->log_level_ptr)
+        printf("\nLog levels are: %s\n", LOG_LEVEL_NAMES);
+}
+
+
+/**
+ * @brief Handle the log command of a client.
+ *
+ * @param[in] ci The client info (with a log level).
+ * @param[in] argc Number of arguments, including the client and "log".
+ * @param[in] argv Argument values, including the client and "log".
+ *
+ * @return 0 for success, else a "ERR" value.
+ */
+static int32_t cmd_client_log(const struct cmd_client_info* ci,
+                              int32_t argc, const char** argv)
+{
+    int32_t log_level;
+
+    if (argc < 3) {
+        printf("Log level for %s = %s\n", ci->name,
+               log_level_str(*ci->log_level_ptr));
+    } else {
+        log_level = log_level_int(argv[2]);
+        if (log_level < 0) {
+            printf("Invalid log level: %s\n", argv[2]);
+            return SHELL_ERR_ARG;
+        }
+        *ci->log_level_ptr = log_level;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Handle the pm command of a client.
+ *
+ * @param[in] ci The client info (with measurements).
+ * @param[in] argc Number of arguments, including the client and "pm".
+ * @param[in] argv Argument values, including the client and "pm".
+ *
+ * @return 0 for success, else a "ERR" value.
+ */
+static int32_t cmd_client_pm(const struct cmd_client_info* ci,
+                             int32_t argc, const char** argv)
+{
+    if (argc == 3 && strcasecmp(argv[2], "clear") == 0) {
+        cmd_pm(ci, true);
+    } else if (argc == 2) {
+        cmd_pm(ci, false);
+    } else {
+        printf("Invalid arguments\n");
+        return SHELL_ERR_ARG;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Print the help of commands, and of their subcommands.
+ *
+ * @param[in] path The tokens before the commands (e.g. "ttys 1").
+ * @param[in] cmds The commands.
+ * @param[in] num_cmds Number of commands.
+ */
+static void cmd_help_cmds(const char* path, const struct cmd_info* cmds,
+                          int32_t num_cmds)
+{
+    char sub_path[CMD_PATH_SIZE];
+
+    for (int32_t idx = 0; idx < num_cmds; idx++) {
+        printf("%s %s: %s\n", path, cmds[idx].name, cmds[idx].help);
+        if (cmds[idx].num_subcmds > 0) {
+            snprintf(sub_path, sizeof(sub_path), "%s %s", path,
+                     cmds[idx].name);
+            cmd_help_cmds(sub_path, cmds[idx].subcmds,
+                          cmds[idx].num_subcmds);
+        }
+    }
+}
+
+
+/**
+ * @brief Report a command line token that is not found.
+ *
+ * @param[in] rc Result of the search.
+ * @param[in] tokens The command line tokens.
+ * @param[in] num_tokens Number of tokens up to the one not found.
+ * @param[in] node Trie node reached, for an ambiguous token.
+ *
+ * @return SHELL_ERR_BAD_CMD
+ */
+static int32_t cmd_not_found(enum cmd_match_rc rc, const char** tokens,
+                             int32_t num_tokens, uint16_t node)
+{
+    printf(rc == CMD_MATCH_AMBIGUOUS ? "Ambiguous command (" :
+                                       "No such command (");
+    for (int32_t idx = 0; idx < num_tokens; idx++)
+        printf("%s%s", idx == 0 ? "" : " ", tokens[idx]);
+
+#if CMD_TRIE_SIZE > 0
+    if (rc == CMD_MATCH_AMBIGUOUS) {
+        printf("), could be:");
+        cmd_trie_list(node);
+        printf("\n");
+        return SHELL_ERR_BAD_CMD;
+    }
+#endif
+    printf(")\n");
+
+    return SHELL_ERR_BAD_CMD;
+}
+
+
+/**
+ * @brief Find a client by name, or by the start of its name.
+ *
+ * @param[in] tokens The command line tokens (the client is the first one).
+ * @param[out] match The client found.
+ *
+ * @return Result of the search.
+ */
+static enum cmd_match_rc cmd_match_client(const char** tokens,
+                                          struct cmd_match* match)
+{
+    int32_t idx;
+
+    idx = cmd_find_client(tokens[0]);
+    if (idx < 0)
+        return cmd_match_abbrev(tokens, 0, match);
+
+    *match = (struct cmd_match) {
+        .type = CMD_NAME_CLIENT,
+        .target = cmd_client_at(idx),
+    };
+
+    return CMD_MATCH_FOUND;
+}
+
+
+/**
+ * @brief Find a command of a client by name, or by the start of its name.
+ *
+ * @param[in] ci The client info.
+ * @param[in] tokens The command line tokens (the command is the second one).
+ * @param[out] match The command found, or the help, log or pm command.
+ *
+ * @return Result of the search.
+ *
+ * The help, log and pm commands take precedence over those of the client, as
+ * in the trie.
+ */
+static enum cmd_match_rc cmd_match_cmd(const struct cmd_client_info* ci,
+                                       const char** tokens,
+                                       struct cmd_match* match)
+{
+    const char* token = tokens[1];
+    int32_t idx;
+
+    if (strcasecmp(token, cmd_builtin_names[CMD_NAME_HELP]) == 0) {
+        *match = (struct cmd_match) { .type = CMD_NAME_HELP };
+    } else if (ci->log_level_ptr != NULL &&
+               strcasecmp(token, cmd_builtin_names[CMD_NAME_LOG]) == 0) {
+        *match = (struct cmd_match) { .type = CMD_NAME_LOG };
+    } else if (ci->num_pms > 0 &&
+               strcasecmp(token, cmd_builtin_names[CMD_NAME_PM]) == 0) {
+        *match = (struct cmd_match) { .type = CMD_NAME_PM };
+    } else {
+        idx = cmd_find_cmd(ci, token);
+        if (idx < 0)
+            return cmd_match_abbrev(tokens, 1, match);
+        *match = (struct cmd_match) {
+            .type = CMD_NAME_CMD,
+            .target = &ci->cmds[idx],
+        };
+    }
+
+    return CMD_MATCH_FOUND;
+}
+
+
+/**
+ * @brief Find a subcommand by name, or by the start of its name.
+ *
+ * @param[in] cmdi The command info.
+ * @param[in] tokens The command line tokens.
+ * @param[in] idx Index of the subcommand token.
+ * @param[out] match The subcommand found.
+ *
+ * @return Result of the search.
+ */
+static enum cmd_match_rc cmd_match_subcmd(const struct cmd_info* cmdi,
+                                          const char** tokens, int32_t idx,
+                                          struct cmd_match* match)
+{
+    int32_t sub_idx;
+
+    sub_idx = cmd_find_name(cmdi->subcmds, cmdi->num_subcmds, tokens[idx]);
+    if (sub_idx < 0)
+        return cmd_match_abbrev(tokens, idx, match);
+
+    *match = (struct cmd_match) {
+        .type = CMD_NAME_CMD,
+        .target = &cmdi->subcmds[sub_idx],
+    };
+
+    return CMD_MATCH_FOUND;
+}
+
+
+/**
+ * @brief Find the name that a token is the start of, through the trie.
+ *
+ * @param[in] tokens The command line tokens. Those before idx are the names
+ *                   found (not copies of them).
+ * @param[in] idx Index of the token.
+ * @param[out] match The name found, or the trie node reached if ambiguous.
+ *
+ * @return Result of the search (CMD_MATCH_NONE without the trie).
+ *
+ * Only used for the tokens that are not a full name, so the exact names are
+ * found without the trie.
+ */
+static enum cmd_match_rc cmd_match_abbrev(const char** tokens, int32_t idx,
+                                          struct cmd_match* match)
+{
+#if CMD_TRIE_SIZE > 0
+    uint16_t level;
+    uint16_t node;
+    uint32_t pos;
+
+    if (!cmd_trie_valid)
+        cmd_trie_build();
+
+    // Go down to the level of the token, through the nodes of the names
+    // before it. A node must name the same object as its token, not another
+    // one of the same name that was added to the trie first.
+    level = cmd_trie_root;
+    for (int32_t idx2 = 0; idx2 < idx && level != 0; idx2++) {
+        pos = 0;
+        node = cmd_trie_walk(level, tokens[idx2], strlen(tokens[idx2]), &pos);
+        if (node == 0 || pos != cmd_trie[node].len ||
+            cmd_trie[node].type == CMD_NAME_NONE ||
+            cmd_trie_name(node) != tokens[idx2])
+            level = 0;
+        else
+            level = cmd_trie[node].sub;
+    }
+
+    return cmd_trie_match(level, tokens[idx], strlen(tokens[idx]), match);
+#else
+    match->node = 0;
+    return CMD_MATCH_NONE;
+#endif
+}
+
+
+/**
+ * @brief Parse an argument of a schema.
+ *
+ * @param[in] desc The argument description.
+ * @param[in] str The argument.
+ * @param[out] field The field of the argument struct.
+ *
+ * @return 0 for success, else SHELL_ERR_ARG (a message is printed).
+ */
+static int32_t cmd_parse_arg(const struct cmd_arg_desc* desc, const char* str,
+                             void* field)
+{
+#if CMD_ARG_FLOAT_ENABLED
+    char* endptr;
+    float fval;
+#endif
+    int32_t ival;
+    uint32_t uval;
+    int32_t rc;
+    const char* hex;
+    uint16_t* blob_len;
+    uint8_t* blob_data;
+    uint32_t len;
+    uint32_t idx;
+
+    switch (desc->type) {
+        case CMD_ARG_TYPE_INT:
+            rc = num_parse_int(str, &ival);
+            if (rc < 0 && rc != SHELL_ERR_RANGE)
+                return cmd_arg_invalid(desc, str, false);
+            if (rc < 0 || ival < desc->u.i.min || ival > desc->u.i.max)
+                return cmd_arg_invalid(desc, str, true);
+            *(int32_t*)field = ival;
+            break;
+
+        case CMD_ARG_TYPE_UINT:
+            rc = num_parse_uint(str, &uval);
+            if (rc < 0 && rc != SHELL_ERR_RANGE)
+                return cmd_arg_invalid(desc, str, false);
+            if (rc < 0 || uval < desc->u.u.min || uval > desc->u.u.max)
+                return cmd_arg_invalid(desc, str, true);
+            *(uint32_t*)field = uval;
+            break;
+
+        case CMD_ARG_TYPE_BOOL:
+            for (idx = 0; idx < ARRAY_SIZE(cmd_bool_names); idx++)
+                if (strcasecmp(str, cmd_bool_names[idx]) == 0)
+                    break;
+            if (idx >= ARRAY_SIZE(cmd_bool_names))
+                return cmd_arg_invalid(desc, str, false);
+            *(bool*)field = idx & 1;
+            break;
+
+        case CMD_ARG_TYPE_ENUM:
+            for (idx = 0; idx < desc->u.e.num_names; idx++)
+                if (strcasecmp(str, desc->u.e.names[idx]) == 0)
+                    break;
+            if (idx >= desc->u.e.num_names)
+                return cmd_arg_invalid(desc, str, false);
+            *(int32_t*)field = idx;
+            break;
+
+#if CMD_ARG_FLOAT_ENABLED
+        case CMD_ARG_TYPE_FLOAT:
+            fval = strtof(str, &endptr);
+            if (*str == '\0' || *endptr != '\0')
+                return cmd_arg_invalid(desc, str, false);
+            // Written so that NaN is out of range.
+            if (!(fval >= desc->u.f.min && fval <= desc->u.f.max))
+                return cmd_arg_invalid(desc, str, true);
+            *(float*)field = fval;
+            break;
+#endif
+
+        case CMD_ARG_TYPE_FIXED:
+            rc = num_parse_fixed(str, desc->frac_bits, &ival);
+            if (rc < 0 && rc != SHELL_ERR_RANGE)
+                return cmd_arg_invalid(desc, str, false);
+            if (rc < 0 || ival < desc->u.i.min || ival > desc->u.i.max)
+                return cmd_arg_invalid(desc, str, true);
+            *(int32_t*)field = ival;
+            break;
+
+        case CMD_ARG_TYPE_BLOB:
+            // The data follow the length (checked by CMD_ARG_BLOB()).
+            blob_len = field;
+            blob_data = (uint8_t*)field + sizeof(uint16_t);
+            hex = str;
+            if (hex[0] == '0' && (hex[1] == 'x' || hex[1] == 'X'))
+                hex += 2;
+            len = strlen(hex);
+            if (len == 0 || len % 2 != 0)
+                return cmd_arg_invalid(desc, str, false);
+            if (len / 2 > desc->u.max_len)
+                return cmd_arg_invalid(desc, str, true);
+            for (idx = 0; idx < len / 2; idx++) {
+                if (cmd_hex_digit(hex[2 * idx]) < 0 ||
+                    cmd_hex_digit(hex[2 * idx + 1]) < 0)
+                    return cmd_arg_invalid(desc, str, false);
+                blob_data[idx] = cmd_hex_digit(hex[2 * idx]) << 4 |
+                                 cmd_hex_digit(hex[2 * idx + 1]);
+            }
+            *blob_len = len / 2;
+            break;
+
+        case CMD_ARG_TYPE_STR:
+            *(const char**)field = str;
+            break;
+
+        default:
+            printf("Bad argument type %u\n", desc->type);
+            return SHELL_ERR_ARG;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Report an invalid argument of a schema, with the values it can take.
+ *
+ * @param[in] desc The argument description.
+ * @param[in] str The argument.
+ * @param[in] range True if the argument is out of range, rather than malformed.
+ *
+ * @return SHELL_ERR_ARG
+ */
+static int32_t cmd_arg_invalid(const struct cmd_arg_desc* desc,
+                               const char* str, bool range)
+{
+    uint32_t idx;
+
+    printf("%s <%s> '%s'", range ? "Out of range" : "Invalid", desc->name,
+           str);
+
+    switch (desc->type) {
+        case CMD_ARG_TYPE_INT:
+            printf(", must be in [%ld, %ld]", (long)desc->u.i.min,
+                   (long)desc->u.i.max);
+            break;
+        case CMD_ARG_TYPE_UINT:
+            printf(", must be in [%lu, %lu]", (unsigned long)desc->u.u.min,
+                   (unsigned long)desc->u.u.max);
+            break;
+        case CMD_ARG_TYPE_BOOL:
+            printf(", must be 0/1, off/on, false/true or no/yes");
+            break;
+        case CMD_ARG_TYPE_ENUM:
+            printf(", must be one of:");
+            for (idx = 0; idx < desc->u.e.num_names; idx++)
+                printf(" %s", desc->u.e.names[idx]);
+            break;
+#if CMD_ARG_FLOAT_ENABLED
+        case CMD_ARG_TYPE_FLOAT:
+            printf(", must be in [%g, %g]", desc->u.f.min, desc->u.f.max);
+            break;
+#endif
+        case CMD_ARG_TYPE_FIXED:
+            // As scaled integers, so that no floating-point printf is needed.
+            printf(", must be in [%ld, %ld] / 2^%u", (long)desc->u.i.min,
+                   (long)desc->u.i.max, (unsigned)desc->frac_bits);
+            break;
+        case CMD_ARG_TYPE_BLOB:
+            printf(", must be 1 to %lu bytes in hex",
+                   (unsigned long)desc->u.max_len);
+            break;
+        default:
+            break;
+    }
+    printf("\n");
+
+    return SHELL_ERR_ARG;
+}
+
+
+/**
+ * @brief Get the value of a hex digit.
+ *
+ * @param[in] c The character.
+ *
+ * @return Value of the digit, or -1 if c is not a hex digit.
+ */
+static int32_t cmd_hex_digit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+
+/**
+ * @brief Find a client by its full name, without the trie.
+ *
+ * @param[in] name The client name (case insensitive).
+ *
+ * @return Index of the client (see cmd_client_at()), or -1 if not found.
+ */
+static int32_t cmd_find_client(const char* name)
+{
+    int32_t idx;
+
+#if CMD_SECTION_CLIENTS
+    // Binary search of the linker section, sorted by (lowercase) name.
+    int32_t low = 0;
+    int32_t high = CMD_NUM_SECTION_CLIENTS - 1;
+
+    while (low <= high) {
+        int32_t mid = (low + high) / 2;
+        int32_t cmp = strcasecmp(name, __shell_clients_start[mid].name);
+        if (cmp == 0)
+            return mid;
+        if (cmp < 0)
+            high = mid - 1;
+        else
+            low = mid + 1;
+    }
+#endif
+
+#if CMD_HASH_SIZE > 0
+    idx = cmd_hash_find(cmd_hash_str(CMD_HASH_INIT, name), NULL, name);
+    if (idx >= 0 || !cmd_hash_full)
+        return idx;
+#endif
+
+    for (idx = 0; idx < CMD_MAX_CLIENTS && client_info[idx] != NULL; idx++) {
+        if (strcasecmp(name, client_info[idx]->name) == 0)
+            return CMD_NUM_SECTION_CLIENTS + idx;
+    }
+
+    return -1;
+}
+
+
+/**
+ * @brief Find a command of a client by its full name, without the trie.
+ *
+ * @param[in] ci The client info.
+ * @param[in] name The command name (case insensitive).
+ *
+ * @return Index of the command in the client's cmds[], or -1 if not found.
+ *
+ * The command is found through the perfect hash of the client, if it has
+ * one, else through the hash index, else by a linear search.
+ */
+static int32_t cmd_find_cmd(const struct cmd_client_info* ci,
+                            const char* name)
+{
+    const struct cmd_hash_info* ph = ci->cmd_hash;
+    int32_t idx;
+
+    if (ph != NULL) {
+        idx = ph->slots[cmd_hash_str(ph->seed, name) & ph->mask];
+        if (idx != 0 && strcasecmp(name, ci->cmds[idx - 1].name) == 0)
+            return idx - 1;
+        return -1;
+    }
+
+#if CMD_HASH_SIZE > 0
+    uint32_t hash = cmd_hash_str(cmd_hash_str(CMD_HASH_INIT, ci->name), " ");
+
+    idx = cmd_hash_find(cmd_hash_str(hash, name), ci, name);
+    if (idx >= 0 || !cmd_hash_full)
+        return idx;
+#endif
+
+    return cmd_find_name(ci->cmds, ci->num_cmds, name);
+}
+
+
+/**
+ * @brief Find a command by its full name, by a linear search.
+ *
+ * @param[in] cmds The commands.
+ * @param[in] num_cmds Number of commands.
+ * @param[in] name The command name (case insensitive).
+ *
+ * @return Index of the command in cmds[], or -1 if not found.
+ */
+static int32_t cmd_find_name(const struct cmd_info* cmds, int32_t num_cmds,
+                             const char* name)
+{
+    for (int32_t idx = 0; idx < num_cmds; idx++) {
+        if (strcasecmp(name, cmds[idx].name) == 0)
+            return idx;
+    }
+
+    return -1;
+}
+
+
+/**
+ * @brief Hash a string, case insensitively.
+ *
+ * @param[in] hash The hash of the preceding characters.
+ * @param[in] str The string.
+ *
+ * @return The hash of the preceding characters followed by str.
+ *
+ * Only ASCII letters are folded, as by strcasecmp() in the "C" locale.
+ */
+static uint32_t cmd_hash_str(uint32_t hash, const char* str)
+{
+    for (; *str != '\0'; str++)
+        hash = (hash ^ cmd_lower(*str)) * CMD_HASH_PRIME;
+
+    return hash;
+}
+
+
+/**
+ * @brief Fold a character to lowercase, as strcasecmp() in the "C" locale.
+ *
+ * @param[in] c The character.
+ *
+ * @return The character, in lowercase if it is an ASCII letter.
+ */
+static uint8_t cmd_lower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : (uint8_t)c;
+}
+
+#if CMD_HASH_SIZE > 0
+
+/**
+ * @brief Build the hash index from the clients.
+ *
+ * The names of the registered clients are indexed (those of the linker
+ * section are found by a binary search), and the command names of all the
+ * clients, except those with a perfect hash.
+ */
+static void cmd_hash_build(void)
+{
+    const struct cmd_client_info* ci;
+    uint32_t hash;
+    uint32_t cmd_hash_base;
+    int32_t idx;
+
+    memset(cmd_hash, 0, sizeof(cmd_hash));
+    cmd_hash_count = 0;
+    cmd_hash_full = false;
+
+    for (idx = 0; (ci = cmd_client_at(idx)) != NULL && !cmd_hash_full;
+         idx++) {
+        hash = cmd_hash_str(CMD_HASH_INIT, ci->name);
+        if (idx >= CMD_NUM_SECTION_CLIENTS)
+            cmd_hash_insert(hash, idx, CMD_HASH_CLIENT);
+        if (ci->cmd_hash != NULL)
+            continue;
+        if (ci->num_cmds >= CMD_HASH_CLIENT)
+            cmd_hash_full = true;
+        cmd_hash_base = cmd_hash_str(hash, " ");
+        for (int32_t idx2 = 0; idx2 < ci->num_cmds && !cmd_hash_full; idx2++)
+            cmd_hash_insert(cmd_hash_str(cmd_hash_base, ci->cmds[idx2].name),
+                            idx, idx2);
+    }
+    cmd_hash_valid = true;
+
+    if (cmd_hash_full)
+        printf("cmd: hash index full, increase CMD_HASH_SIZE\n");
+}
+
+
+/**
+ * @brief Insert an entry in the hash index.
+ *
+ * @param[in] hash The hash of the name.
+ * @param[in] client_idx Index of the client (see cmd_client_at()).
+ * @param[in] cmd Command index, or CMD_HASH_CLIENT.
+ *
+ * If the index is full, cmd_hash_full is set instead. One entry is always
+ * left free, as it ends the searches.
+ */
+static void cmd_hash_insert(uint32_t hash, int32_t client_idx, uint16_t cmd)
+{
+    uint32_t idx = hash & (CMD_HASH_SIZE - 1);
+
+    if (cmd_hash_count >= CMD_HASH_SIZE - 1 || client_idx >= UINT16_MAX - 1) {
+        cmd_hash_full = true;
+        return;
+    }
+
+    while (cmd_hash[idx].client != 0)
+        idx = (idx + 1) & (CMD_HASH_SIZE - 1);
+    cmd_hash_count++;
+
+    cmd_hash[idx] = (struct cmd_hash_entry) {
+        .hash = hash,
+        .client = client_idx + 1,
+        .cmd = cmd,
+    };
+}
+
+
+/**
+ * @brief Find a name in the hash index.
+ *
+ * @param[in] hash The hash of the name (after its client name, for a
+ *                 command).
+ * @param[in] ci The client of the command, or NULL for a client name.
+ * @param[in] name The name (case insensitive).
+ *
+ * @return Index of the client (see cmd_client_at()), or of the command in the
+ *         client's cmds[], or -1 if not in the index.
+ */
+static int32_t cmd_hash_find(uint32_t hash, const struct cmd_client_info* ci,
+                             const char* name)
+{
+    const struct cmd_hash_entry* entry;
+    const struct cmd_client_info* entry_ci;
+
+    for (uint32_t idx = hash & (CMD_HASH_SIZE - 1);
+         cmd_hash[idx].client != 0;
+         idx = (idx + 1) & (CMD_HASH_SIZE - 1)) {
+        entry = &cmd_hash[idx];
+        if (entry->hash != hash)
+            continue;
+        entry_ci = cmd_client_at(entry->client - 1);
+        if (ci == NULL) {
+            if (entry->cmd == CMD_HASH_CLIENT &&
+                strcasecmp(name, entry_ci->name) == 0)
+                return entry->client - 1;
+        } else if (entry->cmd != CMD_HASH_CLIENT && entry_ci == ci &&
+                   strcasecmp(name, ci->cmds[entry->cmd].name) == 0) {
+            return entry->cmd;
+        }
+    }
+
+    return -1;
+}
+
+#endif /* CMD_HASH_SIZE > 0 */
+
+#if CMD_TRIE_SIZE > 0
+
+
+/**
+ * @brief Build the trie from the clients.
+ *
+ * The help, log and pm commands are added before those of the client, so
+ * they take precedence, and the clients of the linker section before the
+ * others, as cmd_find_client() finds them first.
+ */
+static void cmd_trie_build(void)
+{
+    const struct cmd_client_info* ci;
+    uint16_t node;
+
+    cmd_trie_count = 1;
+    cmd_trie_root = 0;
+    cmd_trie_full = false;
+
+    for (int32_t idx = 0; (ci = cmd_client_at(idx)) != NULL; idx++) {
+        node = cmd_trie_insert(&cmd_trie_root, ci->name, CMD_NAME_CLIENT, ci);
+        if (node == 0)
+            continue;
+        cmd_trie_insert(&cmd_trie[node].sub, cmd_builtin_names[CMD_NAME_HELP],
+                        CMD_NAME_HELP, NULL);
+        if (ci->log_level_ptr != NULL)
+            cmd_trie_insert(&cmd_trie[node].sub,
+                            cmd_builtin_names[CMD_NAME_LOG],
+                            CMD_NAME_LOG, NULL);
+        if (ci->num_pms > 0)
+            cmd_trie_insert(&cmd_trie[node].sub,
+                            cmd_builtin_names[CMD_NAME_PM],
+                            CMD_NAME_PM, NULL);
+        cmd_trie_add_cmds(&cmd_trie[node].sub, ci->cmds, ci->num_cmds);
+    }
+    cmd_trie_valid = true;
+
+    if (cmd_trie_full)
+        printf("cmd: name trie full, increase CMD_TRIE_SIZE\n");
+}
+
+
+/**
+ * @brief Add commands to a level of the trie, with their subcommands.
+ *
+ * @param[in,out] level The first node of the level.
+ * @param[in] cmds The commands.
+ * @param[in] num_cmds Number of commands.
+ */
+static void cmd_trie_add_cmds(uint16_t* level, const struct cmd_info* cmds,
+                              int32_t num_cmds)
+{
+    uint16_t node;
+
+    for (int32_t idx = 0; idx < num_cmds; idx++) {
+        node = cmd_trie_insert(level, cmds[idx].name, CMD_NAME_CMD,
+                               &cmds[idx]);
+        if (node != 0 && cmds[idx].num_subcmds > 0)
+            cmd_trie_add_cmds(&cmd_trie[node].sub, cmds[idx].subcmds,
+                              cmds[idx].num_subcmds);
+    }
+}
+
+
+/**
+ * @brief Insert a name in a level of the trie.
+ *
+ * @param[in,out] level The first node of the level.
+ * @param[in] name The name. It must outlive the trie (the labels point in it).
+ * @param[in] type The kind of name (enum cmd_name_type).
+ * @param[in] target The object named.
+ *
+ * @return The node where the name ends, or 0 if it is already in the level
+ *         (the first one is kept) or the trie is full.
+ */
+static uint16_t cmd_trie_insert(uint16_t* level, const char* name,
+                                uint8_t type, const void* target)
+{
+    uint32_t len = strlen(name);
+    uint32_t common;
+    uint32_t pos = 0;
+    uint16_t* link = level;
+    uint16_t node;
+    uint16_t split;
+    struct cmd_trie_node* n;
+
+    if (len == 0)
+        return 0;
+    node = cmd_trie_walk(*level, name, len, &pos);
+    if (node != 0 && pos == cmd_trie[node].len &&
+        cmd_trie[node].type != CMD_NAME_NONE)
+        return 0;
+
+    // A name takes two nodes at most: its leaf, and the split of an edge.
+    if (len > UINT8_MAX || cmd_trie_count > CMD_TRIE_SIZE - 2) {
+        cmd_trie_full = true;
+        return 0;
+    }
+
+    while (1) {
+        // Find the child starting with the next character.
+        while (*link != 0 &&
+               cmd_lower(cmd_trie[*link].label[0]) < cmd_lower(*name))
+            link = &cmd_trie[*link].sibling;
+        node = *link;
+
+        if (node == 0 ||
+            cmd_lower(cmd_trie[node].label[0]) != cmd_lower(*name)) {
+            // None: the rest of the name is a new leaf.
+            node = cmd_trie_count++;
+            cmd_trie[node] = (struct cmd_trie_node) {
+                .label = name,
+                .target = target,
+                .sibling = *link,
+                .num_names = 1,
+                .len = len,
+                .type = type,
+            };
+            *link = node;
+            return node;
+        }
+
+        n = &cmd_trie[node];
+        for (common = 1; common < n->len && common < len &&
+             cmd_lower(n->label[common]) == cmd_lower(name[common]); common++)
+            ;
+        if (common < n->len) {
+            // The name leaves the edge: split it, the node keeps the common
+            // characters, and the rest moves to a new child.
+            split = cmd_trie_count++;
+            cmd_trie[split] = *n;
+            cmd_trie[split].label += common;
+            cmd_trie[split].len -= common;
+            cmd_trie[split].sibling = 0;
+            n->child = split;
+            n->sub = 0;
+            n->len = common;
+            n->type = CMD_NAME_NONE;
+            n->target = NULL;
+        }
+        n->num_names++;
+
+        name += common;
+        len -= common;
+        if (len == 0) {
+            n->type = type;
+            n->target = target;
+            return node;
+        }
+        link = &n->child;
+    }
+}
+
+
+/**
+ * @brief Follow a string in a level of the trie.
+ *
+ * @param[in] level The first node of the level.
+ * @param[in] str The string (case insensitive).
+ * @param[in] len Length of the string (at least 1).
+ * @param[out] pos Number of characters of the node's label in the string.
+ *
+ * @return The node whose edge the string ends on, or 0 if no name of the
+ *         level starts with the string.
+ */
+static uint16_t cmd_trie_walk(uint16_t level, const char* str, uint32_t len,
+                              uint32_t* pos)
+{
+    uint16_t node = level;
+    const struct cmd_trie_node* n;
+    uint32_t idx;
+
+    while (node != 0) {
+        n = &cmd_trie[node];
+        if (cmd_lower(n->label[0]) != cmd_lower(*str)) {
+            node = n->sibling;
+            continue;
+        }
+        for (idx = 1; idx < n->len && idx < len; idx++) {
+            if (cmd_lower(n->label[idx]) != cmd_lower(str[idx]))
+                return 0;
+        }
+        if (len <= n->len) {
+            *pos = len;
+            return node;
+        }
+        str += n->len;
+        len -= n->len;
+        node = n->child;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Find a name in a level of the trie, or the only one starting with a
+ *        string.
+ *
+ * @param[in] level The first node of the level (0 for an empty level).
+ * @param[in] str The name or its start (case insensitive).
+ * @param[in] len Length of str.
+ * @param[out] match The name found, or the node reached if ambiguous.
+ *
+ * @return Result of the search.
+ *
+ * A name is found even if it is the start of others (e.g. "set" with "setup").
+ */
+static enum cmd_match_rc cmd_trie_match(uint16_t level, const char* str,
+                                        uint32_t len, struct cmd_match* match)
+{
+    const struct cmd_trie_node* n;
+    uint32_t pos = 0;
+    uint16_t node;
+
+    node = len > 0 ? cmd_trie_walk(level, str, len, &pos) : 0;
+    match->node = node;
+    if (node == 0)
+        return CMD_MATCH_NONE;
+
+    n = &cmd_trie[node];
+    if ((pos == n->len && n->type != CMD_NAME_NONE) || n->num_names == 1) {
+        match->type = n->type;
+        match->target = n->target;
+        match->sub = n->sub;
+        return CMD_MATCH_FOUND;
+    }
+
+    return CMD_MATCH_AMBIGUOUS;
+}
+
+
+/**
+ * @brief Get the name ending at a trie node.
+ *
+ * @param[in] node The node (with a name).
+ *
+ * @return The full name.
+ */
+static const char* cmd_trie_name(uint16_t node)
+{
+    return cmd_name(cmd_trie[node].type, cmd_trie[node].target);
+}
+
+
+/**
+ * @brief Get the name of a client, command or built-in command.
+ *
+ * @param[in] type The type of name (enum cmd_name_type).
+ * @param[in] target The client or command info (unused for the built-ins).
+ *
+ * @return The name.
+ */
+static const char* cmd_name(uint8_t type, const void* target)
+{
+    switch (type) {
+        case CMD_NAME_CLIENT:
+            return ((const struct cmd_client_info*)target)->name;
+        case CMD_NAME_CMD:
+            return ((const struct cmd_info*)target)->name;
+        default:
+            return cmd_builtin_names[type];
+    }
+}
+
+
+/**
+ * @brief Print the names ending at a trie node or below it (in its level),
+ *        in alphabetical order, each after a space.
+ *
+ * @param[in] node The node.
+ */
+static void cmd_trie_list(uint16_t node)
+{
+    if (cmd_trie[node].type != CMD_NAME_NONE)
+        printf(" %s", cmd_trie_name(node));
+
+    for (node = cmd_trie[node].child; node != 0; node = cmd_trie[node].sibling)
+        cmd_trie_list(node);
+}
+
+#endif /* CMD_TRIE_SIZE > 0 */
@@ -1,105 +1,181 @@
-/**
- * @brief Implementation of console module.
- */
-
-#include "shell.h"
-
-//=============================================================================
-//                           Macro Definitions
-//=============================================================================
-#define PROMPT "> "
-
-//=============================================================================
-//                            Type Definitions
-//=============================================================================
-#define CONSOLE_CMD_BFR_SIZE 80
-
-struct console_state {
-    struct console_cfg cfg;
-    char cmd_bfr[CONSOLE_CMD_BFR_SIZE];
-    uint16_t num_cmd_bfr_chars;
-    bool start_of_line;
-};
-
-//=============================================================================
-//                       Private (static) variables
-//=============================================================================
-static struct console_state state;
-static int32_t log_level = LOG_DEFAULT;
-
-//=============================================================================
-//                          Function Definitions
-//=============================================================================
-int32_t console_get_default_cfg(struct console_cfg* cfg)
-{
-    if (cfg == NULL)
-        return SHELL_ERR_ARG;
-
-    memset(cfg, 0, sizeof(struct console_cfg));
-    cfg->ttys_instance_id = TTYS_INSTANCE_UART1;
-
-    return 0;
-}
-
-
-int32_t console_init(struct console_cfg* cfg)
-{
-    if (cfg == NULL)
-        return SHELL_ERR_ARG;
-
-    log_debug("Initializing console...\n");
-    memset(&state, 0, sizeof(struct console_state));
-    state.cfg = *cfg;
-    state.start_of_line = true;
-
-    return 0;
-}
-
-
-int32_t console_run(void)
-{
-    char c;
-
-    // Print the PROMPT character if we are in the start of line
-    if (state.start_of_line) {
-        state.start_of_line = false;
-        printf(PROMPT);
-    }
-
-    while (ttys_getc(state.cfg.ttys_instance_id, &c)) {
-
-        // Handle the processing of completed command line
-        if (c == '\n' || c == '\r') {
-            state.cmd_bfr[state.num_cmd_bfr_chars] = '\0';
-            printf("\n");
-            cmd_execute(state.cmd_bfr);
-            state.num_cmd_bfr_chars = 0;
-            state.start_of_line = true;
-        }
-        // Handle backspace/delete
-        else if (c == '\b' || c == '\x7f') {
-            if (state.num_cmd_bfr_chars > 0) {
-                // Overwrite last character with a blank
-                printf("\b \b");
-                state.num_cmd_bfr_chars--;
-            }
-        }
-        // Handle logging on/off toggle
-        else if (c == LOG_TOGGLE_CHAR) {
-            log_toggle_active();
-            printf("\n<Logging %s>\n", log_is_active() ? "on" : "off");
-        }
-        // Echo the character back.
-        else if (isprint(c)) {
-            if (state.num_cmd_bfr_chars < (CONSOLE_CMD_BFR_SIZE-1)) {
-                state.cmd_bfr[state.num_cmd_bfr_chars++] = c;
-                printf("%c", c);
-            } else {
-                // No space in buffer for the character!
-                printf("\a");
-            }
-        }
-    }
-
-    return 0;
-}
+/**
+ * @brief Implementation of console module.
+ */
+
+#include "shell.h"
+
+//=============================================================================
+//                           Macro Definitions
+//=============================================================================
+#define PROMPT "> "
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+#define CONSOLE_CMD_BFR_SIZE 80
+
+// Number of characters taken from the ttys per read.
+#define CONSOLE_RX_CHUNK_SIZE 32
+
+struct console_state {
+    struct console_cfg cfg;
+    char cmd_bfr[CONSOLE_CMD_BFR_SIZE];
+    uint16_t num_cmd_bfr_chars;
+    uint16_t num_echoed_chars;
+    bool start_of_line;
+    bool last_char_cr;
+};
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static void console_echo(void);
+
+//=============================================================================
+//                       Private (static) variables
+//=============================================================================
+static struct console_state state;
+static int32_t log_level = LOG_DEFAULT;
+
+//=============================================================================
+//                          Function Definitions
+//=============================================================================
+int32_t console_get_default_cfg(struct console_cfg* cfg)
+{
+    if (cfg == NULL)
+        return SHELL_ERR_ARG;
+
+    memset(cfg, 0, sizeof(struct console_cfg));
+    cfg->ttys_instance_id = (enum ttys_instance_id)0;  // First enabled UART
+
+    return 0;
+}
+
+
+int32_t console_init(struct console_cfg* cfg)
+{
+    if (cfg == NULL)
+        return SHELL_ERR_ARG;
+
+    log_debug("Initializing console...\n");
+    memset(&state, 0, sizeof(struct console_state));
+    state.cfg = *cfg;
+    state.start_of_line = true;
+
+    return 0;
+}
+
+
+int32_t console_run(void)
+{
+    char bfr[CONSOLE_RX_CHUNK_SIZE];
+    int32_t num_chars;
+    int32_t idx;
+    int32_t rc;
+    char c;
+
+    // Print the PROMPT character if we are in the start of line
+    if (state.start_of_line) {
+        state.start_of_line = false;
+        printf(PROMPT);
+    }
+
+    // All the available input is processed, so that pasted scripts are run
+    // line after line at the rate they arrive (ttys flow control keeps the
+    // host from overrunning the RX buffer while commands run).
+    while ((num_chars = ttys_read(state.cfg.ttys_instance_id, bfr,
+                                  sizeof(bfr))) > 0) {
+        for (idx = 0; idx < num_chars; idx++) {
+            c = bfr[idx];
+
+            // A CR LF pair (e.g. from pasted text) ends a single line.
+            if (c == '\n' && state.last_char_cr) {
+                state.last_char_cr = false;
+                continue;
+            }
+            state.last_char_cr = (c == '\r');
+
+            // Print the prompt of the next line, if there is one in the input.
+            if (state.start_of_line) {
+                state.start_of_line = false;
+                printf(PROMPT);
+            }
+
+            // Printable characters are echoed in bulk, so only flush the
+            // echo before other output.
+            if (!isprint((unsigned char)c))
+                console_echo();
+
+            // Handle the processing of completed command line
+            if (c == '\n' || c == '\r') {
+                state.cmd_bfr[state.num_cmd_bfr_chars] = '\0';
+                printf("\n");
+                cmd_execute(state.cmd_bfr);
+                state.num_cmd_bfr_chars = 0;
+                state.num_echoed_chars = 0;
+                state.start_of_line = true;
+            }
+            // Handle backspace/delete
+            else if (c == '\b' || c == '\x7f') {
+                if (state.num_cmd_bfr_chars > 0) {
+                    // Overwrite last character with a blank
+                    printf("\b \b");
+                    state.num_cmd_bfr_chars--;
+                    state.num_echoed_chars--;
+                }
+            }
+            // Handle command name completion
+            else if (c == '\t') {
+                state.cmd_bfr[state.num_cmd_bfr_chars] = '\0';
+                rc = cmd_complete(state.cmd_bfr, CONSOLE_CMD_BFR_SIZE);
+                if (rc < 0) {
+                    printf("\a");
+                } else if (rc == 0) {
+                    // The names were listed: print the line again.
+                    printf(PROMPT);
+                    state.num_echoed_chars = 0;
+                }
+                state.num_cmd_bfr_chars = strlen(state.cmd_bfr);
+            }
+            // Handle logging on/off toggle
+            else if (c == LOG_TOGGLE_CHAR) {
+                log_toggle_active();
+                printf("\n<Logging %s>\n", log_is_active() ? "on" : "off");
+            }
+            // Store the character, it is echoed back later.
+            else if (isprint((unsigned char)c)) {
+                if (state.num_cmd_bfr_chars < (CONSOLE_CMD_BFR_SIZE-1)) {
+                    state.cmd_bfr[state.num_cmd_bfr_chars++] = c;
+                } else {
+                    // No space in buffer for the character!
+                    console_echo();
+                    printf("\a");
+                }
+            }
+        }
+        console_echo();
+    }
+
+    // Call the expired timers, then output the log messages queued by the
+    // deferred log modes.
+    tmr_run();
+    log_drain();
+
+    return 0;
+}
+
+//=============================================================================
+//                       Private (static) functions
+//=============================================================================
+/**
+ * @brief Echo the command line characters that haven't been echoed yet.
+ */
+static void console_echo(void)
+{
+    if (state.num_echoed_chars < state.num_cmd_bfr_chars) {
+        ttys_write(state.cfg.ttys_instance_id,
+                   &state.cmd_bfr[state.num_echoed_chars],
+                   state.num_cmd_bfr_chars - state.num_echoed_chars);
+        state.num_echoed_chars = state.num_cmd_bfr_chars;
+    }
+}
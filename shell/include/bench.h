@@ -0,0 +1,59 @@
+#ifndef _SHELL_BENCH_H_
+#define _SHELL_BENCH_H_
+
+/**
+ * @brief Interface declaration of bench module.
+ *
+ * This module provides console commands to measure the shell on the target,
+ * with the CPU cycle counter (see port_get_cycles()):
+ *
+ * > bench tx <bytes>
+ *   Sends bytes of test pattern through the ttys instance of stdout, and
+ *   reports the time until the last one has left the UART, the throughput and
+ *   its ratio to the line rate (10 bits per character).
+ *
+ * > bench echo <seq>
+ *   Replies "echo <seq> <cycles> <cycles-per-second>", so that a host tool can
+ *   time command round trips, and compare them with the shell's clock (see
+ *   tools/bench_echo.py).
+ *
+ * > bench cmd <n> <command line>
+ *   Runs the command line n times with cmd_execute(), and reports the
+ *   min/avg/max cycles per run. The output of the command is included, so
+ *   commands with little output measure the dispatch best (e.g.
+ *   "bench cmd 100 dio set LED_1 1").
+ *
+ * The module is compiled out unless SHELL_BENCH_ENABLED is set to 1 (e.g.
+ * -DSHELL_BENCH_ENABLED=1). The commands use the cycle counter that
+ * tmr_init() starts.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//                         Preprocessor Constants
+//=============================================================================
+// Set to 1 to build the bench commands.
+#ifndef SHELL_BENCH_ENABLED
+#define SHELL_BENCH_ENABLED 0
+#endif
+
+//=============================================================================
+//                      BENCH module interface functions
+//=============================================================================
+/**
+ * @brief Initialize bench module.
+ *
+ * @return 0 for success, else a "ERR" value.
+ */
+int32_t bench_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHELL_BENCH_H_ */
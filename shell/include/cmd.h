@@ -1,213 +1,691 @@
-#ifndef _SHELL_CMD_H_
-#define _SHELL_CMD_H_
-
-/**
- * @brief Interface declaration of cmd module.
- *
- * This module is a utility used by clients (e.g. other modules) to provide
- * console commands. It works like this:
- * - Client register a set of console commands during startup.
- * - When the console module receives a command line string, it passes it to
- *   this (cmd) module which parses the string, and handles it directly, or
- *   calls a client command handler function.
- * - This module also provides some common commands automatically, on behalf
- *   of the clients, as described below.
- *
- * Generally, a command line string consists of a client name, then the command
- * name, and then optional command arguments.
- *
- * For example, say the tmr module has two commands, "status" and "test". The
- * tmr module would register these commands, with this (cmd) module. It would
- * specify a client name of "tmr". It would provide information for the commands
- * "status" and "test". Then, to invoke these commands, the console user would
- * enter commands like this.
- *
- * > tmr status
- * > tmr test get 0
- *
- * This module would parse the command line, and call the appropriate command
- * handler function specified by the tmr client (as part of registration).
- *
- * All command line tokens (i.e. the client name, the command name, and any
- * arguments) are passed to the command handler using the (int32_t argc, char**
- * argv) pattern. It is up to the command handler function to validate the
- * arguments.
- *
- * The cmd module provides several commands automatically on behalf of the
- * clients:
- * - A help command. For example, if the console user enters "tmr help" then a
- *   list of tmr commands is printed.
- * - A command to get and set the client's logging level, if the client provided
- *   access to its logging level variable (as part of registration). For
- *   example, the console user could enter "tmr log" to get the current log
- *   level, or "tmr log debug" or "tmr log off" to set the log level.
- * - A command to get or clear the client's performance measurements (typically
- *   counters), if the client provided access to these measurements (as part of
- *   registration). For example, the console user could enter "ttys pm" to get
- *   the current performance measurement values, or "ttys pm clear" to clear
- *   them.
- *
- * The cmd module provides a global "help" command to list the commands of all
- * clients. The token "?" can be used in place of help.
- *
- * The cmd module provides "wild card" commands which are executed for all
- * clients. In this case, the first token in the command line is "*" rather than
- * a client name. The following wild card commands are supported:
- *
- * > * log
- * > * log <new-level>
- */
-
-#include <stdint.h>
-
-//=============================================================================
-//                         Preprocessor Constants
-//=============================================================================
-/**
- * Maximum number of clients (modules) supported
- */
-#define CMD_MAX_CLIENTS  10
-
-//=============================================================================
-//                            Type Definitions
-//=============================================================================
-/**
- * Function signature for a command handler function
- */
-typedef int32_t (*cmd_func)(int32_t argc, const char** argv);
-
-/**
- * Information about a single command, provided by the client
- */
-struct cmd_info {
-    const char* const name;  /**< Name of command     */
-    const char* const help;  /**< Command help string */
-    const cmd_func func;     /**< Command function    */
-};
-
-/**
- * Information provided by the client:
- * - Command base name
- * - Command set info
- * - Pointer to log level variable (optional)
- */
-struct cmd_client_info {
-    const char* const name;                  /**< Client name (first command line token)  */
-    const int32_t num_cmds;                  /**< Number of commands                      */
-    const struct cmd_info* const cmds;       /**< Pointer to array of command info struct */
-    int32_t* const log_level_ptr;            /**< Pointer to log level variable (or NULL) */
-};
-
-/**
- * Structure containing a parsed argument value
- */
-struct cmd_arg_val {
-    char type;
-    union {
-        void*       p;
-        uint8_t*    p8;
-        uint16_t*   p16;
-        uint32_t*   p32;
-        int32_t     i;
-        uint32_t    u;
-        const char* s;
-    } val;
-};
-
-struct cmd_cfg {
-    // FUTURE
-};
-
-//=============================================================================
-//                       CMD module interface functions
-//=============================================================================
-/**
- * @brief Initialize cmd instance.
- *
- * @param[in] cfg The cmd configuration. (FUTURE)
- *
- * @return 0 for success, else a "ERR" value.
- *
- * This function initializes the cmd singleton module. Generally, it should not
- * access other modules as they might not have been initialized yet. An
- * exception is the log module.
- */
-int32_t cmd_init(struct cmd_cfg* cfg);
-
-/**
- * @brief Register a client.
- *
- * @param[in] cmd_client_info The client's configuration (eg. command metadata)
- *
- * @return 0 for success, else a "SHELL_ERR_RESOURCE" value.
- *
- * @note This function keeps a copy of the cmd_client_info pointer.
- */
-int32_t cmd_register(const struct cmd_client_info* cmd_client_info);
-
-/**
- * @brief Execute a command line
- *
- * @param[in] bfr The buffer containing the command line arguments.
- *
- * @return 0 for success, else a "ERR" value. See code for details.
- *
- * This function parses the command line and then executes the command,
- * typically by running a command function handler for a client.
- *
- * @note The user may not need to call this function as it's implicitly
- * called by the console module.
- */
-int32_t cmd_execute(char* bfr);
-
-/**
- * @brief Parse and validate command arguments
- *
- * @param[in]  argc The number of arguments to be parsed.
- * @param[in]  argv Pointer string array of arguments to be be parsed.
- * @param[in]  fmt String indicating expected argument types (format)
- * @param[out] arg_vals Pointer to array of parsed argument values
- *
- * @return Number of parsed arguments, negative value if error.
- *
- * @note In case of error, an error message is always printed to the
- * console.
- *
- * This function provides a common method to parse and validate command
- * arguments. In particular, it does string to numeric conversions, with error
- * checking.
- *
- * A format string is used to guide the parsing. The format string contains a
- * letter for each expected argument. The supported letters are:
- * - i Integer value, in either decimal, octal, or hex formats. Octal values
- *     must start with 0, and hex values must start with 0x.
- * - u Unsigned value, in either decimal, octal, or hex formats. Octal values
- *     must start with 0, and hex values must start with 0x.
- * - p Pointer, in hex format. No leading 0x is necessary (but allowed).
- * - s String
- *
- * In addition:
- * - [ indicates that remaining arguments are optional. However,
- *   if one optional argument is present, then subsequent arguments
- *   are required.
- * - ] is ignored; it can be put into the fmt string for readability,
- *   to match brackets.
- *
- * Examples:
- *   "up" - Requires exactly one unsigned and one pointer argument.
- *   "ii" - Requires exactly two integer arguments.
- *   "i[i" - Requires either one or two integer arguments.
- *   "i[i]" - Same as above (matched brackets).
- *   "i[i[i" - Requires either one, two, or three integer arguments.
- *   "i[i[i]]" - Same as above (matched brackets).
- *   "i[ii" - Requires either one or three integer arguments.
- *   "i[ii]" - Same as above (matched brackets).
- *
- * @return On success, the number of arguments present (>=0), a "ERR" value
- *         (<0). See code for details.
- *
- */
-int32_t cmd_parse_args(int32_t argc, const char** argv, const char* fmt,
-                       struct cmd_arg_val* arg_vals);
-
-#endif /* _SHELL_CMD_H_ */
+#ifndef _SHELL_CMD_H_
+#define _SHELL_CMD_H_
+
+/**
+ * @brief Interface declaration of cmd module.
+ *
+ * This module is a utility used by clients (e.g. other modules) to provide
+ * console commands. It works like this:
+ * - Client register a set of console commands during startup.
+ * - When the console module receives a command line string, it passes it to
+ *   this (cmd) module which parses the string, and handles it directly, or
+ *   calls a client command handler function.
+ * - This module also provides some common commands automatically, on behalf
+ *   of the clients, as described below.
+ *
+ * Generally, a command line string consists of a client name, then the command
+ * name, and then optional command arguments.
+ *
+ * For example, say the tmr module has two commands, "status" and "test". The
+ * tmr module would register these commands, with this (cmd) module. It would
+ * specify a client name of "tmr". It would provide information for the commands
+ * "status" and "test". Then, to invoke these commands, the console user would
+ * enter commands like this.
+ *
+ * > tmr status
+ * > tmr test get 0
+ *
+ * This module would parse the command line, and call the appropriate command
+ * handler function specified by the tmr client (as part of registration).
+ *
+ * All command line tokens (i.e. the client name, the command name, and any
+ * arguments) are passed to the command handler using the (int32_t argc, char**
+ * argv) pattern. It is up to the command handler function to validate the
+ * arguments.
+ *
+ * Alternatively, a command can describe its arguments with a schema (see
+ * CMD_ARGS()) instead of a function. This module then parses and checks the
+ * arguments into a struct of the command, and calls the schema's function with
+ * it only if they are all valid. The schema is checked at build time against
+ * the struct (field types, ranges), e.g.
+ * @code
+ *     struct set_args {
+ *         const char* name;
+ *         bool value;
+ *     };
+ *
+ *     .args = CMD_ARGS(struct set_args, cmd_set, 2,
+ *                      CMD_ARG_STR(struct set_args, name, "output-name"),
+ *                      CMD_ARG_BOOL(struct set_args, value, "value")),
+ * @endcode
+ *
+ * The cmd module provides several commands automatically on behalf of the
+ * clients:
+ * - A help command. For example, if the console user enters "tmr help" then a
+ *   list of tmr commands is printed.
+ * - A command to get and set the client's logging level, if the client provided
+ *   access to its logging level variable (as part of registration). For
+ *   example, the console user could enter "tmr log" to get the current log
+ *   level, or "tmr log debug" or "tmr log off" to set the log level.
+ * - A command to get or clear the client's performance measurements (typically
+ *   counters), if the client provided access to these measurements (as part of
+ *   registration). For example, the console user could enter "ttys pm" to get
+ *   the current performance measurement values, or "ttys pm clear" to clear
+ *   them.
+ *
+ * The cmd module provides a global "help" command to list the commands of all
+ * clients. The token "?" can be used in place of help.
+ *
+ * A command can have subcommands, which take the next token of the command
+ * line, e.g. "ttys 1 pm clear" runs the "pm" subcommand of the "1" command of
+ * the ttys client (with "clear" as argument). A command with subcommands can
+ * also have a function, which is called when the next token is not one of
+ * them.
+ *
+ * A full name is found without comparing it with all the others: by a binary
+ * search of the linker section for a client (see below), by the perfect hash
+ * of a C++ command table for a command (see cmd_table.hpp), else through a
+ * hash index of the names (see CMD_HASH_SIZE).
+ *
+ * Each name (client, command or subcommand) can also be abbreviated, as long
+ * as the abbreviation is the start of no other name at the same place, e.g.
+ * "di st" for "dio status". The command function then gets the full names in
+ * argv[]. The abbreviations are found through a prefix tree (trie) of the
+ * names, built on the first abbreviation after a registration (see
+ * CMD_TRIE_SIZE), so that the search takes the same time whatever the number
+ * of commands. The console also uses it to complete names with the Tab key
+ * (see cmd_complete()).
+ *
+ * The cmd module provides "wild card" commands which are executed for all
+ * clients. In this case, the first token in the command line is "*" rather than
+ * a client name. The following wild card commands are supported:
+ *
+ * > * log
+ * > * log <new-level>
+ * > * pm
+ * > * pm clear
+ *
+ * A client is normally defined with SHELL_CLIENT(), e.g.
+ * @code
+ *     SHELL_CLIENT(dio,
+ *         .num_cmds = ARRAY_SIZE(cmds),
+ *         .cmds = cmds,
+ *         .log_level_ptr = &log_level,
+ *     );
+ * @endcode
+ * which needs no registration call. With CMD_SECTION_CLIENTS set to 1, the
+ * client records are placed in the .shell_clients.<name> sections, which the
+ * linker sorts by name and gathers in flash, between the __shell_clients_start
+ * and __shell_clients_end symbols (see shell/port/shell_clients.ld). Then there
+ * is no limit on the number of clients, no RAM is used for them, nothing is
+ * done at startup, and a client is found by a binary search on its name.
+ * Otherwise (the default, no linker script change needed), each record is
+ * registered by a constructor function before main(), as with cmd_register().
+ *
+ * cmd_register() remains for the clients built at run time.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//                         Preprocessor Constants
+//=============================================================================
+/**
+ * Maximum number of clients (modules) registered with cmd_register(), or by
+ * SHELL_CLIENT() without CMD_SECTION_CLIENTS
+ */
+#define CMD_MAX_CLIENTS  10
+
+/**
+ * Set to 1 to place the SHELL_CLIENT() records in a sorted linker section
+ * (the linker script must include shell/port/shell_clients.ld).
+ */
+#ifndef CMD_SECTION_CLIENTS
+#define CMD_SECTION_CLIENTS  0
+#endif
+
+/**
+ * Size of the command name hash index (a power of 2, or 0 for no index).
+ *
+ * The names of the registered clients, and the command names of the clients
+ * without a perfect hash, are indexed in a hash table, built on the first
+ * command after a registration. It needs an entry per name, and should be at
+ * most about 3/4 full; if it is full, the names left out are found by a
+ * linear search (and a warning is printed). Each entry takes 8 bytes. With 0,
+ * these names are all found by a linear search.
+ */
+#ifndef CMD_HASH_SIZE
+#define CMD_HASH_SIZE  64
+#endif
+
+/**
+ * Number of nodes of the command name trie (at most 65535, or 0 for no trie).
+ *
+ * The trie only serves the abbreviations and the Tab completion. Each name
+ * (client, command, subcommand, and the help, log and pm commands of the
+ * clients) takes one or two nodes, of 20 bytes. If the trie is full, the
+ * names left out cannot be abbreviated nor completed (a warning is printed).
+ * With 0, the names must be given in full, and nothing is completed.
+ */
+#ifndef CMD_TRIE_SIZE
+#define CMD_TRIE_SIZE  128
+#endif
+
+/**
+ * Maximum number of tokens in a command line
+ */
+#ifndef CMD_MAX_TOKENS
+#define CMD_MAX_TOKENS  16
+#endif
+
+/**
+ * Maximum size of the argument struct of a schema (see CMD_ARGS())
+ */
+#ifndef CMD_ARGS_MAX_SIZE
+#define CMD_ARGS_MAX_SIZE  64
+#endif
+
+/**
+ * Set to 1 to allow floating-point arguments in schemas (CMD_ARG_FLOAT()).
+ * They are parsed with strtof() and their range is printed with %g, so they
+ * link the floating-point parts of the C library. Fixed-point arguments
+ * (CMD_ARG_FIXED()) don't.
+ */
+#ifndef CMD_ARG_FLOAT_ENABLED
+#define CMD_ARG_FLOAT_ENABLED  0
+#endif
+
+/**
+ * Default value of an optional struct member, in C++ only: there a designated
+ * initializer that leaves the member out warns with -Wextra, unless the member
+ * has a default.
+ */
+#ifdef __cplusplus
+#define CMD_DEFAULT(value)  = value
+#else
+#define CMD_DEFAULT(value)
+#endif
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+/**
+ * Function signature for a command handler function
+ */
+typedef int32_t (*cmd_func)(int32_t argc, const char** argv);
+
+/**
+ * Function signature for a command handler function with an argument schema.
+ * args points to the schema's struct, and num_args is the number of arguments
+ * given (the optional ones that are not given are zero).
+ */
+typedef int32_t (*cmd_args_func)(const void* args, int32_t num_args);
+
+/**
+ * Types of the arguments of a schema, and the type of their struct field
+ */
+enum cmd_arg_type {
+    CMD_ARG_TYPE_INT,    /**< int32_t, within a range                        */
+    CMD_ARG_TYPE_UINT,   /**< uint32_t, within a range                       */
+    CMD_ARG_TYPE_BOOL,   /**< bool, from 0/1, off/on, false/true or no/yes   */
+    CMD_ARG_TYPE_ENUM,   /**< int32_t, index of the name given in a list     */
+    CMD_ARG_TYPE_FLOAT,  /**< float, within a range                          */
+    CMD_ARG_TYPE_FIXED,  /**< int32_t, fixed-point with frac_bits fraction   */
+                         /**< bits (Q format), within a range                */
+    CMD_ARG_TYPE_BLOB,   /**< CMD_ARG_BLOB_T(size), from hex digits          */
+    CMD_ARG_TYPE_STR,    /**< const char*                                    */
+};
+
+/**
+ * Description of an argument of a schema. It is defined with the CMD_ARG_xxx()
+ * macros, which check it against the struct field at build time.
+ */
+struct cmd_arg_desc {
+    const char* const name;     /**< Name, for the error messages           */
+    const uint16_t offset;      /**< Offset of the field in the struct      */
+    const uint8_t type;         /**< Type (enum cmd_arg_type)               */
+    const uint8_t frac_bits;    /**< Fraction bits (CMD_ARG_TYPE_FIXED)     */
+    const union {
+        struct {
+            int32_t min;
+            int32_t max;
+        } i;                    /**< Range (INT, and FIXED in raw values)   */
+        struct {
+            uint32_t min;
+            uint32_t max;
+        } u;                    /**< Range (UINT)                           */
+        struct {
+            float min;
+            float max;
+        } f;                    /**< Range (FLOAT)                          */
+        struct {
+            const char* const* names;
+            uint32_t num_names;
+        } e;                    /**< Names of the values (ENUM)             */
+        uint32_t max_len;       /**< Maximum number of bytes (BLOB)         */
+    } u;
+};
+
+/**
+ * Argument schema of a command, defined with CMD_ARGS()
+ */
+struct cmd_args_schema {
+    const cmd_args_func func;             /**< Command function              */
+    const struct cmd_arg_desc* const args;/**< Arguments, in order          */
+    const uint8_t num_args;               /**< Number of arguments           */
+    const uint8_t num_required;           /**< Number of required arguments  */
+    const uint16_t size;                  /**< Size of the argument struct   */
+};
+
+/**
+ * Information about a single command, provided by the client
+ */
+struct cmd_info {
+    const char* const name;                /**< Name of command                */
+    const char* const help;                /**< Command help string            */
+    const cmd_func func;                   /**< Command function (or NULL)     */
+    const int32_t num_subcmds;             /**< Number of subcommands          */
+    const struct cmd_info* const subcmds;  /**< Array of subcommands (or NULL) */
+    const struct cmd_args_schema* const args; /**< Argument schema, used      */
+                                           /**< instead of func (or NULL)      */
+};
+
+/**
+ * Information about a single performance measurement, provided by the client.
+ * A measurement is either a counter, which is cleared by the "pm clear"
+ * command, or a gauge (e.g. a current level), which is not.
+ */
+struct cmd_pm_info {
+    const char* const name;  /**< Name of measurement           */
+    uint32_t* const val;     /**< Pointer to measurement value  */
+    const bool gauge;        /**< True if value is a gauge      */
+};
+
+/**
+ * Perfect hash of the command names of a client, built at compile time (see
+ * cmd_table.hpp). The slot of a name is the FNV-1a hash of the lowercase name,
+ * started from seed, masked with mask. Each name has its own slot, so a
+ * command is found by its full name with one hash and one string comparison.
+ */
+struct cmd_hash_info {
+    const uint32_t seed;           /**< Initial hash value                    */
+    const uint32_t mask;           /**< Number of slots minus 1 (power of 2)  */
+    const uint16_t* const slots;   /**< Command index plus 1, 0 if free       */
+};
+
+/**
+ * Information provided by the client:
+ * - Command base name
+ * - Command set info
+ * - Perfect hash of the command names (optional)
+ * - Pointer to log level variable (optional)
+ * - Performance measurements info (optional)
+ */
+struct cmd_client_info {
+    /** Client name (first command line token) */
+    const char* const name;
+    /** Number of commands */
+    const int32_t num_cmds;
+    /** Pointer to array of command info struct */
+    const struct cmd_info* const cmds;
+    /** Perfect hash of commands (or NULL) */
+    const struct cmd_hash_info* const cmd_hash CMD_DEFAULT(NULL);
+    /** Pointer to log level variable (or NULL) */
+    int32_t* const log_level_ptr CMD_DEFAULT(NULL);
+    /** Number of performance measurements */
+    const int32_t num_pms CMD_DEFAULT(0);
+    /** Pointer to array of pm info (or NULL) */
+    const struct cmd_pm_info* const pms CMD_DEFAULT(NULL);
+};
+
+/**
+ * Define a client, named after an identifier, with the other members of its
+ * struct cmd_client_info as arguments. The name must be in lowercase, as the
+ * records are sorted by the linker (byte order) and searched ignoring case.
+ * See the description of the module.
+ */
+#if CMD_SECTION_CLIENTS
+// The alignment is set, as compilers can align large objects more than their
+// type, which would leave gaps between the records.
+#define SHELL_CLIENT(name_, ...)                                              \
+    static const struct cmd_client_info shell_client_##name_                  \
+        __attribute__((used, section(".shell_clients." #name_),               \
+                       aligned(__alignof__(struct cmd_client_info)))) = {     \
+        .name = #name_,                                                       \
+        __VA_ARGS__                                                           \
+    }
+#else
+#define SHELL_CLIENT(name_, ...)                                              \
+    static const struct cmd_client_info shell_client_##name_ = {              \
+        .name = #name_,                                                       \
+        __VA_ARGS__                                                           \
+    };                                                                        \
+    static void __attribute__((constructor)) shell_client_reg_##name_(void)   \
+    {                                                                         \
+        cmd_register(&shell_client_##name_);                                  \
+    }                                                                         \
+    struct cmd_client_info
+#endif
+
+/**
+ * Zero, or a build error if cond is false. For the checks of the schema macros,
+ * which are in initializers.
+ */
+#define CMD_BUILD_CHECK(cond) (0 * sizeof(char[(cond) ? 1 : -1]))
+
+/**
+ * Offset of a field of an argument struct, or a build error if the field is not
+ * of type ctype.
+ */
+#define CMD_ARG_OFFSET(type_, field_, ctype)                                  \
+    (offsetof(type_, field_) +                                                \
+     CMD_BUILD_CHECK(_Generic(((type_*)0)->field_, ctype: 1, default: 0)))
+
+/**
+ * Argument schema of a command, for the args member of its cmd_info: the
+ * arguments are parsed into a struct type_ (of at most CMD_ARGS_MAX_SIZE
+ * bytes), then func_ is called with it. The first num_required_ arguments are
+ * required, the others optional. The arguments are given with the macros below.
+ */
+#define CMD_ARGS(type_, func_, num_required_, ...)                            \
+    (&(const struct cmd_args_schema) {                                       \
+        .func = func_,                                                        \
+        .args = (const struct cmd_arg_desc[]) { __VA_ARGS__ },               \
+        .num_args = CMD_ARGS_NUM(__VA_ARGS__),                                \
+        .num_required = (num_required_) + CMD_BUILD_CHECK(                    \
+            (num_required_) <= CMD_ARGS_NUM(__VA_ARGS__)),                    \
+        .size = sizeof(type_) +                                               \
+            CMD_BUILD_CHECK(sizeof(type_) <= CMD_ARGS_MAX_SIZE),              \
+    })
+#define CMD_ARGS_NUM(...)                                                     \
+    (sizeof((const struct cmd_arg_desc[]) { __VA_ARGS__ }) /                  \
+     sizeof(struct cmd_arg_desc))
+
+/**
+ * Signed integer argument, in [min_, max_], into an int32_t field
+ */
+#define CMD_ARG_INT(type_, field_, name_, min_, max_)                         \
+    {                                                                         \
+        .name = name_,                                                        \
+        .offset = CMD_ARG_OFFSET(type_, field_, int32_t) +                    \
+                  CMD_BUILD_CHECK((min_) <= (max_)),                          \
+        .type = CMD_ARG_TYPE_INT,                                             \
+        .u.i = { min_, max_ },                                                \
+    }
+
+/**
+ * Unsigned integer argument, in [min_, max_], into a uint32_t field
+ */
+#define CMD_ARG_UINT(type_, field_, name_, min_, max_)                        \
+    {                                                                         \
+        .name = name_,                                                        \
+        .offset = CMD_ARG_OFFSET(type_, field_, uint32_t) +                   \
+                  CMD_BUILD_CHECK((min_) <= (max_)),                          \
+        .type = CMD_ARG_TYPE_UINT,                                            \
+        .u.u = { min_, max_ },                                                \
+    }
+
+/**
+ * Boolean argument (0/1, off/on, false/true or no/yes), into a bool field
+ */
+#define CMD_ARG_BOOL(type_, field_, name_)                                    \
+    {                                                                         \
+        .name = name_,                                                        \
+        .offset = CMD_ARG_OFFSET(type_, field_, bool),                        \
+        .type = CMD_ARG_TYPE_BOOL,                                            \
+    }
+
+/**
+ * Argument taking one of the names of the array names_ (case insensitive),
+ * into an int32_t field set to the index of the name
+ */
+#define CMD_ARG_ENUM(type_, field_, name_, names_)                            \
+    {                                                                         \
+        .name = name_,                                                        \
+        .offset = CMD_ARG_OFFSET(type_, field_, int32_t),                     \
+        .type = CMD_ARG_TYPE_ENUM,                                            \
+        .u.e = { names_, sizeof(names_) / sizeof((names_)[0]) },              \
+    }
+
+/**
+ * Floating-point argument, in [min_, max_], into a float field. Needs
+ * CMD_ARG_FLOAT_ENABLED.
+ */
+#define CMD_ARG_FLOAT(type_, field_, name_, min_, max_)                       \
+    {                                                                         \
+        .name = name_,                                                        \
+        .offset = CMD_ARG_OFFSET(type_, field_, float) +                      \
+                  CMD_BUILD_CHECK(CMD_ARG_FLOAT_ENABLED && (min_) <= (max_)), \
+        .type = CMD_ARG_TYPE_FLOAT,                                           \
+        .u.f = { min_, max_ },                                                \
+    }
+
+/**
+ * Fixed-point argument with frac_bits_ fraction bits (Q format), in [min_,
+ * max_] (given as real values), into an int32_t field holding the value
+ * multiplied by 2^frac_bits_. The range must fit in the field once multiplied:
+ * from INT32_MIN >> frac_bits_ to below (INT32_MAX >> frac_bits_) + 1.
+ */
+#define CMD_ARG_FIXED(type_, field_, name_, frac_bits_, min_, max_)           \
+    {                                                                         \
+        .name = name_,                                                        \
+        .offset = CMD_ARG_OFFSET(type_, field_, int32_t) +                    \
+                  CMD_BUILD_CHECK((frac_bits_) < 31 && (min_) <= (max_) &&    \
+                      (min_) >= (INT32_MIN >> (frac_bits_)) &&                \
+                      (max_) < (INT32_MAX >> (frac_bits_)) + 1),              \
+        .type = CMD_ARG_TYPE_FIXED,                                           \
+        .frac_bits = frac_bits_,                                              \
+        .u.i = { (int32_t)((min_) * (1L << (frac_bits_))),                    \
+                 (int32_t)((max_) * (1L << (frac_bits_))) },                  \
+    }
+
+/**
+ * Type of the field of a hex blob argument of at most size bytes: the bytes are
+ * in data[0..len).
+ */
+#define CMD_ARG_BLOB_T(size)                                                  \
+    struct {                                                                  \
+        uint16_t len;                                                         \
+        uint8_t data[size];                                                   \
+    }
+
+/**
+ * Hex blob argument (pairs of hex digits, optionally after 0x), into a
+ * CMD_ARG_BLOB_T() field
+ */
+#define CMD_ARG_BLOB(type_, field_, name_)                                    \
+    {                                                                         \
+        .name = name_,                                                        \
+        .offset = CMD_ARG_OFFSET(type_, field_.len, uint16_t) +               \
+                  CMD_BUILD_CHECK(offsetof(type_, field_.data) ==             \
+                                  offsetof(type_, field_.len) + 2),           \
+        .type = CMD_ARG_TYPE_BLOB,                                            \
+        .u.max_len = sizeof(((type_*)0)->field_.data),                        \
+    }
+
+/**
+ * String argument, into a const char* field (pointing to the command line)
+ */
+#define CMD_ARG_STR(type_, field_, name_)                                     \
+    {                                                                         \
+        .name = name_,                                                        \
+        .offset = CMD_ARG_OFFSET(type_, field_, const char*),                 \
+        .type = CMD_ARG_TYPE_STR,                                             \
+    }
+
+/**
+ * Structure containing a parsed argument value
+ */
+struct cmd_arg_val {
+    char type;
+    union {
+        void*       p;
+        uint8_t*    p8;
+        uint16_t*   p16;
+        uint32_t*   p32;
+        int32_t     i;
+        uint32_t    u;
+        const char* s;
+    } val;
+};
+
+struct cmd_cfg {
+    // FUTURE
+};
+
+//=============================================================================
+//                       CMD module interface functions
+//=============================================================================
+/**
+ * @brief Initialize cmd instance.
+ *
+ * @param[in] cfg The cmd configuration. (FUTURE)
+ *
+ * @return 0 for success, else a "ERR" value.
+ *
+ * This function initializes the cmd singleton module. Generally, it should not
+ * access other modules as they might not have been initialized yet. An
+ * exception is the log module.
+ */
+int32_t cmd_init(struct cmd_cfg* cfg);
+
+/**
+ * @brief Register a client.
+ *
+ * @param[in] cmd_client_info The client's configuration (eg. command metadata)
+ *
+ * @return 0 for success, else a "SHELL_ERR_RESOURCE" value.
+ *
+ * @note This function keeps a copy of the cmd_client_info pointer.
+ *
+ * Registering a client with the name of another one replaces it, except for the
+ * SHELL_CLIENT() clients placed in the linker section, which are found first.
+ * It can be called before cmd_init().
+ */
+int32_t cmd_register(const struct cmd_client_info* cmd_client_info);
+
+/**
+ * @brief Execute a command line
+ *
+ * @param[in] bfr The buffer containing the command line arguments.
+ *
+ * @return The return value of the command function, else a "ERR" value if
+ *         the command line is not valid (see code for details).
+ *
+ * This function parses the command line and then executes the command,
+ * typically by running a command function handler for a client.
+ *
+ * @note The user may not need to call this function as it's implicitly
+ * called by the console module.
+ */
+int32_t cmd_execute(char* bfr);
+
+/**
+ * @brief Complete the last name of a command line
+ *
+ * @param[in,out] bfr The command line (null terminated), completed in place.
+ * @param[in] size Size of bfr.
+ *
+ * @return Number of characters added, 0 if several names are possible and
+ *         they were printed instead (on a line of their own), else
+ *         SHELL_ERR_BAD_CMD if there is nothing to complete.
+ *
+ * The last token of the command line (empty after a space) is completed as
+ * far as all the names it is the start of agree, and is followed by a space
+ * if it names a single one. The tokens before it can be abbreviated. Only
+ * the client, command and subcommand names are completed, not the arguments.
+ * Names are only completed from the trie (see CMD_TRIE_SIZE).
+ */
+int32_t cmd_complete(char* bfr, uint32_t size);
+
+/**
+ * @brief Split a command line into tokens
+ *
+ * @param[in,out] bfr The command line. The tokens are terminated in place.
+ * @param[out] tokens The tokens.
+ * @param[in] max_tokens Size of tokens.
+ *
+ * @return Number of tokens, else SHELL_ERR_BAD_CMD if there are more than
+ *         max_tokens.
+ *
+ * Tokens are separated by white space. This is the first step of
+ * cmd_execute().
+ */
+int32_t cmd_tokenize(char* bfr, const char** tokens, int32_t max_tokens);
+
+/**
+ * @brief Parse and validate command arguments
+ *
+ * @param[in]  argc The number of arguments to be parsed.
+ * @param[in]  argv Pointer string array of arguments to be be parsed.
+ * @param[in]  fmt String indicating expected argument types (format)
+ * @param[out] arg_vals Pointer to array of parsed argument values
+ *
+ * @return Number of parsed arguments, negative value if error.
+ *
+ * @note In case of error, an error message is always printed to the
+ * console.
+ *
+ * This function provides a common method to parse and validate command
+ * arguments. In particular, it does string to numeric conversions, with error
+ * checking.
+ *
+ * A format string is used to guide the parsing. The format string contains a
+ * letter for each expected argument. The supported letters are:
+ * - i Integer value, in either decimal, octal, hex, or binary formats. Octal
+ *     values must start with 0, hex values with 0x, and binary values with 0b.
+ * - u Unsigned value, in either decimal, octal, hex, or binary formats. Octal
+ *     values must start with 0, hex values with 0x, and binary values with 0b.
+ * - p Pointer, in hex format. No leading 0x is necessary (but allowed).
+ * - s String
+ *
+ * The numbers are converted by the num module (see num.h): the digits can be
+ * grouped with separators (e.g. 1_000_000), and values that do not fit in 32
+ * bits are rejected.
+ *
+ * In addition:
+ * - [ indicates that remaining arguments are optional. However,
+ *   if one optional argument is present, then subsequent arguments
+ *   are required.
+ * - ] is ignored; it can be put into the fmt string for readability,
+ *   to match brackets.
+ *
+ * Examples:
+ *   "up" - Requires exactly one unsigned and one pointer argument.
+ *   "ii" - Requires exactly two integer arguments.
+ *   "i[i" - Requires either one or two integer arguments.
+ *   "i[i]" - Same as above (matched brackets).
+ *   "i[i[i" - Requires either one, two, or three integer arguments.
+ *   "i[i[i]]" - Same as above (matched brackets).
+ *   "i[ii" - Requires either one or three integer arguments.
+ *   "i[ii]" - Same as above (matched brackets).
+ *
+ * @return On success, the number of arguments present (>=0), a "ERR" value
+ *         (<0). See code for details.
+ *
+ */
+int32_t cmd_parse_args(int32_t argc, const char** argv, const char* fmt,
+                       struct cmd_arg_val* arg_vals);
+
+/**
+ * @brief Parse and validate command arguments with a schema
+ *
+ * @param[in]  schema The argument schema (see CMD_ARGS()).
+ * @param[in]  argc The number of arguments to be parsed.
+ * @param[in]  argv The arguments to be parsed.
+ * @param[out] args The argument struct of the schema (schema->size bytes).
+ *
+ * @return On success, the number of arguments present (>=0), else a "ERR"
+ *         value (<0).
+ *
+ * @note In case of error, an error message is always printed to the
+ * console.
+ *
+ * The fields of the optional arguments that are not given are set to zero.
+ * This is done by cmd_execute() for the commands with a schema, before calling
+ * their function.
+ */
+int32_t cmd_parse_schema(const struct cmd_args_schema* schema, int32_t argc,
+                         const char** argv, void* args);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHELL_CMD_H_ */
@@ -0,0 +1,294 @@
+#ifndef _SHELL_CMD_TABLE_HPP_
+#define _SHELL_CMD_TABLE_HPP_
+
+/**
+ * @brief C++ front end of cmd module: command tables with a perfect hash.
+ *
+ * SHELL_CMD_TABLE() defines the command array of a client, and computes at
+ * compile time a perfect hash of its command names (struct cmd_hash_info). Two
+ * names equal ignoring case fail the build, as does a table for which no
+ * perfect hash is found. Everything is constant data (in flash on the target):
+ * @code
+ *     SHELL_CMD_TABLE(dio_cmds,
+ *         { "status", "Get module status, usage: dio status", cmd_dio_status },
+ *         { "get", "Get input value, usage: dio get <input-name>", cmd_dio_get },
+ *         { "set", "Set output value, usage: dio set <output-name> {0|1}",
+ *           cmd_dio_set },
+ *     );
+ *
+ *     SHELL_CLIENT(dio,
+ *         SHELL_CMD_TABLE_FIELDS(dio_cmds),
+ *         .log_level_ptr = &log_level,
+ *     );
+ * @endcode
+ * The commands are then found by their full name with one hash of the name,
+ * and one string comparison to verify it, without the hash index (see
+ * CMD_HASH_SIZE).
+ *
+ * SHELL_CMD_INDEX(dio_cmds, "get") is the index of a command in the table,
+ * computed at compile time: a name that is not in the table fails the build.
+ *
+ * The search is done for the few commands of a client: the number of slots is
+ * at most 32 times the number of commands, rounded up to a power of 2 (2 bytes
+ * each), and is usually below 8 times.
+ *
+ * Requires C++17 (C++20 for the designated initializers of SHELL_CLIENT()).
+ */
+
+//=============================================================================
+//                             Included Files
+//=============================================================================
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "cmd.h"
+
+//=============================================================================
+//                           Macro Definitions
+//=============================================================================
+/**
+ * Define the constant command array var of a client (a std::array of
+ * cmd_info), from cmd_info initializers ({ name, help, function }, the
+ * trailing members are value-initialized), and its perfect hash var_hash.
+ */
+#define SHELL_CMD_TABLE(var, ...)                                             \
+    static constexpr ::shell::detail::cmd_entry var##_entries[] = {           \
+        __VA_ARGS__                                                           \
+    };                                                                        \
+    static constexpr auto var = ::shell::detail::make_cmds(var##_entries);    \
+    static constexpr ::shell::detail::table_params var##_params =             \
+        ::shell::detail::find_params(var);                                    \
+    static_assert(!var##_params.duplicate,                                    \
+                  "duplicate command name in " #var);                         \
+    static_assert(var##_params.found,                                         \
+                  "no perfect hash found for " #var);                         \
+    static constexpr auto var##_slots =                                       \
+        ::shell::detail::make_slots<var##_params.num_slots>(                  \
+            var, var##_params.seed);                                          \
+    static constexpr cmd_hash_info var##_hash = {                             \
+        var##_params.seed,                                                    \
+        var##_params.num_slots - 1,                                           \
+        var##_slots.data(),                                                   \
+    }
+
+/**
+ * The cmd_client_info members of a SHELL_CMD_TABLE() (for SHELL_CLIENT()).
+ * The optional members left out of SHELL_CLIENT() are NULL or 0 (see
+ * CMD_DEFAULT()).
+ */
+#define SHELL_CMD_TABLE_FIELDS(var)                                           \
+    .num_cmds = (var).size(),                                                 \
+    .cmds = (var).data(),                                                     \
+    .cmd_hash = &var##_hash
+
+/**
+ * Index of the command name in the SHELL_CMD_TABLE() var, as a constant
+ * expression. Fails the build if the name is not in the table.
+ */
+#define SHELL_CMD_INDEX(var, name)                                            \
+    (std::integral_constant<std::size_t,                                      \
+                            ::shell::detail::cmd_index(var, name)>::value)
+
+//=============================================================================
+//                          Compile time helpers
+//=============================================================================
+namespace shell {
+namespace detail {
+
+// Hash parameters, as in cmd.c (FNV-1a, 32 bits).
+constexpr uint32_t hash_init = 2166136261U;
+constexpr uint32_t hash_prime = 16777619U;
+
+// Seeds tried per number of slots, and largest number of slots per command.
+constexpr uint32_t max_seeds = 256;
+constexpr std::size_t max_slots_per_cmd = 32;
+
+/**
+ * Result of the perfect hash search.
+ */
+struct table_params {
+    bool duplicate;         // Two names are equal (ignoring case)
+    bool found;             // A perfect hash was found
+    uint32_t seed;          // Initial hash value
+    std::size_t num_slots;  // Number of slots (power of 2)
+};
+
+/**
+ * A command of SHELL_CMD_TABLE(): the members of cmd_info, with default
+ * values for those after the function.
+ */
+struct cmd_entry {
+    const char* name;
+    const char* help;
+    cmd_func func;
+    int32_t num_subcmds = 0;
+    const cmd_info* subcmds = nullptr;
+    const cmd_args_schema* args = nullptr;
+};
+
+// Not constexpr: calling it at compile time fails the build.
+std::size_t cmd_name_not_in_table();
+
+/**
+ * ASCII lowercase, as strcasecmp() in the "C" locale.
+ */
+constexpr uint8_t lower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<uint8_t>(c + ('a' - 'A'))
+                                : static_cast<uint8_t>(c);
+}
+
+/**
+ * Hash of the lowercase string, as cmd_hash_str() in cmd.c.
+ */
+constexpr uint32_t hash_str(uint32_t hash, const char* str)
+{
+    for (; *str != '\0'; str++)
+        hash = (hash ^ lower(*str)) * hash_prime;
+
+    return hash;
+}
+
+/**
+ * Compare two strings ignoring case.
+ */
+constexpr bool equal_nocase(const char* a, const char* b)
+{
+    for (; *a != '\0' && lower(*a) == lower(*b); a++, b++)
+        ;
+
+    return lower(*a) == lower(*b);
+}
+
+/**
+ * Smallest power of 2 not below n.
+ */
+constexpr std::size_t next_pow2(std::size_t n)
+{
+    std::size_t p = 1;
+
+    while (p < n)
+        p *= 2;
+
+    return p;
+}
+
+/**
+ * Largest number of slots for N commands.
+ */
+constexpr std::size_t max_slots(std::size_t n)
+{
+    return next_pow2(n * max_slots_per_cmd);
+}
+
+/**
+ * Build the commands from their entries.
+ */
+template <std::size_t N, std::size_t... I>
+constexpr std::array<cmd_info, N> make_cmds(const cmd_entry (&entries)[N],
+                                            std::index_sequence<I...>)
+{
+    return {{ cmd_info{ entries[I].name, entries[I].help, entries[I].func,
+                        entries[I].num_subcmds, entries[I].subcmds,
+                        entries[I].args }... }};
+}
+
+template <std::size_t N>
+constexpr std::array<cmd_info, N> make_cmds(const cmd_entry (&entries)[N])
+{
+    return make_cmds(entries, std::make_index_sequence<N>());
+}
+
+/**
+ * Check that the names have distinct slots.
+ */
+template <std::size_t N>
+constexpr bool is_perfect(const std::array<cmd_info, N>& cmds,
+                          uint32_t seed, std::size_t num_slots)
+{
+    std::array<bool, max_slots(N)> used{};
+
+    for (std::size_t i = 0; i < N; i++) {
+        std::size_t slot = hash_str(seed, cmds[i].name) & (num_slots - 1);
+        if (used[slot])
+            return false;
+        used[slot] = true;
+    }
+
+    return true;
+}
+
+/**
+ * Check the names, and search a seed and number of slots giving a perfect
+ * hash, starting with the fewest slots.
+ */
+template <std::size_t N>
+constexpr table_params find_params(const std::array<cmd_info, N>& cmds)
+{
+    table_params params{false, false, hash_init, 1};
+
+    for (std::size_t i = 0; i < N; i++) {
+        for (std::size_t j = 0; j < i; j++) {
+            if (equal_nocase(cmds[i].name, cmds[j].name)) {
+                params.duplicate = true;
+                return params;
+            }
+        }
+    }
+
+    for (std::size_t num_slots = next_pow2(N);
+         num_slots <= max_slots(N);
+         num_slots *= 2) {
+        for (uint32_t k = 0; k < max_seeds; k++) {
+            uint32_t seed = hash_init ^ (k * 0x9e3779b9U);
+            if (is_perfect(cmds, seed, num_slots)) {
+                params.found = true;
+                params.seed = seed;
+                params.num_slots = num_slots;
+                return params;
+            }
+        }
+    }
+
+    return params;
+}
+
+/**
+ * Build the slots: command index plus 1, 0 if free.
+ */
+template <std::size_t S, std::size_t N>
+constexpr std::array<uint16_t, S> make_slots(
+    const std::array<cmd_info, N>& cmds, uint32_t seed)
+{
+    static_assert(N < UINT16_MAX, "too many commands");
+    std::array<uint16_t, S> slots{};
+
+    for (std::size_t i = 0; i < N; i++)
+        slots[hash_str(seed, cmds[i].name) & (S - 1)] =
+            static_cast<uint16_t>(i + 1);
+
+    return slots;
+}
+
+/**
+ * Index of a command name (for SHELL_CMD_INDEX()).
+ */
+template <std::size_t N>
+constexpr std::size_t cmd_index(const std::array<cmd_info, N>& cmds,
+                                const char* name)
+{
+    for (std::size_t i = 0; i < N; i++) {
+        if (equal_nocase(cmds[i].name, name))
+            return i;
+    }
+
+    return cmd_name_not_in_table();
+}
+
+} // namespace detail
+} // namespace shell
+
+#endif /* _SHELL_CMD_TABLE_HPP_ */
@@ -1,87 +1,200 @@
-#ifndef _SHELL_LOG_H_
-#define _SHELL_LOG_H_
-
-/**
- * @brief Interface declaration of log module.
- *
- * This module provides a simple logging utility. Most of the API is implemented
- * via macros found in this header file. Output is written to a ttys instance
- * specified during module creation.
- *
- * A client that uses the log API macros must have a private/static variable
- * called "log_level" to control the amount of logging. Typically, the client
- * provides a pointer to this variable to the cmd module. The cmd module then
- * allows the console user to display and set the client's logging level.
- *
- * There is also a global variable, log_active, that can be used to inhibit
- * log output. The console module toggles this variable on/off based on a
- * input key (ctrl-L).
- */
-
-#include "shell.h"
-
-//=============================================================================
-//                         Preprocessor Constants
-//=============================================================================
-/**
- * The log toggle char at the console is ctrl-L which is form feed, or 0x0c
- */
-#define LOG_TOGGLE_CHAR '\x0c'
-
-#define LOG_LEVEL_NAMES "off, error, warning, info, debug, trace"
-#define LOG_LEVEL_NAMES_CSV "off", "error", "warning", "info", "debug", "trace"
-
-//=============================================================================
-//                            Type Definitions
-//=============================================================================
-enum log_level {
-    LOG_OFF = 0,
-    LOG_ERROR,
-    LOG_WARNING,
-    LOG_INFO,
-    LOG_DEBUG,
-    LOG_TRACE,
-    LOG_DEFAULT = LOG_INFO
-};
-
-//=============================================================================
-//                                   API
-//=============================================================================
-/**
- * @brief Toggle state of "log active".
- */
-void log_toggle_active(void);
-
-/**
- * @brief Get state of "log active".
- *
- * @return Value of log active.
- */
-bool log_is_active(void);
-
-/**
- * @brief Base "printf" style function for logging.
- *
- * @param[in] fmt Format string
- */
-void log_printf(const char* fmt, ...);
-
-//=============================================================================
-//                         Preprocessor Macros
-//=============================================================================
-#define log_error(fmt, ...) do { if (_log_active && log_level >= LOG_ERROR) \
-            log_printf("ERR  " fmt, ##__VA_ARGS__); } while (0)
-#define log_warning(fmt, ...) do { if (_log_active && log_level >= LOG_WARNING) \
-            log_printf("WARN " fmt, ##__VA_ARGS__); } while (0)
-#define log_info(fmt, ...) do { if (_log_active && log_level >= LOG_INFO) \
-            log_printf("INFO " fmt, ##__VA_ARGS__); } while (0)
-#define log_debug(fmt, ...) do { if (_log_active && log_level >= LOG_DEBUG) \
-            log_printf("DBG  " fmt, ##__VA_ARGS__); } while (0)
-#define log_trace(fmt, ...) do { if (_log_active && log_level >= LOG_TRACE) \
-            log_printf("TRC  " fmt, ##__VA_ARGS__); } while (0)
-
-// Following variable is global to allow efficient access by macros,
-// but is considered private.
-extern bool _log_active;
-
-#endif /* _SHELL_LOG_H_ */
+#ifndef _SHELL_LOG_H_
+#define _SHELL_LOG_H_
+
+/**
+ * @brief Interface declaration of log module.
+ *
+ * This module provides a simple logging utility. Most of the API is implemented
+ * via macros found in this header file. Output is written to a ttys instance
+ * specified during module creation.
+ *
+ * A client that uses the log API macros must have a private/static variable
+ * called "log_level" to control the amount of logging. Typically, the client
+ * provides a pointer to this variable to the cmd module. The cmd module then
+ * allows the console user to display and set the client's logging level.
+ *
+ * There is also a global variable, log_active, that can be used to inhibit
+ * log output. The console module toggles this variable on/off based on a
+ * input key (ctrl-L).
+ *
+ * Each message starts with its time (seconds since tmr_init(), with six
+ * decimals, e.g. "12.000345 INFO ..."), taken from tmr_get_cycles() when the
+ * log macro is called, before the message is formatted.
+ *
+ * By default (LOG_MODE_DIRECT), the log macros format their message at once,
+ * in the context of the caller. In the deferred modes, they only queue the
+ * address of the format string and the arguments, as words, in a ring buffer,
+ * which takes tens of cycles. The messages are taken from the ring by
+ * log_drain(), called in the main loop by console_run():
+ * - LOG_MODE_DEFERRED: log_drain() formats them, as log_printf() would.
+ * - LOG_MODE_BINARY: log_drain() writes them as binary frames, which are
+ *   formatted on the host, from the format strings of the ELF file, by
+ *   tools/log_decode.py. The frames can be mixed with the text of the console:
+ *   each one is LOG_FRAME_SYNC, the number of arguments (one byte), the time
+ *   in microseconds (8 bytes), then the address of the format string and the
+ *   arguments, as words of sizeof(uintptr_t) bytes, all little-endian. On a
+ *   host, build without position independent code (-no-pie), so that the
+ *   addresses are those of the ELF file.
+ *
+ * In the deferred modes, the arguments of the log macros must be integers of
+ * at most the size of a pointer, or pointers (no floating-point values), and
+ * at most LOG_MAX_ARGS. A string (%s) is read when the message is formatted,
+ * so it must not change until then (e.g. a string literal or a name in flash).
+ * In binary mode, only the strings of the ELF file can be shown. Messages are
+ * dropped when the ring is full, and the number dropped is logged once there
+ * is space again.
+ */
+
+#include "shell.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//                         Preprocessor Constants
+//=============================================================================
+/**
+ * The log toggle char at the console is ctrl-L which is form feed, or 0x0c
+ */
+#define LOG_TOGGLE_CHAR '\x0c'
+
+#define LOG_LEVEL_NAMES "off, error, warning, info, debug, trace"
+#define LOG_LEVEL_NAMES_CSV "off", "error", "warning", "info", "debug", "trace"
+
+/**
+ * Log modes (see the description of the module)
+ */
+#define LOG_MODE_DIRECT    0
+#define LOG_MODE_DEFERRED  1
+#define LOG_MODE_BINARY    2
+
+#ifndef LOG_MODE
+#define LOG_MODE  LOG_MODE_DIRECT
+#endif
+
+/**
+ * Size of the ring buffer of the deferred modes (bytes, a power of two). A
+ * message takes 9 bytes (argument count and time) plus one word per argument
+ * and for the format.
+ */
+#ifndef LOG_BUF_SIZE
+#define LOG_BUF_SIZE  1024
+#endif
+
+/**
+ * Maximum number of arguments of a message in the deferred modes
+ */
+#define LOG_MAX_ARGS  8
+
+/**
+ * First byte of the binary frames (ASCII record separator)
+ */
+#define LOG_FRAME_SYNC  '\x1e'
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+enum log_level {
+    LOG_OFF = 0,
+    LOG_ERROR,
+    LOG_WARNING,
+    LOG_INFO,
+    LOG_DEBUG,
+    LOG_TRACE,
+    LOG_DEFAULT = LOG_INFO
+};
+
+//=============================================================================
+//                                   API
+//=============================================================================
+/**
+ * @brief Toggle state of "log active".
+ */
+void log_toggle_active(void);
+
+/**
+ * @brief Get state of "log active".
+ *
+ * @return Value of log active.
+ */
+bool log_is_active(void);
+
+/**
+ * @brief Base "printf" style function for logging.
+ *
+ * @param[in] fmt Format string
+ *
+ * Prints the time, then the message.
+ */
+void log_printf(const char* fmt, ...);
+
+/**
+ * @brief Queue a message, in the deferred modes.
+ *
+ * @param[in] fmt Format string (kept until the message is formatted).
+ * @param[in] num_args Number of arguments (at most LOG_MAX_ARGS).
+ * @param[in] args The arguments, converted to words.
+ *
+ * Called by the log macros. It can be called from interrupt handlers.
+ */
+void log_defer(const char* fmt, uint32_t num_args, const uintptr_t* args);
+
+/**
+ * @brief Output the queued messages, in the deferred modes.
+ *
+ * Formats the messages queued when it is called (or writes them as binary
+ * frames), in the order they were queued. Called by console_run(); does
+ * nothing in LOG_MODE_DIRECT.
+ */
+void log_drain(void);
+
+//=============================================================================
+//                         Preprocessor Macros
+//=============================================================================
+#define log_error(fmt, ...) do { if (_log_active && log_level >= LOG_ERROR) \
+            LOG_OUT("ERR  " fmt, ##__VA_ARGS__); } while (0)
+#define log_warning(fmt, ...) do { if (_log_active && log_level >= LOG_WARNING) \
+            LOG_OUT("WARN " fmt, ##__VA_ARGS__); } while (0)
+#define log_info(fmt, ...) do { if (_log_active && log_level >= LOG_INFO) \
+            LOG_OUT("INFO " fmt, ##__VA_ARGS__); } while (0)
+#define log_debug(fmt, ...) do { if (_log_active && log_level >= LOG_DEBUG) \
+            LOG_OUT("DBG  " fmt, ##__VA_ARGS__); } while (0)
+#define log_trace(fmt, ...) do { if (_log_active && log_level >= LOG_TRACE) \
+            LOG_OUT("TRC  " fmt, ##__VA_ARGS__); } while (0)
+
+#if LOG_MODE == LOG_MODE_DIRECT
+#define LOG_OUT(fmt, ...) log_printf(fmt, ##__VA_ARGS__)
+#else
+// The arguments are converted to words, followed by a 0 so that the array is
+// never empty. More than LOG_MAX_ARGS arguments do not compile.
+#define LOG_OUT(fmt, ...)                                                     \
+    log_defer(fmt, LOG_NUM_ARGS(__VA_ARGS__),                                 \
+              (const uintptr_t[]) { LOG_WORDS(__VA_ARGS__) 0 })
+#endif
+
+#define LOG_NUM_ARGS(...) \
+    LOG_NUM_ARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_NUM_ARGS_(z, a1, a2, a3, a4, a5, a6, a7, a8, n, ...) n
+#define LOG_WORDS(...) LOG_WORDS_N(LOG_NUM_ARGS(__VA_ARGS__), ##__VA_ARGS__)
+#define LOG_WORDS_N(n, ...) LOG_WORDS_N_(n, ##__VA_ARGS__)
+#define LOG_WORDS_N_(n, ...) LOG_WORDS_##n(__VA_ARGS__)
+#define LOG_WORDS_0(...)
+#define LOG_WORDS_1(a) (uintptr_t)(a),
+#define LOG_WORDS_2(a, ...) (uintptr_t)(a), LOG_WORDS_1(__VA_ARGS__)
+#define LOG_WORDS_3(a, ...) (uintptr_t)(a), LOG_WORDS_2(__VA_ARGS__)
+#define LOG_WORDS_4(a, ...) (uintptr_t)(a), LOG_WORDS_3(__VA_ARGS__)
+#define LOG_WORDS_5(a, ...) (uintptr_t)(a), LOG_WORDS_4(__VA_ARGS__)
+#define LOG_WORDS_6(a, ...) (uintptr_t)(a), LOG_WORDS_5(__VA_ARGS__)
+#define LOG_WORDS_7(a, ...) (uintptr_t)(a), LOG_WORDS_6(__VA_ARGS__)
+#define LOG_WORDS_8(a, ...) (uintptr_t)(a), LOG_WORDS_7(__VA_ARGS__)
+
+// Following variable is global to allow efficient access by macros,
+// but is considered private.
+extern bool _log_active;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHELL_LOG_H_ */
@@ -0,0 +1,91 @@
+#ifndef _SHELL_NUM_H_
+#define _SHELL_NUM_H_
+
+/**
+ * @brief Interface declaration of num module.
+ *
+ * This module converts command line arguments to numbers, for the cmd module
+ * and the command functions. Unlike strtol() and the like, it does not depend
+ * on the locale, does not skip white space, does not use errno, and the whole
+ * string must be a number, so that it is small and fast.
+ *
+ * Integers are in decimal, hex (starting with 0x), binary (starting with 0b)
+ * or octal (starting with 0), e.g. 100, 0x64, 0b1100100, 0144. Signed values
+ * can start with - or +, unsigned values with +. The digits can be grouped
+ * with a separator (NUM_SEPARATOR) between two digits, e.g. 1_000_000 or
+ * 0xdead_beef. The prefix is not a digit, so 0x_ff and 0_7 are not numbers.
+ *
+ * Fixed-point values (Q format) are in decimal, with an optional fraction,
+ * e.g. -1.25 or .5, rounded to the nearest value (half away from zero).
+ *
+ * All functions return SHELL_ERR_ARG if the string is not a number, and
+ * SHELL_ERR_RANGE if it is one that does not fit. The value is not changed
+ * in case of error.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//                         Preprocessor Constants
+//=============================================================================
+/**
+ * Digit separator, allowed between two digits
+ */
+#define NUM_SEPARATOR '_'
+
+//=============================================================================
+//                       NUM module interface functions
+//=============================================================================
+/**
+ * @brief Convert a string to an unsigned integer.
+ *
+ * @param[in] str The string (decimal, hex, binary or octal).
+ * @param[out] val The value.
+ *
+ * @return 0 for success, else a "ERR" value (see module description).
+ */
+int32_t num_parse_uint(const char* str, uint32_t* val);
+
+/**
+ * @brief Convert a string to a signed integer.
+ *
+ * @param[in] str The string (decimal, hex, binary or octal, with a sign).
+ * @param[out] val The value.
+ *
+ * @return 0 for success, else a "ERR" value (see module description).
+ */
+int32_t num_parse_int(const char* str, int32_t* val);
+
+/**
+ * @brief Convert a string of hex digits to an unsigned integer.
+ *
+ * @param[in] str The string, with or without 0x (e.g. an address).
+ * @param[out] val The value.
+ *
+ * @return 0 for success, else a "ERR" value (see module description).
+ */
+int32_t num_parse_hex(const char* str, uint32_t* val);
+
+/**
+ * @brief Convert a string to a signed fixed-point value.
+ *
+ * @param[in] str The string (decimal, with an optional sign and fraction).
+ * @param[in] frac_bits Number of fraction bits (at most 31).
+ * @param[out] val The value multiplied by 2^frac_bits, rounded.
+ *
+ * @return 0 for success, else a "ERR" value (see module description).
+ *
+ * The fraction digits after the ninth are checked, but not used (the value
+ * is rounded from the first nine).
+ */
+int32_t num_parse_fixed(const char* str, uint32_t frac_bits, int32_t* val);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHELL_NUM_H_ */
@@ -0,0 +1,111 @@
+#ifndef _SHELL_PORT_H_
+#define _SHELL_PORT_H_
+
+/**
+ * @brief Interface declaration of port layer.
+ *
+ * The port layer holds everything the shell needs from the platform, so that
+ * the rest of the shell (console, cmd, log, ring, and the buffering logic of
+ * ttys) is platform independent. It consists of:
+ * - The platform services below (time, cycle counter, interrupt masking).
+ * - The ttys hardware backend (see ttys_port.h), which moves characters between
+ *   the ttys buffers and the device.
+ *
+ * The platform is selected at build time:
+ * - Default: STM32F7 MCU, with the USART registers and DMA streams driven
+ *   directly (shell/port/port_stm32f7.c and shell/port/ttys_stm32f7.c).
+ * - SHELL_PORT_POSIX defined: Linux (or other POSIX) process, with the ttys
+ *   instances mapped to stdin/stdout, pseudo terminals or Unix sockets
+ *   (shell/port/port_posix.c and shell/port/ttys_posix.c). See port_posix.h.
+ * - SHELL_PORT_SIM defined: the STM32F7 backend built for the host, on
+ *   simulated USARTs driven by a virtual clock (shell/port/port_sim.c), to run
+ *   the interrupt handlers at realistic character timings. See port_sim.h.
+ *
+ * All the port files can be compiled in any build, those of the other platforms
+ * compile to nothing.
+ */
+
+//=============================================================================
+//                             Included Files
+//=============================================================================
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(SHELL_PORT_POSIX)
+#include "port_posix.h"
+#elif defined(SHELL_PORT_SIM)
+#include "port_sim.h"
+#else
+#include "stm32f7xx_hal.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//                        Platform service functions
+//=============================================================================
+/**
+ * @brief Get the time in milliseconds.
+ *
+ * @return Free running millisecond counter (wraps around).
+ */
+uint32_t port_get_ms(void);
+
+/**
+ * @brief Mask interrupts.
+ *
+ * @return The previous interrupt mask state, for port_irq_restore().
+ *
+ * This is what keeps the main loop side of ttys consistent with the interrupt
+ * handlers, e.g. when a DMA transfer is started or aborted. Calls can be
+ * nested.
+ */
+uint32_t port_irq_disable(void);
+
+/**
+ * @brief Restore the interrupt mask state.
+ *
+ * @param[in] state The state returned by port_irq_disable().
+ */
+void port_irq_restore(uint32_t state);
+
+/**
+ * @brief Check if the caller can wait for an interrupt driven condition.
+ *
+ * @return False if called from an interrupt handler or with interrupts masked,
+ *         where waiting would never end, else true.
+ */
+bool port_can_wait(void);
+
+/**
+ * @brief Start the CPU cycle counter.
+ *
+ * Must be called before port_get_cycles() is used. Calling it again is
+ * harmless.
+ */
+void port_cycles_start(void);
+
+/**
+ * @brief Get the CPU cycle counter.
+ *
+ * @return Free running cycle counter (wraps around), at port_get_cycles_hz().
+ *
+ * On the target this is the DWT cycle counter, which wraps around in about 20
+ * seconds at 216 MHz. Intervals are measured as the difference of two values.
+ */
+uint32_t port_get_cycles(void);
+
+/**
+ * @brief Get the frequency of the CPU cycle counter.
+ *
+ * @return Cycles per second.
+ */
+uint32_t port_get_cycles_hz(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHELL_PORT_H_ */
@@ -0,0 +1,76 @@
+#ifndef _SHELL_PORT_POSIX_H_
+#define _SHELL_PORT_POSIX_H_
+
+/**
+ * @brief Interface declaration of POSIX port.
+ *
+ * With SHELL_PORT_POSIX defined, the shell runs as a Linux (or other POSIX)
+ * process, e.g. to try commands, or to benchmark and profile the shell
+ * off-target. The ttys instances are mapped to devices of the process, chosen
+ * at run time with environment variables named after the instances
+ * (TTYS_UART1, TTYS_UART5, ...):
+ * - "stdio": standard input and output. If the input is a terminal, it is put
+ *   in non-canonical mode without echo while the shell runs (the console does
+ *   the echo). Input from a pipe or file ends at end of file.
+ * - "pty": a new pseudo terminal. Its name is printed on stderr, to connect a
+ *   terminal program (e.g. "screen /dev/pts/3").
+ * - "unix:<path>": a Unix stream socket, listening at path. One client is
+ *   served at a time (e.g. "socat - UNIX-CONNECT:<path>").
+ * - "none": output is discarded, there is no input.
+ * The default is "stdio" for the stdout instance (file descriptor 1), and
+ * "none" for the others.
+ *
+ * The stdout instance becomes the process' stdout stream, so printf() and
+ * friends go through its TX buffer like on the target.
+ *
+ * There are no interrupts: the backend moves characters when the ttys functions
+ * are called (output when queued, input when read), so the process is single
+ * threaded. The main loop calls ttys_posix_wait() between console_run() calls
+ * to sleep until there is input.
+ *
+ * The baud rate is only recorded, the devices have none.
+ */
+
+//=============================================================================
+//                             Included Files
+//=============================================================================
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//                         Preprocessor Macros
+//=============================================================================
+// Alignment attribute, as defined by CMSIS on the target.
+#ifndef __ALIGNED
+#define __ALIGNED(x) __attribute__((aligned(x)))
+#endif
+
+//=============================================================================
+//                           POSIX port functions
+//=============================================================================
+/**
+ * @brief Wait for input on the ttys instances.
+ *
+ * @param[in] timeout_ms Maximum wait.
+ *
+ * @return 1 if there is input (or a new client), 0 on timeout, else a "ERR"
+ *         value (SHELL_ERR_RESOURCE once all the inputs have ended, e.g. end
+ *         of a script piped to standard input).
+ *
+ * Pending output is sent first. Example main loop:
+ * @code
+ *     do {
+ *         console_run();
+ *     } while (ttys_posix_wait(tmr_get_idle_ms(1000)) >= 0);
+ * @endcode
+ */
+int32_t ttys_posix_wait(uint32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHELL_PORT_POSIX_H_ */
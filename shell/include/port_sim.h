@@ -0,0 +1,431 @@
+#ifndef _SHELL_PORT_SIM_H_
+#define _SHELL_PORT_SIM_H_
+
+/**
+ * @brief Interface declaration of simulated STM32F7 port.
+ *
+ * With SHELL_PORT_SIM defined, the STM32F7 backend (port_stm32f7.c and
+ * ttys_stm32f7.c, unmodified) is built for the host against this header, which
+ * stands in for the HAL one. The USARTs are a register level model, driven by
+ * a virtual clock counted in CPU cycles:
+ * - A character takes the time of its frame on the line (start bit, data and
+ *   parity bits per CR1, stop bits per CR2), at the rate set by BRR, OVER8 and
+ *   the kernel clock selected in RCC->DCKCFGR2.
+ * - TDR and the shift register, TXE and TC behave as on the MCU. RDR holds one
+ *   received character; a character completing while RXNE is still set is
+ *   lost and sets ORE.
+ * - With RTSE, the peer does not start a character while RXNE is set. With
+ *   CTSE, the USART does not start one while the peer deasserts CTS (see
+ *   sim_line_set_cts()). With XON/XOFF (see sim_line_set_xon_xoff()), the
+ *   peer stops sending when it receives XOFF, after a few more characters,
+ *   and resumes when it receives XON.
+ * - Interrupts are level triggered, from the enabled USART flags, and are
+ *   taken between events or when unmasked (not nested, as the ttys interrupts
+ *   share a priority). Taking one costs irq_cycles, and each register access
+ *   costs reg_cycles, so the handlers take virtual time like on the target.
+ *
+ * - A DMA stream enabled for memory to peripheral transfers into a USART's TDR
+ *   (PAR), with DMAT set, writes the next byte (from M0AR on) whenever TXE is
+ *   set, and counts NDTR down. It sets HTIF half way, and at the end TCIF,
+ *   clearing EN. The interrupts of the streams are taken like those of the
+ *   USARTs. The address registers hold host pointers.
+ *
+ * The register accesses of the backend go through the CMSIS macros (READ_REG,
+ * WRITE_REG, SET_BIT...) which this header maps to the model. The DMA flag
+ * registers are plain memory: the writes to LIFCR/HIFCR take effect at the
+ * next register access. Peripheral to memory streams are not modeled, so the
+ * instances must use the interrupt reception mode. The DWT cycle counter
+ * follows the virtual clock.
+ *
+ * The other end of each line (the "peer") is the test program: it queues
+ * characters to receive with sim_line_send(), and takes the transmitted ones
+ * with sim_line_recv(). The main loop of the program calls sim_run() to let
+ * virtual time pass; the shell functions it calls take the time of their
+ * register accesses only.
+ */
+
+//=============================================================================
+//                             Included Files
+//=============================================================================
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//                         Preprocessor Constants
+//=============================================================================
+// CMSIS definitions
+#define __IO volatile
+#ifndef __ALIGNED
+#define __ALIGNED(x) __attribute__((aligned(x)))
+#endif
+#define __DCACHE_PRESENT 0U
+
+// Oscillators (Hz)
+#define HSI_VALUE 16000000U
+#define LSE_VALUE 32768U
+
+// Number of simulated USARTs (USART1 to UART8)
+#define SIM_NUM_USARTS 8
+
+// Size of the peer's buffers, per line
+#define SIM_LINE_BUF_SIZE 4096
+
+// USART registers
+#define USART_CR1_UE     (1U << 0)
+#define USART_CR1_RE     (1U << 2)
+#define USART_CR1_TE     (1U << 3)
+#define USART_CR1_IDLEIE (1U << 4)
+#define USART_CR1_RXNEIE (1U << 5)
+#define USART_CR1_TCIE   (1U << 6)
+#define USART_CR1_TXEIE  (1U << 7)
+#define USART_CR1_PEIE   (1U << 8)
+#define USART_CR1_PCE    (1U << 10)
+#define USART_CR1_M0     (1U << 12)
+#define USART_CR1_OVER8  (1U << 15)
+#define USART_CR1_M1     (1U << 28)
+#define USART_CR2_STOP_Pos 12U
+#define USART_CR2_STOP   (3U << USART_CR2_STOP_Pos)
+#define USART_CR3_EIE    (1U << 0)
+#define USART_CR3_DMAR   (1U << 6)
+#define USART_CR3_DMAT   (1U << 7)
+#define USART_CR3_RTSE   (1U << 8)
+#define USART_CR3_CTSE   (1U << 9)
+#define USART_ISR_PE     (1U << 0)
+#define USART_ISR_FE     (1U << 1)
+#define USART_ISR_NE     (1U << 2)
+#define USART_ISR_ORE    (1U << 3)
+#define USART_ISR_IDLE   (1U << 4)
+#define USART_ISR_RXNE   (1U << 5)
+#define USART_ISR_TC     (1U << 6)
+#define USART_ISR_TXE    (1U << 7)
+#define USART_ICR_PECF   (1U << 0)
+#define USART_ICR_FECF   (1U << 1)
+#define USART_ICR_NCF    (1U << 2)
+#define USART_ICR_ORECF  (1U << 3)
+#define USART_ICR_IDLECF (1U << 4)
+#define USART_ICR_TCCF   (1U << 6)
+
+// DMA stream registers
+#define DMA_SxCR_EN        (1U << 0)
+#define DMA_SxCR_TEIE      (1U << 2)
+#define DMA_SxCR_HTIE      (1U << 3)
+#define DMA_SxCR_TCIE      (1U << 4)
+#define DMA_SxCR_DIR_0     (1U << 6)
+#define DMA_SxCR_CIRC      (1U << 8)
+#define DMA_SxCR_MINC      (1U << 10)
+#define DMA_SxCR_CHSEL_Pos 25U
+
+// Core debug and DWT registers
+#define CoreDebug_DEMCR_TRCENA_Msk (1U << 24)
+#define DWT_CTRL_CYCCNTENA_Msk     (1U << 0)
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+/**
+ * Interrupt numbers, as on the STM32F7
+ */
+typedef enum {
+    DMA1_Stream0_IRQn = 11,
+    DMA1_Stream1_IRQn = 12,
+    DMA1_Stream2_IRQn = 13,
+    DMA1_Stream3_IRQn = 14,
+    DMA1_Stream4_IRQn = 15,
+    DMA1_Stream5_IRQn = 16,
+    DMA1_Stream6_IRQn = 17,
+    USART1_IRQn = 37,
+    USART2_IRQn = 38,
+    USART3_IRQn = 39,
+    DMA1_Stream7_IRQn = 47,
+    UART4_IRQn = 52,
+    UART5_IRQn = 53,
+    DMA2_Stream0_IRQn = 56,
+    DMA2_Stream1_IRQn = 57,
+    DMA2_Stream2_IRQn = 58,
+    DMA2_Stream3_IRQn = 59,
+    DMA2_Stream4_IRQn = 60,
+    DMA2_Stream5_IRQn = 68,
+    DMA2_Stream6_IRQn = 69,
+    DMA2_Stream7_IRQn = 70,
+    USART6_IRQn = 71,
+    UART7_IRQn = 82,
+    UART8_IRQn = 83,
+    SIM_NUM_IRQS
+} IRQn_Type;
+
+typedef struct {
+    __IO uint32_t CR1;
+    __IO uint32_t CR2;
+    __IO uint32_t CR3;
+    __IO uint32_t BRR;
+    __IO uint32_t GTPR;
+    __IO uint32_t RTOR;
+    __IO uint32_t RQR;
+    __IO uint32_t ISR;
+    __IO uint32_t ICR;
+    __IO uint32_t RDR;
+    __IO uint32_t TDR;
+} USART_TypeDef;
+
+typedef struct {
+    __IO uint32_t CR;
+    __IO uint32_t NDTR;
+    __IO uintptr_t PAR;
+    __IO uintptr_t M0AR;
+    __IO uintptr_t M1AR;
+    __IO uint32_t FCR;
+} DMA_Stream_TypeDef;
+
+typedef struct {
+    __IO uint32_t LISR;
+    __IO uint32_t HISR;
+    __IO uint32_t LIFCR;
+    __IO uint32_t HIFCR;
+} DMA_TypeDef;
+
+typedef struct {
+    __IO uint32_t DCKCFGR2;
+} RCC_TypeDef;
+
+typedef struct {
+    __IO uint32_t CTRL;
+    __IO uint32_t CYCCNT;
+    __IO uint32_t LAR;
+} DWT_Type;
+
+typedef struct {
+    __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+/**
+ * Simulation parameters. The clocks are those of the example's board setup.
+ */
+struct sim_cfg {
+    uint32_t sysclk_hz;     // CPU clock, the unit of the virtual clock
+    uint32_t pclk1_hz;      // APB1 clock (USART2 to 5, UART7 and 8)
+    uint32_t pclk2_hz;      // APB2 clock (USART1 and 6)
+    uint32_t irq_cycles;    // Interrupt entry and exit (at least 1)
+    uint32_t reg_cycles;    // Peripheral register access
+};
+
+/**
+ * Counters of a simulated line
+ */
+struct sim_line_stats {
+    uint32_t rx_chars;      // Characters received by the USART (incl. lost)
+    uint32_t rx_lost;       // Characters lost by overrun (ORE)
+    uint32_t rx_rts_stalls; // Times the peer waited for RTS
+    uint32_t rx_xoffs;      // XOFF received by the peer (with XON/XOFF)
+    uint32_t tx_chars;      // Characters transmitted by the USART
+    uint32_t tx_overwrites; // Writes to TDR while full (driver bug)
+    uint32_t peer_overruns; // Transmitted characters not taken by the peer
+    uint32_t tx_dma_starts; // TX DMA transfers started (stream enabled)
+    uint32_t irq_entries;   // Interrupt handler calls (USART and its DMA)
+};
+
+//=============================================================================
+//                         Simulated peripherals
+//=============================================================================
+extern USART_TypeDef sim_usarts[SIM_NUM_USARTS];
+extern DMA_TypeDef sim_dmas[2];
+extern DMA_Stream_TypeDef sim_dma_streams[2][8];
+extern RCC_TypeDef sim_rcc;
+extern DWT_Type sim_dwt;
+extern CoreDebug_Type sim_core_debug;
+
+#define USART1 (&sim_usarts[0])
+#define USART2 (&sim_usarts[1])
+#define USART3 (&sim_usarts[2])
+#define UART4  (&sim_usarts[3])
+#define UART5  (&sim_usarts[4])
+#define USART6 (&sim_usarts[5])
+#define UART7  (&sim_usarts[6])
+#define UART8  (&sim_usarts[7])
+
+#define DMA1 (&sim_dmas[0])
+#define DMA2 (&sim_dmas[1])
+#define DMA1_Stream0 (&sim_dma_streams[0][0])
+#define DMA1_Stream1 (&sim_dma_streams[0][1])
+#define DMA1_Stream2 (&sim_dma_streams[0][2])
+#define DMA1_Stream3 (&sim_dma_streams[0][3])
+#define DMA1_Stream4 (&sim_dma_streams[0][4])
+#define DMA1_Stream5 (&sim_dma_streams[0][5])
+#define DMA1_Stream6 (&sim_dma_streams[0][6])
+#define DMA1_Stream7 (&sim_dma_streams[0][7])
+#define DMA2_Stream0 (&sim_dma_streams[1][0])
+#define DMA2_Stream1 (&sim_dma_streams[1][1])
+#define DMA2_Stream2 (&sim_dma_streams[1][2])
+#define DMA2_Stream3 (&sim_dma_streams[1][3])
+#define DMA2_Stream4 (&sim_dma_streams[1][4])
+#define DMA2_Stream5 (&sim_dma_streams[1][5])
+#define DMA2_Stream6 (&sim_dma_streams[1][6])
+#define DMA2_Stream7 (&sim_dma_streams[1][7])
+
+#define RCC       (&sim_rcc)
+#define DWT       (&sim_dwt)
+#define CoreDebug (&sim_core_debug)
+
+//=============================================================================
+//                      Register access (CMSIS macros)
+//=============================================================================
+#define READ_REG(REG)         sim_reg_read(&(REG))
+#define WRITE_REG(REG, VAL)   sim_reg_write(&(REG), (VAL))
+#define READ_BIT(REG, BIT)    (sim_reg_read(&(REG)) & (BIT))
+#define SET_BIT(REG, BIT)     sim_reg_write(&(REG), sim_reg_read(&(REG)) | (BIT))
+#define CLEAR_BIT(REG, BIT)   sim_reg_write(&(REG), sim_reg_read(&(REG)) & ~(BIT))
+#define ATOMIC_SET_BIT(REG, BIT)   SET_BIT(REG, BIT)
+#define ATOMIC_CLEAR_BIT(REG, BIT) CLEAR_BIT(REG, BIT)
+
+/**
+ * @brief Read a register, with the side effects of the model.
+ *
+ * @param[in] reg The register.
+ *
+ * @return The register value.
+ */
+uint32_t sim_reg_read(volatile uint32_t* reg);
+
+/**
+ * @brief Write a register, with the side effects of the model.
+ *
+ * @param[in] reg The register.
+ * @param[in] val The value.
+ *
+ * Interrupts that become pending are taken before returning, unless masked.
+ */
+void sim_reg_write(volatile uint32_t* reg, uint32_t val);
+
+//=============================================================================
+//                     Core and HAL functions (subset)
+//=============================================================================
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_IPSR(void);
+
+uint32_t NVIC_GetPriorityGrouping(void);
+uint32_t NVIC_EncodePriority(uint32_t group, uint32_t preempt, uint32_t sub);
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority);
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+
+uint32_t HAL_GetTick(void);
+uint32_t HAL_RCC_GetSysClockFreq(void);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+uint32_t HAL_RCC_GetPCLK2Freq(void);
+
+#define __HAL_RCC_DMA1_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_DMA2_CLK_ENABLE() do {} while (0)
+
+//=============================================================================
+//                         Simulation functions
+//=============================================================================
+/**
+ * @brief Get default simulation parameters.
+ *
+ * @param[out] cfg The parameters with defaults filled in (216 MHz CPU, 54 and
+ *                 108 MHz APB clocks, Cortex-M7 interrupt and bus timings).
+ */
+void sim_get_default_cfg(struct sim_cfg* cfg);
+
+/**
+ * @brief Reset the simulation.
+ *
+ * @param[in] cfg The simulation parameters, or NULL for the defaults.
+ *
+ * The virtual clock restarts at 0, and the peripherals are in their reset
+ * state: the program sets up the USARTs (CR1, BRR...) before ttys_init(), as
+ * the board initialization does on the target.
+ */
+void sim_init(const struct sim_cfg* cfg);
+
+/**
+ * @brief Get the virtual time.
+ *
+ * @return CPU cycles since sim_init().
+ */
+uint64_t sim_get_cycles(void);
+
+/**
+ * @brief Let virtual time pass.
+ *
+ * @param[in] cycles Number of CPU cycles, e.g. spent by the main loop in
+ *                   other work.
+ *
+ * The lines run, and the interrupts are taken as they become pending.
+ */
+void sim_run(uint64_t cycles);
+
+/**
+ * @brief Queue characters to be sent by the peer to a USART.
+ *
+ * @param[in] uart The USART.
+ * @param[in] data The characters.
+ * @param[in] len Number of characters.
+ *
+ * @return Number of characters queued (limited by SIM_LINE_BUF_SIZE).
+ *
+ * The characters are sent back to back, as fast as the line (and RTS, if
+ * used) allows, from the current virtual time on.
+ */
+uint32_t sim_line_send(USART_TypeDef* uart, const char* data, uint32_t len);
+
+/**
+ * @brief Get the number of characters queued and not yet sent by the peer.
+ *
+ * @param[in] uart The USART.
+ *
+ * @return Number of characters.
+ */
+uint32_t sim_line_send_pending(USART_TypeDef* uart);
+
+/**
+ * @brief Take the characters transmitted by a USART.
+ *
+ * @param[in] uart The USART.
+ * @param[out] buf Location for the characters (NULL to discard them).
+ * @param[in] size Size of buf.
+ *
+ * @return Number of characters taken.
+ */
+uint32_t sim_line_recv(USART_TypeDef* uart, char* buf, uint32_t size);
+
+/**
+ * @brief Set the peer's readiness to receive (the USART's CTS input).
+ *
+ * @param[in] uart The USART.
+ * @param[in] ready False to hold off transmission (with CTSE).
+ */
+void sim_line_set_cts(USART_TypeDef* uart, bool ready);
+
+/**
+ * @brief Make the peer follow XON/XOFF flow control from the USART.
+ *
+ * @param[in] uart The USART.
+ * @param[in] enable True to stop sending on XOFF and resume on XON.
+ * @param[in] lag_chars Characters the peer still starts after XOFF, like the
+ *                      FIFO of a USB serial adapter.
+ *
+ * The XON and XOFF characters are still passed to sim_line_recv().
+ */
+void sim_line_set_xon_xoff(USART_TypeDef* uart, bool enable,
+                           uint32_t lag_chars);
+
+/**
+ * @brief Get the counters of a line.
+ *
+ * @param[in] uart The USART.
+ * @param[out] stats The counters since sim_init().
+ */
+void sim_line_get_stats(USART_TypeDef* uart, struct sim_line_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHELL_PORT_SIM_H_ */
@@ -0,0 +1,184 @@
+#ifndef _SHELL_RING_H_
+#define _SHELL_RING_H_
+
+/**
+ * @brief Interface declaration of ring module.
+ *
+ * This module provides a lock-free single-producer/single-consumer (SPSC) ring
+ * buffer of characters. It is used by the ttys module for its TX and RX
+ * queues, where one side runs in an interrupt handler and the other in the
+ * main loop.
+ *
+ * Main features:
+ * - The size must be a power of two. The put and get indexes are free running
+ *   counters and are masked on access, so all the buffer can be used and no
+ *   compare-and-wrap arithmetic is needed.
+ * - Only the producer writes the put index, and only the consumer writes the
+ *   get index. Each index is published with release semantics after the data
+ *   has been written or read, and loaded by the other side with acquire
+ *   semantics. This makes the handoff safe without disabling interrupts.
+ * - Besides single character and bulk copy functions, contiguous spans of the
+ *   buffer can be accessed in place (e.g. by a DMA stream) and then committed.
+ *
+ * Functions whose names contain "put" or "write" must only be called by the
+ * producer, and those with "get" or "read" only by the consumer.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+/**
+ * Ring buffer state. Treat as opaque, use the functions below.
+ */
+struct ring {
+    char* buf;
+    uint32_t mask;
+    uint32_t put_idx;
+    uint32_t get_idx;
+};
+
+//=============================================================================
+//                         Preprocessor Macros
+//=============================================================================
+/**
+ * Static initializer, for rings that might be used before ring_init().
+ */
+#define RING_INITIALIZER(_buf, _size) { .buf = (_buf), .mask = (_size) - 1 }
+
+/**
+ * Check, at compile time, if a ring size is valid (a power of two).
+ */
+#define RING_SIZE_IS_VALID(size) ((size) != 0 && ((size) & ((size) - 1)) == 0)
+
+//=============================================================================
+//                       Ring module interface functions
+//=============================================================================
+/**
+ * @brief Initialize a ring.
+ *
+ * @param[out] ring The ring to initialize.
+ * @param[in] buf The storage for the ring's data.
+ * @param[in] size Size of buf, must be a power of two.
+ *
+ * @return 0 for success, else a "SHELL_ERR_ARG" value.
+ */
+int32_t ring_init(struct ring* ring, char* buf, uint32_t size);
+
+/**
+ * @brief Get number of characters in the ring.
+ *
+ * @param[in] ring The ring.
+ *
+ * @return Number of characters that can be read.
+ */
+uint32_t ring_count(const struct ring* ring);
+
+/**
+ * @brief Get free space in the ring.
+ *
+ * @param[in] ring The ring.
+ *
+ * @return Number of characters that can be written.
+ */
+uint32_t ring_space(const struct ring* ring);
+
+/**
+ * @brief Put one character in the ring.
+ *
+ * @param[in] ring The ring.
+ * @param[in] c The character.
+ *
+ * @return Number of characters put (0 if the ring is full, or 1).
+ */
+uint32_t ring_putc(struct ring* ring, char c);
+
+/**
+ * @brief Get one character from the ring.
+ *
+ * @param[in] ring The ring.
+ * @param[out] c The character.
+ *
+ * @return Number of characters returned (0 if the ring is empty, or 1).
+ */
+uint32_t ring_getc(struct ring* ring, char* c);
+
+/**
+ * @brief Copy characters into the ring.
+ *
+ * @param[in] ring The ring.
+ * @param[in] data Characters to write.
+ * @param[in] len Number of characters to write.
+ *
+ * @return Number of characters written, which is less than len if the ring
+ *         becomes full.
+ */
+uint32_t ring_write(struct ring* ring, const char* data, uint32_t len);
+
+/**
+ * @brief Copy characters out of the ring.
+ *
+ * @param[in] ring The ring.
+ * @param[out] data Buffer for the characters.
+ * @param[in] len Size of the buffer.
+ *
+ * @return Number of characters read, which is less than len if the ring
+ *         becomes empty.
+ */
+uint32_t ring_read(struct ring* ring, char* data, uint32_t len);
+
+/**
+ * @brief Get the contiguous free span at the put position.
+ *
+ * @param[in] ring The ring.
+ * @param[out] ptr Start of the span.
+ *
+ * @return Length of the span. It can be less than ring_space() if the free
+ *         space wraps around the end of the buffer.
+ *
+ * The producer can write directly into the span and then make the data
+ * visible with ring_put_commit().
+ */
+uint32_t ring_put_span(const struct ring* ring, char** ptr);
+
+/**
+ * @brief Make characters written into the put span visible to the consumer.
+ *
+ * @param[in] ring The ring.
+ * @param[in] len Number of characters, not more than ring_space().
+ */
+void ring_put_commit(struct ring* ring, uint32_t len);
+
+/**
+ * @brief Get the contiguous span of data at the get position.
+ *
+ * @param[in] ring The ring.
+ * @param[out] ptr Start of the span.
+ *
+ * @return Length of the span. It can be less than ring_count() if the data
+ *         wraps around the end of the buffer.
+ *
+ * The consumer can read directly from the span and then release it with
+ * ring_get_commit().
+ */
+uint32_t ring_get_span(const struct ring* ring, char** ptr);
+
+/**
+ * @brief Release characters read from the get span back to the producer.
+ *
+ * @param[in] ring The ring.
+ * @param[in] len Number of characters, not more than ring_count().
+ */
+void ring_get_commit(struct ring* ring, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHELL_RING_H_ */
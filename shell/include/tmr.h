@@ -0,0 +1,181 @@
+#ifndef _SHELL_TMR_H_
+#define _SHELL_TMR_H_
+
+/**
+ * @brief Interface declaration of tmr module.
+ *
+ * This module provides the time base of the shell:
+ * - A monotonic 64-bit clock, in CPU cycles (the port cycle counter, i.e. the
+ *   DWT cycle counter on the target) and in microseconds. The 32-bit cycle
+ *   counter wraps around in about 20 seconds at 216 MHz, so the millisecond
+ *   tick (SysTick) is read with it, to count the wraps between two reads
+ *   however far apart. tmr_get_cycles() takes tens of cycles, so it can be
+ *   called in timing-critical code and interrupt handlers, e.g. to timestamp
+ *   log messages before they are formatted.
+ * - Timers, calling a function once or periodically, with a resolution of one
+ *   millisecond. The timers are kept in a hashed timer wheel
+ *   (TMR_WHEEL_SIZE slots of one tick), so starting and stopping a timer takes
+ *   a constant time, and tmr_run() only looks at the timers of the slots of
+ *   the elapsed ticks. The functions are called by tmr_run(), in the main loop
+ *   (console_run() calls it), so they can use the other modules. A timer can
+ *   be started and stopped from a timer function, including its own.
+ *
+ * The timers are owned by the caller (typically static variables), the module
+ * does not allocate memory. The timer functions are not for interrupt
+ * handlers.
+ *
+ * Example:
+ *
+ *     static struct tmr blink_tmr;
+ *
+ *     static void blink(void* arg)
+ *     {
+ *         uint32_t led_idx = (uintptr_t)arg;
+ *
+ *         dio_set(led_idx, !dio_get_out(led_idx));
+ *     }
+ *
+ *     tmr_start(&blink_tmr, 500, 500, blink, (void*)(uintptr_t)led_idx);
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//                         Preprocessor Constants
+//=============================================================================
+/**
+ * Number of slots of the timer wheel (a power of two). Timers expiring more
+ * than this number of milliseconds ahead stay in their slot for several turns.
+ */
+#ifndef TMR_WHEEL_SIZE
+#define TMR_WHEEL_SIZE  64
+#endif
+
+/**
+ * Maximum delay and period of a timer (ms), about 24 days
+ */
+#define TMR_MAX_MS  INT32_MAX
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+/**
+ * Function called when a timer expires, with the argument given to
+ * tmr_start()
+ */
+typedef void (*tmr_func)(void* arg);
+
+/**
+ * A timer. The members are private to the module.
+ */
+struct tmr {
+    struct tmr* next;
+    struct tmr** pprev;     // NULL if the timer is not running
+    uint32_t expiry_ms;
+    uint32_t period_ms;
+    tmr_func func;
+    void* arg;
+};
+
+//=============================================================================
+//                      TMR module interface functions
+//=============================================================================
+/**
+ * @brief Initialize the tmr module.
+ *
+ * @return 0 for success.
+ *
+ * Starts the cycle counter, and the clock from 0.
+ */
+int32_t tmr_init(void);
+
+/**
+ * @brief Get the monotonic clock, in CPU cycles.
+ *
+ * @return Cycles since tmr_init().
+ *
+ * Can be called from interrupt handlers.
+ */
+uint64_t tmr_get_cycles(void);
+
+/**
+ * @brief Convert a number of cycles to microseconds.
+ *
+ * @param[in] cycles The cycles (e.g. a value of tmr_get_cycles()).
+ *
+ * @return The microseconds, rounded down.
+ */
+uint64_t tmr_cycles_to_us(uint64_t cycles);
+
+/**
+ * @brief Get the monotonic clock, in microseconds.
+ *
+ * @return Microseconds since tmr_init().
+ *
+ * Can be called from interrupt handlers.
+ */
+uint64_t tmr_get_us(void);
+
+/**
+ * @brief Start a timer.
+ *
+ * @param[in] tmr The timer (restarted if it is running).
+ * @param[in] delay_ms Delay before the first call (0 for the next tmr_run()).
+ * @param[in] period_ms Period of the next calls, or 0 for a one-shot timer.
+ * @param[in] func The function to call.
+ * @param[in] arg The argument of the function.
+ *
+ * @return 0 for success, else a "ERR" value (SHELL_ERR_ARG).
+ *
+ * A periodic timer keeps its phase. If tmr_run() is late by more than a
+ * period, the missed calls are skipped.
+ */
+int32_t tmr_start(struct tmr* tmr, uint32_t delay_ms, uint32_t period_ms,
+                  tmr_func func, void* arg);
+
+/**
+ * @brief Stop a timer.
+ *
+ * @param[in] tmr The timer (nothing is done if it is not running).
+ */
+void tmr_stop(struct tmr* tmr);
+
+/**
+ * @brief Check if a timer is running.
+ *
+ * @param[in] tmr The timer.
+ *
+ * @return True if the timer is started and its function will be called.
+ */
+bool tmr_is_running(const struct tmr* tmr);
+
+/**
+ * @brief Call the functions of the expired timers.
+ *
+ * @note This function should not block. It is called by console_run().
+ */
+void tmr_run(void);
+
+/**
+ * @brief Get the time until the next timer expires.
+ *
+ * @param[in] max_ms The value returned if no timer expires before.
+ *
+ * @return Milliseconds until the next call of tmr_run() has a function to
+ *         call, at most max_ms.
+ *
+ * For a main loop that sleeps until there is something to do. It looks at
+ * every running timer.
+ */
+uint32_t tmr_get_idle_ms(uint32_t max_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHELL_TMR_H_ */
@@ -1,146 +1,419 @@
-#ifndef _SHELL_TTYS_H_
-#define _SHELL_TTYS_H_
-
-/**
- * @brief Interface declaration of ttys module.
- *
- * This module provides a simple "TTY serial" interface for MCU UARTs.
- * Main features:
- * - Buffering on output to prevent blocking (overrun is possible)
- * - Buffering on input to avoid loss of input characters (overrun is possible)
- * - Integrate into the C standard library streams I/O (to support printf and
-     friends)
- *
- * This library makes use of the STMicroelectronics HAL device library.
- *
- * Currently, this module does not perform hardware initialization of the UART
- * and associated hardware (e.g. GPIO), except for the interrupt controller (see
- * below). It is expected that the driver library has been used for
- * initialization (e.g. via generated IDE code). This avoids having to deal with
- * the issue of inconsistent driver libraries among MCUs.
- *
- * This module enables USART interrupts on the Nested Vector Interrupt
- * Controller (NVIC). It also overrides the (weak) USART interrupt handler
- * functions (USARTx_IRQHandler). Thus, in the IDE device configuration tool,
- * the "USARTx global interrupt" should NOT be chosen or you will get a
- * duplicate symbol at link time.
- *
- * A future feature is to perform full hardware initialization in this library,
- * and allowing at least some UART parameters to be set (e.g. baud).
- * Also allow communication to the host PC by methods other than UART,
- * like Ethernet.
- */
-
-//=============================================================================
-//                             Included Files
-//=============================================================================
-#include <stdbool.h>
-#include <stdint.h>
-#include <stdio.h>
-
-//=============================================================================
-//                         Preprocessor Constants
-//=============================================================================
-#define TTYS_RX_BUF_SIZE 80
-#define TTYS_TX_BUF_SIZE 1024
-
-//=============================================================================
-//                            Type Definitions
-//=============================================================================
-/**
- * UART numbering based on the MCU hardware definition
- */
-enum ttys_instance_id {
-    TTYS_INSTANCE_UART1,
-    TTYS_INSTANCE_UART5,
-    TTYS_INSTANCE_UART6,
-
-    TTYS_NUM_INSTANCES
-};
-
-/**
- * TTYS configuration struct:
- * - create_stream:    if set to TRUE, stdio stream is created for the UART, which
- *                     allows you to use stream IO API like printf(). Creating the
- *                     stream uses some heap memory.
- * - send_cr_after_nl: determines if a carriage return is automatically sent
- *                     after a new line.
- */
-struct ttys_cfg {
-    bool create_stream;
-    bool send_cr_after_nl;
-};
-
-//=============================================================================
-//                       TTYS core interface functions
-//=============================================================================
-/**
- * @brief Get default ttys configuration.
- *
- * @param[out] cfg The ttys configuration with defaults filled in.
- *
- * @return 0 for success, else a "ERR" value. See code for details.
- */
-int32_t ttys_get_default_cfg(enum ttys_instance_id instance_id,
-		                     struct ttys_cfg* cfg);
-
-/**
- * @brief Initialize ttys module instance.
- *
- * @param[in] instance_id Identifies the ttys instance.
- * @param[in] cfg The ttys module configuration (FUTURE)
- *
- * @return 0 for success, else a "ERR" value. See code for details.
- *
- * This function initializes a ttys module instance and enable
- * its interrupts.
- */
-int32_t ttys_init(enum ttys_instance_id instance_id, struct ttys_cfg* cfg);
-
-//=============================================================================
-//                                Other APIs
-//=============================================================================
-/**
- * @brief Put a character in the transmission buffer.
- *
- * @param[in] instance_id Identifies the ttys instance.
- * @param[in] c Character to transmit.
- *
- * @return 0 for success, else a "ERR" value. See code for details.
- *
- * @note Before this module is started, the UART is not known, but the user can
- *       still put chars in the TX buffer that will be transmitted if and when
- *       the module is started.
- */
-int32_t ttys_putc(enum ttys_instance_id instance_id, char c);
-
-/**
- * @brief Get character from the receive buffer.
- *
- * @param[in] instance_id Identifies the ttys instance.
- * @param[out] c Received character.
- *
- * @return Number of characters returned (0 or 1)
- */
-int32_t ttys_getc(enum ttys_instance_id instance_id, char* c);
-
-/**
- * @brief Get file descriptor for a ttys instance.
- *
- * @param[in] instance_id Identifies the ttys instance.
- *
- * @return File descriptor (>= 0) for success, else a "ERR" value (<0). See
- *          code for details.
- */
-int ttys_get_fd(enum ttys_instance_id instance_id);
-
-/**
- * @brief Get FILE stream for a ttys instance.
- *
- * @param[in] instance_id Identifies the ttys instance.
- *
- * @return FILE stream pointer, or NULL if error.
- */
-FILE* ttys_get_stream(enum ttys_instance_id instance_id);
-
-#endif /* _SHELL_TTYS_H_ */
+#ifndef _SHELL_TTYS_H_
+#define _SHELL_TTYS_H_
+
+/**
+ * @brief Interface declaration of ttys module.
+ *
+ * This module provides a simple "TTY serial" interface for MCU UARTs.
+ * Main features:
+ * - Buffering on output to prevent blocking (overrun is possible, handled
+ *   according to a per-instance policy)
+ * - Buffering on input to avoid loss of input characters (overrun is possible,
+ *   unless RTS/CTS flow control is used; overrun characters are dropped)
+ * - Integrate into the C standard library streams I/O (to support printf and
+     friends)
+ * - The UART instances and their buffer sizes are selected at build time (see
+ *   ttys_conf.h), so unused instances cost no memory.
+ *
+ * The hardware access is done by a port backend (see port.h): on the target,
+ * it makes use of the STMicroelectronics HAL device library, and with
+ * SHELL_PORT_POSIX the instances are mapped to devices of a Linux process (see
+ * port_posix.h).
+ *
+ * Currently, this module does not perform hardware initialization of the UART
+ * and associated hardware (e.g. GPIO), except for the interrupt controller (see
+ * below). It is expected that the driver library has been used for
+ * initialization (e.g. via generated IDE code). This avoids having to deal with
+ * the issue of inconsistent driver libraries among MCUs.
+ *
+ * This module enables USART interrupts on the Nested Vector Interrupt
+ * Controller (NVIC). It also overrides the (weak) USART interrupt handler
+ * functions (USARTx_IRQHandler). Thus, in the IDE device configuration tool,
+ * the "USARTx global interrupt" should NOT be chosen or you will get a
+ * duplicate symbol at link time.
+ *
+ * For the instances built with DMA support (see ttys_conf.h), this module also
+ * takes ownership of the UART's TX/RX DMA streams and overrides their interrupt
+ * handlers (DMAx_Streamy_IRQHandler). The streams must not be configured in the
+ * IDE device configuration tool. The streams used are:
+ * - UART1: TX DMA2 stream 7, channel 4; RX DMA2 stream 2, channel 4
+ * - UART2: TX DMA1 stream 6, channel 4; RX DMA1 stream 5, channel 4
+ * - UART3: TX DMA1 stream 3, channel 4; RX DMA1 stream 1, channel 4
+ * - UART4: TX DMA1 stream 4, channel 4; RX DMA1 stream 2, channel 4
+ * - UART5: TX DMA1 stream 7, channel 4; RX DMA1 stream 0, channel 4
+ * - UART6: TX DMA2 stream 6, channel 5; RX DMA2 stream 1, channel 5
+ * - UART7: TX DMA1 stream 1, channel 5; RX DMA1 stream 3, channel 5
+ * - UART8: TX DMA1 stream 0, channel 5; RX DMA1 stream 6, channel 5
+ * Thus UART3 and UART7, and UART5 and UART8, and UART2 and UART8 can't both
+ * have DMA support.
+ *
+ * The baud rate can be changed at run time (see ttys_set_baud() and the
+ * "ttys baud" command). A future feature is to perform full hardware
+ * initialization in this library, and to allow communication to the host PC
+ * by methods other than UART, like Ethernet.
+ */
+
+//=============================================================================
+//                             Included Files
+//=============================================================================
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ttys_conf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//                         Preprocessor Macros
+//=============================================================================
+// All the UARTs of the MCU, for use as X-macro: X(NAME, name, ...). Their
+// hardware details are in ttys.c.
+#define TTYS_FOR_EACH_UART(X, ...) \
+    X(UART1, uart1, __VA_ARGS__)   \
+    X(UART2, uart2, __VA_ARGS__)   \
+    X(UART3, uart3, __VA_ARGS__)   \
+    X(UART4, uart4, __VA_ARGS__)   \
+    X(UART5, uart5, __VA_ARGS__)   \
+    X(UART6, uart6, __VA_ARGS__)   \
+    X(UART7, uart7, __VA_ARGS__)   \
+    X(UART8, uart8, __VA_ARGS__)
+
+// Expand to the remaining arguments if flag (a literal 0 or 1 after macro
+// expansion, e.g. TTYS_UART1_ENABLED) is 1, else to nothing.
+#define TTYS_IF(flag, ...) TTYS_IF_(flag, __VA_ARGS__)
+#define TTYS_IF_(flag, ...) TTYS_IF_##flag(__VA_ARGS__)
+#define TTYS_IF_0(...)
+#define TTYS_IF_1(...) __VA_ARGS__
+
+// Instance identifier of an enabled UART.
+#define TTYS_INSTANCE_ID(NAME, name, ...) \
+    TTYS_IF(TTYS_##NAME##_ENABLED, TTYS_INSTANCE_##NAME,)
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+/**
+ * UART numbering based on the MCU hardware definition. Only the instances
+ * enabled in ttys_conf.h are defined (e.g. TTYS_INSTANCE_UART1).
+ */
+enum ttys_instance_id {
+    TTYS_FOR_EACH_UART(TTYS_INSTANCE_ID, unused)
+
+    TTYS_NUM_INSTANCES
+};
+
+/**
+ * Transmission modes:
+ * - TTYS_TX_MODE_IRQ: characters are moved from the TX buffer to the UART one
+ *                     at a time, by the TXE interrupt.
+ * - TTYS_TX_MODE_DMA: contiguous regions of the TX buffer are handed to a DMA
+ *                     stream, so there is one (transfer complete) interrupt
+ *                     per region instead of one per character.
+ */
+enum ttys_tx_mode {
+    TTYS_TX_MODE_IRQ,
+    TTYS_TX_MODE_DMA,
+};
+
+/**
+ * Reception modes:
+ * - TTYS_RX_MODE_IRQ: each received character is moved from the UART to the RX
+ *                     buffer by the RXNE interrupt.
+ * - TTYS_RX_MODE_DMA: a circular DMA stream writes received characters straight
+ *                     into the RX buffer. They are published to the reader in
+ *                     bulk when the line goes idle, or when the DMA reaches the
+ *                     middle or the end of the buffer.
+ */
+enum ttys_rx_mode {
+    TTYS_RX_MODE_IRQ,
+    TTYS_RX_MODE_DMA,
+};
+
+/**
+ * TX overrun policies, i.e. what happens when the TX buffer is full:
+ * - TTYS_TX_POLICY_DROP:      the new characters are dropped. A "[N bytes
+ *                             dropped]" marker is inserted in the output as
+ *                             soon as there is space for it.
+ * - TTYS_TX_POLICY_BLOCK:     wait for space, up to tx_block_timeout_ms, and
+ *                             then drop as above. There is no wait when called
+ *                             from an interrupt handler or with interrupts
+ *                             masked.
+ * - TTYS_TX_POLICY_OVERWRITE: the oldest characters are discarded to make room.
+ *                             Intended for log-only ports.
+ */
+enum ttys_tx_policy {
+    TTYS_TX_POLICY_DROP,
+    TTYS_TX_POLICY_BLOCK,
+    TTYS_TX_POLICY_OVERWRITE,
+};
+
+/**
+ * TTYS configuration struct:
+ * - create_stream:    if set to TRUE, stdio stream is created for the UART, which
+ *                     allows you to use stream IO API like printf(). Creating the
+ *                     stream uses some heap memory.
+ * - send_cr_after_nl: determines if a carriage return is automatically sent
+ *                     after a new line.
+ * - tx_mode:          how characters are moved to the UART (see enum above).
+ * - rx_mode:          how characters are moved from the UART (see enum above).
+ *                     The DMA modes need an instance built with DMA support
+ *                     (see ttys_conf.h).
+ * - tx_policy:        what to do when the TX buffer is full (see enum above).
+ * - tx_block_timeout_ms: maximum wait for the TTYS_TX_POLICY_BLOCK policy.
+ * - hw_flow_control:  enable RTS/CTS hardware flow control. The RTS and CTS
+ *                     pins must be configured by the user, like TX and RX.
+ * - sw_flow_control:  enable XON/XOFF software flow control of the input: XOFF
+ *                     is sent to make the host stop sending, and XON to make it
+ *                     resume. Flow control characters sent by the host are not
+ *                     interpreted.
+ * - rx_high_water:    with flow control, number of characters in the RX buffer
+ *                     at which reception is paused (RTS deasserted or XOFF
+ *                     sent). In the DMA reception mode the level is checked
+ *                     when data is published (at least at each half of the
+ *                     buffer), so it should not be over half the buffer size.
+ * - rx_low_water:     with flow control, number of characters in the RX buffer
+ *                     at or below which reception is resumed, as the reader
+ *                     drains the buffer. Must be below rx_high_water.
+ */
+struct ttys_cfg {
+    bool create_stream;
+    bool send_cr_after_nl;
+    enum ttys_tx_mode tx_mode;
+    enum ttys_rx_mode rx_mode;
+    enum ttys_tx_policy tx_policy;
+    uint32_t tx_block_timeout_ms;
+    bool hw_flow_control;
+    bool sw_flow_control;
+    uint32_t rx_high_water;
+    uint32_t rx_low_water;
+};
+
+//=============================================================================
+//                       TTYS core interface functions
+//=============================================================================
+/**
+ * @brief Get default ttys configuration.
+ *
+ * @param[out] cfg The ttys configuration with defaults filled in.
+ *
+ * @return 0 for success, else a "ERR" value. See code for details.
+ */
+int32_t ttys_get_default_cfg(enum ttys_instance_id instance_id,
+		                     struct ttys_cfg* cfg);
+
+/**
+ * @brief Initialize ttys module instance.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ * @param[in] cfg The ttys module configuration (FUTURE)
+ *
+ * @return 0 for success, else a "ERR" value. See code for details.
+ *
+ * This function initializes a ttys module instance and enable
+ * its interrupts.
+ */
+int32_t ttys_init(enum ttys_instance_id instance_id, struct ttys_cfg* cfg);
+
+//=============================================================================
+//                                Other APIs
+//=============================================================================
+/**
+ * @brief Put a character in the transmission buffer.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ * @param[in] c Character to transmit.
+ *
+ * @return 0 for success, else a "ERR" value. See code for details.
+ *
+ * @note The instance's TX overrun policy applies (see enum ttys_tx_policy).
+ *
+ * @note Before this module is started, the UART is not known, but the user can
+ *       still put chars in the TX buffer that will be transmitted if and when
+ *       the module is started.
+ */
+int32_t ttys_putc(enum ttys_instance_id instance_id, char c);
+
+/**
+ * @brief Get character from the receive buffer.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ * @param[out] c Received character.
+ *
+ * @return Number of characters returned (0 or 1)
+ */
+int32_t ttys_getc(enum ttys_instance_id instance_id, char* c);
+
+/**
+ * @brief Put a block of characters in the transmission buffer.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ * @param[in] buf Characters to transmit.
+ * @param[in] len Number of characters to transmit.
+ *
+ * @return Number of characters from buf put in the buffer, else a "ERR" value
+ *         (<0). See code for details. Depending on the instance's TX overrun
+ *         policy, this can be less than len when the buffer is full.
+ *
+ * The characters are copied in bulk (carriage returns are inserted after new
+ * lines in the same pass, if configured), and the transmission is started once
+ * per call. This is much cheaper than calling ttys_putc() for each character.
+ */
+int32_t ttys_write(enum ttys_instance_id instance_id, const char* buf,
+                   uint32_t len);
+
+/**
+ * @brief Reserve contiguous free space in the transmission buffer.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ * @param[out] ptr Start of the reserved space.
+ *
+ * @return Length of the reserved space (0 if the buffer is full), else a "ERR"
+ *         value (<0). See code for details.
+ *
+ * The caller writes its characters straight into the space, and then hands
+ * them over with ttys_tx_commit(). This avoids copying data that is formatted
+ * or generated in place (e.g. binary streams, hex dumps). The space can be
+ * shorter than the total free space when it wraps around the end of the
+ * buffer; commit and reserve again to get the rest.
+ *
+ * The characters are sent as they are (no carriage return insertion), and the
+ * TX overrun policy does not apply: the caller decides what to do when there
+ * is not enough space. Nothing else may write to the instance between the
+ * reservation and the commit.
+ *
+ * Example:
+ * @code
+ *     char* p;
+ *     int32_t len = ttys_tx_reserve(TTYS_INSTANCE_UART1, &p);
+ *     if (len >= 3) {
+ *         p[0] = hex[b >> 4]; p[1] = hex[b & 0xf]; p[2] = ' ';
+ *         ttys_tx_commit(TTYS_INSTANCE_UART1, 3);
+ *     }
+ * @endcode
+ */
+int32_t ttys_tx_reserve(enum ttys_instance_id instance_id, char** ptr);
+
+/**
+ * @brief Transmit characters written into the space from ttys_tx_reserve().
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ * @param[in] len Number of characters, not more than the reserved length.
+ *
+ * @return 0 for success, else a "ERR" value. See code for details.
+ *
+ * The transmission (TXE interrupt or DMA transfer) is started once per call.
+ */
+int32_t ttys_tx_commit(enum ttys_instance_id instance_id, uint32_t len);
+
+/**
+ * @brief Wait until the queued characters have been transmitted.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ * @param[in] timeout_ms Maximum wait.
+ *
+ * @return 0 for success, else a "ERR" value (SHELL_ERR_RESOURCE on timeout,
+ *         SHELL_ERR_STATE if called from an interrupt handler or with
+ *         interrupts masked). See code for details.
+ *
+ * This includes the last character, up to when it has left the device.
+ */
+int32_t ttys_flush(enum ttys_instance_id instance_id, uint32_t timeout_ms);
+
+/**
+ * @brief Get a block of characters from the receive buffer.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ * @param[out] buf Buffer for the received characters.
+ * @param[in] len Size of buf.
+ *
+ * @return Number of characters returned (0 if none available), else a "ERR"
+ *         value (<0). See code for details.
+ */
+int32_t ttys_read(enum ttys_instance_id instance_id, char* buf, uint32_t len);
+
+/**
+ * @brief Get file descriptor for a ttys instance.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * @return File descriptor (>= 0) for success, else a "ERR" value (<0). See
+ *          code for details.
+ */
+int ttys_get_fd(enum ttys_instance_id instance_id);
+
+/**
+ * @brief Map file descriptor to ttys instance.
+ *
+ * @param[in] fd File descriptor.
+ *
+ * @return Instance ID corresponding to file instance, or TTYS_NUM_INSTANCES if
+ *         no match.
+ */
+enum ttys_instance_id ttys_fd_to_instance(int fd);
+
+/**
+ * @brief Get FILE stream for a ttys instance.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * @return FILE stream pointer, or NULL if error.
+ */
+FILE* ttys_get_stream(enum ttys_instance_id instance_id);
+
+/**
+ * @brief Get the baud rate of a ttys instance.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * @return Baud rate (> 0) for success, else a "ERR" value (<0). See code for
+ *         details.
+ *
+ * The baud rate is computed from the UART's BRR register and kernel clock, so
+ * it also reflects the initialization done outside this module.
+ */
+int32_t ttys_get_baud(enum ttys_instance_id instance_id);
+
+/**
+ * @brief Change the baud rate of a ttys instance.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ * @param[in] baud The new baud rate.
+ * @param[in] confirm_timeout_ms If not 0, the change is tentative: unless
+ *                               ttys_confirm_baud() is called within this
+ *                               time, the previous baud rate is restored.
+ *
+ * @return 0 for success, else a "ERR" value. See code for details.
+ *
+ * The characters in the TX buffer are sent at the current baud rate before
+ * switching, so this waits for them (but fails if they can't be sent within
+ * about a second). The oversampling is chosen according to the rate (16, or 8
+ * for high rates). Must not be called from an interrupt handler.
+ *
+ * The tentative change allows a host to negotiate a higher rate: it sends the
+ * "ttys baud <rate> <timeout-ms>" command, switches its own rate after the
+ * reply, and sends "ttys baud confirm". If the new rate doesn't work, the
+ * confirmation is not received and both sides fall back to the previous rate
+ * (the timeout is checked by ttys_getc() and ttys_read()). See
+ * tools/ttys_baud.py.
+ */
+int32_t ttys_set_baud(enum ttys_instance_id instance_id, uint32_t baud,
+                      uint32_t confirm_timeout_ms);
+
+/**
+ * @brief Confirm a tentative baud rate change.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * @return 0 for success, else a "ERR" value (SHELL_ERR_STATE if no change is
+ *         pending). See code for details.
+ */
+int32_t ttys_confirm_baud(enum ttys_instance_id instance_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHELL_TTYS_H_ */
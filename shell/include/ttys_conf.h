@@ -0,0 +1,188 @@
+#ifndef _SHELL_TTYS_CONF_H_
+#define _SHELL_TTYS_CONF_H_
+
+/**
+ * @brief Build time configuration of ttys module.
+ *
+ * Each UART instance can be enabled individually, and has its own settings:
+ * - TTYS_<uart>_ENABLED: 1 to use the instance, else 0 (must be a literal 0 or
+ *   1, as it selects the code generated for the instance).
+ * - TTYS_<uart>_FD: file descriptor of the instance. The one with descriptor 1
+ *   is stdout, used by printf() and friends.
+ * - TTYS_<uart>_DMA: 1 to make the DMA transmission and reception modes
+ *   available (this overrides the interrupt handlers of the instance's DMA
+ *   streams), else 0. Must be a literal 0 or 1. Some instances share DMA
+ *   streams, so they can't both have it (see ttys.h).
+ * - TTYS_<uart>_RX_BUF_SIZE and TTYS_<uart>_TX_BUF_SIZE: buffer sizes.
+ *
+ * A disabled instance costs no RAM or flash: its state, buffers, interrupt
+ * handlers and file descriptor mapping are compiled out, and its
+ * TTYS_INSTANCE_xxx identifier does not exist.
+ *
+ * All values can be overridden at build time (e.g. -DTTYS_UART5_ENABLED=0
+ * -DTTYS_UART1_TX_BUF_SIZE=256), so this file does not need to be edited.
+ *
+ * The buffer sizes must be powers of two. When the DMA reception mode is used,
+ * the RX buffer should be large enough to hold the input received between two
+ * console_run() calls (e.g. 1024 bytes for pasted scripts).
+ */
+
+//=============================================================================
+//                         Preprocessor Constants
+//=============================================================================
+// Default buffer sizes, used by the instances that don't set their own.
+#ifndef TTYS_RX_BUF_SIZE
+#define TTYS_RX_BUF_SIZE 128
+#endif
+#ifndef TTYS_TX_BUF_SIZE
+#define TTYS_TX_BUF_SIZE 1024
+#endif
+
+// Set to 1 to measure the cycles spent in the USART interrupt handlers, with
+// the DWT cycle counter (shown as isr_cycles and isr_cycles_max by "ttys pm").
+#ifndef TTYS_ISR_CYCLE_STATS
+#define TTYS_ISR_CYCLE_STATS 0
+#endif
+
+// Highest file descriptor that can be assigned to an instance.
+#ifndef TTYS_MAX_FD
+#define TTYS_MAX_FD 15
+#endif
+
+// UART1 (stdout, used by the console by default)
+#ifndef TTYS_UART1_ENABLED
+#define TTYS_UART1_ENABLED 1
+#endif
+#ifndef TTYS_UART1_FD
+#define TTYS_UART1_FD 1
+#endif
+#ifndef TTYS_UART1_DMA
+#define TTYS_UART1_DMA 1
+#endif
+#ifndef TTYS_UART1_RX_BUF_SIZE
+#define TTYS_UART1_RX_BUF_SIZE TTYS_RX_BUF_SIZE
+#endif
+#ifndef TTYS_UART1_TX_BUF_SIZE
+#define TTYS_UART1_TX_BUF_SIZE TTYS_TX_BUF_SIZE
+#endif
+
+// UART2
+#ifndef TTYS_UART2_ENABLED
+#define TTYS_UART2_ENABLED 0
+#endif
+#ifndef TTYS_UART2_FD
+#define TTYS_UART2_FD 5
+#endif
+#ifndef TTYS_UART2_DMA
+#define TTYS_UART2_DMA 0
+#endif
+#ifndef TTYS_UART2_RX_BUF_SIZE
+#define TTYS_UART2_RX_BUF_SIZE TTYS_RX_BUF_SIZE
+#endif
+#ifndef TTYS_UART2_TX_BUF_SIZE
+#define TTYS_UART2_TX_BUF_SIZE TTYS_TX_BUF_SIZE
+#endif
+
+// UART3
+#ifndef TTYS_UART3_ENABLED
+#define TTYS_UART3_ENABLED 0
+#endif
+#ifndef TTYS_UART3_FD
+#define TTYS_UART3_FD 6
+#endif
+#ifndef TTYS_UART3_DMA
+#define TTYS_UART3_DMA 0
+#endif
+#ifndef TTYS_UART3_RX_BUF_SIZE
+#define TTYS_UART3_RX_BUF_SIZE TTYS_RX_BUF_SIZE
+#endif
+#ifndef TTYS_UART3_TX_BUF_SIZE
+#define TTYS_UART3_TX_BUF_SIZE TTYS_TX_BUF_SIZE
+#endif
+
+// UART4
+#ifndef TTYS_UART4_ENABLED
+#define TTYS_UART4_ENABLED 0
+#endif
+#ifndef TTYS_UART4_FD
+#define TTYS_UART4_FD 7
+#endif
+#ifndef TTYS_UART4_DMA
+#define TTYS_UART4_DMA 0
+#endif
+#ifndef TTYS_UART4_RX_BUF_SIZE
+#define TTYS_UART4_RX_BUF_SIZE TTYS_RX_BUF_SIZE
+#endif
+#ifndef TTYS_UART4_TX_BUF_SIZE
+#define TTYS_UART4_TX_BUF_SIZE TTYS_TX_BUF_SIZE
+#endif
+
+// UART5
+#ifndef TTYS_UART5_ENABLED
+#define TTYS_UART5_ENABLED 1
+#endif
+#ifndef TTYS_UART5_FD
+#define TTYS_UART5_FD 3
+#endif
+#ifndef TTYS_UART5_DMA
+#define TTYS_UART5_DMA 0
+#endif
+#ifndef TTYS_UART5_RX_BUF_SIZE
+#define TTYS_UART5_RX_BUF_SIZE TTYS_RX_BUF_SIZE
+#endif
+#ifndef TTYS_UART5_TX_BUF_SIZE
+#define TTYS_UART5_TX_BUF_SIZE TTYS_TX_BUF_SIZE
+#endif
+
+// UART6
+#ifndef TTYS_UART6_ENABLED
+#define TTYS_UART6_ENABLED 1
+#endif
+#ifndef TTYS_UART6_FD
+#define TTYS_UART6_FD 4
+#endif
+#ifndef TTYS_UART6_DMA
+#define TTYS_UART6_DMA 0
+#endif
+#ifndef TTYS_UART6_RX_BUF_SIZE
+#define TTYS_UART6_RX_BUF_SIZE TTYS_RX_BUF_SIZE
+#endif
+#ifndef TTYS_UART6_TX_BUF_SIZE
+#define TTYS_UART6_TX_BUF_SIZE TTYS_TX_BUF_SIZE
+#endif
+
+// UART7
+#ifndef TTYS_UART7_ENABLED
+#define TTYS_UART7_ENABLED 0
+#endif
+#ifndef TTYS_UART7_FD
+#define TTYS_UART7_FD 8
+#endif
+#ifndef TTYS_UART7_DMA
+#define TTYS_UART7_DMA 0
+#endif
+#ifndef TTYS_UART7_RX_BUF_SIZE
+#define TTYS_UART7_RX_BUF_SIZE TTYS_RX_BUF_SIZE
+#endif
+#ifndef TTYS_UART7_TX_BUF_SIZE
+#define TTYS_UART7_TX_BUF_SIZE TTYS_TX_BUF_SIZE
+#endif
+
+// UART8
+#ifndef TTYS_UART8_ENABLED
+#define TTYS_UART8_ENABLED 0
+#endif
+#ifndef TTYS_UART8_FD
+#define TTYS_UART8_FD 9
+#endif
+#ifndef TTYS_UART8_DMA
+#define TTYS_UART8_DMA 0
+#endif
+#ifndef TTYS_UART8_RX_BUF_SIZE
+#define TTYS_UART8_RX_BUF_SIZE TTYS_RX_BUF_SIZE
+#endif
+#ifndef TTYS_UART8_TX_BUF_SIZE
+#define TTYS_UART8_TX_BUF_SIZE TTYS_TX_BUF_SIZE
+#endif
+
+#endif /* _SHELL_TTYS_CONF_H_ */
@@ -0,0 +1,247 @@
+#ifndef _SHELL_TTYS_PORT_H_
+#define _SHELL_TTYS_PORT_H_
+
+/**
+ * @brief Interface between the ttys module and its hardware backend.
+ *
+ * This header is internal to the ttys module, applications use ttys.h.
+ *
+ * ttys.c holds the platform independent part of the module: the TX and RX
+ * buffers, the TX overrun policies, the flow control decisions, the stdio
+ * integration and the console commands. The backend of the platform (see
+ * port.h) moves characters between the buffers and the device:
+ * - Transmission: when ttys_hw_tx_kick() is called, the backend takes the
+ *   pending flow control character (tx_flow_char) first, then the characters
+ *   of the TX ring, e.g. from its interrupt handlers.
+ * - Reception: the backend puts received characters in the RX ring, updates the
+ *   rx_bytes, rx_overruns and rx_high_water counters, and calls
+ *   ttys_rx_check_high_water(). It stops reading while asked to pause (see
+ *   ttys_hw_rx_pause()).
+ *
+ * The backend functions are called from the main loop side, except
+ * ttys_hw_tx_kick() which is also called from the backend's own interrupt
+ * handlers (through ttys_rx_check_high_water()).
+ */
+
+//=============================================================================
+//                             Included Files
+//=============================================================================
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ring.h"
+#include "ttys.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//                         Preprocessor Macros
+//=============================================================================
+// Generate code for each enabled UART, with the TTYS_FOR_EACH_UART X-macro.
+// The generator gen is called with the parameters (id, name, tx_size, rx_size,
+// fd, dma, ...), taken from the instance's configuration. The remaining
+// parameters are the instance's hardware details, TTYS_<uart>_HW, as defined
+// by the backend (generators of ttys.c ignore them).
+#define TTYS_GEN(NAME, name, gen)                                             \
+    TTYS_IF(TTYS_##NAME##_ENABLED,                                            \
+            TTYS_GEN_(gen, TTYS_INSTANCE_##NAME, name,                        \
+                      TTYS_##NAME##_TX_BUF_SIZE, TTYS_##NAME##_RX_BUF_SIZE,   \
+                      TTYS_##NAME##_FD, TTYS_##NAME##_DMA, TTYS_##NAME##_HW))
+#define TTYS_GEN_(gen, ...) gen(__VA_ARGS__)
+
+// D-cache line size. The buffers are aligned and rounded up to it, so that
+// DMA cache maintenance never touches other variables.
+#define DCACHE_LINE_SIZE 32
+
+// Performance measurements of each instance (all are counters). The high
+// water marks are the maximum number of characters seen in the buffers. The
+// interrupt handler events are the conditions handled; divided by the
+// entries, they give the conditions handled per entry. Backends without
+// interrupts or DMA leave those counters at zero.
+#define TTYS_PM_COUNTERS(X, ...)     \
+    X(__VA_ARGS__, rx_bytes)         \
+    X(__VA_ARGS__, tx_bytes)         \
+    X(__VA_ARGS__, rx_overruns)      \
+    X(__VA_ARGS__, rx_throttles)     \
+    X(__VA_ARGS__, tx_overruns)      \
+    X(__VA_ARGS__, ore_errors)       \
+    X(__VA_ARGS__, fe_errors)        \
+    X(__VA_ARGS__, ne_errors)        \
+    X(__VA_ARGS__, pe_errors)        \
+    X(__VA_ARGS__, isr_entries)      \
+    X(__VA_ARGS__, isr_events)       \
+    X(__VA_ARGS__, dma_isr_entries)  \
+    X(__VA_ARGS__, rx_high_water)    \
+    X(__VA_ARGS__, tx_high_water)    \
+    TTYS_PM_ISR_CYCLES(X, __VA_ARGS__)
+
+// Interrupt handler cycles (total and maximum per entry), measured with the
+// DWT cycle counter.
+#if TTYS_ISR_CYCLE_STATS
+#define TTYS_PM_ISR_CYCLES(X, ...)   \
+    X(__VA_ARGS__, isr_cycles)       \
+    X(__VA_ARGS__, isr_cycles_max)
+#else
+#define TTYS_PM_ISR_CYCLES(X, ...)
+#endif
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+/**
+ * Per-instance performance measurements
+ */
+struct ttys_pm {
+#define TTYS_PM_FIELD(unused, counter) uint32_t counter;
+    TTYS_PM_COUNTERS(TTYS_PM_FIELD, unused)
+#undef TTYS_PM_FIELD
+};
+
+/**
+ * Per-instance ttys state information, shared with the backend. The backend
+ * keeps its own device state apart.
+ *
+ * The TX and RX buffers are kept apart too, as their sizes depend on the
+ * instance.
+ */
+struct ttys_state {
+    struct ttys_cfg cfg;
+    FILE* stream;
+    int fd;
+    bool initialized;
+    volatile bool rx_throttled;
+    volatile char tx_flow_char;
+    uint32_t baud_revert;
+    uint32_t baud_confirm_start_ms;
+    uint32_t baud_confirm_timeout_ms;
+    uint32_t tx_dropped;
+    struct ttys_pm pm;
+    struct ring tx_ring;
+    struct ring rx_ring;
+    char* rx_buf;
+    uint32_t rx_buf_size;
+};
+
+//=============================================================================
+//                          Shared ttys.c data
+//=============================================================================
+extern struct ttys_state ttys_states[TTYS_NUM_INSTANCES];
+
+//=============================================================================
+//                     Functions provided by ttys.c
+//=============================================================================
+/**
+ * @brief Pause reception if the RX buffer reached the high water mark.
+ *
+ * @param[in] state The ttys instance state.
+ *
+ * Called by the backend after putting characters in the RX buffer.
+ */
+void ttys_rx_check_high_water(struct ttys_state* state);
+
+//=============================================================================
+//                   Functions provided by the backend
+//=============================================================================
+/**
+ * @brief Start the device of an instance.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * @return 0 for success, else a "ERR" value (SHELL_ERR_ARG if the instance's
+ *         configuration is not supported, e.g. a DMA mode without DMA).
+ *
+ * Called by ttys_init(), once the state is set up.
+ */
+int32_t ttys_hw_init(enum ttys_instance_id instance_id);
+
+/**
+ * @brief Create the stdio stream of an instance.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * @return The stream, or NULL if error.
+ */
+FILE* ttys_hw_open_stream(enum ttys_instance_id instance_id);
+
+/**
+ * @brief Make sure queued TX characters are being transmitted.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * Does nothing before ttys_hw_init().
+ */
+void ttys_hw_tx_kick(enum ttys_instance_id instance_id);
+
+/**
+ * @brief Stop the transmission of the TX ring characters in progress.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * The characters already sent are released from the TX buffer, the rest stay
+ * queued, so that the oldest characters can be discarded. Called with
+ * interrupts masked.
+ */
+void ttys_hw_tx_abort(enum ttys_instance_id instance_id);
+
+/**
+ * @brief Check if the device has sent all the characters handed to it.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * @return True if the transmission is complete, including the last character
+ *         on the line.
+ */
+bool ttys_hw_tx_done(enum ttys_instance_id instance_id);
+
+/**
+ * @brief Stop or resume reading from the device (hardware flow control).
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ * @param[in] pause True to stop, false to resume.
+ *
+ * Called from the backend's interrupt handlers, or with interrupts masked.
+ */
+void ttys_hw_rx_pause(enum ttys_instance_id instance_id, bool pause);
+
+/**
+ * @brief Take the characters received by the device, for backends that are not
+ *        interrupt driven.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * Called by the reader before taking characters from the RX buffer. Being on
+ * the reader's side, it can also drop characters from the RX buffer (e.g. to
+ * recover from an overrun of a DMA writing in the buffer).
+ */
+void ttys_hw_rx_poll(enum ttys_instance_id instance_id);
+
+/**
+ * @brief Get the baud rate of the device.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * @return Baud rate (> 0) for success, else a "ERR" value (<0).
+ */
+int32_t ttys_hw_get_baud(enum ttys_instance_id instance_id);
+
+/**
+ * @brief Change the baud rate of the device.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ * @param[in] baud The new baud rate (> 0).
+ *
+ * @return 0 for success, else a "ERR" value (SHELL_ERR_ARG if the rate is not
+ *         supported).
+ *
+ * Called once the TX characters have been sent.
+ */
+int32_t ttys_hw_set_baud(enum ttys_instance_id instance_id, uint32_t baud);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHELL_TTYS_PORT_H_ */
@@ -1,37 +1,243 @@
-/**
- * @brief Implementation of log module.
- *
- */
-
-#include "shell.h"
-
-//=============================================================================
-//                         Public (global) variables
-//=============================================================================
-bool _log_active = true;
-
-//=============================================================================
-//                         Public (global) functions
-//=============================================================================
-void log_toggle_active(void)
-{
-    _log_active = _log_active ? false : true;
-}
-
-
-bool log_is_active(void)
-{
-    return _log_active;
-}
-
-
-void log_printf(const char* fmt, ...)
-{
-    va_list args;
-    //uint32_t ms = tmr_get_ms();
-
-    //printf("%lu.%03lu ", ms / 1000U, ms % 1000U);
-    va_start(args, fmt);
-    vprintf(fmt, args);
-    va_end(args);
-}
+/**
+ * @brief Implementation of log module.
+ *
+ */
+
+#include "shell.h"
+
+//=============================================================================
+//                           Macro Definitions
+//=============================================================================
+#if LOG_MODE != LOG_MODE_DIRECT
+_Static_assert(RING_SIZE_IS_VALID(LOG_BUF_SIZE),
+               "LOG_BUF_SIZE must be a power of 2");
+#endif
+
+// Size of a queued message: number of arguments, time (cycles), format and
+// arguments.
+#define LOG_MSG_SIZE(num_args) \
+    (1 + sizeof(uint64_t) + (1 + (num_args)) * sizeof(uintptr_t))
+
+// Size of a binary frame: sync, number of arguments, time (us), format and
+// arguments.
+#define LOG_FRAME_SIZE(num_args) \
+    (2 + sizeof(uint64_t) + (1 + (num_args)) * sizeof(uintptr_t))
+
+// Maximum wait for TX space in the middle of a binary frame (ms).
+#define LOG_FRAME_TIMEOUT_MS 100
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static bool log_out(uint64_t cycles, const char* fmt, uint32_t num_args,
+                    const uintptr_t* args);
+static void log_time(uint64_t cycles);
+
+//=============================================================================
+//                         Public (global) variables
+//=============================================================================
+bool _log_active = true;
+
+//=============================================================================
+//                         Private (static) variables
+//=============================================================================
+#if LOG_MODE != LOG_MODE_DIRECT
+// Queued messages. The ring has a single producer, so the messages are queued
+// with interrupts masked.
+static char log_buf[LOG_BUF_SIZE];
+static struct ring log_ring = RING_INITIALIZER(log_buf, LOG_BUF_SIZE);
+
+// Number of messages dropped as the ring was full, not reported yet.
+static uint32_t log_dropped;
+#endif
+
+//=============================================================================
+//                         Public (global) functions
+//=============================================================================
+void log_toggle_active(void)
+{
+    _log_active = _log_active ? false : true;
+}
+
+
+bool log_is_active(void)
+{
+    return _log_active;
+}
+
+
+void log_printf(const char* fmt, ...)
+{
+    uint64_t cycles = tmr_get_cycles();
+    va_list args;
+
+    log_time(cycles);
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+}
+
+
+void log_defer(const char* fmt, uint32_t num_args, const uintptr_t* args)
+{
+    uint64_t cycles = tmr_get_cycles();
+#if LOG_MODE != LOG_MODE_DIRECT
+    char msg[LOG_MSG_SIZE(LOG_MAX_ARGS)];
+    uint32_t len;
+    uint32_t irq_state;
+
+    if (num_args > LOG_MAX_ARGS)
+        num_args = LOG_MAX_ARGS;
+
+    // The message is written at once, so that the reader never sees part of
+    // it.
+    msg[0] = num_args;
+    memcpy(&msg[1], &cycles, sizeof(cycles));
+    memcpy(&msg[1 + sizeof(cycles)], &fmt, sizeof(fmt));
+    memcpy(&msg[1 + sizeof(cycles) + sizeof(fmt)], args,
+           num_args * sizeof(uintptr_t));
+    len = LOG_MSG_SIZE(num_args);
+
+    irq_state = port_irq_disable();
+    if (ring_space(&log_ring) >= len)
+        ring_write(&log_ring, msg, len);
+    else
+        log_dropped++;
+    port_irq_restore(irq_state);
+#else
+    log_out(cycles, fmt, num_args, args);
+#endif
+}
+
+
+void log_drain(void)
+{
+#if LOG_MODE != LOG_MODE_DIRECT
+    // Only the messages queued so far are taken, so that the messages logged
+    // while formatting (e.g. by ttys) don't keep this loop going.
+    uint32_t count = ring_count(&log_ring);
+    uintptr_t args[LOG_MAX_ARGS];
+    uintptr_t dropped;
+    uint64_t cycles;
+    uint32_t num_args;
+    uint32_t irq_state;
+    const char* fmt;
+    char c;
+
+    while (count > 0) {
+        ring_getc(&log_ring, &c);
+        num_args = (uint8_t)c;
+        ring_read(&log_ring, (char*)&cycles, sizeof(cycles));
+        ring_read(&log_ring, (char*)&fmt, sizeof(fmt));
+        ring_read(&log_ring, (char*)args, num_args * sizeof(uintptr_t));
+        count -= LOG_MSG_SIZE(num_args);
+
+        // If the console is full, the rest waits for the next call.
+        if (!log_out(cycles, fmt, num_args, args)) {
+            irq_state = port_irq_disable();
+            log_dropped++;
+            port_irq_restore(irq_state);
+            return;
+        }
+    }
+
+    if (log_dropped != 0) {
+        irq_state = port_irq_disable();
+        dropped = log_dropped;
+        log_dropped = 0;
+        port_irq_restore(irq_state);
+        if (!log_out(tmr_get_cycles(), "WARN %lu log messages dropped\n", 1,
+                     &dropped)) {
+            irq_state = port_irq_disable();
+            log_dropped += dropped;
+            port_irq_restore(irq_state);
+        }
+    }
+#endif
+}
+
+//=============================================================================
+//                         Private (static) functions
+//=============================================================================
+/**
+ * @brief Output a message.
+ *
+ * @param[in] cycles Time of the message (tmr_get_cycles()).
+ * @param[in] fmt Format string.
+ * @param[in] num_args Number of arguments.
+ * @param[in] args The arguments, as words.
+ *
+ * @return False if the message was lost, as the console could not take it.
+ *
+ * The message is formatted, or written as a binary frame in LOG_MODE_BINARY.
+ */
+static bool log_out(uint64_t cycles, const char* fmt, uint32_t num_args,
+                    const uintptr_t* args)
+{
+#if LOG_MODE == LOG_MODE_BINARY
+    enum ttys_instance_id instance_id = ttys_fd_to_instance(STDOUT_FILENO);
+    char frame[LOG_FRAME_SIZE(LOG_MAX_ARGS)];
+    uint64_t us = tmr_cycles_to_us(cycles);
+    uintptr_t word;
+    uint32_t len = 0;
+    uint32_t done;
+    int32_t space;
+    char* ptr;
+
+    frame[len++] = LOG_FRAME_SYNC;
+    frame[len++] = num_args;
+    for (uint32_t byte = 0; byte < sizeof(us); byte++)
+        frame[len++] = us >> (8 * byte);
+    for (int32_t idx = -1; idx < (int32_t)num_args; idx++) {
+        word = idx < 0 ? (uintptr_t)fmt : args[idx];
+        for (uint32_t byte = 0; byte < sizeof(word); byte++)
+            frame[len++] = word >> (8 * byte);
+    }
+
+    // The frame is written as is (no carriage return after new lines). If
+    // there is no space for its start, it is lost. Once started, it is
+    // completed as the console sends, so that it is not cut.
+    for (done = 0; done < len; done += space) {
+        space = ttys_tx_reserve(instance_id, &ptr);
+        if (space < 0)
+            return false;
+        if (space == 0) {
+            if (done == 0 ||
+                ttys_flush(instance_id, LOG_FRAME_TIMEOUT_MS) < 0)
+                return false;
+            continue;
+        }
+        if ((uint32_t)space > len - done)
+            space = len - done;
+        memcpy(ptr, &frame[done], space);
+        ttys_tx_commit(instance_id, space);
+    }
+#else
+    // The words are passed in place of the original arguments, which were at
+    // most words themselves (on the Arm and x86-64 ABIs, integer and pointer
+    // arguments take a whole register or stack word each). The unused ones
+    // are ignored by printf().
+    uintptr_t words[LOG_MAX_ARGS] = { 0 };
+
+    memcpy(words, args, num_args * sizeof(uintptr_t));
+    log_time(cycles);
+    printf(fmt, words[0], words[1], words[2], words[3], words[4], words[5],
+           words[6], words[7]);
+#endif
+
+    return true;
+}
+
+
+/**
+ * @brief Print the time of a message.
+ *
+ * @param[in] cycles Time of the message (tmr_get_cycles()).
+ */
+static void log_time(uint64_t cycles)
+{
+    uint64_t us = tmr_cycles_to_us(cycles);
+
+    printf("%lu.%06lu ", (unsigned long)(us / 1000000U),
+           (unsigned long)(us % 1000000U));
+}
@@ -0,0 +1,241 @@
+/**
+ * @brief Implementation of num module.
+ */
+
+#include "shell.h"
+
+//=============================================================================
+//                           Macro Definitions
+//=============================================================================
+// Maximum power of 10 of the fraction of num_parse_fixed() (nine digits). The
+// fraction times 2^31 then fits in 64 bits.
+#define NUM_FRAC_SCALE_MAX 1000000000U
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static const char* num_prefix(const char* str, uint32_t* base);
+static const char* num_scan(const char* str, uint32_t base, uint32_t* val,
+                            bool* overflow);
+static uint32_t num_digit(char c);
+
+//=============================================================================
+//                       Public (global) functions
+//=============================================================================
+int32_t num_parse_uint(const char* str, uint32_t* val)
+{
+    uint32_t base;
+    uint32_t value;
+    bool overflow;
+
+    if (*str == '+')
+        str++;
+    str = num_prefix(str, &base);
+    str = num_scan(str, base, &value, &overflow);
+    if (str == NULL || *str != '\0')
+        return SHELL_ERR_ARG;
+    if (overflow)
+        return SHELL_ERR_RANGE;
+
+    *val = value;
+    return 0;
+}
+
+
+int32_t num_parse_int(const char* str, int32_t* val)
+{
+    bool neg = *str == '-';
+    uint32_t base;
+    uint32_t value;
+    bool overflow;
+
+    if (*str == '-' || *str == '+')
+        str++;
+    str = num_prefix(str, &base);
+    str = num_scan(str, base, &value, &overflow);
+    if (str == NULL || *str != '\0')
+        return SHELL_ERR_ARG;
+
+    // The magnitude of a negative value can be one more than INT32_MAX.
+    if (overflow || value > (uint32_t)INT32_MAX + neg)
+        return SHELL_ERR_RANGE;
+
+    *val = neg ? (int32_t)(0U - value) : (int32_t)value;
+    return 0;
+}
+
+
+int32_t num_parse_hex(const char* str, uint32_t* val)
+{
+    uint32_t value;
+    bool overflow;
+
+    if (str[0] == '0' && (str[1] | 0x20) == 'x')
+        str += 2;
+    str = num_scan(str, 16, &value, &overflow);
+    if (str == NULL || *str != '\0')
+        return SHELL_ERR_ARG;
+    if (overflow)
+        return SHELL_ERR_RANGE;
+
+    *val = value;
+    return 0;
+}
+
+
+int32_t num_parse_fixed(const char* str, uint32_t frac_bits, int32_t* val)
+{
+    bool neg = *str == '-';
+    bool overflow = false;
+    bool digit = false;
+    uint32_t int_part = 0;
+    uint32_t frac = 0;
+    uint32_t scale = 1;
+    uint32_t d;
+    uint64_t value;
+
+    if (frac_bits > 31)
+        return SHELL_ERR_ARG;
+
+    if (*str == '-' || *str == '+')
+        str++;
+
+    // The integer part can be left out (e.g. .5), but not the fraction after
+    // a point.
+    if (*str != '.') {
+        str = num_scan(str, 10, &int_part, &overflow);
+        if (str == NULL)
+            return SHELL_ERR_ARG;
+    }
+    if (*str == '.') {
+        for (str++; *str != '\0'; str++) {
+            d = num_digit(*str);
+            if (d < 10) {
+                if (scale < NUM_FRAC_SCALE_MAX) {
+                    frac = frac * 10 + d;
+                    scale *= 10;
+                }
+                digit = true;
+            } else if (*str == NUM_SEPARATOR && digit) {
+                digit = false;
+            } else {
+                return SHELL_ERR_ARG;
+            }
+        }
+        if (!digit)
+            return SHELL_ERR_ARG;
+    }
+    if (*str != '\0')
+        return SHELL_ERR_ARG;
+
+    // The fraction is rounded once, on its own: a carry into the integer part
+    // is added with it.
+    value = (uint64_t)int_part << frac_bits;
+    if (scale > 1)
+        value += (((uint64_t)frac << frac_bits) + scale / 2) / scale;
+
+    if (overflow || value > (uint64_t)INT32_MAX + neg)
+        return SHELL_ERR_RANGE;
+
+    *val = neg ? (int32_t)(0U - (uint32_t)value) : (int32_t)value;
+    return 0;
+}
+
+//=============================================================================
+//                       Private (static) functions
+//=============================================================================
+/**
+ * @brief Skip the base prefix of an integer.
+ *
+ * @param[in] str The integer, after its sign.
+ * @param[out] base The base: 16 after 0x, 2 after 0b, 8 after another 0, else
+ *                  10.
+ *
+ * @return The string after the prefix.
+ */
+static const char* num_prefix(const char* str, uint32_t* base)
+{
+    *base = 10;
+    if (str[0] != '0' || str[1] == '\0')
+        return str;
+
+    switch (str[1] | 0x20) {
+        case 'x':
+            *base = 16;
+            return str + 2;
+        case 'b':
+            *base = 2;
+            return str + 2;
+        default:
+            *base = 8;
+            return str + 1;
+    }
+}
+
+
+/**
+ * @brief Convert the digits at the start of a string.
+ *
+ * @param[in] str The string.
+ * @param[in] base The base of the digits (2 to 16).
+ * @param[out] val The value, modulo 2^32.
+ * @param[out] overflow Set to true if the value does not fit in 32 bits, else
+ *                      false.
+ *
+ * @return The string after the digits, or NULL if there is no digit, or a
+ *         separator is not between two digits.
+ *
+ * The overflow is accumulated without branches, so that the loop only tests
+ * the characters.
+ */
+static const char* num_scan(const char* str, uint32_t base, uint32_t* val,
+                            bool* overflow)
+{
+    uint32_t cutoff = UINT32_MAX / base;
+    uint32_t acc = 0;
+    uint32_t d;
+    bool ovf = false;
+    bool digit = false;
+
+    for (;; str++) {
+        d = num_digit(*str);
+        if (d < base) {
+            ovf |= acc > cutoff;
+            acc *= base;
+            ovf |= acc + d < acc;
+            acc += d;
+            digit = true;
+        } else if (*str == NUM_SEPARATOR && digit) {
+            digit = false;
+        } else {
+            break;
+        }
+    }
+
+    if (!digit)
+        return NULL;
+
+    *val = acc;
+    *overflow = ovf;
+    return str;
+}
+
+
+/**
+ * @brief Get the value of a digit.
+ *
+ * @param[in] c The character.
+ *
+ * @return Value of the digit (0 to 15), else a value larger than any base.
+ */
+static uint32_t num_digit(char c)
+{
+    uint32_t d = (uint32_t)(uint8_t)c - '0';
+
+    if (d <= 9)
+        return d;
+
+    // Lowercase letter (other characters are mapped out of a-f).
+    d = ((uint32_t)(uint8_t)c | 0x20) - 'a';
+    return d < 6 ? d + 10 : UINT32_MAX;
+}
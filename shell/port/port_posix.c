@@ -0,0 +1,64 @@
+/**
+ * @brief Implementation of port layer for POSIX systems.
+ */
+
+#include "shell.h"
+
+#if defined(SHELL_PORT_POSIX)
+
+#include <time.h>
+
+//=============================================================================
+//                        Public (global) functions
+//=============================================================================
+uint32_t port_get_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint32_t)(ts.tv_sec * 1000U + ts.tv_nsec / 1000000U);
+}
+
+
+uint32_t port_irq_disable(void)
+{
+    // No interrupts, the ttys backend runs in the main loop.
+    return 0;
+}
+
+
+void port_irq_restore(uint32_t state)
+{
+    (void)state;
+}
+
+
+bool port_can_wait(void)
+{
+    return true;
+}
+
+
+void port_cycles_start(void)
+{
+}
+
+
+uint32_t port_get_cycles(void)
+{
+    struct timespec ts;
+
+    // Nanoseconds stand in for cycles.
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+
+uint32_t port_get_cycles_hz(void)
+{
+    return 1000000000U;
+}
+
+#endif /* SHELL_PORT_POSIX */
@@ -0,0 +1,917 @@
+/**
+ * @brief Implementation of simulated STM32F7 port (see port_sim.h).
+ *
+ * The model is event driven: the only events are the ends of the characters
+ * on the lines. Between events the peripheral state is constant, so the
+ * virtual clock jumps from one event to the next, and interrupts are taken
+ * after the events (or register writes) that make them pending. The DMA
+ * streams take no time: a TX stream refills TDR as soon as TXE is set.
+ */
+
+#include "shell.h"
+
+#if defined(SHELL_PORT_SIM)
+
+//=============================================================================
+//                         Preprocessor Constants
+//=============================================================================
+// Number of DMA streams (DMA1 and DMA2)
+#define SIM_NUM_DMA_STREAMS 16
+
+// DMA stream interrupt flags, relative to the stream's position in LISR/HISR
+#define SIM_DMA_TEIF (1U << 3)
+#define SIM_DMA_HTIF (1U << 4)
+#define SIM_DMA_TCIF (1U << 5)
+
+// Flow control characters followed by the peer
+#define SIM_XON  '\x11'
+#define SIM_XOFF '\x13'
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+/**
+ * State of a line: the characters in flight in each direction, and the
+ * peer's buffers.
+ */
+struct sim_line {
+    struct ring rx_queue;       // Peer to USART, not yet sent
+    struct ring tx_capture;     // USART to peer, not yet taken
+    bool rx_busy;
+    bool tx_busy;
+    bool rts_stalled;
+    bool cts_ready;
+    bool xon_xoff;              // The peer follows XON/XOFF
+    bool xoff;                  // XOFF received, no XON since
+    uint32_t xoff_lag;          // Characters started after XOFF
+    uint32_t xoff_lag_left;     // Of those, not started yet
+    char rx_char;
+    char tx_char;
+    uint64_t rx_end;
+    uint64_t tx_end;
+    struct sim_line_stats stats;
+    char rx_queue_buf[SIM_LINE_BUF_SIZE];
+    char tx_capture_buf[SIM_LINE_BUF_SIZE];
+};
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static int32_t sim_usart_index(volatile uint32_t* reg);
+static uint64_t sim_frame_cycles(uint32_t idx);
+static void sim_line_kick(uint32_t idx);
+static void sim_line_tx_end(uint32_t idx);
+static void sim_line_rx_end(uint32_t idx);
+static void sim_step(uint64_t until);
+static void sim_advance(uint64_t cycles);
+static bool sim_usart_irq_pending(uint32_t idx);
+static int32_t sim_dma_stream_index(volatile uint32_t* reg);
+static void sim_dma_write(volatile uint32_t* reg, uint32_t val);
+static void sim_dma_sync_flags(void);
+static void sim_dma_set_flags(uint32_t num, uint32_t flags);
+static void sim_dma_tx(uint32_t idx);
+static bool sim_dma_irq_pending(uint32_t num);
+static bool sim_take_irq(void);
+static void sim_take_irqs(void);
+
+//=============================================================================
+//                        Public (global) variables
+//=============================================================================
+USART_TypeDef sim_usarts[SIM_NUM_USARTS];
+DMA_TypeDef sim_dmas[2];
+DMA_Stream_TypeDef sim_dma_streams[2][8];
+RCC_TypeDef sim_rcc;
+DWT_Type sim_dwt;
+CoreDebug_Type sim_core_debug;
+
+// The USART interrupt handlers, defined by the ttys backend for the enabled
+// instances only. As in the target's vector table, the others are weak.
+void USART1_IRQHandler(void) __attribute__((weak));
+void USART2_IRQHandler(void) __attribute__((weak));
+void USART3_IRQHandler(void) __attribute__((weak));
+void UART4_IRQHandler(void) __attribute__((weak));
+void UART5_IRQHandler(void) __attribute__((weak));
+void USART6_IRQHandler(void) __attribute__((weak));
+void UART7_IRQHandler(void) __attribute__((weak));
+void UART8_IRQHandler(void) __attribute__((weak));
+void DMA1_Stream0_IRQHandler(void) __attribute__((weak));
+void DMA1_Stream1_IRQHandler(void) __attribute__((weak));
+void DMA1_Stream2_IRQHandler(void) __attribute__((weak));
+void DMA1_Stream3_IRQHandler(void) __attribute__((weak));
+void DMA1_Stream4_IRQHandler(void) __attribute__((weak));
+void DMA1_Stream5_IRQHandler(void) __attribute__((weak));
+void DMA1_Stream6_IRQHandler(void) __attribute__((weak));
+void DMA1_Stream7_IRQHandler(void) __attribute__((weak));
+void DMA2_Stream0_IRQHandler(void) __attribute__((weak));
+void DMA2_Stream1_IRQHandler(void) __attribute__((weak));
+void DMA2_Stream2_IRQHandler(void) __attribute__((weak));
+void DMA2_Stream3_IRQHandler(void) __attribute__((weak));
+void DMA2_Stream4_IRQHandler(void) __attribute__((weak));
+void DMA2_Stream5_IRQHandler(void) __attribute__((weak));
+void DMA2_Stream6_IRQHandler(void) __attribute__((weak));
+void DMA2_Stream7_IRQHandler(void) __attribute__((weak));
+
+//=============================================================================
+//                        Private (static) variables
+//=============================================================================
+static void (* const sim_usart_handlers[SIM_NUM_USARTS])(void) = {
+    USART1_IRQHandler, USART2_IRQHandler, USART3_IRQHandler, UART4_IRQHandler,
+    UART5_IRQHandler, USART6_IRQHandler, UART7_IRQHandler, UART8_IRQHandler,
+};
+
+static const IRQn_Type sim_usart_irqs[SIM_NUM_USARTS] = {
+    USART1_IRQn, USART2_IRQn, USART3_IRQn, UART4_IRQn,
+    UART5_IRQn, USART6_IRQn, UART7_IRQn, UART8_IRQn,
+};
+
+// The DMA stream interrupt handlers, indexed by stream number (DMA2 from 8)
+static void (* const sim_dma_handlers[SIM_NUM_DMA_STREAMS])(void) = {
+    DMA1_Stream0_IRQHandler, DMA1_Stream1_IRQHandler, DMA1_Stream2_IRQHandler,
+    DMA1_Stream3_IRQHandler, DMA1_Stream4_IRQHandler, DMA1_Stream5_IRQHandler,
+    DMA1_Stream6_IRQHandler, DMA1_Stream7_IRQHandler, DMA2_Stream0_IRQHandler,
+    DMA2_Stream1_IRQHandler, DMA2_Stream2_IRQHandler, DMA2_Stream3_IRQHandler,
+    DMA2_Stream4_IRQHandler, DMA2_Stream5_IRQHandler, DMA2_Stream6_IRQHandler,
+    DMA2_Stream7_IRQHandler,
+};
+
+static const IRQn_Type sim_dma_irqs[SIM_NUM_DMA_STREAMS] = {
+    DMA1_Stream0_IRQn, DMA1_Stream1_IRQn, DMA1_Stream2_IRQn, DMA1_Stream3_IRQn,
+    DMA1_Stream4_IRQn, DMA1_Stream5_IRQn, DMA1_Stream6_IRQn, DMA1_Stream7_IRQn,
+    DMA2_Stream0_IRQn, DMA2_Stream1_IRQn, DMA2_Stream2_IRQn, DMA2_Stream3_IRQn,
+    DMA2_Stream4_IRQn, DMA2_Stream5_IRQn, DMA2_Stream6_IRQn, DMA2_Stream7_IRQn,
+};
+
+static struct sim_cfg sim_cfg;
+static uint64_t sim_cycles;
+static uint32_t sim_primask;
+static uint32_t sim_active_irq;     // 0 in thread mode
+static bool sim_irq_enabled[SIM_NUM_IRQS];
+static struct sim_line sim_lines[SIM_NUM_USARTS];
+
+// Per DMA stream: NDTR when it was enabled, and bytes transferred since
+static uint32_t sim_dma_len[SIM_NUM_DMA_STREAMS];
+static uint32_t sim_dma_pos[SIM_NUM_DMA_STREAMS];
+
+//=============================================================================
+//                        Public (global) functions
+//=============================================================================
+void sim_get_default_cfg(struct sim_cfg* cfg)
+{
+    memset(cfg, 0, sizeof(struct sim_cfg));
+    cfg->sysclk_hz = 216000000;
+    cfg->pclk1_hz = 54000000;
+    cfg->pclk2_hz = 108000000;
+    cfg->irq_cycles = 24;       // Exception entry and return, no FPU context
+    cfg->reg_cycles = 4;        // APB access from the AXI bus
+}
+
+
+void sim_init(const struct sim_cfg* cfg)
+{
+    if (cfg != NULL)
+        sim_cfg = *cfg;
+    else
+        sim_get_default_cfg(&sim_cfg);
+    if (sim_cfg.irq_cycles == 0)
+        sim_cfg.irq_cycles = 1;
+
+    sim_cycles = 0;
+    sim_primask = 0;
+    sim_active_irq = 0;
+    memset(sim_irq_enabled, 0, sizeof(sim_irq_enabled));
+    memset(sim_usarts, 0, sizeof(sim_usarts));
+    memset(sim_dmas, 0, sizeof(sim_dmas));
+    memset(sim_dma_streams, 0, sizeof(sim_dma_streams));
+    memset(sim_dma_len, 0, sizeof(sim_dma_len));
+    memset(sim_dma_pos, 0, sizeof(sim_dma_pos));
+    memset(&sim_rcc, 0, sizeof(sim_rcc));
+    memset(&sim_dwt, 0, sizeof(sim_dwt));
+    memset(&sim_core_debug, 0, sizeof(sim_core_debug));
+
+    for (uint32_t idx = 0; idx < SIM_NUM_USARTS; idx++) {
+        struct sim_line* line = &sim_lines[idx];
+
+        // Reset value of ISR: transmitter idle
+        sim_usarts[idx].ISR = USART_ISR_TXE | USART_ISR_TC;
+        memset(line, 0, sizeof(struct sim_line));
+        ring_init(&line->rx_queue, line->rx_queue_buf, SIM_LINE_BUF_SIZE);
+        ring_init(&line->tx_capture, line->tx_capture_buf, SIM_LINE_BUF_SIZE);
+        line->cts_ready = true;
+    }
+}
+
+
+uint64_t sim_get_cycles(void)
+{
+    return sim_cycles;
+}
+
+
+/**
+ * The interrupts are taken one at a time, so that an interrupt that never
+ * stops being pending (a driver bug) still lets the virtual time reach the end.
+ */
+void sim_run(uint64_t cycles)
+{
+    uint64_t end = sim_cycles + cycles;
+
+    while (sim_cycles < end) {
+        if (!sim_take_irq())
+            sim_step(end);
+    }
+    sim_take_irqs();
+}
+
+
+uint32_t sim_line_send(USART_TypeDef* uart, const char* data, uint32_t len)
+{
+    uint32_t idx = uart - sim_usarts;
+    uint32_t done = ring_write(&sim_lines[idx].rx_queue, data, len);
+
+    sim_line_kick(idx);
+    sim_take_irqs();
+
+    return done;
+}
+
+
+uint32_t sim_line_send_pending(USART_TypeDef* uart)
+{
+    return ring_count(&sim_lines[uart - sim_usarts].rx_queue);
+}
+
+
+uint32_t sim_line_recv(USART_TypeDef* uart, char* buf, uint32_t size)
+{
+    struct ring* capture = &sim_lines[uart - sim_usarts].tx_capture;
+    uint32_t len;
+
+    if (buf != NULL)
+        return ring_read(capture, buf, size);
+
+    len = ring_count(capture);
+    if (len > size)
+        len = size;
+    ring_get_commit(capture, len);
+
+    return len;
+}
+
+
+void sim_line_set_cts(USART_TypeDef* uart, bool ready)
+{
+    uint32_t idx = uart - sim_usarts;
+
+    sim_lines[idx].cts_ready = ready;
+    sim_line_kick(idx);
+    sim_take_irqs();
+}
+
+
+void sim_line_set_xon_xoff(USART_TypeDef* uart, bool enable,
+                           uint32_t lag_chars)
+{
+    uint32_t idx = uart - sim_usarts;
+
+    sim_lines[idx].xon_xoff = enable;
+    sim_lines[idx].xoff = false;
+    sim_lines[idx].xoff_lag = lag_chars;
+    sim_line_kick(idx);
+    sim_take_irqs();
+}
+
+
+void sim_line_get_stats(USART_TypeDef* uart, struct sim_line_stats* stats)
+{
+    *stats = sim_lines[uart - sim_usarts].stats;
+}
+
+//=============================================================================
+//                           Register access
+//=============================================================================
+uint32_t sim_reg_read(volatile uint32_t* reg)
+{
+    int32_t idx = sim_usart_index(reg);
+    uint32_t val;
+
+    sim_advance(sim_cfg.reg_cycles);
+    sim_dma_sync_flags();
+    sim_take_irqs();
+
+    val = *reg;
+    if (idx >= 0 && reg == &sim_usarts[idx].RDR) {
+        // Reading the data register makes room for the next character
+        sim_usarts[idx].ISR &= ~USART_ISR_RXNE;
+        sim_line_kick(idx);
+    }
+
+    return val;
+}
+
+
+void sim_reg_write(volatile uint32_t* reg, uint32_t val)
+{
+    int32_t idx = sim_usart_index(reg);
+    USART_TypeDef* uart;
+
+    sim_advance(sim_cfg.reg_cycles);
+    sim_dma_sync_flags();
+    sim_take_irqs();
+
+    if (idx < 0) {
+        sim_dma_write(reg, val);
+        return;
+    }
+
+    uart = &sim_usarts[idx];
+    if (reg == &uart->ISR || reg == &uart->RDR) {
+        // Read only
+    } else if (reg == &uart->ICR) {
+        // The clear flags are at the positions of the ISR flags
+        uart->ISR &= ~(val & (USART_ICR_PECF | USART_ICR_FECF | USART_ICR_NCF |
+                              USART_ICR_ORECF | USART_ICR_IDLECF |
+                              USART_ICR_TCCF));
+    } else if (reg == &uart->TDR) {
+        if (!(uart->ISR & USART_ISR_TXE))
+            sim_lines[idx].stats.tx_overwrites++;
+        uart->TDR = val & 0x1ff;
+        uart->ISR &= ~(USART_ISR_TXE | USART_ISR_TC);
+    } else if (reg == &uart->CR1 && !(val & USART_CR1_UE)) {
+        // Disabling the USART discards the characters in flight
+        uart->CR1 = val;
+        sim_lines[idx].rx_busy = false;
+        sim_lines[idx].tx_busy = false;
+    } else {
+        *reg = val;
+    }
+
+    sim_line_kick(idx);
+    sim_take_irqs();
+}
+
+//=============================================================================
+//                     Core and HAL functions (subset)
+//=============================================================================
+uint32_t __get_PRIMASK(void)
+{
+    return sim_primask;
+}
+
+
+void __set_PRIMASK(uint32_t primask)
+{
+    sim_primask = primask & 1;
+    sim_take_irqs();
+}
+
+
+void __disable_irq(void)
+{
+    sim_primask = 1;
+}
+
+
+void __enable_irq(void)
+{
+    __set_PRIMASK(0);
+}
+
+
+uint32_t __get_IPSR(void)
+{
+    return sim_active_irq != 0 ? sim_active_irq + 16 : 0;
+}
+
+
+uint32_t NVIC_GetPriorityGrouping(void)
+{
+    return 0;
+}
+
+
+uint32_t NVIC_EncodePriority(uint32_t group, uint32_t preempt, uint32_t sub)
+{
+    (void)group;
+    (void)sub;
+    return preempt;
+}
+
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority)
+{
+    // The interrupts are not nested, priorities do not matter.
+    (void)irq;
+    (void)priority;
+}
+
+
+void NVIC_EnableIRQ(IRQn_Type irq)
+{
+    sim_irq_enabled[irq] = true;
+    sim_take_irqs();
+}
+
+
+void NVIC_DisableIRQ(IRQn_Type irq)
+{
+    sim_irq_enabled[irq] = false;
+}
+
+
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t)(sim_cycles / (sim_cfg.sysclk_hz / 1000));
+}
+
+
+uint32_t HAL_RCC_GetSysClockFreq(void)
+{
+    return sim_cfg.sysclk_hz;
+}
+
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+    return sim_cfg.pclk1_hz;
+}
+
+
+uint32_t HAL_RCC_GetPCLK2Freq(void)
+{
+    return sim_cfg.pclk2_hz;
+}
+
+//=============================================================================
+//                       Private (static) functions
+//=============================================================================
+/**
+ * @brief Get the USART of a register.
+ *
+ * @param[in] reg The register.
+ *
+ * @return The USART index, or -1 if the register is not a USART one.
+ */
+static int32_t sim_usart_index(volatile uint32_t* reg)
+{
+    uintptr_t addr = (uintptr_t)reg;
+    uintptr_t base = (uintptr_t)sim_usarts;
+
+    if (addr < base || addr >= base + sizeof(sim_usarts))
+        return -1;
+
+    return (addr - base) / sizeof(USART_TypeDef);
+}
+
+
+/**
+ * @brief Get the duration of a character on a line.
+ *
+ * @param[in] idx The USART index.
+ *
+ * @return The frame time in CPU cycles, or 0 if the baud rate is not set.
+ *
+ * The bit time is BRR kernel clocks with 16 times oversampling, and USARTDIV/2
+ * with 8 times oversampling. The frame has a start bit, 7 to 9 data bits
+ * (including parity) and 0.5 to 2 stop bits, so it is counted in half bits.
+ */
+static uint64_t sim_frame_cycles(uint32_t idx)
+{
+    USART_TypeDef* uart = &sim_usarts[idx];
+    uint32_t kclk;
+    uint32_t bit_half_kclks;
+    uint32_t half_bits;
+    static const uint8_t stop_half_bits[4] = { 2, 1, 4, 3 };
+
+    switch ((sim_rcc.DCKCFGR2 >> (2 * idx)) & 0x3) {
+        case 0:
+            kclk = (idx == 0 || idx == 5) ? sim_cfg.pclk2_hz : sim_cfg.pclk1_hz;
+            break;
+        case 1:
+            kclk = sim_cfg.sysclk_hz;
+            break;
+        case 2:
+            kclk = HSI_VALUE;
+            break;
+        default:
+            kclk = LSE_VALUE;
+            break;
+    }
+
+    if (uart->CR1 & USART_CR1_OVER8)
+        bit_half_kclks = (uart->BRR & 0xfff0) | ((uart->BRR & 0x7) << 1);
+    else
+        bit_half_kclks = 2 * uart->BRR;
+    if (bit_half_kclks == 0)
+        return 0;
+
+    half_bits = 2 * (1 + 8);
+    if (uart->CR1 & USART_CR1_M1)
+        half_bits -= 2;
+    else if (uart->CR1 & USART_CR1_M0)
+        half_bits += 2;
+    half_bits += stop_half_bits[(uart->CR2 & USART_CR2_STOP) >>
+                                USART_CR2_STOP_Pos];
+
+    return ((uint64_t)half_bits * bit_half_kclks * sim_cfg.sysclk_hz +
+            2 * (uint64_t)kclk) / (4 * (uint64_t)kclk);
+}
+
+
+/**
+ * @brief Start the next characters of a line, if they can be.
+ *
+ * @param[in] idx The USART index.
+ *
+ * The transmitter moves TDR to the shift register once it is free (and CTS
+ * allows), and a TX DMA stream refills TDR. The peer starts a character once
+ * the line is free, unless RTS is deasserted (RTSE and RXNE set) or it is
+ * stopped by XOFF.
+ */
+static void sim_line_kick(uint32_t idx)
+{
+    USART_TypeDef* uart = &sim_usarts[idx];
+    struct sim_line* line = &sim_lines[idx];
+    uint64_t frame = sim_frame_cycles(idx);
+
+    if (!(uart->CR1 & USART_CR1_UE) || frame == 0)
+        return;
+
+    sim_dma_tx(idx);
+    if ((uart->CR1 & USART_CR1_TE) && !line->tx_busy &&
+        !(uart->ISR & USART_ISR_TXE) &&
+        (line->cts_ready || !(uart->CR3 & USART_CR3_CTSE))) {
+        line->tx_char = uart->TDR;
+        line->tx_busy = true;
+        line->tx_end = sim_cycles + frame;
+        uart->ISR |= USART_ISR_TXE;
+        sim_dma_tx(idx);
+    }
+
+    if ((uart->CR1 & USART_CR1_RE) && !line->rx_busy &&
+        ring_count(&line->rx_queue) != 0) {
+        if ((uart->CR3 & USART_CR3_RTSE) && (uart->ISR & USART_ISR_RXNE)) {
+            if (!line->rts_stalled)
+                line->stats.rx_rts_stalls++;
+            line->rts_stalled = true;
+        } else if (!line->xoff || line->xoff_lag_left > 0) {
+            if (line->xoff)
+                line->xoff_lag_left--;
+            ring_getc(&line->rx_queue, &line->rx_char);
+            line->rx_busy = true;
+            line->rx_end = sim_cycles + frame;
+            line->rts_stalled = false;
+        }
+    }
+}
+
+
+/**
+ * @brief End of a transmitted character: the peer gets it, and follows it if
+ *        it is XON or XOFF.
+ *
+ * @param[in] idx The USART index.
+ */
+static void sim_line_tx_end(uint32_t idx)
+{
+    struct sim_line* line = &sim_lines[idx];
+
+    line->tx_busy = false;
+    line->stats.tx_chars++;
+    if (ring_putc(&line->tx_capture, line->tx_char) == 0)
+        line->stats.peer_overruns++;
+
+    if (line->xon_xoff && line->tx_char == SIM_XOFF) {
+        line->stats.rx_xoffs++;
+        if (!line->xoff)
+            line->xoff_lag_left = line->xoff_lag;
+        line->xoff = true;
+    } else if (line->xon_xoff && line->tx_char == SIM_XON) {
+        line->xoff = false;
+    }
+
+    sim_line_kick(idx);
+    if (!line->tx_busy)
+        sim_usarts[idx].ISR |= USART_ISR_TC;
+}
+
+
+/**
+ * @brief End of a received character: it goes to RDR, unless RDR is still
+ *        full (overrun, the character is lost).
+ *
+ * @param[in] idx The USART index.
+ */
+static void sim_line_rx_end(uint32_t idx)
+{
+    USART_TypeDef* uart = &sim_usarts[idx];
+    struct sim_line* line = &sim_lines[idx];
+
+    line->rx_busy = false;
+    line->stats.rx_chars++;
+    if (uart->ISR & USART_ISR_RXNE) {
+        uart->ISR |= USART_ISR_ORE;
+        line->stats.rx_lost++;
+    } else {
+        uart->RDR = (uint8_t)line->rx_char;
+        uart->ISR |= USART_ISR_RXNE;
+    }
+
+    sim_line_kick(idx);
+}
+
+
+/**
+ * @brief Advance the virtual clock to the next event, if any is due by the
+ *        given time, else to that time.
+ *
+ * @param[in] until The time limit.
+ */
+static void sim_step(uint64_t until)
+{
+    uint64_t next = until;
+    int32_t next_idx = -1;
+    bool next_is_tx = false;
+
+    for (uint32_t idx = 0; idx < SIM_NUM_USARTS; idx++) {
+        struct sim_line* line = &sim_lines[idx];
+
+        if (line->tx_busy && line->tx_end <= next) {
+            next = line->tx_end;
+            next_idx = idx;
+            next_is_tx = true;
+        }
+        if (line->rx_busy && line->rx_end < next) {
+            next = line->rx_end;
+            next_idx = idx;
+            next_is_tx = false;
+        }
+    }
+
+    if (next > sim_cycles)
+        sim_cycles = next;
+    sim_dwt.CYCCNT = (uint32_t)sim_cycles;
+
+    if (next_idx >= 0) {
+        if (next_is_tx)
+            sim_line_tx_end(next_idx);
+        else
+            sim_line_rx_end(next_idx);
+    }
+}
+
+
+/**
+ * @brief Let time pass without taking interrupts, e.g. in a handler.
+ *
+ * @param[in] cycles Number of CPU cycles.
+ */
+static void sim_advance(uint64_t cycles)
+{
+    uint64_t end = sim_cycles + cycles;
+
+    do {
+        sim_step(end);
+    } while (sim_cycles < end);
+}
+
+
+/**
+ * @brief Check if a USART requests its interrupt.
+ *
+ * @param[in] idx The USART index.
+ *
+ * @return True if an enabled flag is set.
+ */
+static bool sim_usart_irq_pending(uint32_t idx)
+{
+    USART_TypeDef* uart = &sim_usarts[idx];
+    uint32_t cr1 = uart->CR1;
+    uint32_t isr = uart->ISR;
+
+    return ((cr1 & USART_CR1_RXNEIE) &&
+            (isr & (USART_ISR_RXNE | USART_ISR_ORE))) ||
+           ((cr1 & USART_CR1_TXEIE) && (isr & USART_ISR_TXE)) ||
+           ((cr1 & USART_CR1_TCIE) && (isr & USART_ISR_TC)) ||
+           ((cr1 & USART_CR1_IDLEIE) && (isr & USART_ISR_IDLE)) ||
+           ((cr1 & USART_CR1_PEIE) && (isr & USART_ISR_PE)) ||
+           ((uart->CR3 & USART_CR3_EIE) &&
+            (isr & (USART_ISR_FE | USART_ISR_NE | USART_ISR_ORE)));
+}
+
+
+/**
+ * @brief Get the DMA stream of a register.
+ *
+ * @param[in] reg The register.
+ *
+ * @return The stream number (DMA2 streams from 8), or -1 if the register is
+ *         not a stream one.
+ */
+static int32_t sim_dma_stream_index(volatile uint32_t* reg)
+{
+    uintptr_t addr = (uintptr_t)reg;
+    uintptr_t base = (uintptr_t)sim_dma_streams;
+
+    if (addr < base || addr >= base + sizeof(sim_dma_streams))
+        return -1;
+
+    return (addr - base) / sizeof(DMA_Stream_TypeDef);
+}
+
+
+/**
+ * @brief Write a register other than a USART one.
+ *
+ * @param[in] reg The register.
+ * @param[in] val The value.
+ *
+ * Setting EN in a stream's CR starts a transfer of NDTR bytes, from M0AR on.
+ */
+static void sim_dma_write(volatile uint32_t* reg, uint32_t val)
+{
+    int32_t num = sim_dma_stream_index(reg);
+    DMA_Stream_TypeDef* stream;
+    int32_t idx;
+    bool start;
+
+    if (num < 0) {
+        *reg = val;
+        return;
+    }
+
+    stream = &sim_dma_streams[num / 8][num % 8];
+    start = reg == &stream->CR && !(stream->CR & DMA_SxCR_EN) &&
+            (val & DMA_SxCR_EN);
+    *reg = val;
+    if (!start)
+        return;
+
+    sim_dma_len[num] = stream->NDTR;
+    sim_dma_pos[num] = 0;
+    idx = sim_usart_index((volatile uint32_t*)stream->PAR);
+    if (idx >= 0) {
+        sim_lines[idx].stats.tx_dma_starts++;
+        sim_line_kick(idx);
+    }
+}
+
+
+/**
+ * @brief Apply the writes to the DMA flag clear registers.
+ */
+static void sim_dma_sync_flags(void)
+{
+    for (uint32_t dma = 0; dma < 2; dma++) {
+        sim_dmas[dma].LISR &= ~sim_dmas[dma].LIFCR;
+        sim_dmas[dma].HISR &= ~sim_dmas[dma].HIFCR;
+        sim_dmas[dma].LIFCR = 0;
+        sim_dmas[dma].HIFCR = 0;
+    }
+}
+
+
+/**
+ * @brief Set interrupt flags of a DMA stream.
+ *
+ * @param[in] num The stream number.
+ * @param[in] flags The SIM_DMA_xxx flags.
+ */
+static void sim_dma_set_flags(uint32_t num, uint32_t flags)
+{
+    DMA_TypeDef* dma = &sim_dmas[num / 8];
+    uint32_t stream = num % 8;
+    uint32_t shift = (stream & 1) * 6 + (stream & 2) * 8;
+
+    sim_dma_sync_flags();
+    if (stream < 4)
+        dma->LISR |= flags << shift;
+    else
+        dma->HISR |= flags << shift;
+}
+
+
+/**
+ * @brief Let a TX DMA stream write TDR, if the USART requests it.
+ *
+ * @param[in] idx The USART index.
+ */
+static void sim_dma_tx(uint32_t idx)
+{
+    USART_TypeDef* uart = &sim_usarts[idx];
+    DMA_Stream_TypeDef* stream;
+    const char* src;
+
+    if (!(uart->CR3 & USART_CR3_DMAT) || !(uart->ISR & USART_ISR_TXE))
+        return;
+
+    for (uint32_t num = 0; num < SIM_NUM_DMA_STREAMS; num++) {
+        stream = &sim_dma_streams[num / 8][num % 8];
+        if (!(stream->CR & DMA_SxCR_EN) || !(stream->CR & DMA_SxCR_DIR_0) ||
+            stream->PAR != (uintptr_t)&uart->TDR || stream->NDTR == 0)
+            continue;
+
+        src = (const char*)stream->M0AR;
+        if (stream->CR & DMA_SxCR_MINC)
+            src += sim_dma_pos[num];
+        uart->TDR = (uint8_t)*src;
+        uart->ISR &= ~(USART_ISR_TXE | USART_ISR_TC);
+        sim_dma_pos[num]++;
+        stream->NDTR--;
+
+        if (stream->NDTR == sim_dma_len[num] / 2)
+            sim_dma_set_flags(num, SIM_DMA_HTIF);
+        if (stream->NDTR == 0) {
+            sim_dma_set_flags(num, SIM_DMA_TCIF);
+            stream->CR &= ~DMA_SxCR_EN;
+        }
+        return;
+    }
+}
+
+
+/**
+ * @brief Check if a DMA stream requests its interrupt.
+ *
+ * @param[in] num The stream number.
+ *
+ * @return True if an enabled flag is set.
+ */
+static bool sim_dma_irq_pending(uint32_t num)
+{
+    DMA_TypeDef* dma = &sim_dmas[num / 8];
+    uint32_t stream = num % 8;
+    uint32_t shift = (stream & 1) * 6 + (stream & 2) * 8;
+    uint32_t cr = sim_dma_streams[num / 8][stream].CR;
+    uint32_t flags;
+
+    sim_dma_sync_flags();
+    flags = ((stream < 4 ? dma->LISR : dma->HISR) >> shift);
+
+    return ((cr & DMA_SxCR_TCIE) && (flags & SIM_DMA_TCIF)) ||
+           ((cr & DMA_SxCR_HTIE) && (flags & SIM_DMA_HTIF)) ||
+           ((cr & DMA_SxCR_TEIE) && (flags & SIM_DMA_TEIF));
+}
+
+
+/**
+ * @brief Take one pending interrupt, if not masked or already in a handler.
+ *
+ * @return True if a handler was called.
+ *
+ * The lowest interrupt number goes first, as with equal priorities in the
+ * NVIC. A DMA stream interrupt counts in the stats of its USART.
+ */
+static bool sim_take_irq(void)
+{
+    void (*handler)(void) = NULL;
+    IRQn_Type irq = SIM_NUM_IRQS;
+    int32_t line_idx = -1;
+
+    if (sim_active_irq != 0 || sim_primask != 0)
+        return false;
+
+    for (uint32_t idx = 0; idx < SIM_NUM_USARTS; idx++) {
+        IRQn_Type usart_irq = sim_usart_irqs[idx];
+
+        if (usart_irq > irq || !sim_irq_enabled[usart_irq] ||
+            sim_usart_handlers[idx] == NULL || !sim_usart_irq_pending(idx))
+            continue;
+        irq = usart_irq;
+        handler = sim_usart_handlers[idx];
+        line_idx = idx;
+    }
+    for (uint32_t num = 0; num < SIM_NUM_DMA_STREAMS; num++) {
+        IRQn_Type dma_irq = sim_dma_irqs[num];
+
+        if (dma_irq > irq || !sim_irq_enabled[dma_irq] ||
+            sim_dma_handlers[num] == NULL || !sim_dma_irq_pending(num))
+            continue;
+        irq = dma_irq;
+        handler = sim_dma_handlers[num];
+        line_idx = sim_usart_index(
+            (volatile uint32_t*)sim_dma_streams[num / 8][num % 8].PAR);
+    }
+    if (handler == NULL)
+        return false;
+
+    sim_active_irq = irq;
+    if (line_idx >= 0)
+        sim_lines[line_idx].stats.irq_entries++;
+    sim_advance(sim_cfg.irq_cycles);
+    handler();
+    sim_active_irq = 0;
+
+    return true;
+}
+
+
+/**
+ * @brief Take the pending interrupts, until there are none.
+ */
+static void sim_take_irqs(void)
+{
+    while (sim_take_irq())
+        ;
+}
+
+#endif /* SHELL_PORT_SIM */
@@ -0,0 +1,59 @@
+/**
+ * @brief Implementation of port layer for the STM32F7.
+ */
+
+#include "shell.h"
+
+#if !defined(SHELL_PORT_POSIX)
+
+//=============================================================================
+//                        Public (global) functions
+//=============================================================================
+uint32_t port_get_ms(void)
+{
+    return HAL_GetTick();
+}
+
+
+uint32_t port_irq_disable(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    return primask;
+}
+
+
+void port_irq_restore(uint32_t state)
+{
+    __set_PRIMASK(state);
+}
+
+
+bool port_can_wait(void)
+{
+    return __get_IPSR() == 0 && __get_PRIMASK() == 0;
+}
+
+
+void port_cycles_start(void)
+{
+    SET_BIT(CoreDebug->DEMCR, CoreDebug_DEMCR_TRCENA_Msk);
+    DWT->LAR = 0xC5ACCE55;  // Unlock access (Cortex-M7)
+    SET_BIT(DWT->CTRL, DWT_CTRL_CYCCNTENA_Msk);
+}
+
+
+uint32_t port_get_cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+
+uint32_t port_get_cycles_hz(void)
+{
+    return HAL_RCC_GetSysClockFreq();
+}
+
+#endif /* !SHELL_PORT_POSIX */
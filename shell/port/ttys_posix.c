@@ -0,0 +1,609 @@
+/**
+ * @brief Implementation of ttys backend for POSIX systems.
+ *
+ * The ttys instances are mapped to standard input/output, pseudo terminals or
+ * Unix sockets (see port_posix.h). File descriptors are only read when they
+ * are ready (poll), so reading never blocks.
+ */
+
+#if defined(SHELL_PORT_POSIX)
+#define _GNU_SOURCE  // fopencookie(), posix_openpt()
+#endif
+
+#include "shell.h"
+#include "ttys_port.h"
+
+#if defined(SHELL_PORT_POSIX)
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+//=============================================================================
+//                              Common Macros
+//=============================================================================
+// Name of an instance, used for its environment variable.
+#define TTYS_GEN_NAME(id, name, ...) [id] = #name,
+
+// Baud rate reported until one is set.
+#define TTYS_POSIX_DEFAULT_BAUD 115200
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+/**
+ * Device types (see port_posix.h)
+ */
+enum ttys_posix_dev {
+    TTYS_POSIX_DEV_NONE,
+    TTYS_POSIX_DEV_STDIO,
+    TTYS_POSIX_DEV_PTY,
+    TTYS_POSIX_DEV_UNIX,
+};
+
+/**
+ * Per-instance device state. The file descriptors are -1 when not open (e.g.
+ * no client connected to the socket).
+ */
+struct ttys_hw_state {
+    bool started;
+    enum ttys_posix_dev dev;
+    int in_fd;
+    int out_fd;
+    int listen_fd;
+    int pty_slave_fd;
+    bool in_eof;
+    bool rx_paused;
+    uint32_t baud;
+};
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static int32_t ttys_posix_open(enum ttys_instance_id instance_id,
+                               const char* spec);
+static void ttys_posix_accept(struct ttys_hw_state* hw);
+static void ttys_posix_close(struct ttys_hw_state* hw);
+static bool ttys_posix_send(struct ttys_hw_state* hw, const char* buf,
+                            uint32_t len, uint32_t* sent);
+static bool ttys_posix_readable(int fd);
+static void ttys_posix_exit(void);
+static ssize_t ttys_posix_cookie_read(void* cookie, char* buf, size_t size);
+static ssize_t ttys_posix_cookie_write(void* cookie, const char* buf,
+                                       size_t size);
+
+//=============================================================================
+//                        Private (static) variables
+//=============================================================================
+static const char* const ttys_names[TTYS_NUM_INSTANCES] = {
+    TTYS_FOR_EACH_UART(TTYS_GEN, TTYS_GEN_NAME)
+};
+
+static struct ttys_hw_state ttys_hw_states[TTYS_NUM_INSTANCES];
+
+// Terminal settings of standard input, restored at exit.
+static struct termios ttys_saved_termios;
+static bool ttys_termios_saved;
+static bool ttys_exit_registered;
+
+//=============================================================================
+//                    Backend functions (see ttys_port.h)
+//=============================================================================
+int32_t ttys_hw_init(enum ttys_instance_id instance_id)
+{
+    struct ttys_state* state = &ttys_states[instance_id];
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+    char var[16];
+    const char* spec;
+    int32_t rc;
+    int idx;
+
+    // The DMA modes and flow control settings are accepted as they are, so
+    // that the target configuration can be used.
+    if (hw->started)
+        ttys_posix_close(hw);
+    memset(hw, 0, sizeof(struct ttys_hw_state));
+    hw->in_fd = -1;
+    hw->out_fd = -1;
+    hw->listen_fd = -1;
+    hw->pty_slave_fd = -1;
+    hw->baud = TTYS_POSIX_DEFAULT_BAUD;
+
+    // Device from the environment, e.g. TTYS_UART1=pty
+    snprintf(var, sizeof(var), "TTYS_%s", ttys_names[instance_id]);
+    for (idx = 0; var[idx] != '\0'; idx++)
+        var[idx] = toupper((unsigned char)var[idx]);
+    spec = getenv(var);
+    if (spec == NULL)
+        spec = state->fd == STDOUT_FILENO ? "stdio" : "none";
+
+    rc = ttys_posix_open(instance_id, spec);
+    if (rc < 0) {
+        fprintf(stderr, "ttys: can't open %s=%s\n", var, spec);
+        return rc;
+    }
+
+    if (!ttys_exit_registered) {
+        atexit(ttys_posix_exit);
+        ttys_exit_registered = true;
+    }
+
+    // printf() and friends go through the stdout instance, as on the target.
+    if (state->fd == STDOUT_FILENO) {
+        FILE* stream = state->stream != NULL ? state->stream :
+                                               ttys_hw_open_stream(instance_id);
+        if (stream != NULL)
+            stdout = stream;
+    }
+
+    hw->started = true;
+
+    return 0;
+}
+
+
+FILE* ttys_hw_open_stream(enum ttys_instance_id instance_id)
+{
+    cookie_io_functions_t funcs = {
+        .read = ttys_posix_cookie_read,
+        .write = ttys_posix_cookie_write,
+        .seek = NULL,
+        .close = NULL,
+    };
+
+    return fopencookie((void*)(intptr_t)instance_id, "r+", funcs);
+}
+
+
+/**
+ * The characters are written to the device right away, as far as it takes
+ * them. The rest stays queued for the next call (e.g. from ttys_posix_wait()).
+ */
+void ttys_hw_tx_kick(enum ttys_instance_id instance_id)
+{
+    struct ttys_state* state = &ttys_states[instance_id];
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+    char* ptr;
+    uint32_t len;
+    uint32_t sent;
+
+    if (!hw->started)
+        return;
+
+    ttys_posix_accept(hw);
+
+    if (state->tx_flow_char != 0) {
+        char c = state->tx_flow_char;
+        if (!ttys_posix_send(hw, &c, 1, &sent))
+            return;
+        state->tx_flow_char = 0;
+    }
+
+    while ((len = ring_get_span(&state->tx_ring, &ptr)) != 0) {
+        bool done = !ttys_posix_send(hw, ptr, len, &sent);
+        ring_get_commit(&state->tx_ring, sent);
+        state->pm.tx_bytes += sent;
+        if (done)
+            break;
+    }
+}
+
+
+void ttys_hw_tx_abort(enum ttys_instance_id instance_id)
+{
+    // Characters are written synchronously, there is nothing in progress.
+    (void)instance_id;
+}
+
+
+bool ttys_hw_tx_done(enum ttys_instance_id instance_id)
+{
+    (void)instance_id;
+
+    return true;
+}
+
+
+/**
+ * The device is not read while paused, so the sender is held back by the pipe,
+ * terminal or socket buffer.
+ */
+void ttys_hw_rx_pause(enum ttys_instance_id instance_id, bool pause)
+{
+    ttys_hw_states[instance_id].rx_paused = pause;
+}
+
+
+void ttys_hw_rx_poll(enum ttys_instance_id instance_id)
+{
+    struct ttys_state* state = &ttys_states[instance_id];
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+    char* ptr;
+    uint32_t len;
+    uint32_t count;
+    ssize_t rc;
+
+    if (!hw->started)
+        return;
+
+    ttys_posix_accept(hw);
+
+    // What the device has, up to the free space. Unlike the UART, characters
+    // that don't fit are left in the device rather than dropped.
+    while (hw->in_fd >= 0 && !hw->in_eof && !hw->rx_paused &&
+           (len = ring_put_span(&state->rx_ring, &ptr)) != 0 &&
+           ttys_posix_readable(hw->in_fd)) {
+        rc = read(hw->in_fd, ptr, len);
+        if (rc <= 0) {
+            if (rc < 0 && (errno == EAGAIN || errno == EINTR))
+                break;
+            if (hw->dev == TTYS_POSIX_DEV_UNIX) {
+                // The client is gone, wait for the next one.
+                close(hw->in_fd);
+                hw->in_fd = -1;
+                hw->out_fd = -1;
+            } else if (hw->dev == TTYS_POSIX_DEV_PTY) {
+                // Terminal program disconnected, another one can connect.
+                break;
+            } else {
+                hw->in_eof = true;
+            }
+            break;
+        }
+
+        ring_put_commit(&state->rx_ring, rc);
+        state->pm.rx_bytes += rc;
+        count = ring_count(&state->rx_ring);
+        if (count > state->pm.rx_high_water)
+            state->pm.rx_high_water = count;
+        ttys_rx_check_high_water(state);
+    }
+
+    // Replies and flow control characters go out at the same time.
+    ttys_hw_tx_kick(instance_id);
+}
+
+
+int32_t ttys_hw_get_baud(enum ttys_instance_id instance_id)
+{
+    return ttys_hw_states[instance_id].baud;
+}
+
+
+int32_t ttys_hw_set_baud(enum ttys_instance_id instance_id, uint32_t baud)
+{
+    ttys_hw_states[instance_id].baud = baud;
+
+    return 0;
+}
+
+//=============================================================================
+//                        Public (global) functions
+//=============================================================================
+int32_t ttys_posix_wait(uint32_t timeout_ms)
+{
+    struct pollfd fds[TTYS_NUM_INSTANCES];
+    nfds_t num_fds = 0;
+    bool any_input = false;
+    int idx;
+
+    for (idx = 0; idx < TTYS_NUM_INSTANCES; idx++) {
+        struct ttys_state* state = &ttys_states[idx];
+        struct ttys_hw_state* hw = &ttys_hw_states[idx];
+        short events = 0;
+        int fd = -1;
+
+        if (!hw->started)
+            continue;
+
+        ttys_hw_tx_kick(idx);
+
+        if (hw->dev == TTYS_POSIX_DEV_NONE ||
+            (hw->dev == TTYS_POSIX_DEV_STDIO && hw->in_eof))
+            continue;
+        any_input = true;
+
+        // Input already buffered (e.g. left by the reader) needs no wait.
+        if (ring_count(&state->rx_ring) != 0)
+            return 1;
+
+        if (hw->in_fd >= 0) {
+            fd = hw->in_fd;
+            if (!hw->rx_paused)
+                events |= POLLIN;
+            if (ring_count(&state->tx_ring) != 0 || state->tx_flow_char != 0)
+                events |= POLLOUT;
+        } else if (hw->listen_fd >= 0) {
+            fd = hw->listen_fd;
+            events = POLLIN;
+        }
+        if (events != 0) {
+            fds[num_fds].fd = fd;
+            fds[num_fds].events = events;
+            fds[num_fds].revents = 0;
+            num_fds++;
+        }
+    }
+
+    if (!any_input) {
+        // Only ended inputs, or only "none" devices.
+        for (idx = 0; idx < TTYS_NUM_INSTANCES; idx++)
+            if (ttys_hw_states[idx].dev == TTYS_POSIX_DEV_STDIO)
+                return SHELL_ERR_RESOURCE;
+    }
+
+    if (poll(fds, num_fds, timeout_ms) > 0) {
+        for (idx = 0; idx < (int)num_fds; idx++)
+            if (fds[idx].revents & (POLLIN | POLLHUP | POLLERR))
+                return 1;
+    }
+
+    return 0;
+}
+
+//=============================================================================
+//                    Private (static) functions
+//=============================================================================
+/**
+ * @brief Open the device of an instance.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ * @param[in] spec Device specification (see port_posix.h).
+ *
+ * @return 0 for success, else a "ERR" value. See code for details.
+ */
+static int32_t ttys_posix_open(enum ttys_instance_id instance_id,
+                               const char* spec)
+{
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+
+    if (strcmp(spec, "none") == 0) {
+        hw->dev = TTYS_POSIX_DEV_NONE;
+    } else if (strcmp(spec, "stdio") == 0) {
+        struct termios tio;
+
+        hw->dev = TTYS_POSIX_DEV_STDIO;
+        hw->in_fd = STDIN_FILENO;
+        hw->out_fd = STDOUT_FILENO;
+
+        // Character at a time input, the console does the echo.
+        if (isatty(STDIN_FILENO) && !ttys_termios_saved &&
+            tcgetattr(STDIN_FILENO, &ttys_saved_termios) == 0) {
+            ttys_termios_saved = true;
+            tio = ttys_saved_termios;
+            tio.c_lflag &= ~(ICANON | ECHO);
+            tio.c_cc[VMIN] = 1;
+            tio.c_cc[VTIME] = 0;
+            tcsetattr(STDIN_FILENO, TCSANOW, &tio);
+        }
+    } else if (strcmp(spec, "pty") == 0) {
+        struct termios tio;
+        int fd = posix_openpt(O_RDWR | O_NOCTTY);
+        int slave_fd = -1;
+
+        if (fd >= 0 && grantpt(fd) == 0 && unlockpt(fd) == 0)
+            slave_fd = open(ptsname(fd), O_RDWR | O_NOCTTY);
+        if (slave_fd < 0) {
+            if (fd >= 0)
+                close(fd);
+            return SHELL_ERR_RESOURCE;
+        }
+
+        // The slave side is kept open, so that the master does not hang up
+        // while no terminal program is connected. It is set to raw mode, so
+        // that the output is not echoed back as input in the meantime.
+        if (tcgetattr(slave_fd, &tio) == 0) {
+            cfmakeraw(&tio);
+            tcsetattr(slave_fd, TCSANOW, &tio);
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        hw->dev = TTYS_POSIX_DEV_PTY;
+        hw->in_fd = fd;
+        hw->out_fd = fd;
+        hw->pty_slave_fd = slave_fd;
+        fprintf(stderr, "ttys %s: %s\n", ttys_names[instance_id], ptsname(fd));
+    } else if (strncmp(spec, "unix:", 5) == 0) {
+        struct sockaddr_un addr;
+        int fd;
+
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(spec + 5) == 0 || strlen(spec + 5) >= sizeof(addr.sun_path))
+            return SHELL_ERR_ARG;
+        strcpy(addr.sun_path, spec + 5);
+
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (fd < 0)
+            return SHELL_ERR_RESOURCE;
+        unlink(addr.sun_path);
+        if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+            listen(fd, 1) < 0) {
+            close(fd);
+            return SHELL_ERR_RESOURCE;
+        }
+        hw->dev = TTYS_POSIX_DEV_UNIX;
+        hw->listen_fd = fd;
+    } else {
+        return SHELL_ERR_ARG;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Accept a client on a Unix socket device, if none is connected.
+ *
+ * @param[in] hw The instance's device state.
+ */
+static void ttys_posix_accept(struct ttys_hw_state* hw)
+{
+    int fd;
+
+    if (hw->dev != TTYS_POSIX_DEV_UNIX || hw->in_fd >= 0)
+        return;
+
+    fd = accept4(hw->listen_fd, NULL, NULL, SOCK_NONBLOCK);
+    if (fd >= 0) {
+        hw->in_fd = fd;
+        hw->out_fd = fd;
+    }
+}
+
+
+/**
+ * @brief Close the device of an instance.
+ *
+ * @param[in] hw The instance's device state.
+ */
+static void ttys_posix_close(struct ttys_hw_state* hw)
+{
+    if (hw->dev == TTYS_POSIX_DEV_PTY || hw->dev == TTYS_POSIX_DEV_UNIX) {
+        if (hw->in_fd >= 0)
+            close(hw->in_fd);
+        if (hw->listen_fd >= 0)
+            close(hw->listen_fd);
+        if (hw->pty_slave_fd >= 0)
+            close(hw->pty_slave_fd);
+    }
+    hw->in_fd = -1;
+    hw->out_fd = -1;
+    hw->listen_fd = -1;
+    hw->pty_slave_fd = -1;
+}
+
+
+/**
+ * @brief Write characters to the device of an instance.
+ *
+ * @param[in] hw The instance's device state.
+ * @param[in] buf Characters to write.
+ * @param[in] len Number of characters.
+ * @param[out] sent Number of characters taken by the device.
+ *
+ * @return True if all the characters were taken. Without an open device (e.g.
+ *         no socket client) they are discarded, as a UART with nothing
+ *         connected would do.
+ */
+static bool ttys_posix_send(struct ttys_hw_state* hw, const char* buf,
+                            uint32_t len, uint32_t* sent)
+{
+    ssize_t rc;
+
+    *sent = 0;
+    if (hw->out_fd < 0) {
+        *sent = len;
+        return true;
+    }
+
+    while (*sent < len) {
+        if (hw->dev == TTYS_POSIX_DEV_UNIX)
+            rc = send(hw->out_fd, buf + *sent, len - *sent, MSG_NOSIGNAL);
+        else
+            rc = write(hw->out_fd, buf + *sent, len - *sent);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc < 0 && errno != EAGAIN && hw->dev != TTYS_POSIX_DEV_PTY) {
+            // Broken pipe or socket, the output is lost.
+            *sent = len;
+            return true;
+        }
+        if (rc <= 0)
+            return false;
+        *sent += rc;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Check if a file descriptor can be read without blocking.
+ *
+ * @param[in] fd The file descriptor.
+ *
+ * @return True if there is input, or end of file.
+ */
+static bool ttys_posix_readable(int fd)
+{
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+    return poll(&pfd, 1, 0) > 0;
+}
+
+
+/**
+ * @brief Send the pending output and restore the terminal, at process exit.
+ */
+static void ttys_posix_exit(void)
+{
+    uint32_t start_ms = port_get_ms();
+    int idx;
+
+    // Output to a terminal program or socket client that has gone away must
+    // not hold up the exit.
+    for (idx = 0; idx < TTYS_NUM_INSTANCES; idx++) {
+        while (ttys_hw_states[idx].started &&
+               ring_count(&ttys_states[idx].tx_ring) != 0 &&
+               port_get_ms() - start_ms < 100)
+            ttys_hw_tx_kick(idx);
+    }
+
+    if (ttys_termios_saved)
+        tcsetattr(STDIN_FILENO, TCSANOW, &ttys_saved_termios);
+}
+
+
+/**
+ * @brief stdio stream read function.
+ *
+ * @param[in] cookie The ttys instance ID.
+ * @param[out] buf Buffer for the received characters.
+ * @param[in] size Size of buf.
+ *
+ * @return Number of characters read, or -1 for error (errno=EAGAIN if none is
+ *         available).
+ */
+static ssize_t ttys_posix_cookie_read(void* cookie, char* buf, size_t size)
+{
+    int32_t rc = ttys_read((enum ttys_instance_id)(intptr_t)cookie, buf, size);
+
+    if (rc == 0) {
+        errno = EAGAIN;
+        rc = -1;
+    }
+
+    return rc;
+}
+
+
+/**
+ * @brief stdio stream write function.
+ *
+ * @param[in] cookie The ttys instance ID.
+ * @param[in] buf Data to be written.
+ * @param[in] size Length of data.
+ *
+ * @return Number of characters written, or -1 for error (errno=EAGAIN if no
+ *         character could be queued).
+ *
+ * @note What happens when the TX buffer is full depends on the instance's TX
+ *       overrun policy. Fewer than size characters might be written.
+ */
+static ssize_t ttys_posix_cookie_write(void* cookie, const char* buf,
+                                       size_t size)
+{
+    int32_t rc = ttys_write((enum ttys_instance_id)(intptr_t)cookie, buf, size);
+
+    if (rc == 0 && size > 0) {
+        errno = EAGAIN;
+        rc = -1;
+    }
+
+    return rc;
+}
+
+#endif /* SHELL_PORT_POSIX */
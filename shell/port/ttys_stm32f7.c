@@ -0,0 +1,1030 @@
+/**
+ * @brief Implementation of ttys backend for the STM32F7 USARTs.
+ *
+ * The USART registers and DMA streams are driven directly (see ttys.h for the
+ * DMA streams used), and the module integrates into the newlib stdio system
+ * through the _write and _read system call functions.
+ *
+ * The USART registers are accessed with the CMSIS macros (READ_REG, WRITE_REG,
+ * SET_BIT...), so that this file also builds against the simulated USARTs of
+ * port_sim.h, where these accesses have side effects.
+ */
+
+#include "shell.h"
+#include "ttys_port.h"
+
+#if !defined(SHELL_PORT_POSIX)
+
+//=============================================================================
+//                              Common Macros
+//=============================================================================
+// Hardware of each UART: register base, IRQ number, IRQ handler, TX DMA
+// controller, stream and channel, RX DMA controller, stream and channel,
+// clock selection field position in RCC DCKCFGR2, APB bus number. These are
+// the trailing parameters of the TTYS_GEN generators (see ttys_port.h).
+#define TTYS_UART1_HW \
+    USART1, USART1_IRQn, USART1_IRQHandler, 2, 7, 4, 2, 2, 4, 0,  2
+#define TTYS_UART2_HW \
+    USART2, USART2_IRQn, USART2_IRQHandler, 1, 6, 4, 1, 5, 4, 2,  1
+#define TTYS_UART3_HW \
+    USART3, USART3_IRQn, USART3_IRQHandler, 1, 3, 4, 1, 1, 4, 4,  1
+#define TTYS_UART4_HW \
+    UART4,  UART4_IRQn,  UART4_IRQHandler,  1, 4, 4, 1, 2, 4, 6,  1
+#define TTYS_UART5_HW \
+    UART5,  UART5_IRQn,  UART5_IRQHandler,  1, 7, 4, 1, 0, 4, 8,  1
+#define TTYS_UART6_HW \
+    USART6, USART6_IRQn, USART6_IRQHandler, 2, 6, 5, 2, 1, 5, 10, 2
+#define TTYS_UART7_HW \
+    UART7,  UART7_IRQn,  UART7_IRQHandler,  1, 1, 5, 1, 3, 5, 12, 1
+#define TTYS_UART8_HW \
+    UART8,  UART8_IRQn,  UART8_IRQHandler,  1, 0, 5, 1, 6, 5, 14, 1
+
+// Instances sharing DMA streams
+#if TTYS_UART3_ENABLED && TTYS_UART3_DMA && TTYS_UART7_ENABLED && TTYS_UART7_DMA
+#error "UART3 and UART7 share DMA1 streams 1 and 3, only one can have DMA"
+#endif
+#if TTYS_UART5_ENABLED && TTYS_UART5_DMA && TTYS_UART8_ENABLED && TTYS_UART8_DMA
+#error "UART5 and UART8 share DMA1 stream 0, only one can have DMA"
+#endif
+#if TTYS_UART2_ENABLED && TTYS_UART2_DMA && TTYS_UART8_ENABLED && TTYS_UART8_DMA
+#error "UART2 and UART8 share DMA1 stream 6, only one can have DMA"
+#endif
+
+// Declaration of the IRQ handler of an instance.
+#define TTYS_GEN_IRQ_HANDLER_DECL(id, name, tx_size, rx_size, fd, dma,        \
+                                  reg_base, irq_num, irq_handler, ...)        \
+    void irq_handler(void);
+
+// Hardware descriptor of an instance (see struct ttys_hw_info). The parameters
+// are named apart from the structure members.
+#define TTYS_GEN_HW_INFO(id, name, tx_size, rx_size, fd_, dma_,               \
+                         base_, irq_num_, handler_,                           \
+                         tx_dma_, tx_stream_, tx_channel_,                    \
+                         rx_dma_, rx_stream_, rx_channel_,                    \
+                         clk_sel_pos_, apb_)                                  \
+    [id] = {                                                                  \
+        .reg_base = base_,                                                    \
+        .clk_sel_pos = clk_sel_pos_,                                          \
+        .apb = apb_,                                                          \
+        .irq_type = irq_num_,                                                 \
+        .irq_handler = handler_,                                              \
+        TTYS_IF(dma_,                                                         \
+        .tx_dma = TTYS_DMA_INFO(tx_dma_, tx_stream_, tx_channel_),            \
+        .rx_dma = TTYS_DMA_INFO(rx_dma_, rx_stream_, rx_channel_),)           \
+    },
+#define TTYS_DMA_INFO(dma_, stream_, channel_) {                             \
+    .dma = DMA##dma_,                                                         \
+    .stream = DMA##dma_##_Stream##stream_,                                    \
+    .stream_num = stream_,                                                    \
+    .channel = channel_,                                                      \
+    .irq_type = DMA##dma_##_Stream##stream_##_IRQn,                           \
+}
+
+// IRQ handlers of an instance. The DMA stream handlers are only defined for
+// the instances built with DMA support.
+#define TTYS_GEN_IRQ_HANDLERS(id, name, tx_size, rx_size, fd, dma,            \
+                              reg_base, irq_num, irq_handler,                 \
+                              tx_dma, tx_stream, tx_channel,                  \
+                              rx_dma, rx_stream, rx_channel, ...)             \
+    void irq_handler(void)                                                    \
+    {                                                                         \
+        ttys_interrupt(id, irq_num);                                          \
+    }                                                                         \
+    TTYS_IF(dma,                                                              \
+    void DMA##tx_dma##_Stream##tx_stream##_IRQHandler(void)                   \
+    {                                                                         \
+        ttys_dma_tx_interrupt(id);                                            \
+    }                                                                         \
+    void DMA##rx_dma##_Stream##rx_stream##_IRQHandler(void)                   \
+    {                                                                         \
+        ttys_dma_rx_interrupt(id);                                            \
+    })
+
+// DMA stream interrupt status flags, relative to the stream's position in the
+// LISR/HISR registers (the same layout is used in LIFCR/HIFCR).
+#define DMA_FLAG_FEIF  (1U << 0)
+#define DMA_FLAG_DMEIF (1U << 2)
+#define DMA_FLAG_TEIF  (1U << 3)
+#define DMA_FLAG_HTIF  (1U << 4)
+#define DMA_FLAG_TCIF  (1U << 5)
+#define DMA_FLAG_ALL   (DMA_FLAG_FEIF | DMA_FLAG_DMEIF | DMA_FLAG_TEIF | \
+                        DMA_FLAG_HTIF | DMA_FLAG_TCIF)
+
+// Maximum TX DMA transfer length with software flow control, so that flow
+// control characters aren't delayed by long transfers.
+#define TTYS_SW_FLOW_DMA_MAX_LEN 32
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+/**
+ * DMA stream assigned to a UART (fixed by the MCU's DMA request mapping)
+ */
+struct ttys_dma_info {
+    DMA_TypeDef* dma;
+    DMA_Stream_TypeDef* stream;
+    uint8_t stream_num;
+    uint8_t channel;
+    IRQn_Type irq_type;
+};
+
+/**
+ * Constant hardware descriptor of an instance. The IRQ handler is provided for
+ * applications that relocate the vector table. The DMA streams are only set
+ * (dma != NULL) for instances built with DMA support.
+ */
+struct ttys_hw_info {
+    USART_TypeDef* reg_base;
+    IRQn_Type irq_type;
+    void (*irq_handler)(void);
+    uint8_t clk_sel_pos;
+    uint8_t apb;
+    struct ttys_dma_info tx_dma;
+    struct ttys_dma_info rx_dma;
+};
+
+/**
+ * Per-instance device state. The UART is not known (NULL) before
+ * ttys_hw_init(), and the DMA streams are only set in the DMA modes. Reception
+ * is paused by RTS/CTS flow control only; with XON/XOFF the UART keeps being
+ * read.
+ *
+ * In RX DMA mode, rx_dma_pos is the position of the DMA in the RX buffer when
+ * it was last looked at. After an overrun (rx_dma_overrun), rx_dma_ahead
+ * counts the characters the DMA wrote past the RX ring's put position, until
+ * the reader resynchronizes the ring (ttys_hw_rx_poll()).
+ */
+struct ttys_hw_state {
+    USART_TypeDef* uart_reg_base;
+    const struct ttys_dma_info* tx_dma;
+    const struct ttys_dma_info* rx_dma;
+    volatile uint16_t tx_dma_len;
+    volatile bool rx_paused;
+    volatile bool rx_dma_overrun;
+    uint32_t rx_dma_pos;
+    uint32_t rx_dma_ahead;
+};
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static void ttys_interrupt(enum ttys_instance_id instance_id,
+                           IRQn_Type irq_type);
+static void ttys_dma_tx_interrupt(enum ttys_instance_id instance_id);
+static uint32_t ttys_dma_get_flags(const struct ttys_dma_info* dma_info);
+static void ttys_dma_clear_flags(const struct ttys_dma_info* dma_info,
+                                 uint32_t flags);
+static void ttys_dma_tx_init(enum ttys_instance_id instance_id);
+static void ttys_dma_tx_start(enum ttys_instance_id instance_id);
+static void ttys_dma_rx_interrupt(enum ttys_instance_id instance_id);
+static void ttys_dma_rx_init(enum ttys_instance_id instance_id);
+static void ttys_dma_rx_publish(enum ttys_instance_id instance_id);
+static void ttys_dma_rx_invalidate(const struct ttys_state* state,
+                                   uint32_t pos, uint32_t len);
+static uint32_t ttys_get_clock(enum ttys_instance_id instance_id);
+
+TTYS_FOR_EACH_UART(TTYS_GEN, TTYS_GEN_IRQ_HANDLER_DECL)
+
+//=============================================================================
+//                        Private (static) variables
+//=============================================================================
+static const struct ttys_hw_info ttys_hw_info[TTYS_NUM_INSTANCES] = {
+    TTYS_FOR_EACH_UART(TTYS_GEN, TTYS_GEN_HW_INFO)
+};
+
+static struct ttys_hw_state ttys_hw_states[TTYS_NUM_INSTANCES];
+
+//=============================================================================
+//                    Backend functions (see ttys_port.h)
+//=============================================================================
+int32_t ttys_hw_init(enum ttys_instance_id instance_id)
+{
+    const struct ttys_hw_info* hi = &ttys_hw_info[instance_id];
+    struct ttys_state* state = &ttys_states[instance_id];
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+
+    // The DMA modes need an instance built with DMA support
+    if ((state->cfg.tx_mode == TTYS_TX_MODE_DMA ||
+         state->cfg.rx_mode == TTYS_RX_MODE_DMA) && hi->tx_dma.dma == NULL)
+        return SHELL_ERR_ARG;
+
+    memset(hw, 0, sizeof(struct ttys_hw_state));
+    hw->uart_reg_base = hi->reg_base;
+
+#if TTYS_ISR_CYCLE_STATS
+    // Start the cycle counter, used to measure the interrupt handler
+    port_cycles_start();
+#endif
+
+    // Set up RTS/CTS flow control. The UART must be disabled for this.
+    if (state->cfg.hw_flow_control) {
+        CLEAR_BIT(hw->uart_reg_base->CR1, USART_CR1_UE);
+        SET_BIT(hw->uart_reg_base->CR3, USART_CR3_RTSE | USART_CR3_CTSE);
+        SET_BIT(hw->uart_reg_base->CR1, USART_CR1_UE);
+    }
+
+    // Set up the TX DMA stream, if used
+    if (state->cfg.tx_mode == TTYS_TX_MODE_DMA) {
+        hw->tx_dma = &hi->tx_dma;
+        ttys_dma_tx_init(instance_id);
+    }
+
+    // Set up the RX DMA stream, if used
+    if (state->cfg.rx_mode == TTYS_RX_MODE_DMA) {
+        hw->rx_dma = &hi->rx_dma;
+        ttys_dma_rx_init(instance_id);
+    }
+
+    // Enable interrupts
+    if (hw->rx_dma == NULL) {
+        ATOMIC_SET_BIT(hw->uart_reg_base->CR1, USART_CR1_RXNEIE);
+    } else {
+        WRITE_REG(hw->uart_reg_base->ICR, USART_ICR_IDLECF);
+        ATOMIC_SET_BIT(hw->uart_reg_base->CR1, USART_CR1_IDLEIE);
+    }
+    if (hw->tx_dma == NULL)
+        ATOMIC_SET_BIT(hw->uart_reg_base->CR1, USART_CR1_TXEIE);
+
+    NVIC_SetPriority(hi->irq_type,
+                     NVIC_EncodePriority(NVIC_GetPriorityGrouping(),0, 0));
+    NVIC_EnableIRQ(hi->irq_type);
+
+    return 0;
+}
+
+
+FILE* ttys_hw_open_stream(enum ttys_instance_id instance_id)
+{
+    // Goes through the _write and _read functions below.
+    return fdopen(ttys_states[instance_id].fd, "r+");
+}
+
+
+/**
+ * In interrupt mode this just enables the TXE interrupt. In DMA mode a new
+ * transfer is started if the stream is idle; this must be done with interrupts
+ * masked since the DMA interrupt handler also starts transfers.
+ */
+void ttys_hw_tx_kick(enum ttys_instance_id instance_id)
+{
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+
+    if (hw->uart_reg_base == NULL)
+        return;
+
+    if (hw->tx_dma == NULL) {
+        ATOMIC_SET_BIT(hw->uart_reg_base->CR1, USART_CR1_TXEIE);
+    } else if (hw->tx_dma_len == 0) {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        ttys_dma_tx_start(instance_id);
+        __set_PRIMASK(primask);
+    }
+}
+
+
+/**
+ * Only DMA transfers need to be stopped; in interrupt mode the characters are
+ * taken from the TX ring one at a time. The stream's flags are cleared, so a
+ * pending DMA interrupt finds nothing to do.
+ */
+void ttys_hw_tx_abort(enum ttys_instance_id instance_id)
+{
+    struct ttys_state* state = &ttys_states[instance_id];
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+    const struct ttys_dma_info* di = hw->tx_dma;
+
+    if (hw->tx_dma_len == 0)
+        return;
+
+    CLEAR_BIT(di->stream->CR, DMA_SxCR_EN);
+    while (READ_BIT(di->stream->CR, DMA_SxCR_EN))
+        ;
+    ttys_dma_clear_flags(di, DMA_FLAG_ALL);
+
+    uint32_t sent = hw->tx_dma_len - di->stream->NDTR;
+    ring_get_commit(&state->tx_ring, sent);
+    state->pm.tx_bytes += sent;
+    hw->tx_dma_len = 0;
+}
+
+
+/**
+ * The last character has left the UART when the transmission complete (TC)
+ * flag is set.
+ */
+bool ttys_hw_tx_done(enum ttys_instance_id instance_id)
+{
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+
+    return hw->tx_dma_len == 0 &&
+           READ_BIT(hw->uart_reg_base->ISR, USART_ISR_TC);
+}
+
+
+/**
+ * The UART stops being read (RXNE interrupt or DMA request disabled), so the
+ * next character stays in its data register and the hardware deasserts RTS.
+ */
+void ttys_hw_rx_pause(enum ttys_instance_id instance_id, bool pause)
+{
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+
+    hw->rx_paused = pause;
+    if (pause) {
+        if (hw->rx_dma == NULL)
+            ATOMIC_CLEAR_BIT(hw->uart_reg_base->CR1, USART_CR1_RXNEIE);
+        else
+            ATOMIC_CLEAR_BIT(hw->uart_reg_base->CR3, USART_CR3_DMAR);
+    } else {
+        if (hw->rx_dma == NULL)
+            ATOMIC_SET_BIT(hw->uart_reg_base->CR1, USART_CR1_RXNEIE);
+        else
+            ATOMIC_SET_BIT(hw->uart_reg_base->CR3, USART_CR3_DMAR);
+    }
+}
+
+
+/**
+ * Reception is interrupt driven. In RX DMA mode, the RX ring is resynchronized
+ * here after an overrun, as only the reader can drop characters from it. The
+ * unread characters are dropped: the oldest ones were overwritten by the DMA,
+ * and the others would come out of order. The characters the DMA wrote past
+ * the put position are kept, up to the DMA position. Those that were written
+ * over again (the DMA lapped the buffer) are lost too.
+ */
+void ttys_hw_rx_poll(enum ttys_instance_id instance_id)
+{
+    struct ttys_state* state = &ttys_states[instance_id];
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+    uint32_t irq_state;
+    uint32_t count;
+    uint32_t len;
+    char* ptr;
+
+    if (!hw->rx_dma_overrun)
+        return;
+
+    irq_state = port_irq_disable();
+
+    if (hw->rx_dma != NULL)
+        ttys_dma_rx_publish(instance_id);
+
+    count = ring_count(&state->rx_ring);
+    ring_get_commit(&state->rx_ring, count);
+    ring_put_span(&state->rx_ring, &ptr);
+    len = (hw->rx_dma_pos - (ptr - state->rx_buf)) &
+          (state->rx_buf_size - 1);
+    ttys_dma_rx_invalidate(state, ptr - state->rx_buf, len);
+    ring_put_commit(&state->rx_ring, len);
+
+    state->pm.rx_overruns += count + hw->rx_dma_ahead - len;
+    state->pm.rx_bytes += len;
+    hw->rx_dma_overrun = false;
+
+    // Back to interrupt driven reception, if the DMA stream failed meanwhile
+    if (hw->rx_dma == NULL && !hw->rx_paused)
+        ATOMIC_SET_BIT(hw->uart_reg_base->CR1, USART_CR1_RXNEIE);
+
+    ttys_rx_check_high_water(state);
+    port_irq_restore(irq_state);
+}
+
+
+/**
+ * The baud rate is computed from the UART's BRR register and kernel clock, so
+ * it also reflects the initialization done outside this module.
+ */
+int32_t ttys_hw_get_baud(enum ttys_instance_id instance_id)
+{
+    uint32_t brr;
+    uint32_t div;
+    USART_TypeDef* uart;
+
+    uart = ttys_hw_info[instance_id].reg_base;
+    brr = READ_REG(uart->BRR);
+    if (READ_BIT(uart->CR1, USART_CR1_OVER8)) {
+        // BRR[2:0] holds USARTDIV[3:0] shifted right by one
+        div = (brr & 0xfff0) | ((brr & 0x7) << 1);
+        return div == 0 ? SHELL_ERR_STATE : 2 * ttys_get_clock(instance_id) / div;
+    }
+
+    return brr == 0 ? SHELL_ERR_STATE : ttys_get_clock(instance_id) / brr;
+}
+
+
+/**
+ * With 16 times oversampling USARTDIV (= BRR) must be at least 16. Higher
+ * rates use 8 times oversampling, where BRR[2:0] holds USARTDIV[3:0] shifted
+ * right by one. The UART is disabled while the registers are changed.
+ */
+int32_t ttys_hw_set_baud(enum ttys_instance_id instance_id, uint32_t baud)
+{
+    USART_TypeDef* uart = ttys_hw_states[instance_id].uart_reg_base;
+    uint32_t clock = ttys_get_clock(instance_id);
+    uint32_t div;
+    uint32_t brr;
+    bool over8 = false;
+    uint32_t primask;
+
+    div = (clock + baud / 2) / baud;
+    if (div < 16) {
+        over8 = true;
+        div = (2 * clock + baud / 2) / baud;
+        brr = (div & 0xfff0) | ((div & 0xf) >> 1);
+    } else {
+        brr = div;
+    }
+    if (div < 16 || div > 0xffff)
+        return SHELL_ERR_ARG;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    CLEAR_BIT(uart->CR1, USART_CR1_UE);
+    if (over8)
+        SET_BIT(uart->CR1, USART_CR1_OVER8);
+    else
+        CLEAR_BIT(uart->CR1, USART_CR1_OVER8);
+    WRITE_REG(uart->BRR, brr);
+    SET_BIT(uart->CR1, USART_CR1_UE);
+
+    __set_PRIMASK(primask);
+
+    return 0;
+}
+
+//=============================================================================
+//                    USART Interrupt Service Routines
+//=============================================================================
+// The following interrupt handler functions override the default handlers,
+// which are "weak" symbols. They are only defined for the enabled instances
+// (see TTYS_GEN_IRQ_HANDLERS).
+
+TTYS_FOR_EACH_UART(TTYS_GEN, TTYS_GEN_IRQ_HANDLERS)
+
+//=============================================================================
+//                    Private (static) functions
+//=============================================================================
+/**
+ * @brief USART interrupt handler.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ * @param[in] irq_type The USART interrupt.
+ *
+ * All the pending conditions are handled in a single entry: error flags,
+ * reception, and transmission. The status is read again after each pass, until
+ * there is nothing left to do, so that e.g. a character received while sending
+ * is handled without leaving and re-entering the handler.
+ */
+static void ttys_interrupt(enum ttys_instance_id instance_id,
+                           IRQn_Type irq_type)
+{
+    struct ttys_state* state = &ttys_states[instance_id];
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+    USART_TypeDef* uart = hw->uart_reg_base;
+    uint32_t isr;
+    uint32_t count;
+    bool more;
+
+#if TTYS_ISR_CYCLE_STATS
+    uint32_t start_cycles = port_get_cycles();
+#endif
+
+    state->pm.isr_entries++;
+
+    do {
+        isr = READ_REG(uart->ISR);
+        more = false;
+
+        if (isr & (USART_ISR_ORE | USART_ISR_NE | USART_ISR_FE | USART_ISR_PE)) {
+            // Error conditions. Count and clear them. On overrun, the data
+            // register still holds the last good character, read below.
+            if (isr & USART_ISR_ORE)
+                state->pm.ore_errors++;
+            if (isr & USART_ISR_FE)
+                state->pm.fe_errors++;
+            if (isr & USART_ISR_NE)
+                state->pm.ne_errors++;
+            if (isr & USART_ISR_PE)
+                state->pm.pe_errors++;
+            WRITE_REG(uart->ICR, USART_ICR_ORECF | USART_ICR_FECF |
+                                 USART_ICR_NCF | USART_ICR_PECF);
+            state->pm.isr_events++;
+        }
+
+        if (hw->rx_dma != NULL && (isr & USART_ISR_IDLE)) {
+            // Reception paused, publish what the DMA has received so far.
+            WRITE_REG(uart->ICR, USART_ICR_IDLECF);
+            ttys_dma_rx_publish(instance_id);
+            state->pm.isr_events++;
+        }
+
+        if ((isr & USART_ISR_RXNE) && hw->rx_dma == NULL && !hw->rx_paused) {
+            // Got an incoming character.
+            char rx_data = READ_REG(uart->RDR);
+
+            // Put it in the RX buffer. If it's full, the character is dropped.
+            if (ring_putc(&state->rx_ring, rx_data) == 0) {
+                state->pm.rx_overruns++;
+            } else {
+                state->pm.rx_bytes++;
+                count = ring_count(&state->rx_ring);
+                if (count > state->pm.rx_high_water)
+                    state->pm.rx_high_water = count;
+                ttys_rx_check_high_water(state);
+            }
+            state->pm.isr_events++;
+            more = true;
+        }
+
+        // Can send a character. TXE is also set while idle, so the interrupt
+        // enable is checked too (and DMA transfers would lose characters).
+        if ((isr & USART_ISR_TXE) && READ_BIT(uart->CR1, USART_CR1_TXEIE)) {
+            char tx_data;
+            if (state->tx_flow_char != 0 && hw->tx_dma_len == 0) {
+                // Flow control characters go first. In DMA mode, the interrupt
+                // was only enabled to send it.
+                WRITE_REG(uart->TDR, state->tx_flow_char);
+                state->tx_flow_char = 0;
+                if (hw->tx_dma != NULL) {
+                    ATOMIC_CLEAR_BIT(uart->CR1, USART_CR1_TXEIE);
+                    ttys_dma_tx_start(instance_id);
+                } else {
+                    more = true;
+                }
+            } else if (hw->tx_dma != NULL) {
+                // A DMA transfer is running, the flow control character is
+                // sent when it completes.
+                ATOMIC_CLEAR_BIT(uart->CR1, USART_CR1_TXEIE);
+            } else if (ring_getc(&state->tx_ring, &tx_data) == 0) {
+                // No characters to send, disable the interrrupt
+                ATOMIC_CLEAR_BIT(uart->CR1, USART_CR1_TXEIE);
+            } else {
+                // The data register takes the next character as soon as the
+                // previous one moves to the shift register.
+                WRITE_REG(uart->TDR, tx_data);
+                state->pm.tx_bytes++;
+                more = true;
+            }
+            state->pm.isr_events++;
+        }
+    } while (more);
+
+#if TTYS_ISR_CYCLE_STATS
+    uint32_t cycles = port_get_cycles() - start_cycles;
+    state->pm.isr_cycles += cycles;
+    if (cycles > state->pm.isr_cycles_max)
+        state->pm.isr_cycles_max = cycles;
+#endif
+}
+
+
+/**
+ * @brief Get the interrupt status flags of a DMA stream.
+ *
+ * @param[in] dma_info The DMA stream.
+ *
+ * @return The stream's DMA_FLAG_xxx bits.
+ */
+static uint32_t ttys_dma_get_flags(const struct ttys_dma_info* dma_info)
+{
+    uint32_t shift = (dma_info->stream_num & 1) * 6 +
+                     (dma_info->stream_num & 2) * 8;
+    uint32_t isr = dma_info->stream_num < 4 ? dma_info->dma->LISR :
+                                              dma_info->dma->HISR;
+
+    return (isr >> shift) & DMA_FLAG_ALL;
+}
+
+
+/**
+ * @brief Clear interrupt status flags of a DMA stream.
+ *
+ * @param[in] dma_info The DMA stream.
+ * @param[in] flags The DMA_FLAG_xxx bits to clear.
+ */
+static void ttys_dma_clear_flags(const struct ttys_dma_info* dma_info,
+                                 uint32_t flags)
+{
+    uint32_t shift = (dma_info->stream_num & 1) * 6 +
+                     (dma_info->stream_num & 2) * 8;
+
+    if (dma_info->stream_num < 4)
+        dma_info->dma->LIFCR = flags << shift;
+    else
+        dma_info->dma->HIFCR = flags << shift;
+}
+
+
+/**
+ * @brief Configure the TX DMA stream of a ttys instance.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * The stream is set up for memory to peripheral transfers of bytes into the
+ * UART's TDR. Transfers are started later by ttys_dma_tx_start().
+ */
+static void ttys_dma_tx_init(enum ttys_instance_id instance_id)
+{
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+    const struct ttys_dma_info* di = hw->tx_dma;
+
+    if (di->dma == DMA1)
+        __HAL_RCC_DMA1_CLK_ENABLE();
+    else
+        __HAL_RCC_DMA2_CLK_ENABLE();
+
+    // Stop the stream (if running) before touching its configuration
+    CLEAR_BIT(di->stream->CR, DMA_SxCR_EN);
+    while (READ_BIT(di->stream->CR, DMA_SxCR_EN))
+        ;
+    ttys_dma_clear_flags(di, DMA_FLAG_ALL);
+
+    di->stream->PAR = (uintptr_t)&hw->uart_reg_base->TDR;
+    di->stream->CR = ((uint32_t)di->channel << DMA_SxCR_CHSEL_Pos) |
+                     DMA_SxCR_MINC | DMA_SxCR_DIR_0 |
+                     DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    di->stream->FCR = 0;  // Direct mode
+
+    ATOMIC_SET_BIT(hw->uart_reg_base->CR3, USART_CR3_DMAT);
+
+    NVIC_SetPriority(di->irq_type,
+                     NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 0, 0));
+    NVIC_EnableIRQ(di->irq_type);
+}
+
+
+/**
+ * @brief Start a TX DMA transfer, if the stream is idle and there is data.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * The transfer covers the contiguous span of the TX ring at its get position,
+ * i.e. up to either the put position or the end of the buffer, whichever comes
+ * first. If the data wraps, the rest is sent by the next transfer, started from
+ * the transfer complete interrupt.
+ *
+ * @note Must be called with interrupts masked, or from the DMA or USART interrupts.
+ */
+static void ttys_dma_tx_start(enum ttys_instance_id instance_id)
+{
+    struct ttys_state* state = &ttys_states[instance_id];
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+    const struct ttys_dma_info* di = hw->tx_dma;
+    char* ptr;
+    uint32_t len;
+
+    if (hw->tx_dma_len != 0)
+        return;
+
+    // A pending flow control character is sent first, by the TXE interrupt,
+    // which then comes back here.
+    if (state->tx_flow_char != 0) {
+        ATOMIC_SET_BIT(hw->uart_reg_base->CR1, USART_CR1_TXEIE);
+        return;
+    }
+
+    len = ring_get_span(&state->tx_ring, &ptr);
+    if (len == 0)
+        return;
+    if (state->cfg.sw_flow_control && len > TTYS_SW_FLOW_DMA_MAX_LEN)
+        len = TTYS_SW_FLOW_DMA_MAX_LEN;
+
+#if (__DCACHE_PRESENT == 1U)
+    // Write the region back to memory, so the DMA sees the data. The address
+    // has to be rounded down to a cache line.
+    uint32_t addr = (uint32_t)ptr;
+    uint32_t line_addr = addr & ~(uint32_t)(DCACHE_LINE_SIZE - 1);
+    SCB_CleanDCache_by_Addr((uint32_t*)line_addr, addr + len - line_addr);
+#endif
+
+    hw->tx_dma_len = len;
+    ttys_dma_clear_flags(di, DMA_FLAG_ALL);
+    di->stream->M0AR = (uintptr_t)ptr;
+    di->stream->NDTR = len;
+    SET_BIT(di->stream->CR, DMA_SxCR_EN);
+}
+
+
+/**
+ * @brief TX DMA stream interrupt handler.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * On completion the transferred region is released from the TX buffer and
+ * the next transfer (if any data is pending) is started. A transfer error also
+ * releases the region, as those characters can not be sent anyway.
+ */
+static void ttys_dma_tx_interrupt(enum ttys_instance_id instance_id)
+{
+    struct ttys_state* state = &ttys_states[instance_id];
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+    const struct ttys_dma_info* di = &ttys_hw_info[instance_id].tx_dma;
+    uint32_t flags = ttys_dma_get_flags(di);
+
+    ttys_dma_clear_flags(di, flags);
+    state->pm.dma_isr_entries++;
+
+    if ((flags & (DMA_FLAG_TCIF | DMA_FLAG_TEIF)) && hw->tx_dma_len != 0) {
+        ring_get_commit(&state->tx_ring, hw->tx_dma_len);
+        state->pm.tx_bytes += hw->tx_dma_len;
+        hw->tx_dma_len = 0;
+
+        ttys_dma_tx_start(instance_id);
+    }
+}
+
+
+/**
+ * @brief Configure and start the RX DMA stream of a ttys instance.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * The stream runs in circular mode over the whole RX buffer, so it never has
+ * to be restarted. Its half transfer and transfer complete interrupts (plus
+ * the USART IDLE interrupt) are only used to publish the received data, and
+ * their flags to tell how many times the DMA went past the half and full
+ * buffer points.
+ */
+static void ttys_dma_rx_init(enum ttys_instance_id instance_id)
+{
+    struct ttys_state* state = &ttys_states[instance_id];
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+    const struct ttys_dma_info* di = hw->rx_dma;
+
+    if (di->dma == DMA1)
+        __HAL_RCC_DMA1_CLK_ENABLE();
+    else
+        __HAL_RCC_DMA2_CLK_ENABLE();
+
+    // Stop the stream (if running) before touching its configuration
+    CLEAR_BIT(di->stream->CR, DMA_SxCR_EN);
+    while (READ_BIT(di->stream->CR, DMA_SxCR_EN))
+        ;
+    ttys_dma_clear_flags(di, DMA_FLAG_ALL);
+
+    di->stream->PAR = (uintptr_t)&hw->uart_reg_base->RDR;
+    di->stream->M0AR = (uintptr_t)state->rx_buf;
+    di->stream->NDTR = state->rx_buf_size;
+    di->stream->CR = ((uint32_t)di->channel << DMA_SxCR_CHSEL_Pos) |
+                     DMA_SxCR_MINC | DMA_SxCR_CIRC |
+                     DMA_SxCR_HTIE | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    di->stream->FCR = 0;  // Direct mode
+
+    NVIC_SetPriority(di->irq_type,
+                     NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 0, 0));
+    NVIC_EnableIRQ(di->irq_type);
+
+    SET_BIT(di->stream->CR, DMA_SxCR_EN);
+    ATOMIC_SET_BIT(hw->uart_reg_base->CR3, USART_CR3_DMAR);
+}
+
+
+/**
+ * @brief Publish the characters written by the RX DMA to the reader.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * The DMA write position is derived from the stream's remaining transfer
+ * count. Before committing it to the RX ring, the newly written region is
+ * invalidated in the D-cache, so the reader does not see stale data. The CPU
+ * never writes to the RX buffer in this mode, so the invalidation can not
+ * discard data.
+ *
+ * The position alone can not tell a whole lap of the buffer since the last
+ * call, so the half transfer and transfer complete flags are also read (before
+ * the position) and cleared here. A flag set for a point that is not between
+ * the last and the new positions means that the DMA went past it one more
+ * time, i.e. a lap was missed. Several missed laps look like one: the
+ * interrupts would have to be held off for more than a buffer's worth of
+ * characters.
+ *
+ * If the new characters do not fit in the free space, the DMA has overwritten
+ * unread characters. Nothing is committed then: the overrun is flagged, and
+ * the reader resynchronizes the ring (see ttys_hw_rx_poll()), which counts the
+ * lost characters once. Until then only the DMA position is followed.
+ *
+ * @note Called from the USART and DMA interrupt handlers, which have the same
+ *       priority, so they never preempt each other, and by the reader with
+ *       interrupts masked.
+ */
+static void ttys_dma_rx_publish(enum ttys_instance_id instance_id)
+{
+    struct ttys_state* state = &ttys_states[instance_id];
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+    const struct ttys_dma_info* di = hw->rx_dma;
+    uint32_t size = state->rx_buf_size;
+    uint32_t flags;
+    uint32_t passed = 0;
+    uint32_t dma_pos;
+    uint32_t len;
+    uint32_t count;
+    char* ptr;
+
+    flags = ttys_dma_get_flags(di) & (DMA_FLAG_HTIF | DMA_FLAG_TCIF);
+    dma_pos = (size - di->stream->NDTR) & (size - 1);
+    len = (dma_pos - hw->rx_dma_pos) & (size - 1);
+
+    // The half and full buffer points passed since the last call, then a
+    // missed lap.
+    if (((size / 2 - hw->rx_dma_pos - 1) & (size - 1)) < len)
+        passed |= DMA_FLAG_HTIF;
+    if (((size - hw->rx_dma_pos - 1) & (size - 1)) < len)
+        passed |= DMA_FLAG_TCIF;
+    ttys_dma_clear_flags(di, flags | passed);
+    if (flags & ~passed)
+        len += size;
+
+    if (len == 0)
+        return;
+    hw->rx_dma_pos = dma_pos;
+    if (hw->rx_dma_overrun) {
+        hw->rx_dma_ahead += len;
+        return;
+    }
+    if (len > ring_space(&state->rx_ring)) {
+        hw->rx_dma_ahead = len;
+        hw->rx_dma_overrun = true;
+        return;
+    }
+
+    ring_put_span(&state->rx_ring, &ptr);
+    ttys_dma_rx_invalidate(state, ptr - state->rx_buf, len);
+    ring_put_commit(&state->rx_ring, len);
+    state->pm.rx_bytes += len;
+    count = ring_count(&state->rx_ring);
+    if (count > state->pm.rx_high_water)
+        state->pm.rx_high_water = count;
+
+    ttys_rx_check_high_water(state);
+}
+
+
+/**
+ * @brief Invalidate a region of the RX buffer in the D-cache.
+ *
+ * @param[in] state The state of the ttys instance.
+ * @param[in] pos Start of the region in the RX buffer.
+ * @param[in] len Length of the region, which can wrap around the end of the
+ *                buffer.
+ *
+ * The start address is rounded down to a cache line.
+ */
+static void ttys_dma_rx_invalidate(const struct ttys_state* state,
+                                   uint32_t pos, uint32_t len)
+{
+#if (__DCACHE_PRESENT == 1U)
+    uint32_t size = state->rx_buf_size;
+    uint32_t start = (uint32_t)&state->rx_buf[pos] &
+                     ~(uint32_t)(DCACHE_LINE_SIZE - 1);
+    uint32_t end = pos + len;
+
+    if (len == 0)
+        return;
+    if (end > size) {
+        // Wrapped around: invalidate up to the end of the buffer, then the
+        // start of the buffer.
+        SCB_InvalidateDCache_by_Addr((uint32_t*)start,
+            (uint32_t)&state->rx_buf[size] - start);
+        start = (uint32_t)state->rx_buf;
+        end -= size;
+    }
+    SCB_InvalidateDCache_by_Addr((uint32_t*)start,
+        (uint32_t)&state->rx_buf[end] - start);
+#else
+    (void)state;
+    (void)pos;
+    (void)len;
+#endif
+}
+
+
+/**
+ * @brief RX DMA stream interrupt handler.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * At the half and full buffer points the received data is published (the
+ * half transfer and transfer complete flags are cleared there). A transfer
+ * error disables the stream (it can only be caused by a bus error).
+ * In that case the instance falls back to interrupt driven reception, which
+ * continues from the current RX ring position.
+ */
+static void ttys_dma_rx_interrupt(enum ttys_instance_id instance_id)
+{
+    struct ttys_state* state = &ttys_states[instance_id];
+    struct ttys_hw_state* hw = &ttys_hw_states[instance_id];
+    const struct ttys_dma_info* di = &ttys_hw_info[instance_id].rx_dma;
+    uint32_t flags = ttys_dma_get_flags(di);
+
+    ttys_dma_clear_flags(di, flags & ~(DMA_FLAG_HTIF | DMA_FLAG_TCIF));
+    state->pm.dma_isr_entries++;
+
+    if (flags & DMA_FLAG_TEIF) {
+        ttys_dma_rx_publish(instance_id);
+        ATOMIC_CLEAR_BIT(hw->uart_reg_base->CR3, USART_CR3_DMAR);
+        ATOMIC_CLEAR_BIT(hw->uart_reg_base->CR1, USART_CR1_IDLEIE);
+        hw->rx_dma = NULL;
+        // After an overrun, the reader resynchronizes the ring first.
+        if (!hw->rx_paused && !hw->rx_dma_overrun)
+            ATOMIC_SET_BIT(hw->uart_reg_base->CR1, USART_CR1_RXNEIE);
+    } else if (flags & (DMA_FLAG_HTIF | DMA_FLAG_TCIF)) {
+        ttys_dma_rx_publish(instance_id);
+    }
+}
+
+
+/**
+ * @brief Get the kernel clock frequency of a UART.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ *
+ * @return The frequency in Hz, according to the UART's clock selection.
+ */
+static uint32_t ttys_get_clock(enum ttys_instance_id instance_id)
+{
+    const struct ttys_hw_info* hi = &ttys_hw_info[instance_id];
+
+    switch ((RCC->DCKCFGR2 >> hi->clk_sel_pos) & 0x3) {
+        case 0:
+            return hi->apb == 2 ? HAL_RCC_GetPCLK2Freq() :
+                                  HAL_RCC_GetPCLK1Freq();
+        case 1:
+            return HAL_RCC_GetSysClockFreq();
+        case 2:
+            return HSI_VALUE;
+        default:
+            return LSE_VALUE;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The following functions are used to integrate this module into the C
+// language stdio system. This is largely based on overriding of the default
+// "system call functions" _write and _read. The default functions use "weak"
+// symbols.
+////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief System call function for write().
+ *
+ * @param[in] file File descriptor.
+ * @param[in] ptr Data to be written.
+ * @param[in] len Length of data.
+ *
+ * @return Number of characters written, or -1 for error (errno=EAGAIN if no
+ *         character could be queued).
+ *
+ * @note What happens when the TX buffer is full depends on the instance's TX
+ *       overrun policy. Fewer than len characters might be written.
+ */
+int _write(int file, char* ptr, int len)
+{
+    int rc;
+    enum ttys_instance_id instance_id = ttys_fd_to_instance(file);
+
+    if (instance_id >= TTYS_NUM_INSTANCES) {
+        errno = EBADF;
+        return -1;
+    }
+
+    rc = ttys_write(instance_id, ptr, len);
+    if (rc == 0 && len > 0) {
+        errno = EAGAIN;
+        rc = -1;
+    }
+
+    return rc;
+}
+
+/**
+ * @brief System call function for read().
+ *
+ * @param[in] file File descriptor.
+ * @param[in] ptr Location of buffer to place characters.
+ * @param[in] len Length of buffer.
+ *
+ * @return Number of characters written, or -1 for error.
+ *
+ * @note Assumes non-blocking operation.
+ */
+int _read(int file, char* ptr, int len)
+{
+    int rc;
+    enum ttys_instance_id instance_id = ttys_fd_to_instance(file);
+
+    if (instance_id >= TTYS_NUM_INSTANCES) {
+        errno = EBADF;
+        return -1;
+    }
+
+    rc = ttys_read(instance_id, ptr, len);
+    if (rc == 0) {
+        errno = EAGAIN;
+        rc = -1;
+    }
+
+    return rc;
+}
+
+#endif /* !SHELL_PORT_POSIX */
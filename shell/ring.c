@@ -0,0 +1,155 @@
+/**
+ * @brief Implementation of ring module.
+ */
+
+#include "shell.h"
+
+//=============================================================================
+//                           Macro Definitions
+//=============================================================================
+// Index handoff between producer and consumer. The release store makes sure
+// the data accesses before it are complete before the other side can see the
+// new index, and the acquire load makes sure data accesses after it are not
+// done before the index has been read. On Cortex-M7 both emit a DMB.
+#define LOAD_ACQUIRE(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+//=============================================================================
+//                       Public (global) functions
+//=============================================================================
+int32_t ring_init(struct ring* ring, char* buf, uint32_t size)
+{
+    if (ring == NULL || buf == NULL || !RING_SIZE_IS_VALID(size))
+        return SHELL_ERR_ARG;
+
+    ring->buf = buf;
+    ring->mask = size - 1;
+    ring->put_idx = 0;
+    ring->get_idx = 0;
+
+    return 0;
+}
+
+
+uint32_t ring_count(const struct ring* ring)
+{
+    return LOAD_ACQUIRE(&ring->put_idx) - LOAD_ACQUIRE(&ring->get_idx);
+}
+
+
+uint32_t ring_space(const struct ring* ring)
+{
+    return ring->mask + 1 - ring_count(ring);
+}
+
+
+uint32_t ring_putc(struct ring* ring, char c)
+{
+    uint32_t put_idx = ring->put_idx;
+
+    if (put_idx - LOAD_ACQUIRE(&ring->get_idx) > ring->mask)
+        return 0;
+
+    ring->buf[put_idx & ring->mask] = c;
+    STORE_RELEASE(&ring->put_idx, put_idx + 1);
+
+    return 1;
+}
+
+
+uint32_t ring_getc(struct ring* ring, char* c)
+{
+    uint32_t get_idx = ring->get_idx;
+
+    if (LOAD_ACQUIRE(&ring->put_idx) == get_idx)
+        return 0;
+
+    *c = ring->buf[get_idx & ring->mask];
+    STORE_RELEASE(&ring->get_idx, get_idx + 1);
+
+    return 1;
+}
+
+
+uint32_t ring_write(struct ring* ring, const char* data, uint32_t len)
+{
+    uint32_t put_idx = ring->put_idx;
+    uint32_t space = ring->mask + 1 - (put_idx - LOAD_ACQUIRE(&ring->get_idx));
+    uint32_t offset = put_idx & ring->mask;
+    uint32_t seg_len;
+
+    if (len > space)
+        len = space;
+
+    // Copy in (at most) two segments: up to the end of the buffer, and then
+    // from its start.
+    seg_len = ring->mask + 1 - offset;
+    if (seg_len > len)
+        seg_len = len;
+    memcpy(&ring->buf[offset], data, seg_len);
+    memcpy(ring->buf, data + seg_len, len - seg_len);
+
+    STORE_RELEASE(&ring->put_idx, put_idx + len);
+
+    return len;
+}
+
+
+uint32_t ring_read(struct ring* ring, char* data, uint32_t len)
+{
+    uint32_t get_idx = ring->get_idx;
+    uint32_t count = LOAD_ACQUIRE(&ring->put_idx) - get_idx;
+    uint32_t offset = get_idx & ring->mask;
+    uint32_t seg_len;
+
+    if (len > count)
+        len = count;
+
+    seg_len = ring->mask + 1 - offset;
+    if (seg_len > len)
+        seg_len = len;
+    memcpy(data, &ring->buf[offset], seg_len);
+    memcpy(data + seg_len, ring->buf, len - seg_len);
+
+    STORE_RELEASE(&ring->get_idx, get_idx + len);
+
+    return len;
+}
+
+
+uint32_t ring_put_span(const struct ring* ring, char** ptr)
+{
+    uint32_t put_idx = ring->put_idx;
+    uint32_t space = ring->mask + 1 - (put_idx - LOAD_ACQUIRE(&ring->get_idx));
+    uint32_t offset = put_idx & ring->mask;
+    uint32_t seg_len = ring->mask + 1 - offset;
+
+    *ptr = &ring->buf[offset];
+
+    return seg_len < space ? seg_len : space;
+}
+
+
+void ring_put_commit(struct ring* ring, uint32_t len)
+{
+    STORE_RELEASE(&ring->put_idx, ring->put_idx + len);
+}
+
+
+uint32_t ring_get_span(const struct ring* ring, char** ptr)
+{
+    uint32_t get_idx = ring->get_idx;
+    uint32_t count = LOAD_ACQUIRE(&ring->put_idx) - get_idx;
+    uint32_t offset = get_idx & ring->mask;
+    uint32_t seg_len = ring->mask + 1 - offset;
+
+    *ptr = &ring->buf[offset];
+
+    return seg_len < count ? seg_len : count;
+}
+
+
+void ring_get_commit(struct ring* ring, uint32_t len)
+{
+    STORE_RELEASE(&ring->get_idx, ring->get_idx + len);
+}
@@ -0,0 +1,239 @@
+/**
+ * @brief Implementation of tmr module.
+ */
+
+#include "shell.h"
+
+//=============================================================================
+//                           Macro Definitions
+//=============================================================================
+_Static_assert(TMR_WHEEL_SIZE > 0 &&
+               (TMR_WHEEL_SIZE & (TMR_WHEEL_SIZE - 1)) == 0,
+               "TMR_WHEEL_SIZE must be a power of 2");
+
+// Check if a tick is after another, across the wrap around of the ticks.
+#define TMR_AFTER(a, b) ((int32_t)((a) - (b)) > 0)
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static void tmr_link(struct tmr* tmr);
+static void tmr_unlink(struct tmr* tmr);
+
+//=============================================================================
+//                         Private (static) variables
+//=============================================================================
+// Monotonic clock: cycles up to the last read of the cycle counter, and that
+// read, with the millisecond tick read with it.
+static uint64_t tmr_cycles;
+static uint32_t tmr_last_cycles;
+static uint32_t tmr_last_ms;
+
+// Cycle counter frequency, and the milliseconds from which the cycle counter
+// may have wrapped around between two reads (none before tmr_init()).
+static uint32_t tmr_cycles_hz;
+static uint32_t tmr_cycles_per_ms;
+static uint32_t tmr_wrap_check_ms = UINT32_MAX;
+
+// Timer wheel: the running timers, by expiry tick, and the last tick
+// processed by tmr_run().
+static struct tmr* tmr_wheel[TMR_WHEEL_SIZE];
+static uint32_t tmr_tick;
+
+//=============================================================================
+//                         Public (global) functions
+//=============================================================================
+int32_t tmr_init(void)
+{
+    uint32_t irq_state;
+
+    port_cycles_start();
+
+    irq_state = port_irq_disable();
+    tmr_cycles_hz = port_get_cycles_hz();
+    tmr_cycles_per_ms = tmr_cycles_hz / 1000U;
+    tmr_wrap_check_ms = (1U << 31) / tmr_cycles_per_ms + 1;
+    tmr_cycles = 0;
+    tmr_last_cycles = port_get_cycles();
+    tmr_last_ms = port_get_ms();
+    tmr_tick = tmr_last_ms;
+    port_irq_restore(irq_state);
+
+    return 0;
+}
+
+
+uint64_t tmr_get_cycles(void)
+{
+    uint32_t irq_state = port_irq_disable();
+    uint32_t cycles = port_get_cycles();
+    uint32_t ms = port_get_ms();
+    uint32_t delta = cycles - tmr_last_cycles;
+    uint64_t expected;
+    uint64_t result;
+
+    // The cycle counter can only have wrapped around if more than half a wrap
+    // period elapsed (by the millisecond tick). The number of wraps is then
+    // the one that brings delta closest to the elapsed milliseconds, which
+    // are accurate to a few cycles per millisecond.
+    if (ms - tmr_last_ms >= tmr_wrap_check_ms) {
+        expected = (uint64_t)(ms - tmr_last_ms) * tmr_cycles_per_ms;
+        tmr_cycles += (expected + (1U << 31) - delta) & ~(uint64_t)UINT32_MAX;
+    }
+    tmr_cycles += delta;
+    tmr_last_cycles = cycles;
+    tmr_last_ms = ms;
+    result = tmr_cycles;
+    port_irq_restore(irq_state);
+
+    return result;
+}
+
+
+uint64_t tmr_cycles_to_us(uint64_t cycles)
+{
+    if (tmr_cycles_hz == 0)
+        return 0;
+
+    // In two parts, so that the multiplication does not overflow.
+    return cycles / tmr_cycles_hz * 1000000U +
+           cycles % tmr_cycles_hz * 1000000U / tmr_cycles_hz;
+}
+
+
+uint64_t tmr_get_us(void)
+{
+    return tmr_cycles_to_us(tmr_get_cycles());
+}
+
+
+int32_t tmr_start(struct tmr* tmr, uint32_t delay_ms, uint32_t period_ms,
+                  tmr_func func, void* arg)
+{
+    uint32_t expiry_ms = port_get_ms() + delay_ms;
+
+    if (tmr == NULL || func == NULL || delay_ms > TMR_MAX_MS ||
+        period_ms > TMR_MAX_MS)
+        return SHELL_ERR_ARG;
+
+    tmr_stop(tmr);
+
+    // The current tick may have been processed already.
+    if (!TMR_AFTER(expiry_ms, tmr_tick))
+        expiry_ms = tmr_tick + 1;
+
+    tmr->expiry_ms = expiry_ms;
+    tmr->period_ms = period_ms;
+    tmr->func = func;
+    tmr->arg = arg;
+    tmr_link(tmr);
+
+    return 0;
+}
+
+
+void tmr_stop(struct tmr* tmr)
+{
+    if (tmr != NULL && tmr->pprev != NULL)
+        tmr_unlink(tmr);
+}
+
+
+bool tmr_is_running(const struct tmr* tmr)
+{
+    return tmr->pprev != NULL;
+}
+
+
+void tmr_run(void)
+{
+    uint32_t now = port_get_ms();
+    struct tmr** slot;
+    struct tmr* tmr;
+
+    // After a long time without a call, each slot is processed once, with
+    // all its expired timers.
+    if (now - tmr_tick > TMR_WHEEL_SIZE)
+        tmr_tick = now - TMR_WHEEL_SIZE;
+
+    while (tmr_tick != now) {
+        tmr_tick++;
+        slot = &tmr_wheel[tmr_tick & (TMR_WHEEL_SIZE - 1)];
+
+        // The slot is scanned again after each call, as the function can
+        // start or stop any timer. The timers expiring on later turns are
+        // skipped.
+        tmr = *slot;
+        while (tmr != NULL) {
+            if (TMR_AFTER(tmr->expiry_ms, tmr_tick)) {
+                tmr = tmr->next;
+                continue;
+            }
+
+            tmr_unlink(tmr);
+            if (tmr->period_ms != 0) {
+                tmr->expiry_ms += tmr->period_ms;
+                if (!TMR_AFTER(tmr->expiry_ms, tmr_tick))
+                    tmr->expiry_ms = tmr_tick + tmr->period_ms;
+                tmr_link(tmr);
+            }
+            tmr->func(tmr->arg);
+            tmr = *slot;
+        }
+    }
+}
+
+
+uint32_t tmr_get_idle_ms(uint32_t max_ms)
+{
+    uint32_t now = port_get_ms();
+    uint32_t idle_ms = max_ms;
+    int32_t delay_ms;
+
+    for (uint32_t idx = 0; idx < TMR_WHEEL_SIZE && idle_ms > 0; idx++) {
+        for (struct tmr* tmr = tmr_wheel[idx]; tmr != NULL; tmr = tmr->next) {
+            delay_ms = tmr->expiry_ms - now;
+            if (delay_ms <= 0) {
+                idle_ms = 0;
+                break;
+            }
+            if ((uint32_t)delay_ms < idle_ms)
+                idle_ms = delay_ms;
+        }
+    }
+
+    return idle_ms;
+}
+
+//=============================================================================
+//                         Private (static) functions
+//=============================================================================
+/**
+ * @brief Insert a timer in the slot of its expiry tick.
+ *
+ * @param[in] tmr The timer.
+ */
+static void tmr_link(struct tmr* tmr)
+{
+    struct tmr** slot = &tmr_wheel[tmr->expiry_ms & (TMR_WHEEL_SIZE - 1)];
+
+    tmr->next = *slot;
+    if (tmr->next != NULL)
+        tmr->next->pprev = &tmr->next;
+    tmr->pprev = slot;
+    *slot = tmr;
+}
+
+
+/**
+ * @brief Remove a timer from its slot.
+ *
+ * @param[in] tmr The timer, which must be running.
+ */
+static void tmr_unlink(struct tmr* tmr)
+{
+    *tmr->pprev = tmr->next;
+    if (tmr->next != NULL)
+        tmr->next->pprev = tmr->pprev;
+    tmr->pprev = NULL;
+}
@@ -1,369 +1,921 @@
-/**
- * @brief Implementation of ttys module.
- */
-
-#include "shell.h"
-
-//=============================================================================
-//                              Common Macros
-//=============================================================================
-// This module integrates into the C language stdio system. The ttys "device
-// files" can be viewed as always "open", with the following file
-// descriptors. These are then mapped to FILE streams.
-//
-// Note that one of the UARTs is mapped to stdout (file descriptor 1), which
-// is thus the one used for printf() and friends.
-
-#define UART1_FD 1    // stdout
-// #define UARTx_FD   // uncomment for available UARTs
-#define UART5_FD 3
-#define UART6_FD 4
-
-//=============================================================================
-//                            Type Definitions
-//=============================================================================
-/**
- * Per-instance ttys state information
- */
-struct ttys_state {
-    struct ttys_cfg cfg;
-    FILE* stream;
-    int fd;
-    USART_TypeDef* uart_reg_base;
-    uint16_t rx_buf_get_idx;
-    uint16_t rx_buf_put_idx;
-    uint16_t tx_buf_get_idx;
-    uint16_t tx_buf_put_idx;
-    char tx_buf[TTYS_TX_BUF_SIZE];
-    char rx_buf[TTYS_RX_BUF_SIZE];
-};
-
-//=============================================================================
-//                  Private (static) function declarations
-//=============================================================================
-static void ttys_interrupt(enum ttys_instance_id instance_id,
-                           IRQn_Type irq_type);
-
-//=============================================================================
-//                        Private (static) variables
-//=============================================================================
-static struct ttys_state ttys_states[TTYS_NUM_INSTANCES];
-
-//=============================================================================
-//                        Public (global) functions
-//=============================================================================
-int32_t ttys_get_default_cfg(enum ttys_instance_id instance_id, struct ttys_cfg* cfg)
-{
-    if (cfg == NULL)
-        return SHELL_ERR_ARG;
-
-    memset(cfg, 0, sizeof(struct ttys_cfg));
-    cfg->create_stream = true;
-    cfg->send_cr_after_nl = true;
-
-    return 0;
-}
-
-
-int32_t ttys_init(enum ttys_instance_id instance_id, struct ttys_cfg* cfg)
-{
-    IRQn_Type irq_type;
-
-    // Input checking:
-    if (instance_id >= TTYS_NUM_INSTANCES)
-        return SHELL_ERR_BAD_INSTANCE;
-
-    if (cfg == NULL)
-        return SHELL_ERR_ARG;
-
-    // Get corresponding state instance and initialize all values to zero:
-    struct ttys_state* state = &ttys_states[instance_id];
-    memset(state, 0, sizeof(struct ttys_state));
-
-    // Initialize all non-zero variables in the state structure:
-    state->cfg = *cfg;
-
-    switch (instance_id) {
-        case TTYS_INSTANCE_UART1:
-            state->uart_reg_base = USART1;
-            state->fd = UART1_FD;
-            irq_type = USART1_IRQn;
-            break;
-//        case TTYS_INSTANCE_UARTx:
-//            state->uart_reg_base = USARTx;
-//            state->fd = UARTx_FD;
-//            irq_type = USARTx_IRQn;
-//            break;
-        case TTYS_INSTANCE_UART5:
-            state->uart_reg_base = UART5;
-            state->fd = UART5_FD;
-            irq_type = UART5_IRQn;
-            break;
-        case TTYS_INSTANCE_UART6:
-            state->uart_reg_base = USART6;
-            state->fd = UART6_FD;
-            irq_type = USART6_IRQn;
-            break;
-        default:
-            return SHELL_ERR_BAD_INSTANCE;
-    }
-
-    if (state->cfg.create_stream) {
-        state->stream = fdopen(state->fd, "r+");
-        if (state->stream != NULL)
-            setvbuf(state->stream, NULL, _IONBF, 0);
-    } else {
-        state->stream = NULL;
-    }
-
-    // Disable I/O buffering for STDOUT stream, so that
-    // chars are sent out as soon as they are printed
-    setvbuf(stdout, NULL, _IONBF, 0);
-
-    // Enable interrupts
-    ATOMIC_SET_BIT(state->uart_reg_base->CR1, USART_CR1_RXNEIE);
-    ATOMIC_SET_BIT(state->uart_reg_base->CR1, USART_CR1_TXEIE);
-
-    NVIC_SetPriority(irq_type,
-                     NVIC_EncodePriority(NVIC_GetPriorityGrouping(),0, 0));
-    NVIC_EnableIRQ(irq_type);
-
-    return 0;
-}
-
-
-int32_t ttys_putc(enum ttys_instance_id instance_id, char c)
-{
-    if (instance_id >= TTYS_NUM_INSTANCES)
-        return SHELL_ERR_BAD_INSTANCE;
-
-    struct ttys_state* state = &ttys_states[instance_id];
-
-    // Calculate the new TX buffer put index
-    uint16_t next_put_idx = state->tx_buf_put_idx + 1;
-    if (next_put_idx >= TTYS_TX_BUF_SIZE)
-        next_put_idx = 0;
-
-    // If buffer is full, then return error
-    if (next_put_idx == state->tx_buf_get_idx)
-        return SHELL_ERR_BUF_OVERRUN;
-
-    // Put the char in the TX buffer
-    state->tx_buf[state->tx_buf_put_idx] = c;
-    state->tx_buf_put_idx = next_put_idx;
-
-    // Ensure the TX interrupt is enabled
-    if (ttys_states[instance_id].uart_reg_base != NULL)
-	ATOMIC_SET_BIT(state->uart_reg_base->CR1, USART_CR1_TXEIE);
-
-    return 0;
-}
-
-
-int32_t ttys_getc(enum ttys_instance_id instance_id, char* c)
-{
-    if (instance_id >= TTYS_NUM_INSTANCES)
-        return SHELL_ERR_BAD_INSTANCE;
-
-    struct ttys_state* state = &ttys_states[instance_id];
-
-    // Check if buffer is empty
-    if (state->rx_buf_get_idx == state->rx_buf_put_idx)
-        return 0;
-
-    // Get a character and advance get index
-    *c = state->rx_buf[state->rx_buf_get_idx];
-
-    state->rx_buf_get_idx++;
-    if (state->rx_buf_get_idx >= TTYS_RX_BUF_SIZE)
-    	state->rx_buf_get_idx = 0;
-
-    return 1;
-}
-
-
-int ttys_get_fd(enum ttys_instance_id instance_id)
-{
-    if (instance_id >= TTYS_NUM_INSTANCES)
-        return SHELL_ERR_ARG;
-
-    if (ttys_states[instance_id].fd >= 0)
-        return ttys_states[instance_id].fd;
-
-    return SHELL_ERR_RESOURCE;
-}
-
-
-FILE* ttys_get_stream(enum ttys_instance_id instance_id)
-{
-    if (instance_id >= TTYS_NUM_INSTANCES)
-        return NULL;
-
-    return ttys_states[instance_id].stream;
-}
-
-//=============================================================================
-//                    USART Interrupt Service Routines
-//=============================================================================
-// The following interrupt handler functions override the default handlers,
-// which are "weak" symbols.
-
-void USART1_IRQHandler(void)
-{
-    ttys_interrupt(TTYS_INSTANCE_UART1, USART1_IRQn);
-}
-
-// Uncomment and modify for all the available USARTs:
-//
-// void USARTx_IRQHandler(void)
-// {
-//     ttys_interrupt(TTYS_INSTANCE_UARTx, USARTx_IRQn);
-// }
-
-//=============================================================================
-//                    Private (static) functions
-//=============================================================================
-static void ttys_interrupt(enum ttys_instance_id instance_id,
-                           IRQn_Type irq_type)
-{
-    struct ttys_state* state = &ttys_states[instance_id];
-
-    uint32_t isr = state->uart_reg_base->ISR;
-
-    if (isr & USART_ISR_RXNE) {
-        // Got an incoming character.
-    	char rx_data = state->uart_reg_base->RDR;
-
-	// Check RX buffer isn't full
-	if ((state->rx_buf_put_idx + 1) != state->rx_buf_get_idx) {
-	    state->rx_buf[state->rx_buf_put_idx] = rx_data;
-	    state->rx_buf_put_idx++;
-	    if (state->rx_buf_put_idx >= TTYS_RX_BUF_SIZE)
-		state->rx_buf_put_idx = 0;
-	} else {
-	    Error_Handler();
-	}
-    } else if (isr & USART_ISR_TXE) {
-        // Can send a character.
-        if (state->tx_buf_get_idx == state->tx_buf_put_idx) {
-            // No characters to send, disable the interrrupt
-            ATOMIC_CLEAR_BIT(state->uart_reg_base->CR1, USART_CR1_TXEIE);
-        } else {
-            state->uart_reg_base->TDR = state->tx_buf[state->tx_buf_get_idx];
-            state->tx_buf_get_idx++;
-            if (state->tx_buf_get_idx >= TTYS_TX_BUF_SIZE)
-                state->tx_buf_get_idx = 0;
-        }
-    } else if (isr & (USART_ISR_ORE | USART_ISR_NE |
-    		      USART_ISR_FE | USART_ISR_PE)) {
-        // Error conditions. To clear the bit, we need to read the data
-        // register, but we don't use it.
-        (void)state->uart_reg_base->RDR;
-    }
-}
-
-////////////////////////////////////////////////////////////////////////////////
-// The following functions are used to integrate this module into the C
-// language stdio system. This is largely based on overriding of the default
-// "system call functions" _write and _read. The default functions use "weak"
-// symbols.
-////////////////////////////////////////////////////////////////////////////////
-/**
- * @brief Map file descriptor to ttys instance.
- *
- * @param[in] fd File descriptor.
- *
- * @return Instance ID corresponding to file instance, or TTYS_NUM_INSTANCES if
- *         no match.
- */
-static enum ttys_instance_id fd_to_instance(int fd)
-{
-    enum ttys_instance_id instance_id = TTYS_NUM_INSTANCES;
-
-    switch (fd) {
-        case UART1_FD:
-            instance_id = TTYS_INSTANCE_UART1;
-            break;
-//        case UARTx_FD:
-//			instance_id = TTYS_INSTANCE_UARTx;
-//			break;
-        case UART5_FD:
-            instance_id = TTYS_INSTANCE_UART5;
-            break;
-        case UART6_FD:
-            instance_id = TTYS_INSTANCE_UART6;
-            break;
-    }
-
-    return instance_id;
-}
-
-/**
- * @brief System call function for write().
- *
- * @param[in] file File descriptor.
- * @param[in] ptr Data to be written.
- * @param[in] len Length of data.
- *
- * @return Number of characters written, or -1 for error.
- *
- * @note Characters might be dropped due to buffer overrun, and this is not
- *       reflected the return value. An alternative would be to return -1 and
- *       errno=EWOULDBLOCK.
- */
-int _write(int file, char* ptr, int len)
-{
-    int idx;
-    enum ttys_instance_id instance_id = fd_to_instance(file);
-
-    if (instance_id >= TTYS_NUM_INSTANCES) {
-        errno = EBADF;
-        return -1;
-    }
-
-    for (idx = 0; idx < len; idx++) {
-        char c = *ptr++;
-        ttys_putc(instance_id, c);
-        if (c == '\n' && ttys_states[instance_id].cfg.send_cr_after_nl) {
-            ttys_putc(instance_id, '\r');
-        }
-    }
-
-    return len;
-}
-
-/**
- * @brief System call function for read().
- *
- * @param[in] file File descriptor.
- * @param[in] ptr Location of buffer to place characters.
- * @param[in] len Length of buffer.
- *
- * @return Number of characters written, or -1 for error.
- *
- * @note Assumes non-blocking operation.
- */
-int _read(int file, char* ptr, int len)
-{
-    int rc = 0;
-    char c;
-    enum ttys_instance_id instance_id = fd_to_instance(file);
-
-    if (instance_id >= TTYS_NUM_INSTANCES) {
-        errno = EBADF;
-        return -1;
-    }
-
-    if (ttys_states[instance_id].rx_buf_get_idx ==
-        ttys_states[instance_id].rx_buf_put_idx) {
-        errno = EAGAIN;
-        rc = -1;
-    } else {
-        while (rc < len && ttys_getc(instance_id, &c)) {
-            *ptr++ = c;
-            rc++;
-        }
-    }
-
-    return rc;
-}
+/**
+ * @brief Implementation of ttys module.
+ *
+ * This file holds the platform independent part of the module, the device is
+ * driven by the backend of the platform (see ttys_port.h).
+ */
+
+#include "shell.h"
+#include "ttys_port.h"
+
+//=============================================================================
+//                              Common Macros
+//=============================================================================
+// This module integrates into the C language stdio system. The ttys "device
+// files" can be viewed as always "open", with the file descriptors set in
+// ttys_conf.h (TTYS_xxx_FD). These are then mapped to FILE streams.
+//
+// Note that one of the UARTs is mapped to stdout (file descriptor 1), which
+// is thus the one used for printf() and friends.
+
+// Check that the buffer sizes are powers of two.
+#define TTYS_GEN_CHECKS(id, name, tx_size, rx_size, ...)                      \
+    _Static_assert(RING_SIZE_IS_VALID(tx_size) && RING_SIZE_IS_VALID(rx_size),\
+                   "ttys " #name " buffer sizes must be powers of two");
+
+// Buffers of an instance, named ttys_<name>_tx_buf and ttys_<name>_rx_buf.
+// They are rounded up to whole D-cache lines, so that DMA cache maintenance
+// never touches other variables.
+#define TTYS_GEN_BUFFERS(id, name, tx_size, rx_size, ...)                     \
+    static char ttys_##name##_tx_buf[TTYS_BUF_ALLOC_SIZE(tx_size)]            \
+        __ALIGNED(DCACHE_LINE_SIZE);                                          \
+    static char ttys_##name##_rx_buf[TTYS_BUF_ALLOC_SIZE(rx_size)]            \
+        __ALIGNED(DCACHE_LINE_SIZE);
+#define TTYS_BUF_ALLOC_SIZE(size) \
+    (((size) + DCACHE_LINE_SIZE - 1) & ~(DCACHE_LINE_SIZE - 1))
+
+// Descriptor of an instance (see struct ttys_uart_info). The parameters are
+// named apart from the structure members.
+#define TTYS_GEN_UART_INFO(id, name, tx_size, rx_size, fd_, ...)              \
+    [id] = {                                                                  \
+        .fd = fd_,                                                            \
+        .tx_buf = ttys_##name##_tx_buf,                                       \
+        .rx_buf = ttys_##name##_rx_buf,                                       \
+        .tx_buf_size = tx_size,                                               \
+        .rx_buf_size = rx_size,                                               \
+    },
+
+// Static initializer of a state instance, so that its rings can be used before
+// ttys_init().
+#define TTYS_GEN_STATE(id, name, tx_size, rx_size, ...)                       \
+    [id] = {                                                                  \
+        .tx_ring = RING_INITIALIZER(ttys_##name##_tx_buf, tx_size),           \
+        .rx_ring = RING_INITIALIZER(ttys_##name##_rx_buf, rx_size),           \
+    },
+
+// Performance measurements of an instance, named "<name>.<counter>".
+#define TTYS_GEN_PMS(id, name, ...) \
+    TTYS_PM_COUNTERS(TTYS_PM_INFO, id, #name)
+
+// File descriptor to instance mapping entry. The instance is stored plus one,
+// so that unused entries (zero) map to no instance.
+#define TTYS_GEN_FD_MAP(id, name, tx_size, rx_size, fd, ...) \
+    [fd] = id + 1,
+
+// Maximum wait for the TX buffer to drain before a baud rate change.
+#define TTYS_BAUD_DRAIN_TIMEOUT_MS 1000
+
+// Software flow control characters.
+#define XON  '\x11'
+#define XOFF '\x13'
+
+// Performance measurement info of an instance counter, named as
+// "<instance>.<counter>".
+#define TTYS_PM_INFO(id, prefix, counter) {                                   \
+    .name = prefix "." #counter,                                              \
+    .val = &ttys_states[id].pm.counter,                                       \
+},
+
+// Number of the performance measurements of an instance.
+#define TTYS_PM_ONE(...) + 1
+#define TTYS_NUM_PM_COUNTERS (0 TTYS_PM_COUNTERS(TTYS_PM_ONE, unused))
+
+// Number of an instance ("1" for uart1), which names its commands.
+#define TTYS_NUMBER(name) (&(#name)[sizeof("uart") - 1])
+#define TTYS_GEN_NUMBER(id, name, ...) [id] = TTYS_NUMBER(name),
+
+// Commands of an instance, e.g. "ttys 1 pm" for uart1.
+#define TTYS_GEN_CMDS(id, uart, ...)                                          \
+    {                                                                         \
+        .name = TTYS_NUMBER(uart),                                            \
+        .help = "Commands of " #uart,                                         \
+        .num_subcmds = ARRAY_SIZE(ttys_instance_cmds),                        \
+        .subcmds = ttys_instance_cmds,                                        \
+    },
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+/**
+ * Constant descriptor of an instance: its file descriptor and buffers. The
+ * hardware is described by the backend.
+ */
+struct ttys_uart_info {
+    int fd;
+    char* tx_buf;
+    char* rx_buf;
+    uint32_t tx_buf_size;
+    uint32_t rx_buf_size;
+};
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static int32_t ttys_tx_queue(struct ttys_state* state, const char* buf,
+                             uint32_t len, bool expand_nl);
+static uint32_t ttys_tx_copy(struct ttys_state* state, const char* buf,
+                             uint32_t len, bool expand_nl);
+static bool ttys_tx_put_drop_marker(struct ttys_state* state);
+static uint32_t ttys_tx_discard(struct ttys_state* state, uint32_t len);
+static void ttys_rx_check_low_water(struct ttys_state* state);
+static void ttys_tx_flow_char(struct ttys_state* state, char c);
+static int32_t ttys_tx_drain(struct ttys_state* state, uint32_t timeout_ms);
+static int32_t ttys_apply_baud(enum ttys_instance_id instance_id,
+                               uint32_t baud);
+static void ttys_baud_check_confirm(enum ttys_instance_id instance_id);
+static int32_t cmd_ttys_baud(int32_t argc, const char** argv);
+static int32_t cmd_ttys_pm(int32_t argc, const char** argv);
+
+//=============================================================================
+//                        Private (static) variables
+//=============================================================================
+TTYS_FOR_EACH_UART(TTYS_GEN, TTYS_GEN_CHECKS)
+
+TTYS_FOR_EACH_UART(TTYS_GEN, TTYS_GEN_BUFFERS)
+
+static const struct ttys_uart_info ttys_uart_info[TTYS_NUM_INSTANCES] = {
+    TTYS_FOR_EACH_UART(TTYS_GEN, TTYS_GEN_UART_INFO)
+};
+
+static const uint8_t ttys_fd_map[TTYS_MAX_FD + 1] = {
+    TTYS_FOR_EACH_UART(TTYS_GEN, TTYS_GEN_FD_MAP)
+};
+
+static const struct cmd_pm_info ttys_pms[] = {
+    TTYS_FOR_EACH_UART(TTYS_GEN, TTYS_GEN_PMS)
+};
+
+static const char* const ttys_numbers[TTYS_NUM_INSTANCES] = {
+    TTYS_FOR_EACH_UART(TTYS_GEN, TTYS_GEN_NUMBER)
+};
+
+static const struct cmd_info ttys_instance_cmds[] = {
+    {
+        .name = "pm",
+        .func = cmd_ttys_pm,
+        .help = "Get/clear the measurements of an instance, usage: "
+                "ttys <n> pm [clear]",
+    },
+};
+
+static const struct cmd_info ttys_cmds[] = {
+    {
+        .name = "baud",
+        .func = cmd_ttys_baud,
+        .help = "Get/set stdout baud rate, usage: ttys baud [<rate> "
+                "[<confirm-timeout-ms>]] | ttys baud confirm",
+    },
+    TTYS_FOR_EACH_UART(TTYS_GEN, TTYS_GEN_CMDS)
+};
+
+SHELL_CLIENT(ttys,
+    .num_cmds = ARRAY_SIZE(ttys_cmds),
+    .cmds = ttys_cmds,
+    .log_level_ptr = NULL,
+    .num_pms = ARRAY_SIZE(ttys_pms),
+    .pms = ttys_pms,
+);
+
+//=============================================================================
+//                        Public (global) variables
+//=============================================================================
+// Shared with the backend (see ttys_port.h).
+struct ttys_state ttys_states[TTYS_NUM_INSTANCES] = {
+    TTYS_FOR_EACH_UART(TTYS_GEN, TTYS_GEN_STATE)
+};
+
+//=============================================================================
+//                        Public (global) functions
+//=============================================================================
+int32_t ttys_get_default_cfg(enum ttys_instance_id instance_id, struct ttys_cfg* cfg)
+{
+    if (cfg == NULL)
+        return SHELL_ERR_ARG;
+
+    memset(cfg, 0, sizeof(struct ttys_cfg));
+    cfg->create_stream = true;
+    cfg->send_cr_after_nl = true;
+    cfg->tx_mode = TTYS_TX_MODE_IRQ;
+    cfg->rx_mode = TTYS_RX_MODE_IRQ;
+    cfg->tx_policy = TTYS_TX_POLICY_DROP;
+    cfg->tx_block_timeout_ms = 100;
+    if (instance_id < TTYS_NUM_INSTANCES) {
+        cfg->rx_high_water = ttys_uart_info[instance_id].rx_buf_size / 2;
+        cfg->rx_low_water = ttys_uart_info[instance_id].rx_buf_size / 4;
+    }
+
+    return 0;
+}
+
+
+int32_t ttys_init(enum ttys_instance_id instance_id, struct ttys_cfg* cfg)
+{
+    const struct ttys_uart_info* ui;
+    int32_t rc;
+
+    // Input checking:
+    if (instance_id >= TTYS_NUM_INSTANCES)
+        return SHELL_ERR_BAD_INSTANCE;
+
+    if (cfg == NULL)
+        return SHELL_ERR_ARG;
+
+    ui = &ttys_uart_info[instance_id];
+    if ((cfg->hw_flow_control || cfg->sw_flow_control) &&
+        (cfg->rx_high_water > ui->rx_buf_size ||
+         cfg->rx_low_water >= cfg->rx_high_water))
+        return SHELL_ERR_ARG;
+
+    // Get corresponding state instance and initialize all values to zero:
+    struct ttys_state* state = &ttys_states[instance_id];
+    memset(state, 0, sizeof(struct ttys_state));
+
+    // Initialize all non-zero variables in the state structure:
+    state->cfg = *cfg;
+    state->fd = ui->fd;
+    ring_init(&state->tx_ring, ui->tx_buf, ui->tx_buf_size);
+    ring_init(&state->rx_ring, ui->rx_buf, ui->rx_buf_size);
+    state->rx_buf = ui->rx_buf;
+    state->rx_buf_size = ui->rx_buf_size;
+
+    if (state->cfg.create_stream) {
+        state->stream = ttys_hw_open_stream(instance_id);
+        if (state->stream != NULL)
+            setvbuf(state->stream, NULL, _IONBF, 0);
+    } else {
+        state->stream = NULL;
+    }
+
+    // Start the device (and its interrupts)
+    rc = ttys_hw_init(instance_id);
+    if (rc < 0)
+        return rc;
+    state->initialized = true;
+
+    // Disable I/O buffering for STDOUT stream, so that
+    // chars are sent out as soon as they are printed
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    return 0;
+}
+
+
+int32_t ttys_putc(enum ttys_instance_id instance_id, char c)
+{
+    if (instance_id >= TTYS_NUM_INSTANCES)
+        return SHELL_ERR_BAD_INSTANCE;
+
+    if (ttys_tx_queue(&ttys_states[instance_id], &c, 1, false) == 0)
+        return SHELL_ERR_BUF_OVERRUN;
+
+    return 0;
+}
+
+
+int32_t ttys_getc(enum ttys_instance_id instance_id, char* c)
+{
+    int32_t rc;
+
+    if (instance_id >= TTYS_NUM_INSTANCES)
+        return SHELL_ERR_BAD_INSTANCE;
+
+    ttys_baud_check_confirm(instance_id);
+    ttys_hw_rx_poll(instance_id);
+    rc = ring_getc(&ttys_states[instance_id].rx_ring, c);
+    ttys_rx_check_low_water(&ttys_states[instance_id]);
+
+    return rc;
+}
+
+
+int32_t ttys_write(enum ttys_instance_id instance_id, const char* buf,
+                   uint32_t len)
+{
+    if (instance_id >= TTYS_NUM_INSTANCES)
+        return SHELL_ERR_BAD_INSTANCE;
+
+    struct ttys_state* state = &ttys_states[instance_id];
+
+    return ttys_tx_queue(state, buf, len, state->cfg.send_cr_after_nl);
+}
+
+
+int32_t ttys_tx_reserve(enum ttys_instance_id instance_id, char** ptr)
+{
+    if (instance_id >= TTYS_NUM_INSTANCES)
+        return SHELL_ERR_BAD_INSTANCE;
+
+    if (ptr == NULL)
+        return SHELL_ERR_ARG;
+
+    struct ttys_state* state = &ttys_states[instance_id];
+
+    // Report previous drops first, to keep the output in order.
+    if (state->tx_dropped != 0 && !ttys_tx_put_drop_marker(state)) {
+        *ptr = NULL;
+        return 0;
+    }
+
+    return ring_put_span(&state->tx_ring, ptr);
+}
+
+
+int32_t ttys_tx_commit(enum ttys_instance_id instance_id, uint32_t len)
+{
+    uint32_t count;
+
+    if (instance_id >= TTYS_NUM_INSTANCES)
+        return SHELL_ERR_BAD_INSTANCE;
+
+    struct ttys_state* state = &ttys_states[instance_id];
+    char* ptr;
+
+    if (len == 0)
+        return 0;
+    if (len > ring_put_span(&state->tx_ring, &ptr))
+        return SHELL_ERR_ARG;
+
+    ring_put_commit(&state->tx_ring, len);
+
+    count = ring_count(&state->tx_ring);
+    if (count > state->pm.tx_high_water)
+        state->pm.tx_high_water = count;
+
+    ttys_hw_tx_kick(instance_id);
+
+    return 0;
+}
+
+
+int32_t ttys_flush(enum ttys_instance_id instance_id, uint32_t timeout_ms)
+{
+    if (instance_id >= TTYS_NUM_INSTANCES)
+        return SHELL_ERR_BAD_INSTANCE;
+
+    if (!ttys_states[instance_id].initialized)
+        return SHELL_ERR_STATE;
+
+    return ttys_tx_drain(&ttys_states[instance_id], timeout_ms);
+}
+
+
+int32_t ttys_read(enum ttys_instance_id instance_id, char* buf, uint32_t len)
+{
+    int32_t rc;
+
+    if (instance_id >= TTYS_NUM_INSTANCES)
+        return SHELL_ERR_BAD_INSTANCE;
+
+    ttys_baud_check_confirm(instance_id);
+    ttys_hw_rx_poll(instance_id);
+    rc = ring_read(&ttys_states[instance_id].rx_ring, buf, len);
+    ttys_rx_check_low_water(&ttys_states[instance_id]);
+
+    return rc;
+}
+
+
+int ttys_get_fd(enum ttys_instance_id instance_id)
+{
+    if (instance_id >= TTYS_NUM_INSTANCES)
+        return SHELL_ERR_ARG;
+
+    if (ttys_states[instance_id].fd >= 0)
+        return ttys_states[instance_id].fd;
+
+    return SHELL_ERR_RESOURCE;
+}
+
+
+FILE* ttys_get_stream(enum ttys_instance_id instance_id)
+{
+    if (instance_id >= TTYS_NUM_INSTANCES)
+        return NULL;
+
+    return ttys_states[instance_id].stream;
+}
+
+
+int32_t ttys_get_baud(enum ttys_instance_id instance_id)
+{
+    if (instance_id >= TTYS_NUM_INSTANCES)
+        return SHELL_ERR_BAD_INSTANCE;
+
+    return ttys_hw_get_baud(instance_id);
+}
+
+
+int32_t ttys_set_baud(enum ttys_instance_id instance_id, uint32_t baud,
+                      uint32_t confirm_timeout_ms)
+{
+    int32_t old_baud;
+    int32_t rc;
+
+    if (instance_id >= TTYS_NUM_INSTANCES)
+        return SHELL_ERR_BAD_INSTANCE;
+
+    struct ttys_state* state = &ttys_states[instance_id];
+
+    if (!state->initialized)
+        return SHELL_ERR_STATE;
+
+    old_baud = ttys_get_baud(instance_id);
+    rc = ttys_apply_baud(instance_id, baud);
+    if (rc < 0)
+        return rc;
+
+    // Keep the rate to go back to when a tentative change is done on top of
+    // another one.
+    if (confirm_timeout_ms == 0) {
+        state->baud_revert = 0;
+    } else {
+        if (state->baud_revert == 0)
+            state->baud_revert = old_baud > 0 ? old_baud : 0;
+        state->baud_confirm_start_ms = port_get_ms();
+        state->baud_confirm_timeout_ms = confirm_timeout_ms;
+    }
+
+    return 0;
+}
+
+
+int32_t ttys_confirm_baud(enum ttys_instance_id instance_id)
+{
+    if (instance_id >= TTYS_NUM_INSTANCES)
+        return SHELL_ERR_BAD_INSTANCE;
+
+    if (ttys_states[instance_id].baud_revert == 0)
+        return SHELL_ERR_STATE;
+
+    ttys_states[instance_id].baud_revert = 0;
+
+    return 0;
+}
+
+
+void ttys_rx_check_high_water(struct ttys_state* state)
+{
+    enum ttys_instance_id instance_id = state - ttys_states;
+
+    // Only done with flow control. With RTS/CTS, the backend stops reading
+    // the device, so the next character stays in the UART and the hardware
+    // deasserts RTS. With XON/XOFF, XOFF is sent and reception goes on.
+    // Characters already on their way are still received; they fit in the
+    // buffer above the high water mark.
+    if ((!state->cfg.hw_flow_control && !state->cfg.sw_flow_control) ||
+        state->rx_throttled ||
+        ring_count(&state->rx_ring) < state->cfg.rx_high_water)
+        return;
+
+    if (state->cfg.hw_flow_control)
+        ttys_hw_rx_pause(instance_id, true);
+    if (state->cfg.sw_flow_control)
+        ttys_tx_flow_char(state, XOFF);
+    state->rx_throttled = true;
+    state->pm.rx_throttles++;
+}
+
+
+enum ttys_instance_id ttys_fd_to_instance(int fd)
+{
+    if (fd < 0 || fd > TTYS_MAX_FD || ttys_fd_map[fd] == 0)
+        return TTYS_NUM_INSTANCES;
+
+    return (enum ttys_instance_id)(ttys_fd_map[fd] - 1);
+}
+
+//=============================================================================
+//                    Private (static) functions
+//=============================================================================
+/**
+ * @brief Queue characters for transmission, applying the TX overrun policy.
+ *
+ * @param[in] state The ttys instance state.
+ * @param[in] buf Characters to transmit.
+ * @param[in] len Number of characters to transmit.
+ * @param[in] expand_nl Insert a carriage return after each new line.
+ *
+ * @return Number of characters from buf queued.
+ *
+ * With the drop and block policies, a call that queues nothing counts all its
+ * characters as dropped. Partially queued calls don't count the rest, as the
+ * caller is told about it (e.g. the stdio library retries with the rest).
+ * This way each lost character is counted exactly once.
+ */
+static int32_t ttys_tx_queue(struct ttys_state* state, const char* buf,
+                             uint32_t len, bool expand_nl)
+{
+    enum ttys_instance_id instance_id = state - ttys_states;
+    uint32_t done = 0;
+    uint32_t start_ms;
+    uint32_t count;
+
+    // Report previous drops first, to keep the output in order.
+    if (state->tx_dropped != 0 && !ttys_tx_put_drop_marker(state)) {
+        state->tx_dropped += len;
+        state->pm.tx_overruns += len;
+        return 0;
+    }
+
+    switch (state->cfg.tx_policy) {
+        case TTYS_TX_POLICY_DROP: {
+            // Drop whole blocks, rather than queueing their beginning. Blocks
+            // larger than the buffer are queued partially, when it's empty.
+            uint32_t needed = len;
+            const char* p = buf;
+            if (expand_nl) {
+                while ((p = memchr(p, '\n', buf + len - p)) != NULL) {
+                    needed++;
+                    p++;
+                }
+            }
+            if (needed <= ring_space(&state->tx_ring) ||
+                ring_count(&state->tx_ring) == 0)
+                done = ttys_tx_copy(state, buf, len, expand_nl);
+            break;
+        }
+        case TTYS_TX_POLICY_BLOCK:
+            done = ttys_tx_copy(state, buf, len, expand_nl);
+            if (done == len)
+                break;
+
+            // Only wait if the buffer can drain: not in an interrupt handler,
+            // nor with interrupts masked, nor before the device is started.
+            if (!port_can_wait() || !state->initialized)
+                break;
+
+            start_ms = port_get_ms();
+            while (done < len &&
+                   port_get_ms() - start_ms < state->cfg.tx_block_timeout_ms) {
+                ttys_hw_tx_kick(instance_id);
+                done += ttys_tx_copy(state, buf + done, len - done, expand_nl);
+            }
+            break;
+        case TTYS_TX_POLICY_OVERWRITE:
+            done = ttys_tx_copy(state, buf, len, expand_nl);
+            while (done < len) {
+                // Make room for the rest (plus a possible carriage return).
+                ttys_tx_discard(state, len - done + 1);
+                done += ttys_tx_copy(state, buf + done, len - done, expand_nl);
+            }
+            break;
+    }
+
+    if (done == 0) {
+        state->tx_dropped += len;
+        state->pm.tx_overruns += len;
+    }
+
+    count = ring_count(&state->tx_ring);
+    if (count > state->pm.tx_high_water)
+        state->pm.tx_high_water = count;
+
+    if (done != 0)
+        ttys_hw_tx_kick(instance_id);
+
+    return done;
+}
+
+
+/**
+ * @brief Copy characters into the TX buffer, as many as fit.
+ *
+ * @param[in] state The ttys instance state.
+ * @param[in] buf Characters to transmit.
+ * @param[in] len Number of characters to transmit.
+ * @param[in] expand_nl Insert a carriage return after each new line.
+ *
+ * @return Number of characters from buf copied.
+ *
+ * The data is copied in segments ending at each new line, so that a carriage
+ * return can be inserted after it. Without CR insertion there is a single
+ * segment. A new line is only taken if its carriage return also fits.
+ */
+static uint32_t ttys_tx_copy(struct ttys_state* state, const char* buf,
+                             uint32_t len, bool expand_nl)
+{
+    uint32_t done = 0;
+
+    while (done < len) {
+        uint32_t seg_len = len - done;
+        uint32_t space = ring_space(&state->tx_ring);
+        const char* nl = NULL;
+
+        if (expand_nl) {
+            nl = memchr(buf + done, '\n', seg_len);
+            if (nl != NULL)
+                seg_len = nl - (buf + done) + 1;
+        }
+
+        if (nl != NULL && space < seg_len + 1) {
+            done += ring_write(&state->tx_ring, buf + done,
+                               space < seg_len ? space : seg_len - 1);
+            break;
+        }
+
+        done += ring_write(&state->tx_ring, buf + done, seg_len);
+        if (nl == NULL)
+            break;
+        ring_putc(&state->tx_ring, '\r');
+    }
+
+    return done;
+}
+
+
+/**
+ * @brief Put the "[N bytes dropped]" marker in the TX buffer.
+ *
+ * @param[in] state The ttys instance state.
+ *
+ * @return True if the marker was queued (and the drop count reset).
+ */
+static bool ttys_tx_put_drop_marker(struct ttys_state* state)
+{
+    char marker[32];
+    int len = snprintf(marker, sizeof(marker), "[%lu bytes dropped]",
+                       (unsigned long)state->tx_dropped);
+
+    if (ring_space(&state->tx_ring) < (uint32_t)len)
+        return false;
+
+    ring_write(&state->tx_ring, marker, len);
+    state->tx_dropped = 0;
+
+    return true;
+}
+
+
+/**
+ * @brief Discard the oldest characters of the TX buffer.
+ *
+ * @param[in] state The ttys instance state.
+ * @param[in] len Number of characters to discard.
+ *
+ * @return Number of characters discarded.
+ *
+ * This moves the consumer side of the TX ring, so it is done with interrupts
+ * masked. A transmission in progress (e.g. DMA transfer) is stopped first, as
+ * its characters would otherwise be overwritten while being sent. The caller
+ * restarts transmission.
+ */
+static uint32_t ttys_tx_discard(struct ttys_state* state, uint32_t len)
+{
+    uint32_t irq_state = port_irq_disable();
+    uint32_t count;
+
+    ttys_hw_tx_abort(state - ttys_states);
+
+    count = ring_count(&state->tx_ring);
+    if (len > count)
+        len = count;
+    ring_get_commit(&state->tx_ring, len);
+    state->pm.tx_overruns += len;
+
+    port_irq_restore(irq_state);
+
+    return len;
+}
+
+
+/**
+ * @brief Resume reception if the RX buffer drained to the low water mark.
+ *
+ * @param[in] state The ttys instance state.
+ *
+ * Done with interrupts masked, so that the interrupt handlers don't pause
+ * reception again in the middle of it.
+ *
+ * @note Called by the reader, after taking characters from the RX buffer.
+ */
+static void ttys_rx_check_low_water(struct ttys_state* state)
+{
+    uint32_t irq_state;
+
+    if (!state->rx_throttled ||
+        ring_count(&state->rx_ring) > state->cfg.rx_low_water)
+        return;
+
+    irq_state = port_irq_disable();
+
+    state->rx_throttled = false;
+    if (state->cfg.hw_flow_control)
+        ttys_hw_rx_pause(state - ttys_states, false);
+    if (state->cfg.sw_flow_control)
+        ttys_tx_flow_char(state, XON);
+
+    port_irq_restore(irq_state);
+}
+
+
+/**
+ * @brief Send a flow control character ahead of the TX buffer.
+ *
+ * @param[in] state The ttys instance state.
+ * @param[in] c The character (XON or XOFF).
+ *
+ * The backend sends the character as soon as the device can take it, e.g.
+ * after the DMA transfer in progress. A character not sent yet is replaced,
+ * as only the last one matters.
+ *
+ * @note Called from the interrupt handlers, or with interrupts masked.
+ */
+static void ttys_tx_flow_char(struct ttys_state* state, char c)
+{
+    state->tx_flow_char = c;
+    ttys_hw_tx_kick(state - ttys_states);
+}
+
+
+/**
+ * @brief Wait until all the queued characters have been sent.
+ *
+ * @param[in] state The ttys instance state.
+ * @param[in] timeout_ms Maximum wait.
+ *
+ * @return 0 for success, else a "ERR" value (SHELL_ERR_STATE if called from an
+ *         interrupt handler or with interrupts masked, SHELL_ERR_RESOURCE on
+ *         timeout).
+ *
+ * This includes the last character, up to when it has left the device.
+ */
+static int32_t ttys_tx_drain(struct ttys_state* state, uint32_t timeout_ms)
+{
+    enum ttys_instance_id instance_id = state - ttys_states;
+    uint32_t start_ms = port_get_ms();
+
+    if (!port_can_wait())
+        return SHELL_ERR_STATE;
+
+    while (ring_count(&state->tx_ring) != 0 || state->tx_flow_char != 0 ||
+           !ttys_hw_tx_done(instance_id)) {
+        if (port_get_ms() - start_ms >= timeout_ms)
+            return SHELL_ERR_RESOURCE;
+        ttys_hw_tx_kick(instance_id);
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Program a new baud rate in the device.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ * @param[in] baud The new baud rate.
+ *
+ * @return 0 for success, else a "ERR" value (SHELL_ERR_ARG if the rate is not
+ *         supported). See code for details.
+ *
+ * The queued characters are sent at the current rate first.
+ */
+static int32_t ttys_apply_baud(enum ttys_instance_id instance_id,
+                               uint32_t baud)
+{
+    int32_t rc;
+
+    if (baud == 0)
+        return SHELL_ERR_ARG;
+
+    rc = ttys_tx_drain(&ttys_states[instance_id], TTYS_BAUD_DRAIN_TIMEOUT_MS);
+    if (rc < 0)
+        return rc;
+
+    return ttys_hw_set_baud(instance_id, baud);
+}
+
+
+/**
+ * @brief Restore the previous baud rate if a tentative change timed out.
+ *
+ * @param[in] instance_id Identifies the ttys instance.
+ */
+static void ttys_baud_check_confirm(enum ttys_instance_id instance_id)
+{
+    struct ttys_state* state = &ttys_states[instance_id];
+    uint32_t baud = state->baud_revert;
+
+    if (baud == 0 ||
+        port_get_ms() - state->baud_confirm_start_ms <
+            state->baud_confirm_timeout_ms)
+        return;
+
+    // Not called from interrupt handlers, but possibly with interrupts
+    // masked; then the restore is retried later.
+    if (ttys_apply_baud(instance_id, baud) == 0)
+        state->baud_revert = 0;
+}
+
+
+/**
+ * @brief Console command function for "ttys baud".
+ *
+ * @param[in] argc Number of arguments, including "ttys".
+ * @param[in] argv Argument values, including "ttys".
+ *
+ * @return 0 for success, else a "ERR" value. See code for details.
+ *
+ * Command usage: ttys baud [<rate> [<confirm-timeout-ms>]] | ttys baud confirm
+ *
+ * The command applies to the stdout instance, which is normally the console.
+ * The reply is sent at the current rate, before the change.
+ */
+static int32_t cmd_ttys_baud(int32_t argc, const char** argv)
+{
+    enum ttys_instance_id instance_id = ttys_fd_to_instance(STDOUT_FILENO);
+    struct cmd_arg_val arg_vals[2];
+    int32_t num_args;
+    int32_t rc;
+
+    if (instance_id >= TTYS_NUM_INSTANCES) {
+        printf("No ttys instance on stdout\n");
+        return SHELL_ERR_RESOURCE;
+    }
+
+    if (argc == 3 && strcasecmp(argv[2], "confirm") == 0) {
+        rc = ttys_confirm_baud(instance_id);
+        if (rc < 0)
+            printf("No baud rate change to confirm\n");
+        else
+            printf("Baud rate %ld confirmed\n",
+                   (long)ttys_get_baud(instance_id));
+        return rc;
+    }
+
+    num_args = cmd_parse_args(argc-2, argv+2, "[u[u]]", arg_vals);
+    if (num_args < 0)
+        return SHELL_ERR_BAD_CMD;
+
+    if (num_args == 0) {
+        printf("Baud rate %ld\n", (long)ttys_get_baud(instance_id));
+        return 0;
+    }
+
+    if (num_args == 1)
+        arg_vals[1].val.u = 0;
+    if (num_args == 2 && arg_vals[1].val.u == 0) {
+        printf("Invalid confirm timeout '%s'\n", argv[3]);
+        return SHELL_ERR_ARG;
+    }
+
+    if (arg_vals[1].val.u == 0)
+        printf("Switching to %lu baud\n",
+               (unsigned long)arg_vals[0].val.u);
+    else
+        printf("Switching to %lu baud, confirm within %lu ms\n",
+               (unsigned long)arg_vals[0].val.u,
+               (unsigned long)arg_vals[1].val.u);
+
+    rc = ttys_set_baud(instance_id, arg_vals[0].val.u, arg_vals[1].val.u);
+    if (rc < 0)
+        printf("Failed to set baud rate %lu (error %ld)\n",
+               (unsigned long)arg_vals[0].val.u, (long)rc);
+
+    return rc;
+}
+
+
+/**
+ * @brief Console command function for "ttys <n> pm".
+ *
+ * @param[in] argc Number of arguments, including "ttys", <n> and "pm".
+ * @param[in] argv Argument values, including "ttys", <n> and "pm".
+ *
+ * @return 0 for success, else a "ERR" value. See code for details.
+ *
+ * Command usage: ttys <n> pm [clear]
+ *
+ * Gets or clears the measurements of instance <n> (those of "ttys pm").
+ */
+static int32_t cmd_ttys_pm(int32_t argc, const char** argv)
+{
+    enum ttys_instance_id instance_id;
+    const struct cmd_pm_info* pms;
+    bool clear = argc == 4 && strcasecmp(argv[3], "clear") == 0;
+
+    if (argc > 4 || (argc == 4 && !clear)) {
+        printf("Usage: ttys <n> pm [clear]\n");
+        return SHELL_ERR_BAD_CMD;
+    }
+
+    // The cmd module passes the full instance number in argv[1].
+    for (instance_id = 0; instance_id < TTYS_NUM_INSTANCES; instance_id++) {
+        if (strcmp(argv[1], ttys_numbers[instance_id]) == 0)
+            break;
+    }
+    if (instance_id >= TTYS_NUM_INSTANCES)
+        return SHELL_ERR_BAD_INSTANCE;
+
+    pms = &ttys_pms[instance_id * TTYS_NUM_PM_COUNTERS];
+    for (int32_t idx = 0; idx < TTYS_NUM_PM_COUNTERS; idx++) {
+        if (clear) {
+            if (!pms[idx].gauge)
+                *pms[idx].val = 0;
+        } else {
+            printf("ttys %s = %lu\n", pms[idx].name,
+                   (unsigned long)*pms[idx].val);
+        }
+    }
+
+    return 0;
+}
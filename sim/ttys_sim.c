@@ -0,0 +1,735 @@
+/**
+ * @brief Load test of ttys on the simulated USART (see port_sim.h).
+ *
+ * Runs the ttys interrupt handler and buffers of UART1 at the character
+ * timings of a real line, with a main loop that services ttys every poll
+ * period, and prints one JSON object per scenario:
+ * - tx: the main loop queues as much as fits in the TX buffer. Reports the
+ *   achieved throughput against the line rate.
+ * - rx: the peer sends back to back, the main loop reads everything. Reports
+ *   the characters lost (UART overrun or full RX buffer).
+ * - echo: both at once, the main loop sends back what it reads.
+ * - rx-limit: the longest poll period with no RX loss (binary search).
+ *
+ * Check scenarios, not part of "all", verify the data and exit with 1 if it
+ * is not right:
+ * - tx-dma: the TX DMA mode (built with TTYS_UART1_DMA, the default). Bursts
+ *   of numbered characters, some of them from an idle line, go through the TX
+ *   buffer many times over, so the DMA restarts at every wrap of the buffer
+ *   and after each idle time. The peer checks every character.
+ * - paste: the console on UART1, with XON/XOFF flow control and blocking
+ *   output (the console's stdout goes to the UART). The peer pastes numbered
+ *   command lines ending in CR, LF and CR LF, as fast as XON/XOFF lets it,
+ *   with a few characters still arriving after XOFF. Checks that every line
+ *   ran once and in order, that nothing was lost on either side, and that
+ *   XOFF was sent (the echo is longer than the input, so the console falls
+ *   behind).
+ *
+ * Build (from the repository root), with the buffer sizes under test:
+ *
+ *     gcc -O2 -DSHELL_PORT_SIM -Ishell/include \
+ *         -DTTYS_UART1_RX_BUF_SIZE=128 -DTTYS_UART1_TX_BUF_SIZE=1024 \
+ *         shell/[a-z]*.c shell/port/[a-z]*.c sim/ttys_sim.c -o ttys_sim
+ *
+ * Usage: ttys_sim [-s scenario] [-b baud] [-p poll-us] [-n bytes] [-r]
+ * (-r enables RTS/CTS flow control). tools/ttys_sim_sweep.py builds and runs
+ * it over a range of buffer sizes.
+ */
+
+#define _GNU_SOURCE  // fopencookie()
+
+#include <getopt.h>
+#include <stdlib.h>
+
+#include "shell.h"
+#include "ttys_port.h"
+
+//=============================================================================
+//                         Preprocessor Constants
+//=============================================================================
+#define SIM_INSTANCE TTYS_INSTANCE_UART1
+#define SIM_UART USART1
+
+// Give up after this much virtual time (seconds) without progress
+#define SIM_STALL_S 1
+
+// Lines pasted in the paste scenario
+#define SIM_PASTE_LINES 10000
+
+// Characters the peer still sends after XOFF
+#define SIM_PASTE_XOFF_LAG 16
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+struct sim_test {
+    const char* scenario;
+    uint32_t baud;
+    uint32_t poll_us;
+    uint32_t bytes;
+    bool hw_flow_control;
+    bool sw_flow_control;
+    bool tx_dma;
+    bool tx_block;
+};
+
+/**
+ * The peer of the paste scenario
+ */
+struct sim_paste_peer {
+    uint32_t line;          // Next line to queue
+    uint32_t line_pos;      // Characters of it queued
+    uint32_t line_len;
+    uint32_t sent;          // Characters queued
+    uint32_t echoed_lines;  // New lines received from the console
+    char line_bfr[32];
+};
+
+struct sim_result {
+    uint64_t cycles;
+    uint32_t tx_bytes;
+    uint32_t rx_bytes;
+    uint32_t rx_lost;
+    uint32_t rx_ring_drops;
+    uint32_t irq_entries;
+    uint32_t tx_high_water;
+    uint32_t rx_high_water;
+    bool stalled;
+};
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static int32_t sim_setup(const struct sim_test* test);
+static void sim_run_test(const struct sim_test* test, bool do_tx, bool do_rx,
+                         bool echo, struct sim_result* result);
+static uint32_t sim_tx(uint32_t pos, uint32_t len);
+static char sim_data(uint32_t pos);
+static void sim_print(const struct sim_test* test,
+                      const struct sim_result* result);
+static void sim_rx_limit(struct sim_test* test);
+static bool sim_tx_dma(struct sim_test* test);
+static bool sim_paste(struct sim_test* test);
+static void sim_paste_peer_run(void);
+static uint32_t sim_paste_line(uint32_t num, char* bfr);
+static int32_t sim_paste_cmd(int32_t argc, const char** argv);
+static ssize_t sim_console_write(void* cookie, const char* buf, size_t size);
+
+//=============================================================================
+//                         Private (static) variables
+//=============================================================================
+// Lines run by the paste scenario's command, and those not in sequence.
+static uint32_t sim_paste_runs;
+static uint32_t sim_paste_bad;
+
+static struct sim_paste_peer sim_paste_peer;
+
+static const struct cmd_info sim_paste_cmds[] = {
+    { .name = "line", .func = sim_paste_cmd, .help = "Pasted line" },
+};
+
+static const struct cmd_client_info sim_paste_client = {
+    .name = "paste",
+    .num_cmds = ARRAY_SIZE(sim_paste_cmds),
+    .cmds = sim_paste_cmds,
+};
+
+//=============================================================================
+//                        Public (global) functions
+//=============================================================================
+int main(int argc, char** argv)
+{
+    struct sim_test test = {
+        .scenario = "all",
+        .baud = 115200,
+        .poll_us = 100,
+        .bytes = 20000,
+        .hw_flow_control = false,
+        .sw_flow_control = false,
+        .tx_dma = false,
+        .tx_block = false,
+    };
+    struct sim_result result;
+    bool all;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:b:p:n:r")) != -1) {
+        switch (opt) {
+            case 's': test.scenario = optarg; break;
+            case 'b': test.baud = strtoul(optarg, NULL, 0); break;
+            case 'p': test.poll_us = strtoul(optarg, NULL, 0); break;
+            case 'n': test.bytes = strtoul(optarg, NULL, 0); break;
+            case 'r': test.hw_flow_control = true; break;
+            default:
+                fprintf(stderr, "Usage: %s [-s tx|rx|echo|rx-limit|all|"
+                        "tx-dma|paste] [-b baud] [-p poll-us] [-n bytes] "
+                        "[-r]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+    all = strcmp(test.scenario, "all") == 0;
+
+    if (all || strcmp(test.scenario, "tx") == 0) {
+        test.scenario = "tx";
+        if (sim_setup(&test) < 0)
+            return 1;
+        sim_run_test(&test, true, false, false, &result);
+        sim_print(&test, &result);
+    }
+    if (all || strcmp(test.scenario, "rx") == 0) {
+        test.scenario = "rx";
+        if (sim_setup(&test) < 0)
+            return 1;
+        sim_run_test(&test, false, true, false, &result);
+        sim_print(&test, &result);
+    }
+    if (all || strcmp(test.scenario, "echo") == 0) {
+        test.scenario = "echo";
+        if (sim_setup(&test) < 0)
+            return 1;
+        sim_run_test(&test, false, true, true, &result);
+        sim_print(&test, &result);
+    }
+    if (all || strcmp(test.scenario, "rx-limit") == 0) {
+        test.scenario = "rx-limit";
+        sim_rx_limit(&test);
+    }
+    if (strcmp(test.scenario, "tx-dma") == 0 && !sim_tx_dma(&test))
+        return 1;
+    if (strcmp(test.scenario, "paste") == 0 && !sim_paste(&test))
+        return 1;
+
+    return 0;
+}
+
+//=============================================================================
+//                       Private (static) functions
+//=============================================================================
+/**
+ * @brief Reset the simulation and start ttys on the simulated UART.
+ *
+ * @param[in] test The test parameters.
+ *
+ * @return 0 for success, else a "ERR" value.
+ *
+ * The UART is set up like the board initialization does (8N1, transmitter and
+ * receiver enabled), then ttys sets the baud rate. ttys does not create a
+ * stream, so the results go to the real stdout.
+ */
+static int32_t sim_setup(const struct sim_test* test)
+{
+    struct ttys_cfg cfg;
+    int32_t rc;
+
+    sim_init(NULL);
+    WRITE_REG(SIM_UART->BRR, HAL_RCC_GetPCLK2Freq() / 115200);
+    WRITE_REG(SIM_UART->CR1, USART_CR1_UE | USART_CR1_TE | USART_CR1_RE);
+
+    cmd_init(NULL);
+    ttys_get_default_cfg(SIM_INSTANCE, &cfg);
+    cfg.create_stream = false;
+    cfg.send_cr_after_nl = false;
+    cfg.hw_flow_control = test->hw_flow_control;
+    cfg.sw_flow_control = test->sw_flow_control;
+    if (test->tx_dma)
+        cfg.tx_mode = TTYS_TX_MODE_DMA;
+    if (test->tx_block)
+        cfg.tx_policy = TTYS_TX_POLICY_BLOCK;
+    rc = ttys_init(SIM_INSTANCE, &cfg);
+    if (rc == 0)
+        rc = ttys_set_baud(SIM_INSTANCE, test->baud, 0);
+    if (rc < 0)
+        fprintf(stderr, "ttys setup failed (%d)\n", (int)rc);
+
+    return rc;
+}
+
+
+/**
+ * @brief Run a scenario: the main loop services ttys every poll period, until
+ *        all the bytes went through.
+ *
+ * @param[in] test The test parameters.
+ * @param[in] do_tx Write test->bytes to ttys.
+ * @param[in] do_rx Have the peer send test->bytes, and read them.
+ * @param[in] echo Write back what is read.
+ * @param[out] result The measurements.
+ */
+static void sim_run_test(const struct sim_test* test, bool do_tx, bool do_rx,
+                         bool echo, struct sim_result* result)
+{
+    struct ttys_state* state = &ttys_states[SIM_INSTANCE];
+    struct sim_line_stats stats;
+    uint64_t poll_cycles = (uint64_t)HAL_RCC_GetSysClockFreq() / 1000000 *
+                           test->poll_us;
+    uint64_t stall_cycles = (uint64_t)HAL_RCC_GetSysClockFreq() * SIM_STALL_S;
+    uint64_t progress_cycles = 0;
+    uint32_t progress = 0;
+    uint32_t tx_queued = 0;
+    uint32_t rx_sent = 0;
+    uint32_t rx_read = 0;
+    char data[256];
+    uint32_t echo_len = 0;
+    int32_t rc;
+
+    memset(result, 0, sizeof(struct sim_result));
+    memset(data, 'x', sizeof(data));
+
+    for (;;) {
+        uint32_t len;
+        bool rx_done;
+        bool tx_done;
+
+        // Peer side: keep its send queue filled, and take what it received.
+        if (do_rx && rx_sent < test->bytes) {
+            len = test->bytes - rx_sent;
+            if (len > sizeof(data))
+                len = sizeof(data);
+            rx_sent += sim_line_send(SIM_UART, data, len);
+        }
+        sim_line_recv(SIM_UART, NULL, SIM_LINE_BUF_SIZE);
+
+        // Done when every character went through (or was lost).
+        sim_line_get_stats(SIM_UART, &stats);
+        rx_done = !do_rx || (rx_sent == test->bytes &&
+                             stats.rx_chars == rx_sent &&
+                             ring_count(&state->rx_ring) == 0);
+        tx_done = echo_len == 0 && ring_count(&state->tx_ring) == 0 &&
+                  stats.tx_chars >= (do_tx ? test->bytes : echo ? rx_read : 0);
+        if (rx_done && tx_done)
+            break;
+
+        if (stats.tx_chars + stats.rx_chars != progress) {
+            progress = stats.tx_chars + stats.rx_chars;
+            progress_cycles = sim_get_cycles();
+        } else if (sim_get_cycles() - progress_cycles > stall_cycles) {
+            result->stalled = true;
+            break;
+        }
+
+        // Main loop: other work, then service ttys.
+        sim_run(poll_cycles);
+
+        if (do_rx) {
+            do {
+                rc = ttys_read(SIM_INSTANCE, data, sizeof(data));
+                if (rc <= 0)
+                    break;
+                rx_read += rc;
+                if (echo)
+                    echo_len += rc;
+            } while (rc == sizeof(data));
+        }
+        if (echo_len > 0)
+            echo_len -= sim_tx(0, echo_len);
+        if (do_tx && tx_queued < test->bytes)
+            tx_queued += sim_tx(tx_queued, test->bytes - tx_queued);
+    }
+
+    sim_line_get_stats(SIM_UART, &stats);
+    result->cycles = sim_get_cycles();
+    result->tx_bytes = stats.tx_chars;
+    result->rx_bytes = rx_read;
+    result->rx_lost = stats.rx_lost;
+    result->rx_ring_drops = state->pm.rx_overruns;
+    result->irq_entries = stats.irq_entries;
+    result->tx_high_water = state->pm.tx_high_water;
+    result->rx_high_water = state->pm.rx_high_water;
+}
+
+
+/**
+ * @brief Queue characters for transmission, as many as fit.
+ *
+ * @param[in] pos Position of the first character in the test data.
+ * @param[in] len Number of characters wanted.
+ *
+ * @return Number of characters queued.
+ *
+ * The TX buffer space is reserved directly, so that a full buffer is not an
+ * overrun (no TX policy applies).
+ */
+static uint32_t sim_tx(uint32_t pos, uint32_t len)
+{
+    uint32_t done = 0;
+    int32_t space;
+    char* ptr;
+
+    while (done < len &&
+           (space = ttys_tx_reserve(SIM_INSTANCE, &ptr)) > 0) {
+        if ((uint32_t)space > len - done)
+            space = len - done;
+        for (int32_t idx = 0; idx < space; idx++)
+            ptr[idx] = sim_data(pos + done + idx);
+        ttys_tx_commit(SIM_INSTANCE, space);
+        done += space;
+    }
+
+    return done;
+}
+
+
+/**
+ * @brief Get a character of the test data.
+ *
+ * @param[in] pos Its position.
+ *
+ * @return The character. The sequence does not repeat with the period of a
+ *         power of two buffer size, so a misplaced region shows.
+ */
+static char sim_data(uint32_t pos)
+{
+    return (char)(pos + pos / 251);
+}
+
+
+/**
+ * @brief Print the result of a scenario as a JSON object (one line).
+ *
+ * @param[in] test The test parameters.
+ * @param[in] result The measurements.
+ */
+static void sim_print(const struct sim_test* test,
+                      const struct sim_result* result)
+{
+    double seconds = (double)result->cycles / HAL_RCC_GetSysClockFreq();
+    uint32_t bytes = result->tx_bytes > result->rx_bytes ? result->tx_bytes :
+                                                           result->rx_bytes;
+
+    printf("{\"scenario\": \"%s\", \"baud\": %u, \"poll_us\": %u, "
+           "\"hw_flow_control\": %s, \"rx_buf_size\": %u, "
+           "\"tx_buf_size\": %u, \"seconds\": %.6f, "
+           "\"bytes_per_s\": %.0f, \"line_bytes_per_s\": %.0f, "
+           "\"tx_bytes\": %u, \"rx_bytes\": %u, \"rx_lost\": %u, "
+           "\"rx_ring_drops\": %u, \"irq_entries\": %u, "
+           "\"irqs_per_byte\": %.3f, \"tx_high_water\": %u, "
+           "\"rx_high_water\": %u, \"stalled\": %s}\n",
+           test->scenario, (unsigned)test->baud, (unsigned)test->poll_us,
+           test->hw_flow_control ? "true" : "false",
+           (unsigned)TTYS_UART1_RX_BUF_SIZE, (unsigned)TTYS_UART1_TX_BUF_SIZE,
+           seconds, seconds > 0 ? bytes / seconds : 0.0,
+           test->baud / 10.0,
+           (unsigned)result->tx_bytes, (unsigned)result->rx_bytes,
+           (unsigned)result->rx_lost,
+           (unsigned)result->rx_ring_drops, (unsigned)result->irq_entries,
+           bytes > 0 ? (double)result->irq_entries / bytes : 0.0,
+           (unsigned)result->tx_high_water, (unsigned)result->rx_high_water,
+           result->stalled ? "true" : "false");
+}
+
+
+/**
+ * @brief Find the longest poll period with no RX loss.
+ *
+ * @param[in,out] test The test parameters (poll_us is changed).
+ *
+ * Loss only grows with the poll period, so a binary search over it is enough.
+ * The result is printed like the other scenarios, with the poll period found.
+ */
+static void sim_rx_limit(struct sim_test* test)
+{
+    struct sim_result result;
+    uint32_t good = 0;
+    uint32_t bad = 1000000;
+
+    while (bad - good > 1) {
+        test->poll_us = good + (bad - good) / 2;
+        if (sim_setup(test) < 0)
+            return;
+        sim_run_test(test, false, true, false, &result);
+        if (result.rx_lost + result.rx_ring_drops == 0 && !result.stalled)
+            good = test->poll_us;
+        else
+            bad = test->poll_us;
+    }
+
+    test->poll_us = good;
+    if (sim_setup(test) < 0)
+        return;
+    sim_run_test(test, false, true, false, &result);
+    sim_print(test, &result);
+}
+
+
+/**
+ * @brief Check the TX DMA mode: wraps of the TX buffer, and restarts from an
+ *        idle line.
+ *
+ * @param[in,out] test The test parameters (tx_dma is set).
+ *
+ * @return True if every character went through once and in order.
+ *
+ * The bursts are 1 to 3 TX buffers long. Every other burst waits for the line
+ * to be idle. The result is printed as a JSON object (one line).
+ */
+static bool sim_tx_dma(struct sim_test* test)
+{
+    struct ttys_state* state = &ttys_states[SIM_INSTANCE];
+    struct sim_line_stats stats;
+    uint64_t poll_cycles;
+    uint64_t stall_cycles;
+    uint64_t progress_cycles = 0;
+    uint32_t queued = 0;
+    uint32_t burst_end = 0;
+    uint32_t bursts = 0;
+    uint32_t idle_starts = 0;
+    uint32_t checked = 0;
+    uint32_t mismatches = 0;
+    uint32_t laps;
+    uint32_t len;
+    bool stalled = false;
+    bool ok;
+    char data[256];
+
+    test->tx_dma = true;
+    if (sim_setup(test) < 0)
+        return false;
+    poll_cycles = (uint64_t)HAL_RCC_GetSysClockFreq() / 1000000 * test->poll_us;
+    stall_cycles = (uint64_t)HAL_RCC_GetSysClockFreq() * SIM_STALL_S;
+
+    while (checked < test->bytes) {
+        // Peer side: check the characters received.
+        len = sim_line_recv(SIM_UART, data, sizeof(data));
+        for (uint32_t idx = 0; idx < len; idx++) {
+            if (data[idx] != sim_data(checked + idx))
+                mismatches++;
+        }
+        checked += len;
+        if (len > 0) {
+            progress_cycles = sim_get_cycles();
+        } else if (sim_get_cycles() - progress_cycles > stall_cycles) {
+            stalled = true;
+            break;
+        }
+
+        // Main loop: start the next burst once the last one is queued (and
+        // sent, every other time), then queue what fits.
+        sim_line_get_stats(SIM_UART, &stats);
+        if (queued == burst_end && queued < test->bytes) {
+            bool idle = ring_count(&state->tx_ring) == 0 &&
+                        stats.tx_chars == queued;
+
+            if (bursts % 2 == 0 || idle) {
+                burst_end += 1 + (bursts * 2654435761U >> 8) %
+                                 (3 * TTYS_UART1_TX_BUF_SIZE);
+                if (burst_end > test->bytes)
+                    burst_end = test->bytes;
+                if (bursts % 2 != 0)
+                    idle_starts++;
+                bursts++;
+            }
+        }
+        if (queued < burst_end)
+            queued += sim_tx(queued, burst_end - queued);
+
+        sim_run(poll_cycles);
+    }
+
+    // Each lap of the TX buffer ends a transfer at the end of the buffer, and
+    // each burst from an idle line starts one.
+    sim_line_get_stats(SIM_UART, &stats);
+    laps = test->bytes / TTYS_UART1_TX_BUF_SIZE;
+    ok = !stalled && mismatches == 0 && checked == test->bytes &&
+         stats.tx_chars == test->bytes && stats.tx_overwrites == 0 &&
+         stats.peer_overruns == 0 && state->pm.tx_bytes == test->bytes &&
+         stats.tx_dma_starts >= laps + idle_starts;
+
+    printf("{\"scenario\": \"%s\", \"baud\": %u, \"poll_us\": %u, "
+           "\"tx_buf_size\": %u, \"tx_bytes\": %u, \"mismatches\": %u, "
+           "\"bursts\": %u, \"idle_starts\": %u, \"tx_buf_laps\": %u, "
+           "\"tx_dma_starts\": %u, \"irq_entries\": %u, "
+           "\"irqs_per_byte\": %.3f, \"tx_high_water\": %u, "
+           "\"stalled\": %s, \"ok\": %s}\n",
+           test->scenario, (unsigned)test->baud, (unsigned)test->poll_us,
+           (unsigned)TTYS_UART1_TX_BUF_SIZE, (unsigned)checked,
+           (unsigned)mismatches, (unsigned)bursts, (unsigned)idle_starts,
+           (unsigned)laps, (unsigned)stats.tx_dma_starts,
+           (unsigned)stats.irq_entries,
+           checked > 0 ? (double)stats.irq_entries / checked : 0.0,
+           (unsigned)state->pm.tx_high_water, stalled ? "true" : "false",
+           ok ? "true" : "false");
+
+    return ok;
+}
+
+
+/**
+ * @brief Check the console with a pasted script, under XON/XOFF flow control.
+ *
+ * @param[in,out] test The test parameters (sw_flow_control and tx_block are
+ *                     set).
+ *
+ * @return True if every line ran once and in order, with nothing lost.
+ *
+ * The console's output (prompt, echo, new lines) goes through the UART while
+ * the scenario runs, so the peer sees the flow control characters among it.
+ * The result is printed as a JSON object (one line), once stdout is back.
+ */
+static bool sim_paste(struct sim_test* test)
+{
+    struct ttys_state* state = &ttys_states[SIM_INSTANCE];
+    struct sim_paste_peer* peer = &sim_paste_peer;
+    cookie_io_functions_t funcs = { .write = sim_console_write };
+    struct console_cfg console_cfg;
+    struct sim_line_stats stats;
+    FILE* host_stdout = stdout;
+    FILE* stream;
+    uint64_t poll_cycles;
+    uint64_t stall_cycles;
+    uint64_t progress_cycles = 0;
+    uint32_t progress = 0;
+    bool stalled = false;
+    bool ok;
+
+    test->sw_flow_control = true;
+    test->tx_block = true;
+    if (sim_setup(test) < 0 || cmd_register(&sim_paste_client) < 0)
+        return false;
+    console_get_default_cfg(&console_cfg);
+    console_cfg.ttys_instance_id = SIM_INSTANCE;
+    console_init(&console_cfg);
+    sim_paste_runs = 0;
+    sim_paste_bad = 0;
+    memset(peer, 0, sizeof(struct sim_paste_peer));
+    sim_line_set_xon_xoff(SIM_UART, true, SIM_PASTE_XOFF_LAG);
+    poll_cycles = (uint64_t)HAL_RCC_GetSysClockFreq() / 1000000 * test->poll_us;
+    stall_cycles = (uint64_t)HAL_RCC_GetSysClockFreq() * SIM_STALL_S;
+
+    stream = fopencookie(NULL, "w", funcs);
+    if (stream == NULL)
+        return false;
+    setvbuf(stream, NULL, _IONBF, 0);
+    stdout = stream;
+
+    // A line end taken twice (CR LF) would end an extra, empty, line.
+    while (sim_paste_runs < SIM_PASTE_LINES ||
+           peer->echoed_lines < SIM_PASTE_LINES) {
+        sim_paste_peer_run();
+
+        sim_line_get_stats(SIM_UART, &stats);
+        if (stats.tx_chars + stats.rx_chars != progress) {
+            progress = stats.tx_chars + stats.rx_chars;
+            progress_cycles = sim_get_cycles();
+        } else if (sim_get_cycles() - progress_cycles > stall_cycles) {
+            stalled = true;
+            break;
+        }
+
+        // Main loop: other work, then the console.
+        sim_run(poll_cycles);
+        console_run();
+    }
+
+    stdout = host_stdout;
+    fclose(stream);
+
+    sim_line_get_stats(SIM_UART, &stats);
+    ok = !stalled && sim_paste_runs == SIM_PASTE_LINES &&
+         sim_paste_bad == 0 && peer->echoed_lines == SIM_PASTE_LINES &&
+         stats.rx_chars == peer->sent && stats.rx_lost == 0 &&
+         state->pm.rx_overruns == 0 && state->pm.tx_overruns == 0 &&
+         stats.peer_overruns == 0 && stats.rx_xoffs > 0;
+
+    printf("{\"scenario\": \"%s\", \"baud\": %u, \"poll_us\": %u, "
+           "\"rx_buf_size\": %u, \"lines\": %u, \"rx_bytes\": %u, "
+           "\"runs\": %u, \"out_of_sequence\": %u, \"echoed_lines\": %u, "
+           "\"xoffs\": %u, \"rx_throttles\": %u, \"rx_lost\": %u, "
+           "\"rx_ring_drops\": %u, \"tx_dropped\": %u, "
+           "\"rx_high_water\": %u, \"stalled\": %s, \"ok\": %s}\n",
+           test->scenario, (unsigned)test->baud, (unsigned)test->poll_us,
+           (unsigned)TTYS_UART1_RX_BUF_SIZE, (unsigned)SIM_PASTE_LINES,
+           (unsigned)peer->sent, (unsigned)sim_paste_runs,
+           (unsigned)sim_paste_bad, (unsigned)peer->echoed_lines,
+           (unsigned)stats.rx_xoffs,
+           (unsigned)state->pm.rx_throttles, (unsigned)stats.rx_lost,
+           (unsigned)state->pm.rx_overruns, (unsigned)state->pm.tx_overruns,
+           (unsigned)state->pm.rx_high_water, stalled ? "true" : "false",
+           ok ? "true" : "false");
+
+    return ok;
+}
+
+
+/**
+ * @brief Run the peer of the paste scenario: count the lines the console
+ *        ended, and keep the send queue filled (the line model holds it back
+ *        on XOFF).
+ *
+ * Called from the main loop, and when the console writes, as console_run()
+ * does not return while the input keeps coming.
+ */
+static void sim_paste_peer_run(void)
+{
+    struct sim_paste_peer* peer = &sim_paste_peer;
+    uint32_t len;
+    char data[256];
+
+    while ((len = sim_line_recv(SIM_UART, data, sizeof(data))) > 0) {
+        for (uint32_t idx = 0; idx < len; idx++) {
+            if (data[idx] == '\n')
+                peer->echoed_lines++;
+        }
+    }
+
+    while (peer->line < SIM_PASTE_LINES) {
+        if (peer->line_pos == 0)
+            peer->line_len = sim_paste_line(peer->line, peer->line_bfr);
+        len = sim_line_send(SIM_UART, peer->line_bfr + peer->line_pos,
+                            peer->line_len - peer->line_pos);
+        if (len == 0)
+            break;
+        peer->sent += len;
+        peer->line_pos += len;
+        if (peer->line_pos == peer->line_len) {
+            peer->line_pos = 0;
+            peer->line++;
+        }
+    }
+}
+
+
+/**
+ * @brief Get a line of the pasted script.
+ *
+ * @param[in] num Line number.
+ * @param[out] bfr The line, with its end (not terminated).
+ *
+ * @return Length of the line. The lines end in turn with CR, LF and CR LF.
+ */
+static uint32_t sim_paste_line(uint32_t num, char* bfr)
+{
+    static const char* const ends[] = { "\r", "\n", "\r\n" };
+
+    return sprintf(bfr, "paste line %u%s", (unsigned)num, ends[num % 3]);
+}
+
+
+/**
+ * @brief Command of the pasted lines: checks that they come in sequence.
+ */
+static int32_t sim_paste_cmd(int32_t argc, const char** argv)
+{
+    uint32_t num;
+
+    if (argc != 3 || num_parse_uint(argv[2], &num) != 0 ||
+        num != sim_paste_runs)
+        sim_paste_bad++;
+    sim_paste_runs++;
+
+    return 0;
+}
+
+
+/**
+ * @brief Write function of the console's stdout stream, to UART1. The peer
+ *        runs after each write.
+ */
+static ssize_t sim_console_write(void* cookie, const char* buf, size_t size)
+{
+    int32_t rc = ttys_write(SIM_INSTANCE, buf, size);
+
+    sim_paste_peer_run();
+
+    return rc < 0 ? -1 : rc;
+}
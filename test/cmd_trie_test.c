@@ -0,0 +1,271 @@
+/**
+ * @brief Host test of the command name search, with a full name trie.
+ *
+ * The trie is too small for the commands, so it fills up in the middle of the
+ * subcommands of "big cfg". Checks that:
+ * - Names are found in full, also when they are left out of the trie and are
+ *   the start of a name in it (client "bi" and "big", command "set" and
+ *   "setup", subcommand "mode" and "modes").
+ * - Names in the trie are found abbreviated, and not through a name of the
+ *   same start at the level above (e.g. "bi se" is not "big setup").
+ * - Ambiguous and unknown names run nothing.
+ * - cmd_execute() returns the value of the command function, with and without
+ *   a schema.
+ *
+ * tools/run_tests.py runs it with a full hash index, with a hash index that
+ * holds all the names, and without hash index nor trie (CMD_TRIE_SIZE=0),
+ * where the abbreviations are not found.
+ *
+ * Build (from the repository root) and run:
+ *
+ *     gcc -O2 -DSHELL_PORT_POSIX -DCMD_TRIE_SIZE=64 -Ishell/include -Itest \
+ *         shell/[a-z]*.c shell/port/[a-z]*.c test/cmd_trie_test.c \
+ *         -o cmd_trie_test
+ *     ./cmd_trie_test
+ */
+
+#include "shell.h"
+#include "test.h"
+
+//=============================================================================
+//                         Preprocessor Constants
+//=============================================================================
+#if CMD_TRIE_SIZE > 64
+#error "Build with -DCMD_TRIE_SIZE=64 (or less), so that the trie is full"
+#endif
+
+// Fillers: subcommands of "big cfg", commands of "big"
+#define TEST_NUM_SUBCMD_FILLERS 70
+#define TEST_NUM_CMD_FILLERS    200
+
+// Commands of "big": setup, start, stop, cfg, the fillers, set
+#define TEST_NUM_BIG_CMDS       (4 + TEST_NUM_CMD_FILLERS + 1)
+
+// Expected result of an abbreviated name (arguments rc and ran of
+// test_line()): found through the trie, if there is one.
+#if CMD_TRIE_SIZE > 0
+#define TEST_ABBREV(ran) 0, ran
+#else
+#define TEST_ABBREV(ran) SHELL_ERR_BAD_CMD, NULL
+#endif
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static int32_t test_cmd(int32_t argc, const char** argv);
+static int32_t test_subcmd(int32_t argc, const char** argv);
+static int32_t test_fail(int32_t argc, const char** argv);
+static int32_t test_check(const void* args, int32_t num_args);
+static struct cmd_info* test_add(struct cmd_info* cmdi,
+                                 const struct cmd_info* info);
+static void test_line(const char* line, int32_t rc, const char* ran);
+
+//=============================================================================
+//                         Private (static) variables
+//=============================================================================
+// Name of the last command run (its full name, as passed in argv).
+static const char* test_ran;
+
+static struct cmd_info test_subcmds[1 + TEST_NUM_SUBCMD_FILLERS + 1];
+static struct cmd_info test_big_cmds[TEST_NUM_BIG_CMDS];
+static char test_names[TEST_NUM_SUBCMD_FILLERS + TEST_NUM_CMD_FILLERS][8];
+
+static const struct cmd_client_info test_big = {
+    .name = "big",
+    .num_cmds = TEST_NUM_BIG_CMDS,
+    .cmds = test_big_cmds,
+};
+
+// Argument struct of the "bi check" command
+struct test_check_args {
+    int32_t rc;
+};
+
+static const struct cmd_info test_bi_cmds[] = {
+    { .name = "run", .func = test_cmd, .help = "" },
+    { .name = "fail", .func = test_fail, .help = "" },
+    {
+        .name = "check",
+        .help = "",
+        .args = CMD_ARGS(struct test_check_args, test_check, 1,
+            CMD_ARG_INT(struct test_check_args, rc, "rc", -100, 100)),
+    },
+};
+
+static const struct cmd_client_info test_bi = {
+    .name = "bi",
+    .num_cmds = ARRAY_SIZE(test_bi_cmds),
+    .cmds = test_bi_cmds,
+};
+
+//=============================================================================
+//                        Public (global) functions
+//=============================================================================
+int main(void)
+{
+    struct cmd_info* cmdi;
+    uint32_t num_names = 0;
+    uint32_t idx;
+
+    TEST_INIT();
+
+    // big cfg: modes, x00 ... x69, mode
+    cmdi = test_subcmds;
+    cmdi = test_add(cmdi, &(struct cmd_info) { "modes", .func = test_subcmd });
+    for (idx = 0; idx < TEST_NUM_SUBCMD_FILLERS; idx++) {
+        snprintf(test_names[num_names], sizeof(test_names[0]), "x%02u",
+                 (unsigned)idx);
+        cmdi = test_add(cmdi, &(struct cmd_info) {
+            .name = test_names[num_names++],
+            .func = test_subcmd,
+        });
+    }
+    test_add(cmdi, &(struct cmd_info) { "mode", .func = test_subcmd });
+
+    // big: setup, start, stop, cfg, c000 ... c199, set
+    cmdi = test_big_cmds;
+    cmdi = test_add(cmdi, &(struct cmd_info) { "setup", .func = test_cmd });
+    cmdi = test_add(cmdi, &(struct cmd_info) { "start", .func = test_cmd });
+    cmdi = test_add(cmdi, &(struct cmd_info) { "stop", .func = test_cmd });
+    cmdi = test_add(cmdi, &(struct cmd_info) {
+        .name = "cfg",
+        .num_subcmds = ARRAY_SIZE(test_subcmds),
+        .subcmds = test_subcmds,
+    });
+    for (idx = 0; idx < TEST_NUM_CMD_FILLERS; idx++) {
+        snprintf(test_names[num_names], sizeof(test_names[0]), "c%03u",
+                 (unsigned)idx);
+        cmdi = test_add(cmdi, &(struct cmd_info) {
+            .name = test_names[num_names++],
+            .func = test_cmd,
+        });
+    }
+    test_add(cmdi, &(struct cmd_info) { "set", .func = test_cmd });
+
+    // "bi" is registered last, so it is not in the trie.
+    TEST_CHECK_EQ(cmd_register(&test_big), 0);
+    TEST_CHECK_EQ(cmd_register(&test_bi), 0);
+
+    // Clients
+    test_line("big setup", 0, "setup");
+    test_line("bi run", 0, "run");
+    test_line("BI RUN", 0, "run");
+    test_line("b setup", TEST_ABBREV("setup"));
+    test_line("b run", SHELL_ERR_BAD_CMD, NULL);
+    test_line("bigger setup", SHELL_ERR_BAD_CMD, NULL);
+
+    // Commands
+    test_line("big set", 0, "set");
+    test_line("big SET", 0, "set");
+    test_line("big setu", TEST_ABBREV("setup"));
+    test_line("big sta", TEST_ABBREV("start"));
+    test_line("big sto", TEST_ABBREV("stop"));
+    test_line("big st", SHELL_ERR_BAD_CMD, NULL);
+    test_line("big c000", 0, "c000");
+    test_line("big c199", 0, "c199");
+    test_line("big c19", SHELL_ERR_BAD_CMD, NULL);
+    test_line("big help", 0, NULL);
+    test_line("big nothing", SHELL_ERR_BAD_CMD, NULL);
+    test_line("bi se", SHELL_ERR_BAD_CMD, NULL);
+
+    // Subcommands
+    test_line("big cfg modes", 0, "modes");
+    test_line("big cfg mode", 0, "mode");
+    test_line("big cfg mod", TEST_ABBREV("modes"));
+    test_line("big cfg x00", 0, "x00");
+    test_line("big cfg x69", 0, "x69");
+    test_line("big cfg x", SHELL_ERR_BAD_CMD, NULL);
+
+    // Return value of the command function
+    test_line("bi fail", SHELL_ERR_STATE, "fail");
+    test_line("bi check 0", 0, "check");
+    test_line("bi check -3", -3, "check");
+    test_line("bi check 7", 7, "check");
+    test_line("bi check 1000", SHELL_ERR_ARG, NULL);
+
+    return TEST_END();
+}
+
+//=============================================================================
+//                       Private (static) functions
+//=============================================================================
+/**
+ * @brief Command function: records its name.
+ */
+static int32_t test_cmd(int32_t argc, const char** argv)
+{
+    test_ran = argv[1];
+    return 0;
+}
+
+
+/**
+ * @brief Subcommand function: records its name.
+ */
+static int32_t test_subcmd(int32_t argc, const char** argv)
+{
+    test_ran = argv[2];
+    return 0;
+}
+
+
+/**
+ * @brief Command function: records its name, and fails.
+ */
+static int32_t test_fail(int32_t argc, const char** argv)
+{
+    test_ran = argv[1];
+    return SHELL_ERR_STATE;
+}
+
+
+/**
+ * @brief Schema function: records its name, and returns its argument.
+ */
+static int32_t test_check(const void* args, int32_t num_args)
+{
+    test_ran = "check";
+    return ((const struct test_check_args*)args)->rc;
+}
+
+
+/**
+ * @brief Set a command of a generated table (its members are const).
+ *
+ * @param[out] cmdi The command.
+ * @param[in] info Its value.
+ *
+ * @return The next command.
+ */
+static struct cmd_info* test_add(struct cmd_info* cmdi,
+                                 const struct cmd_info* info)
+{
+    memcpy(cmdi, info, sizeof(*cmdi));
+    return cmdi + 1;
+}
+
+
+/**
+ * @brief Run a command line, and check its result.
+ *
+ * @param[in] line The command line.
+ * @param[in] rc Expected return value of cmd_execute().
+ * @param[in] ran Expected command run, or NULL if none.
+ */
+static void test_line(const char* line, int32_t rc, const char* ran)
+{
+    char bfr[80];
+    bool ok;
+
+    snprintf(bfr, sizeof(bfr), "%s", line);
+    test_ran = NULL;
+    TEST_CHECK_EQ(cmd_execute(bfr), rc);
+
+    ok = ran == NULL ? test_ran == NULL :
+                       test_ran != NULL && strcmp(test_ran, ran) == 0;
+    TEST_CHECK(ok);
+    if (!ok)
+        fprintf(stderr, "'%s' ran %s, expected %s\n", line,
+                test_ran != NULL ? test_ran : "nothing",
+                ran != NULL ? ran : "nothing");
+}
@@ -0,0 +1,559 @@
+/**
+ * @brief Host test of the num module.
+ *
+ * Checks num_parse_uint(), num_parse_int(), num_parse_hex() and
+ * num_parse_fixed():
+ * - Fixed cases: base prefixes, separators, limits, Q format rounding and
+ *   carry, incomplete numbers, long fractions.
+ * - Generated cases: numbers in every base, with and without separators, and
+ *   random strings, against strtoull() (with the differences of the num
+ *   module applied: no white space, no 0b in the C library, no sign for
+ *   unsigned values, 32-bit range).
+ *
+ * Build (from the repository root) and run:
+ *
+ *     gcc -O2 -DSHELL_PORT_POSIX -Ishell/include -Itest \
+ *         shell/[a-z]*.c shell/port/[a-z]*.c test/num_test.c -o num_test
+ *     ./num_test
+ */
+
+#include <ctype.h>
+#include <errno.h>
+
+#include "shell.h"
+#include "test.h"
+
+//=============================================================================
+//                         Preprocessor Constants
+//=============================================================================
+// Number of generated cases of each kind
+#define TEST_NUM_GENERATED 200000
+
+// Value left in place by a failed conversion
+#define TEST_UNCHANGED 0x5a5a5a5a
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+/**
+ * A fixed case of num_parse_uint()/num_parse_int()/num_parse_hex()
+ */
+struct test_int_case {
+    const char* str;
+    int32_t rc;
+    uint32_t val;
+};
+
+/**
+ * A fixed case of num_parse_fixed()
+ */
+struct test_fixed_case {
+    const char* str;
+    uint32_t frac_bits;
+    int32_t rc;
+    int32_t val;
+};
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static void test_fixed_cases(void);
+static void test_generated(void);
+static int32_t test_ref_uint(const char* str, uint32_t* val);
+static int32_t test_ref_int(const char* str, int32_t* val);
+static int32_t test_ref_hex(const char* str, uint32_t* val);
+static void test_compare(const char* str);
+static uint32_t test_rand(void);
+static void test_format(char* str, uint32_t size, uint32_t val,
+                        uint32_t base);
+static void test_separate(char* str, uint32_t size, const char* num);
+
+//=============================================================================
+//                         Private (static) variables
+//=============================================================================
+static const struct test_int_case test_uint_cases[] = {
+    // Bases
+    { "0", 0, 0 },
+    { "7", 0, 7 },
+    { "100", 0, 100 },
+    { "+100", 0, 100 },
+    { "0x64", 0, 100 },
+    { "0X64", 0, 100 },
+    { "0xdeadBEEF", 0, 0xdeadbeef },
+    { "0b1100100", 0, 100 },
+    { "0B1", 0, 1 },
+    { "0144", 0, 100 },
+    { "00", 0, 0 },
+    { "0x", SHELL_ERR_ARG, 0 },
+    { "0b", SHELL_ERR_ARG, 0 },
+    { "0b2", SHELL_ERR_ARG, 0 },
+    { "08", SHELL_ERR_ARG, 0 },
+    { "09", SHELL_ERR_ARG, 0 },
+    { "0xg", SHELL_ERR_ARG, 0 },
+    { "0x0x1", SHELL_ERR_ARG, 0 },
+    // Separators
+    { "1_000_000", 0, 1000000 },
+    { "0xdead_beef", 0, 0xdeadbeef },
+    { "0b1_0", 0, 2 },
+    { "01_0", 0, 8 },
+    { "0_1", SHELL_ERR_ARG, 0 },
+    { "0x_1", SHELL_ERR_ARG, 0 },
+    { "1_", SHELL_ERR_ARG, 0 },
+    { "_1", SHELL_ERR_ARG, 0 },
+    { "1__2", SHELL_ERR_ARG, 0 },
+    { "_", SHELL_ERR_ARG, 0 },
+    // Not numbers
+    { "", SHELL_ERR_ARG, 0 },
+    { "+", SHELL_ERR_ARG, 0 },
+    { "-1", SHELL_ERR_ARG, 0 },
+    { "++1", SHELL_ERR_ARG, 0 },
+    { " 1", SHELL_ERR_ARG, 0 },
+    { "1 ", SHELL_ERR_ARG, 0 },
+    { "1a", SHELL_ERR_ARG, 0 },
+    { "1.0", SHELL_ERR_ARG, 0 },
+    // Limits
+    { "4294967295", 0, UINT32_MAX },
+    { "0xffffffff", 0, UINT32_MAX },
+    { "037777777777", 0, UINT32_MAX },
+    { "0b11111111111111111111111111111111", 0, UINT32_MAX },
+    { "4294967296", SHELL_ERR_RANGE, 0 },
+    { "0x100000000", SHELL_ERR_RANGE, 0 },
+    { "040000000000", SHELL_ERR_RANGE, 0 },
+    { "0b100000000000000000000000000000000", SHELL_ERR_RANGE, 0 },
+    { "99999999999999999999", SHELL_ERR_RANGE, 0 },
+    { "0x00000000ffffffff", 0, UINT32_MAX },
+    { "4294967296x", SHELL_ERR_ARG, 0 },
+};
+
+static const struct test_int_case test_int_cases[] = {
+    { "0", 0, 0 },
+    { "-0", 0, 0 },
+    { "+5", 0, 5 },
+    { "-5", 0, (uint32_t)-5 },
+    { "-0x10", 0, (uint32_t)-16 },
+    { "-0b11", 0, (uint32_t)-3 },
+    { "-010", 0, (uint32_t)-8 },
+    { "-1_000", 0, (uint32_t)-1000 },
+    { "2147483647", 0, INT32_MAX },
+    { "-2147483648", 0, (uint32_t)INT32_MIN },
+    { "0x7fffffff", 0, INT32_MAX },
+    { "-0x80000000", 0, (uint32_t)INT32_MIN },
+    { "2147483648", SHELL_ERR_RANGE, 0 },
+    { "-2147483649", SHELL_ERR_RANGE, 0 },
+    { "0x80000000", SHELL_ERR_RANGE, 0 },
+    { "4294967296", SHELL_ERR_RANGE, 0 },
+    { "-4294967296", SHELL_ERR_RANGE, 0 },
+    { "-", SHELL_ERR_ARG, 0 },
+    { "--1", SHELL_ERR_ARG, 0 },
+    { "-+1", SHELL_ERR_ARG, 0 },
+    { "- 1", SHELL_ERR_ARG, 0 },
+    { "-_1", SHELL_ERR_ARG, 0 },
+    { "-08", SHELL_ERR_ARG, 0 },
+};
+
+static const struct test_int_case test_hex_cases[] = {
+    { "20001000", 0, 0x20001000 },
+    { "0x20001000", 0, 0x20001000 },
+    { "0X2000_1000", 0, 0x20001000 },
+    { "ffffffff", 0, UINT32_MAX },
+    { "010", 0, 0x10 },
+    { "0b1", 0, 0xb1 },
+    { "100000000", SHELL_ERR_RANGE, 0 },
+    { "0x", SHELL_ERR_ARG, 0 },
+    { "", SHELL_ERR_ARG, 0 },
+    { "+1", SHELL_ERR_ARG, 0 },
+    { "g", SHELL_ERR_ARG, 0 },
+    { "0x_1", SHELL_ERR_ARG, 0 },
+};
+
+static const struct test_fixed_case test_fixed_cases_q[] = {
+    // Integers and fractions
+    { "0", 16, 0, 0 },
+    { "1", 16, 0, 1 << 16 },
+    { "-1", 16, 0, -(1 << 16) },
+    { "+1.5", 16, 0, 3 << 15 },
+    { "-1.25", 16, 0, -(5 << 14) },
+    { ".5", 16, 0, 1 << 15 },
+    { "-.5", 16, 0, -(1 << 15) },
+    { "0.5", 0, 0, 1 },
+    { "1_000.5", 8, 0, 1000 * 256 + 128 },
+    { "1.000_5", 16, 0, 65569 },
+    { "1.", 16, SHELL_ERR_ARG, 0 },
+    { ".", 16, SHELL_ERR_ARG, 0 },
+    { "-", 16, SHELL_ERR_ARG, 0 },
+    { "", 16, SHELL_ERR_ARG, 0 },
+    { "1.5.", 16, SHELL_ERR_ARG, 0 },
+    { "1._5", 16, SHELL_ERR_ARG, 0 },
+    { "1.5_", 16, SHELL_ERR_ARG, 0 },
+    { "0x1", 16, SHELL_ERR_ARG, 0 },
+    { "1e3", 16, SHELL_ERR_ARG, 0 },
+    { "1", 32, SHELL_ERR_ARG, 0 },
+    // Rounding, half away from zero, and its carry
+    { "0.4", 0, 0, 0 },
+    { "0.5", 0, 0, 1 },
+    { "-0.5", 0, 0, -1 },
+    { "2.5", 0, 0, 3 },
+    { "-2.5", 0, 0, -3 },
+    { "2.4999", 0, 0, 2 },
+    { "0.75", 1, 0, 2 },
+    { "-0.75", 1, 0, -2 },
+    { "0.99999", 8, 0, 256 },
+    { "1.999999999", 16, 0, 2 << 16 },
+    { "0.1", 16, 0, 6554 },
+    { "0.00001", 16, 0, 1 },
+    { "0.000007", 16, 0, 0 },
+    // More than 9 fraction digits: the others are checked, not used
+    { "0.1234567891", 31, 0, 265121436 },
+    { "0.123456789", 31, 0, 265121436 },
+    { "0.0000000009", 31, 0, 0 },
+    { "1.0000000009", 16, 0, 1 << 16 },
+    { "0.1234567890x", 16, SHELL_ERR_ARG, 0 },
+    { "0.12345678901234567890", 16, 0, 8091 },
+    // Limits
+    { "32767", 16, 0, 32767 << 16 },
+    { "32767.99998", 16, 0, INT32_MAX },
+    { "32767.99999", 16, 0, INT32_MAX },
+    { "32767.999993", 16, SHELL_ERR_RANGE, 0 },
+    { "32768", 16, SHELL_ERR_RANGE, 0 },
+    { "-32768", 16, 0, INT32_MIN },
+    { "-32768.000001", 16, 0, INT32_MIN },
+    { "-32768.00001", 16, SHELL_ERR_RANGE, 0 },
+    { "2147483647", 0, 0, INT32_MAX },
+    { "-2147483648", 0, 0, INT32_MIN },
+    { "2147483648", 0, SHELL_ERR_RANGE, 0 },
+    { "4294967296", 0, SHELL_ERR_RANGE, 0 },
+    { "0.5", 31, 0, 1 << 30 },
+    { "-1", 31, 0, INT32_MIN },
+    { "1", 31, SHELL_ERR_RANGE, 0 },
+    { "0.9999999999", 31, 0, 2147483646 },
+    { "0.99999999977", 31, 0, 2147483646 },
+};
+
+// State of the generator (xorshift32), fixed so that the runs repeat.
+static uint32_t test_seed = 2463534242U;
+
+//=============================================================================
+//                        Public (global) functions
+//=============================================================================
+int main(void)
+{
+    const struct test_int_case* c;
+    uint32_t uval;
+    int32_t ival;
+
+    for (uint32_t idx = 0; idx < ARRAY_SIZE(test_uint_cases); idx++) {
+        c = &test_uint_cases[idx];
+        uval = TEST_UNCHANGED;
+        TEST_CHECK_EQ(num_parse_uint(c->str, &uval), c->rc);
+        TEST_CHECK_EQ(uval, c->rc == 0 ? c->val : TEST_UNCHANGED);
+    }
+    for (uint32_t idx = 0; idx < ARRAY_SIZE(test_int_cases); idx++) {
+        c = &test_int_cases[idx];
+        ival = TEST_UNCHANGED;
+        TEST_CHECK_EQ(num_parse_int(c->str, &ival), c->rc);
+        TEST_CHECK_EQ(ival, c->rc == 0 ? (int32_t)c->val : TEST_UNCHANGED);
+    }
+    for (uint32_t idx = 0; idx < ARRAY_SIZE(test_hex_cases); idx++) {
+        c = &test_hex_cases[idx];
+        uval = TEST_UNCHANGED;
+        TEST_CHECK_EQ(num_parse_hex(c->str, &uval), c->rc);
+        TEST_CHECK_EQ(uval, c->rc == 0 ? c->val : TEST_UNCHANGED);
+    }
+    test_fixed_cases();
+    test_generated();
+
+    return TEST_END();
+}
+
+//=============================================================================
+//                       Private (static) functions
+//=============================================================================
+/**
+ * @brief Check the fixed cases of num_parse_fixed(), and the same values
+ *        against strtod() for the other numbers of fraction bits.
+ */
+static void test_fixed_cases(void)
+{
+    const struct test_fixed_case* c;
+    int32_t val;
+
+    for (uint32_t idx = 0; idx < ARRAY_SIZE(test_fixed_cases_q); idx++) {
+        c = &test_fixed_cases_q[idx];
+        val = TEST_UNCHANGED;
+        TEST_CHECK_EQ(num_parse_fixed(c->str, c->frac_bits, &val), c->rc);
+        TEST_CHECK_EQ(val, c->rc == 0 ? c->val : TEST_UNCHANGED);
+        if (c->rc != 0 || val == c->val)
+            continue;
+        fprintf(stderr, "  num_parse_fixed(\"%s\", %u)\n", c->str,
+                (unsigned)c->frac_bits);
+    }
+
+    // Short decimals (exact in a double once scaled) at every Q format.
+    for (uint32_t frac_bits = 0; frac_bits <= 31; frac_bits++) {
+        static const char* const strs[] = {
+            "0.1", "-0.1", "0.25", "3.14159", "-2.71828", "0.999", "1.5",
+            "-0.0000001", "12.345678",
+        };
+        for (uint32_t idx = 0; idx < ARRAY_SIZE(strs); idx++) {
+            double ref = strtod(strs[idx], NULL) * (1ULL << frac_bits);
+            double rounded = ref < 0 ? -(double)(int64_t)(-ref + 0.5) :
+                                       (double)(int64_t)(ref + 0.5);
+            int32_t rc = num_parse_fixed(strs[idx], frac_bits, &val);
+
+            if (rounded > INT32_MAX || rounded < INT32_MIN) {
+                TEST_CHECK_EQ(rc, SHELL_ERR_RANGE);
+            } else {
+                TEST_CHECK_EQ(rc, 0);
+                TEST_CHECK_EQ(val, (int64_t)rounded);
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Check generated numbers and strings against the C library.
+ */
+static void test_generated(void)
+{
+    static const char alphabet[] = "0123456789abfxXB+-_";
+    static const uint32_t bases[] = { 2, 8, 10, 16 };
+    char num[48];
+    char str[96];
+    uint32_t len;
+    uint64_t val;
+
+    for (uint32_t idx = 0; idx < TEST_NUM_GENERATED; idx++) {
+        // A number of up to 36 bits, in a random base, with a sign at times.
+        val = test_rand() >> (test_rand() % 32);
+        if (test_rand() % 4 == 0)
+            val = (val << 4) | (test_rand() & 0xf);
+        test_format(num, sizeof(num), (uint32_t)val, bases[test_rand() % 4]);
+        if (val > UINT32_MAX)
+            snprintf(num, sizeof(num), "%llu", (unsigned long long)val);
+        if (test_rand() % 3 == 0) {
+            snprintf(str, sizeof(str), "%c%s", "+-"[test_rand() % 2], num);
+            test_compare(str);
+        } else {
+            test_compare(num);
+        }
+
+        // The same with separators: the value must not change.
+        test_separate(str, sizeof(str), num);
+        {
+            uint32_t ref;
+            uint32_t sep;
+            int32_t rc = num_parse_uint(num, &ref);
+
+            TEST_CHECK_EQ(num_parse_uint(str, &sep), rc);
+            if (rc == 0)
+                TEST_CHECK_EQ(sep, ref);
+        }
+
+        // A random string.
+        len = 1 + test_rand() % 12;
+        for (uint32_t pos = 0; pos < len; pos++)
+            str[pos] = alphabet[test_rand() % (sizeof(alphabet) - 1)];
+        str[len] = '\0';
+        if (strchr(str, '_') == NULL)
+            test_compare(str);
+    }
+}
+
+
+/**
+ * @brief Compare the conversions of a string (without separator) with the
+ *        reference ones.
+ *
+ * @param[in] str The string.
+ */
+static void test_compare(const char* str)
+{
+    uint32_t uval = TEST_UNCHANGED;
+    uint32_t uref = TEST_UNCHANGED;
+    int32_t ival = TEST_UNCHANGED;
+    int32_t iref = TEST_UNCHANGED;
+    int32_t rc;
+    int32_t ref_rc;
+    unsigned long fails = test_failures;
+
+    rc = num_parse_uint(str, &uval);
+    ref_rc = test_ref_uint(str, &uref);
+    TEST_CHECK_EQ(rc, ref_rc);
+    TEST_CHECK_EQ(uval, uref);
+
+    rc = num_parse_int(str, &ival);
+    ref_rc = test_ref_int(str, &iref);
+    TEST_CHECK_EQ(rc, ref_rc);
+    TEST_CHECK_EQ(ival, iref);
+
+    uval = uref = TEST_UNCHANGED;
+    rc = num_parse_hex(str, &uval);
+    ref_rc = test_ref_hex(str, &uref);
+    TEST_CHECK_EQ(rc, ref_rc);
+    TEST_CHECK_EQ(uval, uref);
+
+    if (test_failures != fails)
+        fprintf(stderr, "  string: \"%s\"\n", str);
+}
+
+
+/**
+ * @brief Reference of num_parse_uint(), from strtoull().
+ */
+static int32_t test_ref_uint(const char* str, uint32_t* val)
+{
+    unsigned long long ull;
+    const char* digits = str;
+    char* end;
+    int base = 0;
+
+    // No sign but +, no white space (which strtoull() accepts).
+    if (*digits == '+')
+        digits++;
+    if (*digits == '\0' || !isalnum((unsigned char)*digits))
+        return SHELL_ERR_ARG;
+
+    // The C library may not know the 0b prefix.
+    if (digits[0] == '0' && (digits[1] | 0x20) == 'b') {
+        digits += 2;
+        base = 2;
+        if (!isalnum((unsigned char)*digits))
+            return SHELL_ERR_ARG;
+    }
+
+    errno = 0;
+    ull = strtoull(digits, &end, base);
+    if (end == digits || *end != '\0')
+        return SHELL_ERR_ARG;
+    if (errno == ERANGE || ull > UINT32_MAX)
+        return SHELL_ERR_RANGE;
+
+    *val = ull;
+    return 0;
+}
+
+
+/**
+ * @brief Reference of num_parse_int(), from test_ref_uint().
+ */
+static int32_t test_ref_int(const char* str, int32_t* val)
+{
+    bool neg = *str == '-';
+    uint32_t uval;
+    int32_t rc;
+
+    if (*str == '-' || *str == '+')
+        str++;
+    if (*str == '+' || *str == '-')
+        return SHELL_ERR_ARG;
+    rc = test_ref_uint(str, &uval);
+    if (rc != 0)
+        return rc;
+    if (uval > (uint32_t)INT32_MAX + neg)
+        return SHELL_ERR_RANGE;
+
+    *val = neg ? (int32_t)(0U - uval) : (int32_t)uval;
+    return 0;
+}
+
+
+/**
+ * @brief Reference of num_parse_hex(), from strtoull().
+ */
+static int32_t test_ref_hex(const char* str, uint32_t* val)
+{
+    unsigned long long ull;
+    char* end;
+
+    // No sign, no white space, and hex digits after 0x.
+    if (!isxdigit((unsigned char)*str))
+        return SHELL_ERR_ARG;
+    if (str[0] == '0' && (str[1] | 0x20) == 'x' &&
+        !isxdigit((unsigned char)str[2]))
+        return SHELL_ERR_ARG;
+
+    errno = 0;
+    ull = strtoull(str, &end, 16);
+    if (*end != '\0')
+        return SHELL_ERR_ARG;
+    if (errno == ERANGE || ull > UINT32_MAX)
+        return SHELL_ERR_RANGE;
+
+    *val = ull;
+    return 0;
+}
+
+
+/**
+ * @brief Get a pseudo-random number (xorshift32).
+ */
+static uint32_t test_rand(void)
+{
+    test_seed ^= test_seed << 13;
+    test_seed ^= test_seed >> 17;
+    test_seed ^= test_seed << 5;
+    return test_seed;
+}
+
+
+/**
+ * @brief Format a number with the prefix of its base.
+ *
+ * @param[out] str The number.
+ * @param[in] size Size of str.
+ * @param[in] val The value.
+ * @param[in] base 2, 8, 10 or 16.
+ */
+static void test_format(char* str, uint32_t size, uint32_t val,
+                        uint32_t base)
+{
+    char digits[33];
+    uint32_t pos = sizeof(digits) - 1;
+
+    switch (base) {
+        case 8:
+            snprintf(str, size, "0%o", (unsigned)val);
+            return;
+        case 10:
+            snprintf(str, size, "%u", (unsigned)val);
+            return;
+        case 16:
+            snprintf(str, size, test_rand() % 2 ? "0x%x" : "0X%X",
+                     (unsigned)val);
+            return;
+        default:
+            digits[pos] = '\0';
+            do {
+                digits[--pos] = '0' + (val & 1);
+                val >>= 1;
+            } while (val != 0);
+            snprintf(str, size, "0b%s", &digits[pos]);
+            return;
+    }
+}
+
+
+/**
+ * @brief Insert separators at random between the digits of a number.
+ *
+ * @param[out] str The number with separators.
+ * @param[in] size Size of str.
+ * @param[in] num The number (unsigned, with its prefix).
+ */
+static void test_separate(char* str, uint32_t size, const char* num)
+{
+    uint32_t len = 0;
+    uint32_t start = 0;
+
+    // The digits start after the prefix (0x, 0b, or the 0 of octal).
+    if (num[0] == '0' && num[1] != '\0')
+        start = isalpha((unsigned char)num[1]) ? 2 : 1;
+
+    for (uint32_t pos = 0; num[pos] != '\0' && len + 2 < size; pos++) {
+        str[len++] = num[pos];
+        if (pos + 1 > start && num[pos + 1] != '\0' && test_rand() % 3 == 0)
+            str[len++] = NUM_SEPARATOR;
+    }
+    str[len] = '\0';
+}
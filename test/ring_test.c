@@ -0,0 +1,347 @@
+/**
+ * @brief Host test of the ring module.
+ *
+ * Checks:
+ * - ring_init() arguments, and the count and space of an empty, full and
+ *   wrapped ring.
+ * - The spans at the end of the buffer (split in two at the wrap).
+ * - A producer and a consumer thread passing a numbered sequence of
+ *   characters through small rings, for many laps of the buffer. Each side
+ *   changes at random between the byte, bulk and span functions, and the
+ *   lengths it asks for, so the copies start and end everywhere in the
+ *   buffer. The consumer checks every character against the sequence: a
+ *   lost, repeated or stale character (e.g. read before the producer's
+ *   write is visible) is a mismatch. The pattern is not periodic in the ring
+ *   size, so a character of another lap does not match. The buffer past
+ *   the ring must not be written.
+ *
+ * Build (from the repository root) and run:
+ *
+ *     gcc -O2 -DSHELL_PORT_POSIX -Ishell/include -Itest \
+ *         shell/[a-z]*.c shell/port/[a-z]*.c test/ring_test.c -lpthread \
+ *         -o ring_test
+ *     ./ring_test
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "shell.h"
+#include "test.h"
+
+//=============================================================================
+//                         Preprocessor Constants
+//=============================================================================
+// Characters passed through each ring by the threads
+#define TEST_NUM_CHARS 4000000
+
+// Largest ring of the thread test, and largest transfer of one call
+#define TEST_MAX_RING_SIZE 256
+#define TEST_MAX_CHUNK     (2 * TEST_MAX_RING_SIZE)
+
+// Fill of the buffer past the ring, which must be left as it is
+#define TEST_GUARD 0x5a
+
+//=============================================================================
+//                            Type Definitions
+//=============================================================================
+/**
+ * State of the thread test, of one ring
+ */
+struct test_spsc {
+    struct ring ring;
+    char buf[TEST_MAX_RING_SIZE + TEST_MAX_CHUNK];  // The ring, and a guard
+    uint32_t size;
+    uint32_t seed;          // Of the consumer (the producer derives its own)
+    uint32_t mismatches;    // Characters not in sequence
+    uint32_t first_bad;     // Position of the first one
+    uint32_t bad_spaces;    // ring_space() more than the size (producer)
+    uint32_t bad_counts;    // ring_count() more than the size (consumer)
+};
+
+//=============================================================================
+//                  Private (static) function declarations
+//=============================================================================
+static char test_data(uint32_t pos);
+static uint32_t test_rand(uint32_t* state);
+static void test_basic(void);
+static void test_spans(void);
+static void* test_producer(void* arg);
+static void* test_consumer(void* arg);
+static void test_threads(uint32_t size, uint32_t seed);
+
+//=============================================================================
+//                        Public (global) functions
+//=============================================================================
+int main(void)
+{
+    test_basic();
+    test_spans();
+
+    test_threads(2, 1);
+    test_threads(16, 2);
+    test_threads(64, 3);
+    test_threads(TEST_MAX_RING_SIZE, 4);
+
+    return TEST_END();
+}
+
+//=============================================================================
+//                       Private (static) functions
+//=============================================================================
+/**
+ * @brief Get the character at a position of the sequence.
+ */
+static char test_data(uint32_t pos)
+{
+    return (char)(pos + pos / 251);
+}
+
+
+/**
+ * @brief Get a pseudo-random number (xorshift32).
+ *
+ * @param[in,out] state Generator state, not 0.
+ */
+static uint32_t test_rand(uint32_t* state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return x;
+}
+
+
+/**
+ * @brief Check ring_init(), and the count and space, with one thread.
+ */
+static void test_basic(void)
+{
+    struct ring ring;
+    char buf[8];
+    char data[16];
+    char c;
+
+    TEST_CHECK_EQ(ring_init(NULL, buf, sizeof(buf)), SHELL_ERR_ARG);
+    TEST_CHECK_EQ(ring_init(&ring, NULL, sizeof(buf)), SHELL_ERR_ARG);
+    TEST_CHECK_EQ(ring_init(&ring, buf, 0), SHELL_ERR_ARG);
+    TEST_CHECK_EQ(ring_init(&ring, buf, 6), SHELL_ERR_ARG);
+    TEST_CHECK_EQ(ring_init(&ring, buf, sizeof(buf)), 0);
+
+    // Empty
+    TEST_CHECK_EQ(ring_count(&ring), 0);
+    TEST_CHECK_EQ(ring_space(&ring), 8);
+    TEST_CHECK_EQ(ring_getc(&ring, &c), 0);
+    TEST_CHECK_EQ(ring_read(&ring, data, sizeof(data)), 0);
+
+    // Full: the whole buffer is used
+    TEST_CHECK_EQ(ring_write(&ring, "0123456789", 10), 8);
+    TEST_CHECK_EQ(ring_count(&ring), 8);
+    TEST_CHECK_EQ(ring_space(&ring), 0);
+    TEST_CHECK_EQ(ring_putc(&ring, 'x'), 0);
+
+    // Wrapped: "567" at the end of the buffer, "89a" at the start
+    TEST_CHECK_EQ(ring_read(&ring, data, 5), 5);
+    TEST_CHECK(memcmp(data, "01234", 5) == 0);
+    TEST_CHECK_EQ(ring_write(&ring, "89", 2), 2);
+    TEST_CHECK_EQ(ring_putc(&ring, 'a'), 1);
+    TEST_CHECK_EQ(ring_count(&ring), 6);
+    TEST_CHECK_EQ(ring_space(&ring), 2);
+    TEST_CHECK_EQ(ring_read(&ring, data, sizeof(data)), 6);
+    TEST_CHECK(memcmp(data, "56789a", 6) == 0);
+    TEST_CHECK_EQ(ring_count(&ring), 0);
+    TEST_CHECK_EQ(ring_space(&ring), 8);
+}
+
+
+/**
+ * @brief Check the spans at the end of the buffer, with one thread.
+ */
+static void test_spans(void)
+{
+    struct ring ring;
+    char buf[8];
+    char* ptr;
+    char c;
+
+    TEST_CHECK_EQ(ring_init(&ring, buf, sizeof(buf)), 0);
+
+    // Put span: all of the empty ring
+    TEST_CHECK_EQ(ring_put_span(&ring, &ptr), 8);
+    TEST_CHECK(ptr == buf);
+    memcpy(ptr, "abcdef", 6);
+    ring_put_commit(&ring, 6);
+
+    // Get span: the data, then nothing
+    TEST_CHECK_EQ(ring_get_span(&ring, &ptr), 6);
+    TEST_CHECK(ptr == buf && memcmp(ptr, "abcdef", 6) == 0);
+    ring_get_commit(&ring, 6);
+    TEST_CHECK_EQ(ring_get_span(&ring, &ptr), 0);
+
+    // Put span at the wrap: up to the end of the buffer, then from its start
+    TEST_CHECK_EQ(ring_put_span(&ring, &ptr), 2);
+    TEST_CHECK(ptr == buf + 6);
+    memcpy(ptr, "gh", 2);
+    ring_put_commit(&ring, 2);
+    TEST_CHECK_EQ(ring_put_span(&ring, &ptr), 6);
+    TEST_CHECK(ptr == buf);
+    memcpy(ptr, "ij", 2);
+    ring_put_commit(&ring, 2);
+
+    // Get span at the wrap
+    TEST_CHECK_EQ(ring_get_span(&ring, &ptr), 2);
+    TEST_CHECK(ptr == buf + 6 && memcmp(ptr, "gh", 2) == 0);
+    ring_get_commit(&ring, 1);
+    TEST_CHECK_EQ(ring_getc(&ring, &c), 1);
+    TEST_CHECK_EQ(c, 'h');
+    TEST_CHECK_EQ(ring_get_span(&ring, &ptr), 2);
+    TEST_CHECK(ptr == buf && memcmp(ptr, "ij", 2) == 0);
+    ring_get_commit(&ring, 2);
+    TEST_CHECK_EQ(ring_count(&ring), 0);
+}
+
+
+/**
+ * @brief Producer thread: put the sequence in the ring.
+ */
+static void* test_producer(void* arg)
+{
+    struct test_spsc* test = arg;
+    uint32_t seed = test->seed * 2654435761U;
+    char data[TEST_MAX_CHUNK];
+    uint32_t pos = 0;
+    uint32_t len;
+    uint32_t num;
+    char* ptr;
+
+    while (pos < TEST_NUM_CHARS) {
+        len = test_rand(&seed) % TEST_MAX_CHUNK + 1;
+        if (len > TEST_NUM_CHARS - pos)
+            len = TEST_NUM_CHARS - pos;
+        if (ring_space(&test->ring) > test->size)
+            test->bad_spaces++;
+
+        switch (test_rand(&seed) % 3) {
+        case 0:
+            num = 0;
+            while (num < len && ring_putc(&test->ring, test_data(pos + num)))
+                num++;
+            break;
+        case 1:
+            for (num = 0; num < len; num++)
+                data[num] = test_data(pos + num);
+            num = ring_write(&test->ring, data, len);
+            break;
+        default:
+            num = ring_put_span(&test->ring, &ptr);
+            if (num > len)
+                num = len;
+            for (uint32_t idx = 0; idx < num; idx++)
+                ptr[idx] = test_data(pos + idx);
+            ring_put_commit(&test->ring, num);
+            break;
+        }
+
+        pos += num;
+        if (num < len)
+            sched_yield();  // Full
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief Consumer thread: get the sequence from the ring, and check it.
+ */
+static void* test_consumer(void* arg)
+{
+    struct test_spsc* test = arg;
+    uint32_t seed = test->seed;
+    char data[TEST_MAX_CHUNK];
+    uint32_t pos = 0;
+    uint32_t len;
+    uint32_t num;
+    char* ptr;
+
+    while (pos < TEST_NUM_CHARS) {
+        len = test_rand(&seed) % TEST_MAX_CHUNK + 1;
+        if (ring_count(&test->ring) > test->size)
+            test->bad_counts++;
+
+        switch (test_rand(&seed) % 3) {
+        case 0:
+            num = 0;
+            while (num < len && ring_getc(&test->ring, &data[num]))
+                num++;
+            break;
+        case 1:
+            num = ring_read(&test->ring, data, len);
+            break;
+        default:
+            num = ring_get_span(&test->ring, &ptr);
+            if (num > len)
+                num = len;
+            memcpy(data, ptr, num);
+            ring_get_commit(&test->ring, num);
+            break;
+        }
+
+        for (uint32_t idx = 0; idx < num; idx++) {
+            if (data[idx] != test_data(pos + idx) &&
+                test->mismatches++ == 0)
+                test->first_bad = pos + idx;
+        }
+
+        pos += num;
+        if (num == 0)
+            sched_yield();  // Empty
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief Pass the sequence through a ring, from a producer to a consumer
+ *        thread.
+ *
+ * @param[in] size Size of the ring.
+ * @param[in] seed Seed of the random lengths and functions.
+ */
+static void test_threads(uint32_t size, uint32_t seed)
+{
+    static struct test_spsc test;
+    pthread_t producer;
+    pthread_t consumer;
+    uint32_t idx;
+
+    memset(&test, 0, sizeof(test));
+    memset(test.buf, TEST_GUARD, sizeof(test.buf));
+    test.size = size;
+    test.seed = seed;
+    TEST_CHECK_EQ(ring_init(&test.ring, test.buf, size), 0);
+
+    TEST_CHECK_EQ(pthread_create(&consumer, NULL, test_consumer, &test), 0);
+    TEST_CHECK_EQ(pthread_create(&producer, NULL, test_producer, &test), 0);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+
+    TEST_CHECK_EQ(test.mismatches, 0);
+    if (test.mismatches != 0)
+        fprintf(stderr, "ring size %u: first mismatch at %u\n",
+                (unsigned)size, (unsigned)test.first_bad);
+    TEST_CHECK_EQ(test.bad_spaces, 0);
+    TEST_CHECK_EQ(test.bad_counts, 0);
+    TEST_CHECK_EQ(ring_count(&test.ring), 0);
+
+    for (idx = size; idx < sizeof(test.buf); idx++) {
+        if (test.buf[idx] != TEST_GUARD)
+            break;
+    }
+    TEST_CHECK_EQ(idx, sizeof(test.buf));
+}
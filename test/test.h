@@ -0,0 +1,87 @@
+#ifndef _SHELL_TEST_H_
+#define _SHELL_TEST_H_
+
+/**
+ * @brief Checks of the host tests (test directory).
+ *
+ * Each test is a program built with the POSIX port (see its file for the
+ * build command), which exits with 0 if all its checks passed, else 1. A
+ * failed check is reported on stderr with its location, and the test goes
+ * on. tools/run_tests.py builds and runs all the tests.
+ *
+ * The console is on the "none" device (TEST_INIT()), so the output of the
+ * shell is discarded.
+ *
+ * Example:
+ *
+ *     int main(void)
+ *     {
+ *         TEST_INIT();
+ *         TEST_CHECK(num_parse_uint("1", &val) == 0);
+ *         TEST_CHECK_EQ(val, 1);
+ *         return TEST_END();
+ *     }
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//=============================================================================
+//                           Macro Definitions
+//=============================================================================
+/**
+ * Initialize the shell for a test, with the console output discarded
+ */
+#define TEST_INIT()                                                           \
+    do {                                                                      \
+        setenv("TTYS_UART1", "none", 1);                                      \
+        if (shell_init(TTYS_INSTANCE_UART1) != 0) {                           \
+            fprintf(stderr, "%s: shell init failed\n", __FILE__);             \
+            exit(1);                                                          \
+        }                                                                     \
+    } while (0)
+
+/**
+ * Check a condition
+ */
+#define TEST_CHECK(cond)                                                      \
+    do {                                                                      \
+        test_checks++;                                                        \
+        if (!(cond)) {                                                        \
+            test_failures++;                                                  \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,  \
+                    #cond);                                                   \
+        }                                                                     \
+    } while (0)
+
+/**
+ * Check that two integers are equal, and print them if not
+ */
+#define TEST_CHECK_EQ(actual, expected)                                       \
+    do {                                                                      \
+        long long test_a_ = (long long)(actual);                              \
+        long long test_e_ = (long long)(expected);                            \
+        test_checks++;                                                        \
+        if (test_a_ != test_e_) {                                             \
+            test_failures++;                                                  \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__,   \
+                    __LINE__, #actual, test_a_, test_e_);                     \
+        }                                                                     \
+    } while (0)
+
+/**
+ * Print the result of the test, and get the exit status of the program
+ */
+#define TEST_END()                                                            \
+    (fprintf(stderr, "%s: %lu checks, %lu failed\n", __FILE__,                \
+             test_checks, test_failures),                                     \
+     test_failures == 0 ? 0 : 1)
+
+//=============================================================================
+//                         Private (static) variables
+//=============================================================================
+// Number of checks, and of failed checks (one test program per file).
+static unsigned long test_checks;
+static unsigned long test_failures;
+
+#endif /* _SHELL_TEST_H_ */
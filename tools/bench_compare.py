@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""Compare two shell benchmark result files.
+
+Results of bench/shell_bench.c are matched by name and parameters, and the
+change of each timing is printed. The exit status is 1 if any timing got
+slower than the threshold.
+
+    shell_bench > base.json
+    (change, rebuild)
+    shell_bench > new.json
+    bench_compare.py base.json new.json --threshold 10
+"""
+
+import argparse
+import json
+import sys
+
+# Result fields holding timings (lower is better); the others identify it
+TIMINGS = ("ns_per_op", "p50_ns", "p90_ns", "p99_ns", "max_ns")
+# Result fields neither identifying a result nor compared
+IGNORED = ("ops_per_s", "samples")
+
+
+def key(result):
+    """Identify a result by its name and parameters."""
+    return tuple(sorted((k, str(v)) for k, v in result.items()
+                        if k not in TIMINGS and k not in IGNORED))
+
+
+def label(result):
+    """Short description of a result."""
+    params = ", ".join("%s=%s" % (k, v) for k, v in result.items()
+                       if k != "name" and k not in TIMINGS
+                       and k not in IGNORED)
+    return "%s(%s)" % (result["name"], params)
+
+
+def load(path):
+    """Load a result file, indexed by result key."""
+    with open(path) as f:
+        return {key(r): r for r in json.load(f)["results"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("base", help="baseline result file")
+    parser.add_argument("new", help="new result file")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="regression threshold in percent (default 10)")
+    parser.add_argument("--max", action="store_true",
+                        help="also compare max_ns, which is noisy")
+    args = parser.parse_args()
+
+    base = load(args.base)
+    new = load(args.new)
+    regressions = 0
+
+    print("%-60s %-9s %10s %10s %8s" % ("benchmark", "timing", "base", "new",
+                                        "change"))
+    for k, result in new.items():
+        old = base.get(k)
+        if old is None:
+            print("%-60s (new)" % label(result))
+            continue
+        for timing in TIMINGS:
+            if timing not in result or timing not in old:
+                continue
+            if timing == "max_ns" and not args.max:
+                continue
+            change = ((result[timing] - old[timing]) * 100.0 / old[timing]
+                      if old[timing] else 0.0)
+            flag = ""
+            if change > args.threshold:
+                flag = " <- slower"
+                regressions += 1
+            print("%-60s %-9s %10.1f %10.1f %+7.1f%%%s"
+                  % (label(result), timing, old[timing], result[timing],
+                     change, flag))
+
+    for k, result in base.items():
+        if k not in new:
+            print("%-60s (removed)" % label(result))
+
+    if regressions:
+        print("%d timing(s) slower than %.1f%%" % (regressions,
+                                                  args.threshold))
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
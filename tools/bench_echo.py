@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Time command round trips to the shell with "bench echo".
+
+Each "bench echo <seq>" command is sent once the reply to the previous one
+has been received, and the round trip times are reported. The replies carry
+the shell's cycle counter, which is checked against the host clock over the
+run (a large difference means a wrong cycles/s value, e.g. a clock setup
+issue).
+
+    bench_echo.py /dev/ttyACM0
+    bench_echo.py --baud 921600 --count 1000 /dev/ttyACM0
+
+The shell must be built with SHELL_BENCH_ENABLED=1. Requires pyserial.
+"""
+
+import argparse
+import re
+import sys
+import time
+
+import serial
+
+
+def percentile(values, p):
+    """Get the p-th percentile of sorted values."""
+    return values[min(len(values) - 1, len(values) * p // 100)]
+
+
+def echo(port, seq, timeout):
+    """Send "bench echo seq", return the shell's cycles and cycles/s."""
+    port.write(b"bench echo %d\r" % seq)
+    pattern = re.compile(rb"echo %d (\d+) (\d+)\r?\n" % seq)
+    deadline = time.monotonic() + timeout
+    reply = b""
+    while time.monotonic() < deadline:
+        reply += port.read(port.in_waiting or 1)
+        match = pattern.search(reply)
+        if match:
+            return int(match.group(1)), int(match.group(2))
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="serial port of the console")
+    parser.add_argument("--baud", type=int, default=115200,
+                        help="baud rate (default: %(default)s)")
+    parser.add_argument("--count", type=int, default=200,
+                        help="number of round trips (default: %(default)s)")
+    args = parser.parse_args()
+
+    port = serial.Serial(args.port, args.baud, timeout=0.05)
+    port.reset_input_buffer()
+
+    round_trips = []
+    shell_time = 0.0
+    first = last = None
+    for seq in range(args.count):
+        start = time.monotonic()
+        reply = echo(port, seq, 1.0)
+        end = time.monotonic()
+        if reply is None:
+            sys.exit("no reply to bench echo %d" % seq)
+        round_trips.append(end - start)
+        cycles, hz = reply
+        if last is None:
+            first = start
+        else:
+            # The cycle counter wraps around at 32 bits
+            shell_time += ((cycles - last) & 0xffffffff) / hz
+        last = cycles
+
+    round_trips.sort()
+    print("round trip (us): min %.0f, p50 %.0f, p90 %.0f, p99 %.0f, max %.0f"
+          % tuple(v * 1e6 for v in (round_trips[0],
+                                    percentile(round_trips, 50),
+                                    percentile(round_trips, 90),
+                                    percentile(round_trips, 99),
+                                    round_trips[-1])))
+    if shell_time > 0:
+        print("shell clock: %+.0f ppm from host"
+              % ((shell_time / (start - first) - 1) * 1e6))
+
+
+if __name__ == "__main__":
+    main()
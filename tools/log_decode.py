@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+"""Decode the binary log frames of the shell (LOG_MODE_BINARY).
+
+The console output is copied to stdout, with each log frame replaced by its
+message, formatted on the host from the format string and the string
+arguments found in the ELF file of the application:
+
+    log_decode.py app.elf /dev/ttyACM0
+    log_decode.py --baud 921600 app.elf /dev/ttyACM0
+    ./shell_posix | log_decode.py shell_posix -
+
+A frame is LOG_FRAME_SYNC (0x1e), the number of arguments, the time in
+microseconds (8 bytes), then the address of the format string and the
+arguments, as words of 4 bytes (32-bit ELF file) or 8 bytes (64-bit), all
+little-endian. The messages are printed with their time, as on the device.
+Reading a serial port requires pyserial.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+FRAME_SYNC = 0x1e
+MAX_ARGS = 8
+TIME_SIZE = 8
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+# printf conversion: flags, width, precision, length modifier, conversion.
+CONV_RE = re.compile(rb"%([-+ #0]*)(\d*|\*)(?:\.(\d*|\*))?(hh|h|ll|l|j|z|t)?"
+                     rb"([diouxXcspn%])")
+
+
+class Elf:
+    """Loaded sections of an ELF file, to read strings at their address."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF" or data[5] != 1:
+            sys.exit("%s: not a little-endian ELF file" % path)
+        self.word_size = 8 if data[4] == 2 else 4
+        if self.word_size == 8:
+            shoff, = struct.unpack_from("<Q", data, 0x28)
+            shentsize, shnum = struct.unpack_from("<HH", data, 0x3a)
+            shdr = "<IIQQQQIIQQ"
+        else:
+            shoff, = struct.unpack_from("<I", data, 0x20)
+            shentsize, shnum = struct.unpack_from("<HH", data, 0x2e)
+            shdr = "<IIIIIIIIII"
+        self.sections = []
+        for idx in range(shnum):
+            (_, sh_type, flags, addr, offset, size,
+             *_) = struct.unpack_from(shdr, data, shoff + idx * shentsize)
+            if flags & SHF_ALLOC and sh_type != SHT_NOBITS and size > 0:
+                self.sections.append((addr, data[offset:offset + size]))
+
+    def string(self, addr):
+        """Get the null terminated string at addr, or None if not found."""
+        for start, content in self.sections:
+            if start <= addr < start + len(content):
+                end = content.find(b"\0", addr - start)
+                return content[addr - start:end if end >= 0 else None]
+        return None
+
+
+def format_message(elf, fmt, args):
+    """Format a message like printf(), with the arguments as words."""
+    bits = elf.word_size * 8
+    out = b""
+    pos = 0
+    args = list(args)
+    for match in CONV_RE.finditer(fmt):
+        out += fmt[pos:match.start()]
+        pos = match.end()
+        flags, width, prec, length, conv = match.groups()
+        if conv == b"%":
+            out += b"%"
+            continue
+        spec = b"%" + flags
+        for part, prefix in ((width, b""), (prec, b".")):
+            if part == b"*":
+                part = b"%d" % (args.pop(0) if args else 0)
+            if part is not None:
+                spec += prefix + part
+        value = args.pop(0) if args else 0
+
+        # Integers are truncated to their size, as printf() does.
+        size = {b"hh": 8, b"h": 16, b"l": bits, b"ll": 64, b"j": 64,
+                b"z": bits, b"t": bits}.get(length, 32)
+        value &= (1 << size) - 1
+        if conv in b"di" and value >= 1 << (size - 1):
+            value -= 1 << size
+
+        if conv in b"diu":
+            out += (spec + b"d") % value
+        elif conv in b"oxX":
+            out += (spec + conv) % value
+        elif conv == b"c":
+            out += (spec + b"c") % (value & 0xff)
+        elif conv == b"p":
+            out += (spec + b"s") % (b"0x%x" % value)
+        elif conv == b"s":
+            string = elf.string(value)
+            if string is None:
+                string = b"<string at 0x%x>" % value
+            out += (spec + b"s") % string
+    return out + fmt[pos:]
+
+
+def decode(elf, data, out):
+    """Write data with its frames decoded, return the unprocessed end."""
+    word = elf.word_size
+    while True:
+        sync = data.find(bytes([FRAME_SYNC]))
+        if sync < 0:
+            out.write(data)
+            return b""
+        out.write(data[:sync])
+        data = data[sync:]
+        if len(data) < 2:
+            return data
+        num_args = data[1]
+        if num_args > MAX_ARGS:
+            # Not a frame (e.g. after a lost byte).
+            out.write(data[:1])
+            data = data[1:]
+            continue
+        start = 2 + TIME_SIZE
+        size = start + (1 + num_args) * word
+        if len(data) < size:
+            return data
+        us = int.from_bytes(data[2:start], "little")
+        words = [int.from_bytes(data[start + idx * word:
+                                     start + (idx + 1) * word], "little")
+                 for idx in range(1 + num_args)]
+        out.write(b"%d.%06d " % (us // 1000000, us % 1000000))
+        fmt = elf.string(words[0])
+        if fmt is None:
+            out.write(b"<log frame with unknown format 0x%x>\r\n" % words[0])
+        else:
+            out.write(format_message(elf, fmt, words[1:]).replace(b"\n",
+                                                                  b"\r\n"))
+        data = data[size:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="ELF file of the application")
+    parser.add_argument("input", help="serial port, file, or - for stdin")
+    parser.add_argument("--baud", type=int, default=115200,
+                        help="baud rate of a serial port "
+                             "(default: %(default)s)")
+    args = parser.parse_args()
+
+    elf = Elf(args.elf)
+    port = None
+    if args.input == "-":
+        stream = sys.stdin.buffer
+    elif args.input.startswith("/dev/"):
+        import serial
+        port = serial.Serial(args.input, args.baud, timeout=0.1)
+    else:
+        stream = open(args.input, "rb")
+
+    out = sys.stdout.buffer
+    pending = b""
+    try:
+        while True:
+            if port is not None:
+                chunk = port.read(port.in_waiting or 1)
+            else:
+                chunk = stream.read1(4096)
+                if not chunk:
+                    break
+            pending = decode(elf, pending + chunk, out)
+            out.flush()
+    except KeyboardInterrupt:
+        pass
+    out.write(pending)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Build and run the host tests.
+
+Each test (test/*.c) is built with the POSIX port and its own build flags
+(once per configuration it is run in), then run. The output of the failed
+checks is shown, and the exit status is 1 if a test failed to build or run.
+
+    run_tests.py
+    run_tests.py num_test ring_test
+
+Run from anywhere; the repository is found from this script's location.
+Requires gcc.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# Test name: extra build flags of each configuration
+TESTS = {
+    "cmd_trie_test": [
+        ["-DCMD_TRIE_SIZE=64"],
+        ["-DCMD_TRIE_SIZE=64", "-DCMD_HASH_SIZE=512"],
+        ["-DCMD_TRIE_SIZE=0", "-DCMD_HASH_SIZE=0"],
+    ],
+    "num_test": [[]],
+    "ring_test": [[]],
+}
+
+
+def sources():
+    """Source files of the shell."""
+    files = []
+    for d in ("shell", os.path.join("shell", "port")):
+        files += sorted(os.path.join(ROOT, d, f)
+                        for f in os.listdir(os.path.join(ROOT, d))
+                        if f.endswith(".c"))
+    return files
+
+
+def build(name, flags, exe):
+    """Build a test, return True if it built."""
+    cmd = ["gcc", "-O2", "-Wall", "-Werror=format", "-DSHELL_PORT_POSIX",
+           "-I" + os.path.join(ROOT, "shell", "include"),
+           "-I" + os.path.join(ROOT, "test")] + flags
+    cmd += sources() + [os.path.join(ROOT, "test", name + ".c"), "-lpthread",
+                        "-o", exe]
+    return subprocess.run(cmd).returncode == 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("tests", nargs="*", default=sorted(TESTS),
+                        help="tests to run (default: all)")
+    args = parser.parse_args()
+
+    runs = 0
+    failed = []
+    with tempfile.TemporaryDirectory() as tmp:
+        for name in args.tests:
+            if name not in TESTS:
+                sys.exit("unknown test: %s" % name)
+            for flags in TESTS[name]:
+                runs += 1
+                label = " ".join([name] + flags)
+                exe = os.path.join(tmp, name)
+                if not build(name, flags, exe):
+                    failed.append(label)
+                    continue
+                if subprocess.run([exe],
+                                  stdout=subprocess.DEVNULL).returncode:
+                    failed.append(label)
+
+    print("%d tests, %d failed%s" % (runs, len(failed),
+                                     ": " + ", ".join(failed) if failed
+                                     else ""))
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
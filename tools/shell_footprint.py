@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""Report the RAM/flash footprint of the shell from GNU ld map files.
+
+Link the application with -Wl,-Map=<file>.map, once per configuration to
+compare (e.g. with different TTYS_xxx_ENABLED and buffer size settings), and
+pass the map files to this script:
+
+    shell_footprint.py all_uarts.map uart1_only.map
+
+For each shell object file, the sizes of its code (.text), read-only data
+(.rodata), initialized data (.data) and zero-initialized data (.bss, COMMON)
+input sections are added up. Flash is text + rodata + data, RAM is
+data + bss. Sections discarded by --gc-sections are not counted.
+
+With several map files, one flash/RAM column pair is printed per map file.
+"""
+
+import argparse
+import collections
+import os
+import re
+import sys
+
+# Input section line: " .text.name  0x08001234  0x1a0 path/to/file.o". Long
+# section names put the address, size and file on the next line.
+SECTION_RE = re.compile(r"^ (\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+))?$")
+CONT_RE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+)$")
+
+KINDS = ("text", "rodata", "data", "bss")
+
+
+def section_kind(name):
+    """Classify an input section name, or return None if not counted."""
+    if name.startswith(".text"):
+        return "text"
+    if name.startswith(".rodata") or name.startswith(".shell_clients"):
+        return "rodata"
+    if name.startswith(".data"):
+        return "data"
+    if name.startswith(".bss") or name == "COMMON":
+        return "bss"
+    return None
+
+
+def object_name(path):
+    """Short object name: "ttys.o", or "ttys.o" for "libshell.a(ttys.o)"."""
+    path = path.strip()
+    m = re.search(r"\(([^)]+)\)$", path)
+    if m:
+        return m.group(1)
+    return os.path.basename(path)
+
+
+def parse_map(path, obj_filter):
+    """Return {object: {kind: bytes}} for the objects matching obj_filter."""
+    sizes = collections.defaultdict(lambda: dict.fromkeys(KINDS, 0))
+    in_map = False
+    pending = None
+
+    with open(path, errors="replace") as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if not in_map:
+                in_map = line.startswith("Linker script and memory map")
+                continue
+
+            if pending is not None:
+                m = CONT_RE.match(line)
+                name, pending = pending, None
+                if m:
+                    add(sizes, obj_filter, name, int(m.group(2), 16), m.group(3))
+                    continue
+
+            m = SECTION_RE.match(line)
+            if not m:
+                continue
+            if m.group(2) is None:
+                pending = m.group(1)
+            else:
+                add(sizes, obj_filter, m.group(1), int(m.group(3), 16), m.group(4))
+
+    return sizes
+
+
+def add(sizes, obj_filter, section, size, path):
+    kind = section_kind(section)
+    if kind is None or size == 0 or not obj_filter.search(path):
+        return
+    sizes[object_name(path)][kind] += size
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("maps", nargs="+", help="GNU ld map files")
+    parser.add_argument("--filter", default=r"(^|[/\\(])shell[/\\]|libshell",
+                        help="regex selecting the shell object files "
+                             "(default: %(default)s)")
+    parser.add_argument("--detail", action="store_true",
+                        help="also print text/rodata/data/bss per object")
+    args = parser.parse_args()
+
+    obj_filter = re.compile(args.filter)
+    reports = [parse_map(path, obj_filter) for path in args.maps]
+    objects = sorted(set().union(*reports))
+    if not objects:
+        sys.exit("no object files match --filter %r" % args.filter)
+
+    names = [os.path.splitext(os.path.basename(p))[0] for p in args.maps]
+    width = max(len(o) for o in objects + ["total"])
+
+    header = "%-*s" % (width, "object")
+    for name in names:
+        header += "  %10s %10s" % ((name + " flash")[-10:], "RAM")
+    print(header)
+
+    totals = [dict.fromkeys(KINDS, 0) for _ in reports]
+    for obj in objects:
+        row = "%-*s" % (width, obj)
+        for report, total in zip(reports, totals):
+            s = report.get(obj, dict.fromkeys(KINDS, 0))
+            for kind in KINDS:
+                total[kind] += s[kind]
+            row += "  %10d %10d" % (s["text"] + s["rodata"] + s["data"],
+                                    s["data"] + s["bss"])
+        print(row)
+        if args.detail:
+            for report in reports:
+                s = report.get(obj, dict.fromkeys(KINDS, 0))
+                print("%-*s    text %d, rodata %d, data %d, bss %d"
+                      % (width, "", s["text"], s["rodata"], s["data"], s["bss"]))
+
+    row = "%-*s" % (width, "total")
+    for t in totals:
+        row += "  %10d %10d" % (t["text"] + t["rodata"] + t["data"],
+                                t["data"] + t["bss"])
+    print(row)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""Negotiate a higher console baud rate with the shell.
+
+The shell is asked to switch tentatively ("ttys baud <rate> <timeout-ms>").
+After its reply, the host switches too and confirms ("ttys baud confirm") at
+the new rate. If the confirmation is not answered, the link doesn't work at
+the new rate: the shell falls back to the current rate after the timeout, and
+so does this script.
+
+    ttys_baud.py /dev/ttyACM0 921600
+    ttys_baud.py --baud 921600 /dev/ttyACM0 115200
+
+Requires pyserial. The port is left at the final rate, so a terminal program
+can be started afterwards with that rate.
+"""
+
+import argparse
+import sys
+import time
+
+import serial
+
+
+def command(port, line, expect, timeout):
+    """Send a command line, return True if a reply line contains expect."""
+    port.reset_input_buffer()
+    port.write(line.encode() + b"\r\n")
+    deadline = time.monotonic() + timeout
+    reply = b""
+    while time.monotonic() < deadline:
+        reply += port.read(port.in_waiting or 1)
+        if expect.encode() in reply:
+            return True
+    return False
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="serial port of the console")
+    parser.add_argument("rate", type=int, help="baud rate to switch to")
+    parser.add_argument("--baud", type=int, default=115200,
+                        help="current baud rate (default: %(default)s)")
+    parser.add_argument("--timeout", type=int, default=1000,
+                        help="confirmation timeout in ms (default: %(default)s)")
+    args = parser.parse_args()
+
+    port = serial.Serial(args.port, args.baud, timeout=0.05)
+
+    if not command(port, "ttys baud %d %d" % (args.rate, args.timeout),
+                   "Switching to", 1.0):
+        sys.exit("no reply at %d baud" % args.baud)
+
+    # The shell drains its reply before switching.
+    time.sleep(0.05)
+    port.baudrate = args.rate
+    if command(port, "ttys baud confirm", "confirmed", args.timeout / 2000):
+        print("switched to %d baud" % args.rate)
+        return
+
+    port.baudrate = args.baud
+    time.sleep(args.timeout / 1000)
+    sys.exit("no confirmation at %d baud, back to %d" % (args.rate, args.baud))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""Run the ttys simulation over a range of buffer sizes.
+
+The simulation (sim/ttys_sim.c) is built once per RX/TX buffer size pair, as
+the sizes are set at build time, and run with the given options. Its JSON
+results are printed as a table, or as JSON lines with --json.
+
+    ttys_sim_sweep.py --rx 64 128 256 --tx 256 1024 -- -b 921600
+    ttys_sim_sweep.py --json -- -s rx-limit -r > results.jsonl
+
+Run from anywhere; the repository is found from this script's location.
+Requires gcc.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# Table columns: result name, header, width (negative to left align)
+COLUMNS = [
+    ("scenario", "scenario", -8), ("rx_buf_size", "rx_buf", 6),
+    ("tx_buf_size", "tx_buf", 6), ("baud", "baud", 8),
+    ("poll_us", "poll_us", 8), ("bytes_per_s", "bytes/s", 8),
+    ("rx_lost", "lost", 6), ("rx_ring_drops", "drops", 6),
+    ("irqs_per_byte", "irq/B", 6),
+]
+
+
+def row(values):
+    """Format a table row."""
+    return " ".join("%*s" % (width, value)
+                    for (_, _, width), value in zip(COLUMNS, values))
+
+
+def build(rx_size, tx_size, exe):
+    """Build the simulation with the given buffer sizes."""
+    sources = []
+    for d in ("shell", os.path.join("shell", "port")):
+        sources += sorted(os.path.join(ROOT, d, f)
+                          for f in os.listdir(os.path.join(ROOT, d))
+                          if f.endswith(".c"))
+    cmd = ["gcc", "-O2", "-DSHELL_PORT_SIM",
+           "-DTTYS_UART1_RX_BUF_SIZE=%d" % rx_size,
+           "-DTTYS_UART1_TX_BUF_SIZE=%d" % tx_size,
+           "-I" + os.path.join(ROOT, "shell", "include")]
+    cmd += sources + [os.path.join(ROOT, "sim", "ttys_sim.c"), "-o", exe]
+    subprocess.run(cmd, check=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--rx", type=int, nargs="+", default=[64, 128, 256],
+                        help="RX buffer sizes (powers of 2)")
+    parser.add_argument("--tx", type=int, nargs="+", default=[1024],
+                        help="TX buffer sizes (powers of 2)")
+    parser.add_argument("--json", action="store_true",
+                        help="print the results as JSON lines")
+    parser.add_argument("sim_args", nargs="*",
+                        help="options of ttys_sim (after --)")
+    args = parser.parse_args()
+
+    if not args.json:
+        print(row(head for _, head, _ in COLUMNS))
+
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = os.path.join(tmp, "ttys_sim")
+        for rx_size in args.rx:
+            for tx_size in args.tx:
+                build(rx_size, tx_size, exe)
+                out = subprocess.run([exe] + args.sim_args, check=True,
+                                     stdout=subprocess.PIPE, text=True).stdout
+                for line in out.splitlines():
+                    if args.json:
+                        print(line)
+                        continue
+                    result = json.loads(line)
+                    print(row(result[name] for name, _, _ in COLUMNS))
+                sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()